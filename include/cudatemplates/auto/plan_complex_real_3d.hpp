@@ -27,6 +27,7 @@
 #define CUFFT_COMPLEX_REAL_3D_H
 
 
+#include <cudatemplates/batch.hpp>
 #include <cudatemplates/cufft_common.hpp>
 #include <cudatemplates/devicememory.hpp>
 
@@ -49,8 +50,10 @@ public:
      @param size requested size of CUFFT plan
      
   */
-  inline Plan(const Size<3> &size)
+  inline Plan(const Size<3> &size):
+    count(1)
   {
+    init(size);
     CUFFT_CHECK(cufftPlan3d(&plan, size[0], size[1], size[2], CUFFT_C2R));
   }
 
@@ -60,11 +63,36 @@ public:
      @param size0, size1, size2 requested size of CUFFT plan
      
   */
-  inline Plan(size_t size0, size_t size1, size_t size2)
+  inline Plan(size_t size0, size_t size1, size_t size2):
+    count(1)
   {
+    init(Size<3>(size0, size1, size2));
     CUFFT_CHECK(cufftPlan3d(&plan, size0, size1, size2, CUFFT_C2R));
   }
 
+  /**
+     Constructor.
+     The constructor creates a CUFFT plan for the items of a batch. The plan transforms one item at a time.
+     @param size requested size of CUFFT plan
+     @param data input or output batch, the size of its items must match the
+     size of the plan
+  */
+  template <class Type, class Storage>
+  inline Plan(const Size<3> &size, const Batch<Type, 3, Storage> &data):
+    count(1)
+  {
+    init(size);
+
+    if(data.getCount() == 0)
+      CUDA_ERROR("empty batch");
+
+    // input and output types only have the same size if both are complex:
+    if(elements(data) != ((sizeof(Type) == sizeof(complex)) ? ielements : oelements))
+      CUDA_ERROR("item size doesn't match plan");
+
+    CUFFT_CHECK(cufftPlan3d(&plan, size[0], size[1], size[2], CUFFT_C2R));
+  }
+
   /**
      Destructor.
      The destructor destroys the CUFFT plan.
@@ -91,9 +119,73 @@ public:
 
     CUFFT_CHECK(cufftExecC2R(plan, const_cast<complex *>(idata.getBuffer()), odata.getBuffer()));
   }
-  
+
+  /**
+     Executes the CUFFT plan for all items of a batch.
+     The number of items must be a multiple of the number of transforms the
+     plan was created for, each call to CUFFT processes this many items.
+     CUFFT expects the items of the input and output data of a single call
+     to be packed, so the number of elements per item must match the size of
+     the plan (n/2+1 complex input values in the last dimension).
+     @param idata input batch
+     @param odata output batch
+     
+  */
+  template <class Storage1, class Storage2>
+  inline void exec(const Batch<complex, 3, Storage1> &idata, Batch<real, 3, Storage2> &odata)
+  {
+    if((idata.getCount() != odata.getCount()) || (idata.getCount() % count != 0))
+      CUDA_ERROR("batch size doesn't match plan");
+
+    if((elements(idata) != ielements) || (elements(odata) != oelements))
+      CUDA_ERROR("item size doesn't match plan");
+
+    if(!(idata.contiguous() && odata.contiguous()))
+      CUDA_ERROR("CUFFT can only be used for contiguous memory (i.e., no padding between rows)");
+
+    for(size_t i = 0; i < idata.getCount(); i += count)
+      CUFFT_CHECK(cufftExecC2R(plan, const_cast<complex *>(idata.getItemBuffer(i)), odata.getItemBuffer(i)));
+  }
+
 private:
   cufftHandle plan;
+
+  /** number of items transformed by one execution of the plan */
+  size_t count;
+
+  /** number of input and output elements of a single transform */
+  size_t ielements, oelements;
+
+  /**
+     Compute number of input and output elements of a single transform.
+     CUFFT stores only the non-redundant half of the coefficients of real
+     data in the last dimension.
+  */
+  inline void init(const Size<3> &size)
+  {
+    size_t n = 1;
+
+    for(unsigned i = 0; i + 1 < Dim; ++i)
+      n *= size[i];
+
+    ielements = n * (size[Dim - 1] / 2 + 1);
+    oelements = n * size[Dim - 1];
+  }
+
+  /**
+     Get number of elements of each item of a batch.
+  */
+  template <class Type, class Storage>
+  static inline size_t elements(const Batch<Type, 3, Storage> &data)
+  {
+    Size<3> s = data.getSize();
+    size_t n = 1;
+
+    for(unsigned i = 0; i < Dim; ++i)
+      n *= s[i];
+
+    return n;
+  }
 };
 
 }  // namespace FFT
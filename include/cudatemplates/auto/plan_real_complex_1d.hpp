@@ -27,6 +27,7 @@
 #define CUFFT_REAL_COMPLEX_1D_H
 
 
+#include <cudatemplates/batch.hpp>
 #include <cudatemplates/cufft_common.hpp>
 #include <cudatemplates/devicememory.hpp>
 
@@ -49,8 +50,10 @@ public:
      @param size requested size of CUFFT plan
      @param batch number of 1D transforms
   */
-  inline Plan(const Size<1> &size, int batch = 1)
+  inline Plan(const Size<1> &size, int batch = 1):
+    count(batch)
   {
+    init(size);
     CUFFT_CHECK(cufftPlan1d(&plan, size[0], CUFFT_R2C, batch));
   }
 
@@ -60,11 +63,36 @@ public:
      @param size0 requested size of CUFFT plan
      @param batch number of 1D transforms
   */
-  inline Plan(size_t size0, int batch = 1)
+  inline Plan(size_t size0, int batch = 1):
+    count(batch)
   {
+    init(Size<1>(size0));
     CUFFT_CHECK(cufftPlan1d(&plan, size0, CUFFT_R2C, batch));
   }
 
+  /**
+     Constructor.
+     The constructor creates a CUFFT plan for the items of a batch. All items are transformed by one execution of the plan.
+     @param size requested size of CUFFT plan
+     @param data input or output batch, the size of its items must match the
+     size of the plan
+  */
+  template <class Type, class Storage>
+  inline Plan(const Size<1> &size, const Batch<Type, 1, Storage> &data):
+    count(data.getCount())
+  {
+    init(size);
+
+    if(data.getCount() == 0)
+      CUDA_ERROR("empty batch");
+
+    // input and output types only have the same size if both are complex:
+    if(elements(data) != ((sizeof(Type) == sizeof(real)) ? ielements : oelements))
+      CUDA_ERROR("item size doesn't match plan");
+
+    CUFFT_CHECK(cufftPlan1d(&plan, size[0], CUFFT_R2C, count));
+  }
+
   /**
      Destructor.
      The destructor destroys the CUFFT plan.
@@ -91,9 +119,73 @@ public:
 
     CUFFT_CHECK(cufftExecR2C(plan, const_cast<real *>(idata.getBuffer()), odata.getBuffer()));
   }
-  
+
+  /**
+     Executes the CUFFT plan for all items of a batch.
+     The number of items must be a multiple of the number of transforms the
+     plan was created for, each call to CUFFT processes this many items.
+     CUFFT expects the items of the input and output data of a single call
+     to be packed, so the number of elements per item must match the size of
+     the plan (n/2+1 complex output values in the last dimension).
+     @param idata input batch
+     @param odata output batch
+     
+  */
+  template <class Storage1, class Storage2>
+  inline void exec(const Batch<real, 1, Storage1> &idata, Batch<complex, 1, Storage2> &odata)
+  {
+    if((idata.getCount() != odata.getCount()) || (idata.getCount() % count != 0))
+      CUDA_ERROR("batch size doesn't match plan");
+
+    if((elements(idata) != ielements) || (elements(odata) != oelements))
+      CUDA_ERROR("item size doesn't match plan");
+
+    if(!(idata.contiguous() && odata.contiguous()))
+      CUDA_ERROR("CUFFT can only be used for contiguous memory (i.e., no padding between rows)");
+
+    for(size_t i = 0; i < idata.getCount(); i += count)
+      CUFFT_CHECK(cufftExecR2C(plan, const_cast<real *>(idata.getItemBuffer(i)), odata.getItemBuffer(i)));
+  }
+
 private:
   cufftHandle plan;
+
+  /** number of items transformed by one execution of the plan */
+  size_t count;
+
+  /** number of input and output elements of a single transform */
+  size_t ielements, oelements;
+
+  /**
+     Compute number of input and output elements of a single transform.
+     CUFFT stores only the non-redundant half of the coefficients of real
+     data in the last dimension.
+  */
+  inline void init(const Size<1> &size)
+  {
+    size_t n = 1;
+
+    for(unsigned i = 0; i + 1 < Dim; ++i)
+      n *= size[i];
+
+    ielements = n * size[Dim - 1];
+    oelements = n * (size[Dim - 1] / 2 + 1);
+  }
+
+  /**
+     Get number of elements of each item of a batch.
+  */
+  template <class Type, class Storage>
+  static inline size_t elements(const Batch<Type, 1, Storage> &data)
+  {
+    Size<1> s = data.getSize();
+    size_t n = 1;
+
+    for(unsigned i = 0; i < Dim; ++i)
+      n *= s[i];
+
+    return n;
+  }
 };
 
 }  // namespace FFT
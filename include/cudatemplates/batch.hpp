@@ -0,0 +1,284 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_BATCH_H
+#define CUDA_BATCH_H
+
+
+#include <vector>
+
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememory.hpp>
+#include <cudatemplates/devicememorypitched.hpp>
+#include <cudatemplates/error.hpp>
+#include <cudatemplates/hostmemory.hpp>
+#include <cudatemplates/view.hpp>
+
+
+namespace Cuda {
+
+/**
+   Container for a number of equally sized items.
+   All items are stored in a single allocation of the given storage type,
+   which has one more dimension than the items: item i is the slice with
+   index i in the last dimension. With the default storage
+   (DeviceMemoryPitched), each row is padded to the pitch chosen by the
+   driver, so every item starts at a properly aligned address.
+
+   The number of items can be changed without reallocation as long as it
+   doesn't exceed the capacity. If more items are requested, the capacity is
+   (at least) doubled and the existing items are copied to the new storage.
+   Slots which are no longer needed can be returned with release() and are
+   handed out again by acquire(), e.g., to recycle buffers from frame to
+   frame.
+*/
+template <class Type, unsigned Dim, class Storage = DeviceMemoryPitched<Type, Dim + 1> >
+class Batch
+{
+public:
+  /**
+     Constructor.
+     @param _size size of each item
+     @param _count initial number of items
+     @param _capacity initial capacity (at least _count)
+  */
+  Batch(const Size<Dim> &_size, size_t _count = 0, size_t _capacity = 0):
+    size(_size), count(0), capacity(0), storage(0)
+  {
+    reserve((_capacity > _count) ? _capacity : _count);
+    resize(_count);
+  }
+
+  /**
+     Destructor.
+  */
+  ~Batch()
+  {
+    delete storage;
+  }
+
+  /**
+     Make sure the storage can hold the given number of items.
+     The existing items are preserved.
+     @param n requested capacity
+  */
+  void reserve(size_t n)
+  {
+    if(n <= capacity)
+      return;
+
+    Storage *s = new Storage(stackSize(n));
+
+    if(count > 0) {
+      try {
+	copy(*s, *storage, Size<Dim + 1>(), Size<Dim + 1>(), stackSize(count));
+      }
+      catch(...) {
+	delete s;
+	throw;
+      }
+    }
+
+    delete storage;
+    storage = s;
+    capacity = n;
+  }
+
+  /**
+     Change the number of items.
+     Storage is only reallocated if the capacity is exceeded, the capacity
+     then grows geometrically. Released slots beyond the new number of items
+     are dropped from the free list.
+     @param n new number of items
+  */
+  void resize(size_t n)
+  {
+    if(n > capacity)
+      reserve((n > 2 * capacity) ? n : 2 * capacity);
+
+    if(n < count) {
+      std::vector<size_t> f;
+
+      for(size_t i = 0; i < released.size(); ++i)
+	if(released[i] < n)
+	  f.push_back(released[i]);
+
+      released.swap(f);
+    }
+
+    used.resize(n, true);
+    count = n;
+  }
+
+  /**
+     Get a free slot.
+     A previously released slot is reused if available, otherwise the batch
+     is grown by one item.
+     @return index of slot
+  */
+  size_t acquire()
+  {
+    if(!released.empty()) {
+      size_t i = released.back();
+      released.pop_back();
+      used[i] = true;
+      return i;
+    }
+
+    resize(count + 1);
+    return count - 1;
+  }
+
+  /**
+     Return slot to the free list.
+     The number of items doesn't change, the slot is handed out again by the
+     next call to acquire().
+     @param i index of slot
+  */
+  void release(size_t i)
+  {
+    if(i >= count)
+      CUDA_ERROR("out of bounds");
+
+    if(!used[i])
+      CUDA_ERROR("slot already released");
+
+    used[i] = false;
+    released.push_back(i);
+  }
+
+  /**
+     Get view of single item.
+     @param i index of item
+  */
+  View<Type, Dim> operator[](size_t i)
+  {
+    Type *data = getItemBuffer(i);
+    ssize_t step[Dim];
+    step[0] = 1;
+
+    for(unsigned k = 1; k < Dim; ++k)
+      step[k] = storage->stride[k - 1];
+
+    return View<Type, Dim>(getLocation(), data, size, step);
+  }
+
+  /**
+     Get pointer to first element of item.
+     @param i index of item
+  */
+  Type *getItemBuffer(size_t i)
+  {
+    if(i >= count)
+      CUDA_ERROR("out of bounds");
+
+    return storage->getBuffer() + i * storage->stride[Dim - 1];
+  }
+
+  /**
+     Get pointer to first element of item.
+     @param i index of item
+  */
+  const Type *getItemBuffer(size_t i) const
+  {
+    if(i >= count)
+      CUDA_ERROR("out of bounds");
+
+    return storage->getBuffer() + i * storage->stride[Dim - 1];
+  }
+
+  /**
+     Get storage of all items.
+     The last dimension of the storage is the capacity, only the first
+     getCount() slices are items of the batch.
+  */
+  inline Storage &getStorage() { return *storage; }
+
+  /**
+     Get storage of all items.
+  */
+  inline const Storage &getStorage() const { return *storage; }
+
+  /** Get number of items. */
+  inline size_t getCount() const { return count; }
+
+  /** Get number of items which fit into the current storage. */
+  inline size_t getCapacity() const { return capacity; }
+
+  /** Get number of released slots. */
+  inline size_t getFree() const { return released.size(); }
+
+  /** Get size of each item. */
+  inline Size<Dim> getSize() const { return size; }
+
+  /** Get location of the storage. */
+  inline memory_t getLocation() const { return location((Storage *)0); }
+
+  /**
+     Determine if the items are stored without padding.
+     This is required by CUFFT.
+  */
+  inline bool contiguous() const { return (storage == 0) || storage->contiguous(); }
+
+private:
+  /** size of each item */
+  Size<Dim> size;
+
+  /** number of items */
+  size_t count;
+
+  /** number of allocated items */
+  size_t capacity;
+
+  /** storage of all items */
+  Storage *storage;
+
+  /** released slots */
+  std::vector<size_t> released;
+
+  /** flags for slots in use */
+  std::vector<bool> used;
+
+  /**
+     Get size of storage for given number of items.
+  */
+  Size<Dim + 1> stackSize(size_t n) const
+  {
+    Size<Dim + 1> s;
+
+    for(unsigned i = Dim; i--;)
+      s[i] = size[i];
+
+    s[Dim] = n;
+    return s;
+  }
+
+  static inline memory_t location(const HostMemory<Type, Dim + 1> *) { return MEMORY_HOST; }
+  static inline memory_t location(const DeviceMemory<Type, Dim + 1> *) { return MEMORY_DEVICE; }
+
+  // no copies:
+  Batch(const Batch &);
+  Batch &operator=(const Batch &);
+};
+
+}  // namespace Cuda
+
+
+#endif
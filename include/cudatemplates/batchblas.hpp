@@ -0,0 +1,459 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_BATCHBLAS_H
+#define CUDA_BATCHBLAS_H
+
+
+#include <cudatemplates/devicememory.hpp>
+#include <cudatemplates/error.hpp>
+#include <cudatemplates/hostmemory.hpp>
+
+
+/**
+   Largest matrix size for which a fixed-size implementation is instantiated.
+   This may be lowered to reduce code size, values above 8 have the same
+   effect as 8.
+*/
+#ifndef CUDA_BATCHBLAS_MAX_FIXED
+#define CUDA_BATCHBLAS_MAX_FIXED 8
+#endif
+
+/**
+   Number of threads per block used by the batched device kernels.
+*/
+#ifndef CUDA_BATCHBLAS_THREADS
+#define CUDA_BATCHBLAS_THREADS 128
+#endif
+
+
+namespace Cuda {
+namespace BLAS {
+
+/*
+  Batched operations on many small matrices.
+
+  A stack of matrices is stored in a three-dimensional Layout: size[0] is the
+  number of rows, size[1] the number of columns and size[2] the number of
+  matrices. As in CUBLAS, the matrices are stored in column-major order, i.e.,
+  element (i, j) of matrix k is found at position
+  i + j * stride[0] + k * stride[1]. A stack of vectors is stored in a
+  two-dimensional Layout with size[0] elements per vector and size[1]
+  vectors.
+
+  Each operation exists for HostMemory and DeviceMemory. On the host, the
+  matrices are distributed among the available threads (if OpenMP is
+  enabled), on the device, each thread processes one matrix, so that a whole
+  stack is handled by a single kernel launch. Square problems of size
+  CUDA_BATCHBLAS_MAX_FIXED or less are dispatched to implementations with the
+  size known at compile time, which allows the compiler to completely unroll
+  (and on the host, vectorize) the inner loops.
+*/
+
+namespace Batched {
+
+/**
+   Small matrix operations.
+   The template parameter N is the matrix size if known at compile time,
+   N = 0 selects the implementation for sizes known at runtime only.
+   op(A)(i, j) is found at position i * ai + j * aj, which allows to handle
+   transposed and non-transposed matrices by the same code.
+*/
+template <class T, int N>
+struct Small
+{
+  static inline __host__ __device__ int dim(int n) { return (N > 0) ? N : n; }
+
+  /**
+     C = alpha * op(A) * op(B) + beta * C for one m x n matrix C.
+  */
+  static inline __host__ __device__ void
+  gemm(int m, int n, int k, T alpha,
+       const T *a, int ai, int aj, const T *b, int bi, int bj,
+       T beta, T *c, int ldc)
+  {
+    m = dim(m);
+    n = dim(n);
+    k = dim(k);
+
+    for(int j = 0; j < n; ++j)
+      for(int i = 0; i < m; ++i) {
+	T s = 0;
+
+	for(int p = 0; p < k; ++p)
+	  s += a[i * ai + p * aj] * b[p * bi + j * bj];
+
+	// as in BLAS, C is not read if beta is zero:
+	c[i + j * ldc] = (beta == 0) ? alpha * s : alpha * s + beta * c[i + j * ldc];
+      }
+  }
+
+  /**
+     y = alpha * op(A) * x + beta * y for one m x n matrix op(A).
+  */
+  static inline __host__ __device__ void
+  gemv(int m, int n, T alpha, const T *a, int ai, int aj, const T *x,
+       T beta, T *y)
+  {
+    m = dim(m);
+    n = dim(n);
+
+    for(int i = 0; i < m; ++i) {
+      T s = 0;
+
+      for(int p = 0; p < n; ++p)
+	s += a[i * ai + p * aj] * x[p];
+
+      y[i] = (beta == 0) ? alpha * s : alpha * s + beta * y[i];
+    }
+  }
+
+  /**
+     Solve op(A) * x = b for one n x n triangular matrix op(A).
+     The right-hand side is passed in x and overwritten by the solution.
+     @param forward true if op(A) is lower triangular
+     @param unit true if the diagonal elements are assumed to be one
+  */
+  static inline __host__ __device__ void
+  trsv(int n, bool forward, bool unit, const T *a, int ai, int aj, T *x)
+  {
+    n = dim(n);
+
+    if(forward) {
+      for(int i = 0; i < n; ++i) {
+	T s = x[i];
+
+	for(int p = 0; p < i; ++p)
+	  s -= a[i * ai + p * aj] * x[p];
+
+	x[i] = unit ? s : s / a[i * (ai + aj)];
+      }
+    }
+    else {
+      for(int i = n; i--;) {
+	T s = x[i];
+
+	for(int p = i + 1; p < n; ++p)
+	  s -= a[i * ai + p * aj] * x[p];
+
+	x[i] = unit ? s : s / a[i * (ai + aj)];
+      }
+    }
+  }
+};
+
+/**
+   Call func<N>(args) with N = n if n is small enough, otherwise with N = 0.
+*/
+#define CUDA_BATCHBLAS_DISPATCH(n, func, args)	\
+  switch(n) {					\
+  case 1: func<1> args; break;			\
+  case 2: func<2> args; break;			\
+  case 3: func<3> args; break;			\
+  case 4: func<4> args; break;			\
+  case 5: func<5> args; break;			\
+  case 6: func<6> args; break;			\
+  case 7: func<7> args; break;			\
+  case 8: func<8> args; break;			\
+  default: func<0> args;			\
+  }
+
+static inline bool trans(char t) { return (t != 'n') && (t != 'N'); }
+
+/**
+   Problem size for which the fixed-size implementation can be used.
+   @return n if all sizes are equal to n, 0 otherwise
+*/
+static inline int fixedSize(int m, int n, int k)
+{
+  return ((m == n) && (n == k) && (n <= CUDA_BATCHBLAS_MAX_FIXED)) ? n : 0;
+}
+
+template <int N, class T>
+void gemm_host(int count, int m, int n, int k, T alpha,
+	       const T *a, int ai, int aj, size_t as,
+	       const T *b, int bi, int bj, size_t bs,
+	       T beta, T *c, int ldc, size_t cs)
+{
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for(int l = 0; l < count; ++l)
+    Small<T, N>::gemm(m, n, k, alpha, a + l * as, ai, aj, b + l * bs, bi, bj, beta, c + l * cs, ldc);
+}
+
+template <int N, class T>
+void gemv_host(int count, int m, int n, T alpha,
+	       const T *a, int ai, int aj, size_t as,
+	       const T *x, size_t xs, T beta, T *y, size_t ys)
+{
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for(int l = 0; l < count; ++l)
+    Small<T, N>::gemv(m, n, alpha, a + l * as, ai, aj, x + l * xs, beta, y + l * ys);
+}
+
+template <int N, class T>
+void trsv_host(int count, int n, bool forward, bool unit,
+	       const T *a, int ai, int aj, size_t as, T *x, size_t xs)
+{
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for(int l = 0; l < count; ++l)
+    Small<T, N>::trsv(n, forward, unit, a + l * as, ai, aj, x + l * xs);
+}
+
+#ifdef __CUDACC__
+
+static inline __device__ int batch_index()
+{
+  return threadIdx.x + blockDim.x * (blockIdx.x + gridDim.x * blockIdx.y);
+}
+
+template <int N, class T>
+__global__ void gemm_kernel(int count, int m, int n, int k, T alpha,
+			    const T *a, int ai, int aj, size_t as,
+			    const T *b, int bi, int bj, size_t bs,
+			    T beta, T *c, int ldc, size_t cs)
+{
+  int l = batch_index();
+
+  if(l < count)
+    Small<T, N>::gemm(m, n, k, alpha, a + l * as, ai, aj, b + l * bs, bi, bj, beta, c + l * cs, ldc);
+}
+
+template <int N, class T>
+__global__ void gemv_kernel(int count, int m, int n, T alpha,
+			    const T *a, int ai, int aj, size_t as,
+			    const T *x, size_t xs, T beta, T *y, size_t ys)
+{
+  int l = batch_index();
+
+  if(l < count)
+    Small<T, N>::gemv(m, n, alpha, a + l * as, ai, aj, x + l * xs, beta, y + l * ys);
+}
+
+template <int N, class T>
+__global__ void trsv_kernel(int count, int n, bool forward, bool unit,
+			    const T *a, int ai, int aj, size_t as, T *x, size_t xs)
+{
+  int l = batch_index();
+
+  if(l < count)
+    Small<T, N>::trsv(n, forward, unit, a + l * as, ai, aj, x + l * xs);
+}
+
+/**
+   Execution configuration for one thread per matrix.
+   The grid is two-dimensional if the number of blocks exceeds the maximum
+   grid width.
+*/
+static inline void configuration(int count, dim3 &gridDim, dim3 &blockDim)
+{
+  int blocks = (count + CUDA_BATCHBLAS_THREADS - 1) / CUDA_BATCHBLAS_THREADS;
+  blockDim = dim3(CUDA_BATCHBLAS_THREADS);
+  gridDim = dim3((blocks < 65535) ? blocks : 65535);
+  gridDim.y = (blocks + gridDim.x - 1) / gridDim.x;
+}
+
+template <int N, class T>
+void gemm_device(int count, int m, int n, int k, T alpha,
+		 const T *a, int ai, int aj, size_t as,
+		 const T *b, int bi, int bj, size_t bs,
+		 T beta, T *c, int ldc, size_t cs)
+{
+  dim3 gridDim, blockDim;
+  configuration(count, gridDim, blockDim);
+  gemm_kernel<N, T><<<gridDim, blockDim>>>(count, m, n, k, alpha, a, ai, aj, as, b, bi, bj, bs, beta, c, ldc, cs);
+}
+
+template <int N, class T>
+void gemv_device(int count, int m, int n, T alpha,
+		 const T *a, int ai, int aj, size_t as,
+		 const T *x, size_t xs, T beta, T *y, size_t ys)
+{
+  dim3 gridDim, blockDim;
+  configuration(count, gridDim, blockDim);
+  gemv_kernel<N, T><<<gridDim, blockDim>>>(count, m, n, alpha, a, ai, aj, as, x, xs, beta, y, ys);
+}
+
+template <int N, class T>
+void trsv_device(int count, int n, bool forward, bool unit,
+		 const T *a, int ai, int aj, size_t as, T *x, size_t xs)
+{
+  dim3 gridDim, blockDim;
+  configuration(count, gridDim, blockDim);
+  trsv_kernel<N, T><<<gridDim, blockDim>>>(count, n, forward, unit, a, ai, aj, as, x, xs);
+}
+
+#endif  // __CUDACC__
+
+}  // namespace Batched
+
+
+/*
+  The following macros check the arguments of the batched operations and
+  compute the element offsets of op(A) and op(B). They are shared by the host
+  and device variants.
+*/
+
+#define CUDA_BATCHBLAS_GEMM_ARGS					\
+  bool ta = Batched::trans(transa), tb = Batched::trans(transb);	\
+  int m = C.size[0], n = C.size[1], k = ta ? A.size[0] : A.size[1];	\
+  if(((ta ? A.size[1] : A.size[0]) != (size_t)m) ||			\
+     ((tb ? B.size[1] : B.size[0]) != (size_t)k) ||			\
+     ((tb ? B.size[0] : B.size[1]) != (size_t)n) ||			\
+     (A.size[2] != C.size[2]) || (B.size[2] != C.size[2]))		\
+    CUDA_ERROR("size mismatch");					\
+  int lda = A.stride[0], ldb = B.stride[0];				\
+  int ai = ta ? lda : 1, aj = ta ? 1 : lda;				\
+  int bi = tb ? ldb : 1, bj = tb ? 1 : ldb;
+
+#define CUDA_BATCHBLAS_GEMV_ARGS					\
+  bool ta = Batched::trans(trans);					\
+  int m = ta ? A.size[1] : A.size[0], n = ta ? A.size[0] : A.size[1];	\
+  if((x.size[0] != (size_t)n) || (y.size[0] != (size_t)m) ||		\
+     (x.size[1] != A.size[2]) || (y.size[1] != A.size[2]))		\
+    CUDA_ERROR("size mismatch");					\
+  int lda = A.stride[0], ai = ta ? lda : 1, aj = ta ? 1 : lda;
+
+#define CUDA_BATCHBLAS_TRSV_ARGS					\
+  bool ta = Batched::trans(trans);					\
+  bool lower = (uplo == 'l') || (uplo == 'L');				\
+  bool unit = (diag == 'u') || (diag == 'U');				\
+  int n = A.size[0];							\
+  if((A.size[1] != (size_t)n) || (x.size[0] != (size_t)n) ||		\
+     (x.size[1] != A.size[2]))						\
+    CUDA_ERROR("size mismatch");					\
+  int lda = A.stride[0], ai = ta ? lda : 1, aj = ta ? 1 : lda;
+
+/**
+   Batched matrix multiplication in host memory.
+   Computes C[l] = alpha * op(A[l]) * op(B[l]) + beta * C[l] for all matrices
+   in the stack.
+   @param transa 'n' or 't' for op(A) = A or op(A) = A^T
+   @param transb 'n' or 't' for op(B) = B or op(B) = B^T
+*/
+template <class T>
+void gemmBatched(char transa, char transb, T alpha, const HostMemory<T, 3> &A, const HostMemory<T, 3> &B, T beta, HostMemory<T, 3> &C)
+{
+  CUDA_BATCHBLAS_GEMM_ARGS;
+  CUDA_BATCHBLAS_DISPATCH(Batched::fixedSize(m, n, k), Batched::gemm_host,
+			  ((int)C.size[2], m, n, k, alpha,
+			   A.getBuffer(), ai, aj, A.stride[1],
+			   B.getBuffer(), bi, bj, B.stride[1],
+			   beta, C.getBuffer(), (int)C.stride[0], C.stride[1]));
+}
+
+/**
+   Batched matrix-vector multiplication in host memory.
+   Computes y[l] = alpha * op(A[l]) * x[l] + beta * y[l] for all matrices
+   in the stack.
+   @param trans 'n' or 't' for op(A) = A or op(A) = A^T
+*/
+template <class T>
+void gemvBatched(char trans, T alpha, const HostMemory<T, 3> &A, const HostMemory<T, 2> &x, T beta, HostMemory<T, 2> &y)
+{
+  CUDA_BATCHBLAS_GEMV_ARGS;
+  CUDA_BATCHBLAS_DISPATCH(Batched::fixedSize(m, n, n), Batched::gemv_host,
+			  ((int)A.size[2], m, n, alpha,
+			   A.getBuffer(), ai, aj, A.stride[1],
+			   x.getBuffer(), x.stride[0], beta, y.getBuffer(), y.stride[0]));
+}
+
+/**
+   Batched triangular solve in host memory.
+   Solves op(A[l]) * x[l] = b[l] for all matrices in the stack, b is passed
+   in x and overwritten by the solution.
+   @param uplo 'u' or 'l' if A is upper or lower triangular
+   @param trans 'n' or 't' for op(A) = A or op(A) = A^T
+   @param diag 'u' if the diagonal of A is assumed to be one, 'n' otherwise
+*/
+template <class T>
+void trsvBatched(char uplo, char trans, char diag, const HostMemory<T, 3> &A, HostMemory<T, 2> &x)
+{
+  CUDA_BATCHBLAS_TRSV_ARGS;
+  CUDA_BATCHBLAS_DISPATCH(Batched::fixedSize(n, n, n), Batched::trsv_host,
+			  ((int)A.size[2], n, lower != ta, unit,
+			   A.getBuffer(), ai, aj, A.stride[1], x.getBuffer(), x.stride[0]));
+}
+
+#if defined(__CUDACC__) || defined(__DOXYGEN__)
+
+/**
+   Batched matrix multiplication in device memory.
+   See the host memory version for details. All matrices are processed by a
+   single kernel launch.
+*/
+template <class T>
+void gemmBatched(char transa, char transb, T alpha, const DeviceMemory<T, 3> &A, const DeviceMemory<T, 3> &B, T beta, DeviceMemory<T, 3> &C)
+{
+  CUDA_BATCHBLAS_GEMM_ARGS;
+  CUDA_BATCHBLAS_DISPATCH(Batched::fixedSize(m, n, k), Batched::gemm_device,
+			  ((int)C.size[2], m, n, k, alpha,
+			   A.getBuffer(), ai, aj, A.stride[1],
+			   B.getBuffer(), bi, bj, B.stride[1],
+			   beta, C.getBuffer(), (int)C.stride[0], C.stride[1]));
+  CUDA_CHECK(cudaGetLastError());
+}
+
+/**
+   Batched matrix-vector multiplication in device memory.
+   See the host memory version for details.
+*/
+template <class T>
+void gemvBatched(char trans, T alpha, const DeviceMemory<T, 3> &A, const DeviceMemory<T, 2> &x, T beta, DeviceMemory<T, 2> &y)
+{
+  CUDA_BATCHBLAS_GEMV_ARGS;
+  CUDA_BATCHBLAS_DISPATCH(Batched::fixedSize(m, n, n), Batched::gemv_device,
+			  ((int)A.size[2], m, n, alpha,
+			   A.getBuffer(), ai, aj, A.stride[1],
+			   x.getBuffer(), x.stride[0], beta, y.getBuffer(), y.stride[0]));
+  CUDA_CHECK(cudaGetLastError());
+}
+
+/**
+   Batched triangular solve in device memory.
+   See the host memory version for details.
+*/
+template <class T>
+void trsvBatched(char uplo, char trans, char diag, const DeviceMemory<T, 3> &A, DeviceMemory<T, 2> &x)
+{
+  CUDA_BATCHBLAS_TRSV_ARGS;
+  CUDA_BATCHBLAS_DISPATCH(Batched::fixedSize(n, n, n), Batched::trsv_device,
+			  ((int)A.size[2], n, lower != ta, unit,
+			   A.getBuffer(), ai, aj, A.stride[1], x.getBuffer(), x.stride[0]));
+  CUDA_CHECK(cudaGetLastError());
+}
+
+#endif  // defined(__CUDACC__) || defined(__DOXYGEN__)
+
+#undef CUDA_BATCHBLAS_GEMM_ARGS
+#undef CUDA_BATCHBLAS_GEMV_ARGS
+#undef CUDA_BATCHBLAS_TRSV_ARGS
+#undef CUDA_BATCHBLAS_DISPATCH
+
+}  // namespace BLAS
+}  // namespace Cuda
+
+
+#endif
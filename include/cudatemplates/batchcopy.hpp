@@ -0,0 +1,509 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_BATCHCOPY_H
+#define CUDA_BATCHCOPY_H
+
+
+#include <string.h>
+#include <sys/time.h>
+
+#include <vector>
+
+#include <cudatemplates/batch.hpp>
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememory.hpp>
+#include <cudatemplates/devicememorylinear.hpp>
+#include <cudatemplates/error.hpp>
+#include <cudatemplates/event.hpp>
+#include <cudatemplates/hostmemory.hpp>
+#include <cudatemplates/pointer.hpp>
+#include <cudatemplates/view.hpp>
+
+
+/**
+   Number of threads per block of the batch copy kernel.
+*/
+#ifndef CUDA_BATCH_THREADS
+#define CUDA_BATCH_THREADS 256
+#endif
+
+/**
+   Maximum number of blocks per item of the batch copy kernel.
+*/
+#ifndef CUDA_BATCH_BLOCKS
+#define CUDA_BATCH_BLOCKS 64
+#endif
+
+
+namespace Cuda {
+
+/**
+   Copying and converting many small regions at once.
+   Calling copy() for each of thousands of small images is dominated by the
+   fixed cost per call (size checks, execution configuration, kernel launch
+   or memcpy). A Batching::Queue checks all regions once when they are added
+   and then processes them in a single parallel loop on the host or a single
+   kernel launch on the device.
+*/
+namespace Batching {
+
+/**
+   Description of a region of host or device memory.
+   This has the same meaning as the data pointer, size and stride of a
+   Layout and can be passed to kernels.
+*/
+template <class Type, unsigned Dim>
+struct Item
+{
+  /** pointer to first element */
+  Type *data;
+
+  /** size of region */
+  size_t size[Dim];
+
+  /** stride of memory (see Layout::stride) */
+  size_t stride[Dim];
+
+  Item(): data(0) {}
+
+  /**
+     Constructor for entire memory.
+     @param mem memory object
+  */
+  Item(const Pointer<Type, Dim> &mem):
+    data(const_cast<Type *>(mem.getBuffer()))
+  {
+    for(int i = Dim; i--;) {
+      size[i] = mem.size[i];
+      stride[i] = mem.stride[i];
+    }
+  }
+
+  /**
+     Constructor for region.
+     @param mem memory object
+     @param ofs offset of region
+     @param _size size of region
+  */
+  Item(const Pointer<Type, Dim> &mem, const Size<Dim> &ofs, const Size<Dim> &_size):
+    data(const_cast<Type *>(mem.getBuffer()) + mem.getOffset(ofs))
+  {
+    for(int i = Dim; i--;) {
+      size[i] = _size[i];
+      stride[i] = mem.stride[i];
+    }
+  }
+
+  /**
+     Constructor for slice of a stack.
+     @param stack memory object with one more dimension than the item
+     @param index index of slice (in the last dimension)
+  */
+  Item(const Pointer<Type, Dim + 1> &stack, size_t index):
+    data(const_cast<Type *>(stack.getBuffer()) + index * stack.stride[Dim - 1])
+  {
+    if(index >= stack.size[Dim])
+      CUDA_ERROR("out of bounds");
+
+    for(int i = Dim; i--;) {
+      size[i] = stack.size[i];
+      stride[i] = stack.stride[i];
+    }
+  }
+
+  /**
+     Get number of elements.
+  */
+  __host__ __device__ inline size_t count() const
+  {
+    size_t n = 1;
+
+    for(unsigned i = 0; i < Dim; ++i)
+      n *= size[i];
+
+    return n;
+  }
+
+  /**
+     Get memory offset of element.
+     @param i index of element in packed order (dimension 0 varies fastest)
+  */
+  __host__ __device__ inline size_t offset(size_t i) const
+  {
+    size_t o = 0, step = 1;
+
+    for(unsigned j = 0; j + 1 < Dim; ++j) {
+      o += (i % size[j]) * step;
+      i /= size[j];
+      step = stride[j];
+    }
+
+    return o + i * step;
+  }
+};
+
+/**
+   Convert row of elements.
+*/
+template <class Type1, class Type2>
+inline void
+row(Type1 *dst, const Type2 *src, size_t n)
+{
+  for(size_t i = 0; i < n; ++i)
+    dst[i] = src[i];
+}
+
+/**
+   Copy row of elements of the same type.
+*/
+template <class Type>
+inline void
+row(Type *dst, const Type *src, size_t n)
+{
+  memcpy(dst, src, n * sizeof(Type));
+}
+
+/**
+   Copy or convert one item on the host.
+*/
+template <class Type1, class Type2, unsigned Dim>
+void
+host(const Item<Type1, Dim> &dst, const Item<Type2, Dim> &src)
+{
+  const size_t width = dst.size[0], rows = dst.count() / width;
+
+  for(size_t r = 0; r < rows; ++r)
+    row(dst.data + dst.offset(r * width), src.data + src.offset(r * width), width);
+}
+
+#ifdef __CUDACC__
+
+/**
+   Batch copy kernel.
+   Block row blockIdx.y processes the items blockIdx.y, blockIdx.y +
+   gridDim.y, ...; the blocks of a row share the elements of the item.
+*/
+template <class Type1, class Type2, unsigned Dim>
+__global__ void copy_kernel(const Item<Type1, Dim> *dst, const Item<Type2, Dim> *src, unsigned count)
+{
+  for(unsigned k = blockIdx.y; k < count; k += gridDim.y) {
+    const Item<Type1, Dim> d = dst[k];
+    const Item<Type2, Dim> s = src[k];
+    const size_t n = d.count();
+
+    for(size_t i = threadIdx.x + blockIdx.x * blockDim.x; i < n; i += blockDim.x * gridDim.x)
+      d.data[d.offset(i)] = s.data[s.offset(i)];
+  }
+}
+
+#endif  // __CUDACC__
+
+/**
+   Queue of copy or conversion operations.
+   All source and destination regions must reside in the memory location
+   given to the constructor. The queue can be executed repeatedly, e.g.,
+   after new data has been written to the same source regions.
+*/
+template <class Type1, class Type2, unsigned Dim>
+class Queue
+{
+public:
+  typedef Item<Type1, Dim> DstItem;
+  typedef Item<Type2, Dim> SrcItem;
+
+  /**
+     Constructor.
+     @param _location memory location of all regions
+  */
+  Queue(memory_t _location):
+    location(_location), device_dst(0), device_src(0), uploaded(false), start(0), stop(0), elapsed(0), timed(false)
+  {
+  }
+
+  /**
+     Destructor.
+  */
+  ~Queue()
+  {
+    delete device_dst;
+    delete device_src;
+    delete start;
+    delete stop;
+  }
+
+  /**
+     Add operation for given regions.
+     The sizes are checked, but it is the caller's responsibility that the
+     regions reside in the memory location of the queue.
+     @param dst destination region
+     @param src source region
+  */
+  void add(const DstItem &dst, const SrcItem &src)
+  {
+    for(unsigned i = Dim; i--;)
+      if(dst.size[i] != src.size[i])
+	CUDA_ERROR("size mismatch");
+
+    if(dst.count() == 0)
+      return;
+
+    dsts.push_back(dst);
+    srcs.push_back(src);
+    uploaded = false;
+  }
+
+  /**
+     Add operation for host memory.
+     @param dst destination pointer
+     @param src source pointer
+  */
+  inline void add(HostMemory<Type1, Dim> &dst, const HostMemory<Type2, Dim> &src)
+  {
+    check(MEMORY_HOST);
+    add(DstItem(dst), SrcItem(src));
+  }
+
+  /**
+     Add operation for region of host memory.
+     @param dst destination pointer
+     @param src source pointer
+     @param dst_ofs destination offset
+     @param src_ofs source offset
+     @param size size of region
+  */
+  inline void add(HostMemory<Type1, Dim> &dst, const HostMemory<Type2, Dim> &src,
+		  const Size<Dim> &dst_ofs, const Size<Dim> &src_ofs, const Size<Dim> &size)
+  {
+    check(MEMORY_HOST);
+    check_bounds(dst, src, dst_ofs, src_ofs, size);
+    add(DstItem(dst, dst_ofs, size), SrcItem(src, src_ofs, size));
+  }
+
+  /**
+     Add operation for device memory.
+     @param dst destination pointer
+     @param src source pointer
+  */
+  inline void add(DeviceMemory<Type1, Dim> &dst, const DeviceMemory<Type2, Dim> &src)
+  {
+    check(MEMORY_DEVICE);
+    add(DstItem(dst), SrcItem(src));
+  }
+
+  /**
+     Add operation for region of device memory.
+     @param dst destination pointer
+     @param src source pointer
+     @param dst_ofs destination offset
+     @param src_ofs source offset
+     @param size size of region
+  */
+  inline void add(DeviceMemory<Type1, Dim> &dst, const DeviceMemory<Type2, Dim> &src,
+		  const Size<Dim> &dst_ofs, const Size<Dim> &src_ofs, const Size<Dim> &size)
+  {
+    check(MEMORY_DEVICE);
+    check_bounds(dst, src, dst_ofs, src_ofs, size);
+    add(DstItem(dst, dst_ofs, size), SrcItem(src, src_ofs, size));
+  }
+
+  /**
+     Add operations for all slices of a stack.
+     Slice i of the source is copied to slice i of the destination.
+     @param dst destination stack
+     @param src source stack
+  */
+  void addStack(Pointer<Type1, Dim + 1> &dst, const Pointer<Type2, Dim + 1> &src)
+  {
+    CUDA_CHECK_SIZE;
+
+    for(size_t i = 0; i < dst.size[Dim]; ++i)
+      add(DstItem(dst, i), SrcItem(src, i));
+  }
+
+  /**
+     Add operations for all items of a batch.
+     Item i of the source is copied to item i of the destination.
+     @param dst destination batch
+     @param src source batch
+  */
+  template <class Storage1, class Storage2>
+  void add(Batch<Type1, Dim, Storage1> &dst, const Batch<Type2, Dim, Storage2> &src)
+  {
+    check(dst.getLocation());
+    check(src.getLocation());
+
+    if((dst.getCount() != src.getCount()) || (dst.getSize() != src.getSize()))
+      CUDA_ERROR("size mismatch");
+
+    for(size_t i = 0; i < dst.getCount(); ++i)
+      add(DstItem(dst.getStorage(), i), SrcItem(src.getStorage(), i));
+  }
+
+  /**
+     Remove all operations.
+  */
+  inline void clear()
+  {
+    dsts.clear();
+    srcs.clear();
+    uploaded = false;
+  }
+
+  /**
+     Get number of operations.
+  */
+  inline size_t getCount() const { return dsts.size(); }
+
+  /**
+     Execute all operations.
+     On the host, the operations are distributed over the OpenMP threads.
+     On the device, all operations are performed by a single kernel launch
+     (this requires that the calling code is compiled by nvcc).
+     @param stream CUDA stream for device operations
+  */
+  void execute(cudaStream_t stream = 0)
+  {
+    const int n = dsts.size();
+
+    if(location == MEMORY_HOST) {
+      struct timeval t0, t1;
+      gettimeofday(&t0, 0);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif
+      for(int i = 0; i < n; ++i)
+	host(dsts[i], srcs[i]);
+
+      gettimeofday(&t1, 0);
+      elapsed = (t1.tv_sec - t0.tv_sec) * 1e3f + (t1.tv_usec - t0.tv_usec) * 1e-3f;
+      timed = false;
+      return;
+    }
+
+#ifdef __CUDACC__
+    if(n == 0)
+      return;
+
+    upload(stream);
+
+    if(start == 0)
+      start = new Event;
+
+    if(stop == 0)
+      stop = new Event;
+
+    size_t count = 0;
+
+    for(int i = n; i--;)
+      if(dsts[i].count() > count)
+	count = dsts[i].count();
+
+    size_t blocks = (count + CUDA_BATCH_THREADS - 1) / CUDA_BATCH_THREADS;
+    dim3 gridDim((blocks < CUDA_BATCH_BLOCKS) ? blocks : CUDA_BATCH_BLOCKS, (n < 65535) ? n : 65535);
+    start->record(stream);
+    copy_kernel<<<gridDim, CUDA_BATCH_THREADS, 0, stream>>>(device_dst->getBuffer(), device_src->getBuffer(), n);
+    CUDA_CHECK(cudaGetLastError());
+    stop->record(stream);
+    timed = true;
+#else
+    (void)stream;
+    CUDA_ERROR("device memory can only be processed in batches in code compiled by nvcc");
+#endif
+  }
+
+  /**
+     Get elapsed time of last execution.
+     For device operations, this waits until the operations are finished.
+     @return elapsed time in milliseconds
+  */
+  float getElapsedTime()
+  {
+    if(timed) {
+      stop->synchronize();
+      elapsed = *stop - *start;
+      timed = false;
+    }
+
+    return elapsed;
+  }
+
+private:
+  memory_t location;
+
+  /** descriptors of operations */
+  std::vector<DstItem> dsts;
+  std::vector<SrcItem> srcs;
+
+  /** descriptors of operations in device memory */
+  DeviceMemoryLinear<DstItem, 1> *device_dst;
+  DeviceMemoryLinear<SrcItem, 1> *device_src;
+
+  /** device descriptors are up to date */
+  bool uploaded;
+
+  /**
+     Timing of last execution.
+     The events are created on first use, so host queues don't need a device.
+  */
+  Event *start, *stop;
+  float elapsed;
+  bool timed;
+
+  inline void check(memory_t l) const
+  {
+    if(l != location)
+      CUDA_ERROR("memory location doesn't match batch");
+  }
+
+  /**
+     Copy descriptors to device memory.
+  */
+  void upload(cudaStream_t stream)
+  {
+    if(uploaded)
+      return;
+
+    if((device_dst == 0) || (device_dst->size[0] < dsts.size())) {
+      delete device_dst;
+      delete device_src;
+      device_dst = 0;
+      device_src = 0;
+      device_dst = new DeviceMemoryLinear<DstItem, 1>(Size<1>(dsts.capacity()));
+      device_src = new DeviceMemoryLinear<SrcItem, 1>(Size<1>(srcs.capacity()));
+    }
+
+    CUDA_CHECK(cudaMemcpyAsync(device_dst->getBuffer(), &dsts[0], dsts.size() * sizeof(DstItem), cudaMemcpyHostToDevice, stream));
+    CUDA_CHECK(cudaMemcpyAsync(device_src->getBuffer(), &srcs[0], srcs.size() * sizeof(SrcItem), cudaMemcpyHostToDevice, stream));
+    uploaded = true;
+  }
+
+  // no copies:
+  Queue(const Queue &);
+  Queue &operator=(const Queue &);
+};
+
+}  // namespace Batching
+
+}  // namespace Cuda
+
+
+#endif
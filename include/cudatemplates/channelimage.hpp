@@ -0,0 +1,339 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_CHANNELIMAGE_H
+#define CUDA_CHANNELIMAGE_H
+
+
+#include <vector>
+
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememorypitched.hpp>
+#include <cudatemplates/error.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/permute.hpp>
+#include <cudatemplates/view.hpp>
+
+
+namespace Cuda {
+
+/**
+   Arrangement of the channels of an image.
+*/
+typedef enum {
+  CHANNELS_INTERLEAVED,  /**< all channels of a pixel are consecutive (array of structures) */
+  CHANNELS_PLANAR        /**< each channel is stored in a separate plane (structure of arrays) */
+} channel_layout_t;
+
+/**
+   Multi-channel image in host and device memory.
+   The image data may exist in up to four representations: interleaved or
+   planar, each in host or device memory. Only the representations which
+   are actually requested are allocated, and they are converted (by copying
+   and/or permuting the axes) lazily when a representation is requested
+   which isn't up to date. As long as the data isn't modified, a kernel
+   which prefers planar data therefore pays for the conversion only once.
+
+   The representations are accessed through views with three dimensions:
+   - interleaved data: channel, x, y (rows share a common pitch)
+   - planar data: x, y, channel (all planes share a common pitch)
+
+   Requesting a representation for writing marks all other representations
+   as out of date.
+*/
+template <class Scalar>
+class ChannelImage
+{
+public:
+  /**
+     Constructor.
+     No memory is allocated before a representation is requested.
+     @param _size size of the image
+     @param _channels number of channels
+     @param _layout preferred channel layout (used by host() and device()
+     without layout argument)
+  */
+  ChannelImage(const Size<2> &_size, unsigned _channels, channel_layout_t _layout = CHANNELS_INTERLEAVED):
+    size(_size), channels(_channels), layout(_layout)
+  {
+    if(channels == 0)
+      CUDA_ERROR("image needs at least one channel");
+
+    for(int i = 2; i--;) {
+      interleaved[i] = 0;
+      planar[i] = 0;
+    }
+
+    invalidate();
+  }
+
+  /**
+     Destructor.
+  */
+  ~ChannelImage()
+  {
+    for(int i = 2; i--;) {
+      delete interleaved[i];
+      delete planar[i];
+    }
+  }
+
+  /**
+     Get view of host memory in preferred layout.
+     @param write if true, all other representations are marked as out of date
+  */
+  inline View<Scalar, 3> host(bool write = false) { return get(MEMORY_HOST, layout, write); }
+
+  /**
+     Get view of host memory.
+     @param _layout requested channel layout
+     @param write if true, all other representations are marked as out of date
+  */
+  inline View<Scalar, 3> host(channel_layout_t _layout, bool write = false) { return get(MEMORY_HOST, _layout, write); }
+
+  /**
+     Get view of device memory in preferred layout.
+     @param write if true, all other representations are marked as out of date
+  */
+  inline View<Scalar, 3> device(bool write = false) { return get(MEMORY_DEVICE, layout, write); }
+
+  /**
+     Get view of device memory.
+     @param _layout requested channel layout
+     @param write if true, all other representations are marked as out of date
+  */
+  inline View<Scalar, 3> device(channel_layout_t _layout, bool write = false) { return get(MEMORY_DEVICE, _layout, write); }
+
+  /**
+     Mark all representations as out of date.
+     This is useful if the entire image will be overwritten (e.g., when a
+     frame is reused for new data).
+  */
+  inline void invalidate()
+  {
+    for(int i = 4; i--;)
+      valid[i] = false;
+  }
+
+  /**
+     Check if a representation is up to date.
+     @param location memory location
+     @param _layout channel layout
+  */
+  inline bool upToDate(memory_t location, channel_layout_t _layout) const { return valid[index(location, _layout)]; }
+
+  /** Get size. */
+  inline Size<2> getSize() const { return size; }
+
+  /** Get number of channels. */
+  inline unsigned getChannels() const { return channels; }
+
+  /** Get preferred channel layout. */
+  inline channel_layout_t getLayout() const { return layout; }
+
+private:
+  Size<2> size;
+  unsigned channels;
+  channel_layout_t layout;
+
+  /** interleaved representations in host and device memory (channels * width x height) */
+  Pointer<Scalar, 2> *interleaved[2];
+
+  /** planar representations in host and device memory (width x height x channels) */
+  Pointer<Scalar, 3> *planar[2];
+
+  /** which representations are up to date, indexed by index() */
+  bool valid[4];
+
+  /**
+     Get index of representation.
+     Indices which differ in bit 0 differ in layout, indices which differ in
+     bit 1 differ in location.
+  */
+  static inline int index(memory_t location, channel_layout_t _layout)
+  {
+    return ((location == MEMORY_DEVICE) ? 2 : 0) | ((_layout == CHANNELS_PLANAR) ? 1 : 0);
+  }
+
+  /**
+     Get view of representation, allocate memory if required.
+  */
+  View<Scalar, 3> view(int i)
+  {
+    memory_t location = (i & 2) ? MEMORY_DEVICE : MEMORY_HOST;
+
+    if(i & 1) {
+      Pointer<Scalar, 3> *&p = planar[i >> 1];
+
+      if(p == 0) {
+	Size<3> s(size[0], size[1], channels);
+	p = (location == MEMORY_HOST) ?
+	  static_cast<Pointer<Scalar, 3> *>(new HostMemoryHeap3D<Scalar>(s)) :
+	  static_cast<Pointer<Scalar, 3> *>(new DeviceMemoryPitched3D<Scalar>(s));
+      }
+
+      ssize_t step[] = { 1, p->stride[0], p->stride[1] };
+      return View<Scalar, 3>(location, p->getBuffer(), p->size, step);
+    }
+
+    Pointer<Scalar, 2> *&p = interleaved[i >> 1];
+
+    if(p == 0) {
+      Size<2> s(size[0] * channels, size[1]);
+      p = (location == MEMORY_HOST) ?
+	static_cast<Pointer<Scalar, 2> *>(new HostMemoryHeap2D<Scalar>(s)) :
+	static_cast<Pointer<Scalar, 2> *>(new DeviceMemoryPitched2D<Scalar>(s));
+    }
+
+    ssize_t step[] = { 1, channels, p->stride[0] };
+    return View<Scalar, 3>(location, p->getBuffer(), Size<3>(channels, size[0], size[1]), step);
+  }
+
+  /**
+     Bring representation up to date.
+     Conversion within the same memory location is preferred, since it
+     avoids transfers between host and device.
+  */
+  void update(int i)
+  {
+    if(valid[i])
+      return;
+
+    if(valid[i ^ 1])
+      convert(i, i ^ 1);
+    else if(valid[i ^ 2])
+      copy(view(i), view(i ^ 2));
+    else if(valid[i ^ 3]) {
+      update(i ^ 1);
+      convert(i, i ^ 1);
+    }
+
+    valid[i] = true;
+  }
+
+  /**
+     Convert between interleaved and planar representation.
+  */
+  void convert(int dst, int src)
+  {
+    static const unsigned to_planar[] = { 1, 2, 0 }, to_interleaved[] = { 2, 0, 1 };
+    permute(view(dst), view(src), (dst & 1) ? to_planar : to_interleaved);
+  }
+
+  /**
+     Get view of representation.
+  */
+  View<Scalar, 3> get(memory_t location, channel_layout_t _layout, bool write)
+  {
+    int i = index(location, _layout);
+    update(i);
+
+    if(write) {
+      invalidate();
+      valid[i] = true;
+    }
+
+    return view(i);
+  }
+
+  // no copies:
+  ChannelImage(const ChannelImage &);
+  ChannelImage &operator=(const ChannelImage &);
+};
+
+/**
+   Ring of frames for video processing.
+   The frames are allocated once and reused in a round-robin manner, frame 0
+   is the current frame, frame 1 the previous one, and so on. Advancing the
+   ring makes the oldest frame the current one and marks its content as out
+   of date, so no stale data is transferred for it.
+   The frame type must provide an invalidate() method.
+*/
+template <class Frame>
+class FrameRing
+{
+public:
+  /**
+     Constructor.
+     @param count number of frames
+     @param _size size of each frame
+     @param channels number of channels
+     @param layout preferred channel layout
+  */
+  FrameRing(unsigned count, const Size<2> &_size, unsigned channels, channel_layout_t layout = CHANNELS_INTERLEAVED):
+    current(0)
+  {
+    if(count == 0)
+      CUDA_ERROR("frame ring needs at least one frame");
+
+    frames.resize(count);
+
+    for(unsigned i = 0; i < count; ++i)
+      frames[i] = new Frame(_size, channels, layout);
+  }
+
+  /**
+     Destructor.
+  */
+  ~FrameRing()
+  {
+    for(size_t i = frames.size(); i--;)
+      delete frames[i];
+  }
+
+  /**
+     Get frame.
+     @param age age of frame (0 is the current frame)
+  */
+  inline Frame &operator[](unsigned age)
+  {
+    if(age >= frames.size())
+      CUDA_ERROR("out of bounds");
+
+    return *frames[(current + frames.size() - age) % frames.size()];
+  }
+
+  /**
+     Advance to next frame.
+     @return new current frame
+  */
+  inline Frame &advance()
+  {
+    current = (current + 1) % frames.size();
+    frames[current]->invalidate();
+    return *frames[current];
+  }
+
+  /** Get number of frames. */
+  inline size_t getCount() const { return frames.size(); }
+
+private:
+  std::vector<Frame *> frames;
+  size_t current;
+
+  // no copies:
+  FrameRing(const FrameRing &);
+  FrameRing &operator=(const FrameRing &);
+};
+
+}  // namespace Cuda
+
+
+#endif
@@ -0,0 +1,915 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_COLOR_H
+#define CUDA_COLOR_H
+
+
+#include <cmath>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <vector_types.h>
+
+#include <cudatemplates/devicememory.hpp>
+#include <cudatemplates/error.hpp>
+#include <cudatemplates/hostmemory.hpp>
+
+
+/**
+   Block size of device color conversion kernels.
+*/
+#ifndef CUDA_COLOR_BLOCK_X
+#define CUDA_COLOR_BLOCK_X 32
+#endif
+
+#ifndef CUDA_COLOR_BLOCK_Y
+#define CUDA_COLOR_BLOCK_Y 8
+#endif
+
+
+namespace Cuda {
+
+/**
+   YUV (YCbCr) standards.
+   Eight bit YUV data uses the limited ("video") range, i.e., Y in [16, 235]
+   and Cb, Cr in [16, 240]. Floating point YUV data has Y in [0, 1] and Cb,
+   Cr in [-0.5, 0.5].
+*/
+typedef enum {
+  YUV_BT601,  /**< ITU-R BT.601 (standard definition) */
+  YUV_BT709   /**< ITU-R BT.709 (high definition) */
+} yuv_standard_t;
+
+namespace Color {
+
+/**
+   Round and saturate to eight bits.
+   Since the value is clamped first, truncation rounds correctly; unlike
+   Convolution::Saturate, this is vectorized by the compiler.
+*/
+__host__ __device__ inline unsigned char saturate(float v)
+{
+  v = (v > 0) ? v : 0;
+  v = (v < 255) ? v : 255;
+  return (unsigned char)(int)(v + 0.5f);
+}
+
+/**
+   Access to the channels of interleaved pixels.
+   Eight bit channels are flagged as integer, their values are in the range
+   [0, 255], floating point channels are in the range [0, 1] (for RGB).
+   Pixels with four channels get an opaque alpha value when written.
+*/
+template <class Type> struct Pixel;
+
+template <>
+struct Pixel<uchar3>
+{
+  enum { integer = 1 };
+  static __host__ __device__ inline void load(const uchar3 &p, float *c) { c[0] = p.x; c[1] = p.y; c[2] = p.z; }
+  static __host__ __device__ inline void store(uchar3 &p, const float *c)
+  {
+    p.x = saturate(c[0]);
+    p.y = saturate(c[1]);
+    p.z = saturate(c[2]);
+  }
+};
+
+template <>
+struct Pixel<uchar4>
+{
+  enum { integer = 1 };
+  static __host__ __device__ inline void load(const uchar4 &p, float *c) { c[0] = p.x; c[1] = p.y; c[2] = p.z; }
+  static __host__ __device__ inline void store(uchar4 &p, const float *c)
+  {
+    p.x = saturate(c[0]);
+    p.y = saturate(c[1]);
+    p.z = saturate(c[2]);
+    p.w = 255;
+  }
+};
+
+template <>
+struct Pixel<float3>
+{
+  enum { integer = 0 };
+  static __host__ __device__ inline void load(const float3 &p, float *c) { c[0] = p.x; c[1] = p.y; c[2] = p.z; }
+  static __host__ __device__ inline void store(float3 &p, const float *c) { p.x = c[0]; p.y = c[1]; p.z = c[2]; }
+};
+
+template <>
+struct Pixel<float4>
+{
+  enum { integer = 0 };
+  static __host__ __device__ inline void load(const float4 &p, float *c) { c[0] = p.x; c[1] = p.y; c[2] = p.z; }
+  static __host__ __device__ inline void store(float4 &p, const float *c) { p.x = c[0]; p.y = c[1]; p.z = c[2]; p.w = 1; }
+};
+
+/**
+   Access to the channels of planar images.
+*/
+template <class Type> struct Channel;
+
+template <>
+struct Channel<unsigned char>
+{
+  enum { integer = 1 };
+  static __host__ __device__ inline float load(unsigned char v) { return v; }
+  static __host__ __device__ inline unsigned char store(float v) { return saturate(v); }
+};
+
+template <>
+struct Channel<float>
+{
+  enum { integer = 0 };
+  static __host__ __device__ inline float load(float v) { return v; }
+  static __host__ __device__ inline float store(float v) { return v; }
+};
+
+/**
+   View of an interleaved image (Layout<Type, 2> with three or four channels
+   per element).
+*/
+template <class Type>
+struct Interleaved
+{
+  enum { integer = Pixel<Type>::integer };
+  Type *data;
+  size_t stride;
+  int width, height;
+
+  Interleaved(const Layout<Type, 2> &layout, Type *_data):
+    data(_data), stride(layout.stride[0]), width(layout.size[0]), height(layout.size[1])
+  {
+  }
+
+  __host__ __device__ inline void load(int x, int y, float *c) const { Pixel<Type>::load(data[y * stride + x], c); }
+  __host__ __device__ inline void store(int x, int y, const float *c) const { Pixel<Type>::store(data[y * stride + x], c); }
+};
+
+/**
+   View of a planar image (Layout<Type, 3> with three planes).
+*/
+template <class Type>
+struct Planar
+{
+  enum { integer = Channel<Type>::integer };
+  Type *data;
+  size_t stride, plane;
+  int width, height;
+
+  Planar(const Layout<Type, 3> &layout, Type *_data):
+    data(_data), stride(layout.stride[0]), plane(layout.stride[1]), width(layout.size[0]), height(layout.size[1])
+  {
+    if(layout.size[2] != 3)
+      CUDA_ERROR("planar color image must have three planes");
+  }
+
+  __host__ __device__ inline void load(int x, int y, float *c) const
+  {
+    const Type *p = data + y * stride + x;
+    c[0] = Channel<Type>::load(p[0]);
+    c[1] = Channel<Type>::load(p[plane]);
+    c[2] = Channel<Type>::load(p[2 * plane]);
+  }
+
+  __host__ __device__ inline void store(int x, int y, const float *c) const
+  {
+    Type *p = data + y * stride + x;
+    p[0] = Channel<Type>::store(c[0]);
+    p[plane] = Channel<Type>::store(c[1]);
+    p[2 * plane] = Channel<Type>::store(c[2]);
+  }
+};
+
+/**
+   Select view for interleaved (Dim == 2) or planar (Dim == 3) images.
+*/
+template <class Type, unsigned Dim> struct View;
+template <class Type> struct View<Type, 2> { typedef Interleaved<Type> type; };
+template <class Type> struct View<Type, 3> { typedef Planar<Type> type; };
+
+/**
+   View of a YUV 4:2:0 image stored in a single eight bit buffer of size
+   width * (height * 3 / 2). The chroma planes follow the luma plane, either
+   interleaved (NV12) or as separate U and V planes (I420) whose rows are
+   half the pitch of the luma rows.
+*/
+struct Yuv420
+{
+  unsigned char *y, *u, *v;
+  size_t stride, stride_uv;
+  int step_uv, width, height;
+
+  Yuv420(const Layout<unsigned char, 2> &layout, unsigned char *data, bool nv12):
+    y(data), stride(layout.stride[0]), width(layout.size[0]), height(layout.size[1] / 3 * 2)
+  {
+    if((width % 2 != 0) || (layout.size[1] % 3 != 0) || (height % 2 != 0))
+      CUDA_ERROR("invalid size of YUV 4:2:0 image");
+
+    unsigned char *c = data + height * stride;
+
+    if(nv12) {
+      u = c;
+      v = c + 1;
+      stride_uv = stride;
+      step_uv = 2;
+    }
+    else {
+      if(stride % 2 != 0)
+	CUDA_ERROR("invalid pitch of YUV 4:2:0 image");
+
+      u = c;
+      v = c + (height / 2) * (stride / 2);
+      stride_uv = stride / 2;
+      step_uv = 1;
+    }
+  }
+};
+
+/**
+   Coefficients of YUV standards.
+*/
+struct Yuv
+{
+  float kr, kb;
+
+  Yuv(yuv_standard_t standard):
+    kr((standard == YUV_BT709) ? 0.2126f : 0.299f),
+    kb((standard == YUV_BT709) ? 0.0722f : 0.114f)
+  {
+  }
+
+  /**
+     Convert normalized RGB to normalized YUV.
+  */
+  __host__ __device__ inline void fromRgb(const float *rgb, float *yuv) const
+  {
+    float y = kr * rgb[0] + (1 - kr - kb) * rgb[1] + kb * rgb[2];
+    yuv[0] = y;
+    yuv[1] = (rgb[2] - y) * (0.5f / (1 - kb));
+    yuv[2] = (rgb[0] - y) * (0.5f / (1 - kr));
+  }
+
+  /**
+     Convert normalized YUV to normalized RGB.
+  */
+  __host__ __device__ inline void toRgb(const float *yuv, float *rgb) const
+  {
+    float r = yuv[0] + 2 * (1 - kr) * yuv[2];
+    float b = yuv[0] + 2 * (1 - kb) * yuv[1];
+    rgb[0] = r;
+    rgb[1] = (yuv[0] - kr * r - kb * b) / (1 - kr - kb);
+    rgb[2] = b;
+  }
+
+  /**
+     Encode normalized YUV as eight bit values.
+  */
+  static __host__ __device__ inline void encode(float *yuv)
+  {
+    yuv[0] = 16 + 219 * yuv[0];
+    yuv[1] = 128 + 224 * yuv[1];
+    yuv[2] = 128 + 224 * yuv[2];
+  }
+
+  /**
+     Decode eight bit YUV values.
+  */
+  static __host__ __device__ inline void decode(float *yuv)
+  {
+    yuv[0] = (yuv[0] - 16) * (1.0f / 219);
+    yuv[1] = (yuv[1] - 128) * (1.0f / 224);
+    yuv[2] = (yuv[2] - 128) * (1.0f / 224);
+  }
+};
+
+/**
+   Conversion from RGB to YUV.
+*/
+struct RgbToYuv: public Yuv
+{
+  RgbToYuv(yuv_standard_t standard): Yuv(standard) {}
+
+  template <bool In8, bool Out8>
+  __host__ __device__ inline void apply(const float *in, float *out) const
+  {
+    float rgb[3];
+
+    for(int i = 0; i < 3; ++i)
+      rgb[i] = In8 ? in[i] * (1.0f / 255) : in[i];
+
+    fromRgb(rgb, out);
+
+    if(Out8)
+      encode(out);
+  }
+};
+
+/**
+   Conversion from YUV to RGB.
+*/
+struct YuvToRgb: public Yuv
+{
+  YuvToRgb(yuv_standard_t standard): Yuv(standard) {}
+
+  template <bool In8, bool Out8>
+  __host__ __device__ inline void apply(const float *in, float *out) const
+  {
+    float yuv[3] = { in[0], in[1], in[2] };
+
+    if(In8)
+      decode(yuv);
+
+    toRgb(yuv, out);
+
+    for(int i = 0; i < 3; ++i)
+      out[i] = Out8 ? out[i] * 255 : out[i];
+  }
+};
+
+/**
+   Conversion between sRGB and CIE L*a*b* (D65 white point).
+   Eight bit Lab values are encoded as L * 255 / 100, a + 128, b + 128,
+   floating point Lab values are not scaled.
+*/
+struct Lab
+{
+  static __host__ __device__ inline float linear(float c)
+  {
+    return (c <= 0.04045f) ? c * (1.0f / 12.92f) : powf((c + 0.055f) * (1.0f / 1.055f), 2.4f);
+  }
+
+  static __host__ __device__ inline float gamma(float c)
+  {
+    return (c <= 0.0031308f) ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+  }
+
+  static __host__ __device__ inline float f(float t)
+  {
+    return (t > 0.008856452f) ? powf(t, 1.0f / 3) : t * 7.787037f + 4.0f / 29;
+  }
+
+  static __host__ __device__ inline float finv(float t)
+  {
+    return (t > 0.20689655f) ? t * t * t : (t - 4.0f / 29) * (1.0f / 7.787037f);
+  }
+};
+
+struct RgbToLab: public Lab
+{
+  template <bool In8, bool Out8>
+  __host__ __device__ inline void apply(const float *in, float *out) const
+  {
+    float r = linear(In8 ? in[0] * (1.0f / 255) : in[0]);
+    float g = linear(In8 ? in[1] * (1.0f / 255) : in[1]);
+    float b = linear(In8 ? in[2] * (1.0f / 255) : in[2]);
+    float fx = f((0.4124564f * r + 0.3575761f * g + 0.1804375f * b) * (1.0f / 0.95047f));
+    float fy = f(0.2126729f * r + 0.7151522f * g + 0.0721750f * b);
+    float fz = f((0.0193339f * r + 0.1191920f * g + 0.9503041f * b) * (1.0f / 1.08883f));
+    out[0] = 116 * fy - 16;
+    out[1] = 500 * (fx - fy);
+    out[2] = 200 * (fy - fz);
+
+    if(Out8) {
+      out[0] *= 2.55f;
+      out[1] += 128;
+      out[2] += 128;
+    }
+  }
+};
+
+struct LabToRgb: public Lab
+{
+  template <bool In8, bool Out8>
+  __host__ __device__ inline void apply(const float *in, float *out) const
+  {
+    float l = In8 ? in[0] * (1.0f / 2.55f) : in[0];
+    float a = In8 ? in[1] - 128 : in[1];
+    float b = In8 ? in[2] - 128 : in[2];
+    float fy = (l + 16) * (1.0f / 116);
+    float x = 0.95047f * finv(fy + a * (1.0f / 500));
+    float y = finv(fy);
+    float z = 1.08883f * finv(fy - b * (1.0f / 200));
+    out[0] = gamma(3.2404542f * x - 1.5371385f * y - 0.4985314f * z);
+    out[1] = gamma(-0.9692660f * x + 1.8760108f * y + 0.0415560f * z);
+    out[2] = gamma(0.0556434f * x - 0.2040259f * y + 1.0572252f * z);
+
+    for(int i = 0; i < 3; ++i) {
+      float c = (out[i] < 0) ? 0 : (out[i] > 1) ? 1 : out[i];
+      out[i] = Out8 ? c * 255 : c;
+    }
+  }
+};
+
+/**
+   Convert a single pixel.
+*/
+template <class Op, class Dst, class Src>
+__host__ __device__ inline void pixel(const Op &op, const Dst &dst, const Src &src, int x, int y)
+{
+  float a[3], b[3];
+  src.load(x, y, a);
+  op.template apply<(bool)Src::integer, (bool)Dst::integer>(a, b);
+  dst.store(x, y, b);
+}
+
+/**
+   Convert a 2x2 block of RGB pixels to YUV 4:2:0.
+   The chroma values are averaged over the block.
+*/
+template <class Src>
+__host__ __device__ inline void toYuv420(const RgbToYuv &op, const Yuv420 &dst, const Src &src, int x, int y)
+{
+  float cb = 0, cr = 0;
+
+  for(int j = 0; j < 2; ++j)
+    for(int i = 0; i < 2; ++i) {
+      float a[3], b[3];
+      src.load(x + i, y + j, a);
+      op.apply<(bool)Src::integer, true>(a, b);
+      dst.y[(y + j) * dst.stride + x + i] = saturate(b[0]);
+      cb += b[1];
+      cr += b[2];
+    }
+
+  size_t o = (y / 2) * dst.stride_uv + (x / 2) * dst.step_uv;
+  dst.u[o] = saturate(0.25f * cb);
+  dst.v[o] = saturate(0.25f * cr);
+}
+
+/**
+   Convert a 2x2 block of YUV 4:2:0 pixels to RGB.
+*/
+template <class Dst>
+__host__ __device__ inline void fromYuv420(const YuvToRgb &op, const Dst &dst, const Yuv420 &src, int x, int y)
+{
+  size_t o = (y / 2) * src.stride_uv + (x / 2) * src.step_uv;
+  float a[3], b[3];
+  a[1] = src.u[o];
+  a[2] = src.v[o];
+
+  for(int j = 0; j < 2; ++j)
+    for(int i = 0; i < 2; ++i) {
+      a[0] = src.y[(y + j) * src.stride + x + i];
+      op.apply<true, (bool)Dst::integer>(a, b);
+      dst.store(x + i, y + j, b);
+    }
+}
+
+template <class Dst, class Src>
+void checkSize(const Dst &dst, const Src &src)
+{
+  if((dst.width != src.width) || (dst.height != src.height))
+    CUDA_ERROR("size mismatch");
+}
+
+/**
+   Convert host image.
+   Rows are distributed among threads (if OpenMP is enabled), each pixel is
+   converted by the scalar code. Conversions between eight bit RGBA and eight
+   bit YUV (planar or 4:2:0) have SSE2 versions below.
+*/
+template <class Op, class Dst, class Src>
+void host(const Op &op, const Dst &dst, const Src &src)
+{
+  checkSize(dst, src);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for(int y = 0; y < dst.height; ++y)
+    for(int x = 0; x < dst.width; ++x)
+      pixel(op, dst, src, x, y);
+}
+
+template <class Src>
+void host(const RgbToYuv &op, const Yuv420 &dst, const Src &src)
+{
+  checkSize(dst, src);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for(int y = 0; y < dst.height; y += 2)
+    for(int x = 0; x < dst.width; x += 2)
+      toYuv420(op, dst, src, x, y);
+}
+
+template <class Dst>
+void host(const YuvToRgb &op, const Dst &dst, const Yuv420 &src)
+{
+  checkSize(dst, src);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for(int y = 0; y < dst.height; y += 2)
+    for(int x = 0; x < dst.width; x += 2)
+      fromYuv420(op, dst, src, x, y);
+}
+
+#ifdef __SSE2__
+
+/**
+   SSE2 conversion between four eight bit RGBA pixels and YUV.
+   The single precision operations are those of RgbToYuv and YuvToRgb in the
+   same order, so the results match the scalar code.
+*/
+class Sse2Yuv
+{
+public:
+  Sse2Yuv(const Yuv &yuv):
+    kr(_mm_set1_ps(yuv.kr)), kg(_mm_set1_ps(1 - yuv.kr - yuv.kb)), kb(_mm_set1_ps(yuv.kb)),
+    ku(_mm_set1_ps(0.5f / (1 - yuv.kb))), kv(_mm_set1_ps(0.5f / (1 - yuv.kr))),
+    cr(_mm_set1_ps(2 * (1 - yuv.kr))), cb(_mm_set1_ps(2 * (1 - yuv.kb)))
+  {
+  }
+
+  /**
+     Convert four RGBA pixels to eight bit YUV values (not yet rounded).
+  */
+  inline void fromRgba(const uchar4 *p, __m128 *yuv) const
+  {
+    const __m128i v = _mm_loadu_si128((const __m128i *)p), m = _mm_set1_epi32(0xff);
+    const __m128 k = _mm_set1_ps(1.0f / 255);
+    __m128 r = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(v, m)), k);
+    __m128 g = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(v, 8), m)), k);
+    __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(v, 16), m)), k);
+    __m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(kr, r), _mm_mul_ps(kg, g)), _mm_mul_ps(kb, b));
+    yuv[0] = _mm_add_ps(_mm_set1_ps(16), _mm_mul_ps(_mm_set1_ps(219), y));
+    yuv[1] = _mm_add_ps(_mm_set1_ps(128), _mm_mul_ps(_mm_set1_ps(224), _mm_mul_ps(_mm_sub_ps(b, y), ku)));
+    yuv[2] = _mm_add_ps(_mm_set1_ps(128), _mm_mul_ps(_mm_set1_ps(224), _mm_mul_ps(_mm_sub_ps(r, y), kv)));
+  }
+
+  /**
+     Convert four eight bit YUV values to opaque RGBA pixels.
+  */
+  inline void toRgba(const __m128 *yuv, uchar4 *p) const
+  {
+    __m128 y = _mm_mul_ps(_mm_sub_ps(yuv[0], _mm_set1_ps(16)), _mm_set1_ps(1.0f / 219));
+    __m128 u = _mm_mul_ps(_mm_sub_ps(yuv[1], _mm_set1_ps(128)), _mm_set1_ps(1.0f / 224));
+    __m128 v = _mm_mul_ps(_mm_sub_ps(yuv[2], _mm_set1_ps(128)), _mm_set1_ps(1.0f / 224));
+    __m128 r = _mm_add_ps(y, _mm_mul_ps(cr, v));
+    __m128 b = _mm_add_ps(y, _mm_mul_ps(cb, u));
+    __m128 g = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(y, _mm_mul_ps(kr, r)), _mm_mul_ps(kb, b)), kg);
+    const __m128 k = _mm_set1_ps(255);
+    __m128i c = _mm_or_si128(saturate(_mm_mul_ps(r, k)), _mm_slli_epi32(saturate(_mm_mul_ps(g, k)), 8));
+    c = _mm_or_si128(c, _mm_slli_epi32(saturate(_mm_mul_ps(b, k)), 16));
+    _mm_storeu_si128((__m128i *)p, _mm_or_si128(c, _mm_set1_epi32((int)0xff000000)));
+  }
+
+  /**
+     Round and saturate to eight bits (as 32 bit integers), see Color::saturate.
+  */
+  static inline __m128i saturate(__m128 v)
+  {
+    v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(255));
+    return _mm_cvttps_epi32(_mm_add_ps(v, _mm_set1_ps(0.5f)));
+  }
+
+  /**
+     Round, saturate and store four eight bit values.
+  */
+  static inline void store(unsigned char *p, __m128 v)
+  {
+    __m128i c = saturate(v);
+    c = _mm_packs_epi32(c, c);
+    int i = _mm_cvtsi128_si32(_mm_packus_epi16(c, c));
+    memcpy(p, &i, 4);
+  }
+
+  /**
+     Load four eight bit values.
+  */
+  static inline __m128 load(const unsigned char *p)
+  {
+    int i;
+    memcpy(&i, p, 4);
+    const __m128i z = _mm_setzero_si128();
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(i), z), z));
+  }
+
+private:
+  __m128 kr, kg, kb, ku, kv, cr, cb;
+};
+
+/**
+   Convert eight bit RGBA to planar eight bit YUV with SSE2.
+*/
+inline void host(const RgbToYuv &op, const Planar<unsigned char> &dst, const Interleaved<uchar4> &src)
+{
+  checkSize(dst, src);
+  const Sse2Yuv sse(op);
+  const int w4 = dst.width & ~3;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for(int y = 0; y < dst.height; ++y) {
+    for(int x = 0; x < w4; x += 4) {
+      __m128 c[3];
+      sse.fromRgba(src.data + y * src.stride + x, c);
+      unsigned char *p = dst.data + y * dst.stride + x;
+      Sse2Yuv::store(p, c[0]);
+      Sse2Yuv::store(p + dst.plane, c[1]);
+      Sse2Yuv::store(p + 2 * dst.plane, c[2]);
+    }
+
+    for(int x = w4; x < dst.width; ++x)
+      pixel(op, dst, src, x, y);
+  }
+}
+
+/**
+   Convert planar eight bit YUV to eight bit RGBA with SSE2.
+*/
+inline void host(const YuvToRgb &op, const Interleaved<uchar4> &dst, const Planar<unsigned char> &src)
+{
+  checkSize(dst, src);
+  const Sse2Yuv sse(op);
+  const int w4 = dst.width & ~3;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for(int y = 0; y < dst.height; ++y) {
+    for(int x = 0; x < w4; x += 4) {
+      const unsigned char *p = src.data + y * src.stride + x;
+      __m128 c[3] = { Sse2Yuv::load(p), Sse2Yuv::load(p + src.plane), Sse2Yuv::load(p + 2 * src.plane) };
+      sse.toRgba(c, dst.data + y * dst.stride + x);
+    }
+
+    for(int x = w4; x < dst.width; ++x)
+      pixel(op, dst, src, x, y);
+  }
+}
+
+/**
+   Convert eight bit RGBA to YUV 4:2:0 with SSE2.
+   Each step converts two 2x2 blocks, the chroma values are summed in the
+   same order as in toYuv420.
+*/
+inline void host(const RgbToYuv &op, const Yuv420 &dst, const Interleaved<uchar4> &src)
+{
+  checkSize(dst, src);
+  const Sse2Yuv sse(op);
+  const int w4 = dst.width & ~3;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for(int y = 0; y < dst.height; y += 2) {
+    for(int x = 0; x < w4; x += 4) {
+      __m128 c0[3], c1[3];
+      sse.fromRgba(src.data + y * src.stride + x, c0);
+      sse.fromRgba(src.data + (y + 1) * src.stride + x, c1);
+      Sse2Yuv::store(dst.y + y * dst.stride + x, c0[0]);
+      Sse2Yuv::store(dst.y + (y + 1) * dst.stride + x, c1[0]);
+      size_t o = (y / 2) * dst.stride_uv + (x / 2) * dst.step_uv;
+
+      for(int k = 1; k < 3; ++k) {
+	// lanes 0 and 1 hold the sums of the two blocks:
+	__m128 s = _mm_add_ps(_mm_shuffle_ps(c0[k], c0[k], _MM_SHUFFLE(2, 0, 2, 0)),
+			      _mm_shuffle_ps(c0[k], c0[k], _MM_SHUFFLE(3, 1, 3, 1)));
+	s = _mm_add_ps(s, _mm_shuffle_ps(c1[k], c1[k], _MM_SHUFFLE(2, 0, 2, 0)));
+	s = _mm_add_ps(s, _mm_shuffle_ps(c1[k], c1[k], _MM_SHUFFLE(3, 1, 3, 1)));
+	__m128i c = Sse2Yuv::saturate(_mm_mul_ps(_mm_set1_ps(0.25f), s));
+	unsigned char *p = ((k == 1) ? dst.u : dst.v) + o;
+	p[0] = (unsigned char)_mm_cvtsi128_si32(c);
+	p[dst.step_uv] = (unsigned char)_mm_cvtsi128_si32(_mm_srli_si128(c, 4));
+      }
+    }
+
+    for(int x = w4; x < dst.width; x += 2)
+      toYuv420(op, dst, src, x, y);
+  }
+}
+
+/**
+   Convert YUV 4:2:0 to eight bit RGBA with SSE2.
+*/
+inline void host(const YuvToRgb &op, const Interleaved<uchar4> &dst, const Yuv420 &src)
+{
+  checkSize(dst, src);
+  const Sse2Yuv sse(op);
+  const int w4 = dst.width & ~3;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for(int y = 0; y < dst.height; y += 2) {
+    for(int x = 0; x < w4; x += 4) {
+      size_t o = (y / 2) * src.stride_uv + (x / 2) * src.step_uv;
+      __m128 c[3];
+      c[1] = _mm_setr_ps(src.u[o], src.u[o], src.u[o + src.step_uv], src.u[o + src.step_uv]);
+      c[2] = _mm_setr_ps(src.v[o], src.v[o], src.v[o + src.step_uv], src.v[o + src.step_uv]);
+
+      for(int j = 0; j < 2; ++j) {
+	c[0] = Sse2Yuv::load(src.y + (y + j) * src.stride + x);
+	sse.toRgba(c, dst.data + (y + j) * dst.stride + x);
+      }
+    }
+
+    for(int x = w4; x < dst.width; x += 2)
+      fromYuv420(op, dst, src, x, y);
+  }
+}
+
+#endif  // __SSE2__
+
+#ifdef __CUDACC__
+
+template <class Op, class Dst, class Src>
+__global__ void pixel_kernel(Op op, Dst dst, Src src)
+{
+  int x = threadIdx.x + blockIdx.x * blockDim.x;
+  int y = threadIdx.y + blockIdx.y * blockDim.y;
+
+  if((x < dst.width) && (y < dst.height))
+    pixel(op, dst, src, x, y);
+}
+
+template <class Src>
+__global__ void to_yuv420_kernel(RgbToYuv op, Yuv420 dst, Src src)
+{
+  int x = 2 * (threadIdx.x + blockIdx.x * blockDim.x);
+  int y = 2 * (threadIdx.y + blockIdx.y * blockDim.y);
+
+  if((x < dst.width) && (y < dst.height))
+    toYuv420(op, dst, src, x, y);
+}
+
+template <class Dst>
+__global__ void from_yuv420_kernel(YuvToRgb op, Dst dst, Yuv420 src)
+{
+  int x = 2 * (threadIdx.x + blockIdx.x * blockDim.x);
+  int y = 2 * (threadIdx.y + blockIdx.y * blockDim.y);
+
+  if((x < dst.width) && (y < dst.height))
+    fromYuv420(op, dst, src, x, y);
+}
+
+/**
+   Grid covering width * height threads.
+*/
+static inline dim3 grid(int width, int height)
+{
+  return dim3((width + CUDA_COLOR_BLOCK_X - 1) / CUDA_COLOR_BLOCK_X, (height + CUDA_COLOR_BLOCK_Y - 1) / CUDA_COLOR_BLOCK_Y);
+}
+
+/**
+   Convert device image, one thread per pixel.
+*/
+template <class Op, class Dst, class Src>
+void device(const Op &op, const Dst &dst, const Src &src)
+{
+  checkSize(dst, src);
+  pixel_kernel<<<grid(dst.width, dst.height), dim3(CUDA_COLOR_BLOCK_X, CUDA_COLOR_BLOCK_Y)>>>(op, dst, src);
+  CUDA_CHECK(cudaGetLastError());
+}
+
+template <class Src>
+void device(const RgbToYuv &op, const Yuv420 &dst, const Src &src)
+{
+  checkSize(dst, src);
+  to_yuv420_kernel<<<grid(dst.width / 2, dst.height / 2), dim3(CUDA_COLOR_BLOCK_X, CUDA_COLOR_BLOCK_Y)>>>(op, dst, src);
+  CUDA_CHECK(cudaGetLastError());
+}
+
+template <class Dst>
+void device(const YuvToRgb &op, const Dst &dst, const Yuv420 &src)
+{
+  checkSize(dst, src);
+  from_yuv420_kernel<<<grid(dst.width / 2, dst.height / 2), dim3(CUDA_COLOR_BLOCK_X, CUDA_COLOR_BLOCK_Y)>>>(op, dst, src);
+  CUDA_CHECK(cudaGetLastError());
+}
+
+#endif  // __CUDACC__
+
+}  // namespace Color
+
+
+/*
+  The conversion functions below accept interleaved images (Dim == 2,
+  elements of type uchar3, uchar4, float3 or float4) and planar images
+  (Dim == 3 with three planes, elements of type unsigned char or float) for
+  source and destination. Eight bit channels hold values in [0, 255], floating
+  point RGB channels in [0, 1].
+*/
+
+#define CUDA_COLOR_FUNCTIONS(Memory, run)				\
+  template <class Type1, unsigned Dim1, class Type2, unsigned Dim2>	\
+  void rgbToYuv(Memory<Type1, Dim1> &dst, const Memory<Type2, Dim2> &src, yuv_standard_t standard = YUV_BT601) \
+  {									\
+    Color::run(Color::RgbToYuv(standard), typename Color::View<Type1, Dim1>::type(dst, dst.getBuffer()), \
+	       typename Color::View<Type2, Dim2>::type(src, const_cast<Type2 *>(src.getBuffer()))); \
+  }									\
+									\
+  template <class Type1, unsigned Dim1, class Type2, unsigned Dim2>	\
+  void yuvToRgb(Memory<Type1, Dim1> &dst, const Memory<Type2, Dim2> &src, yuv_standard_t standard = YUV_BT601) \
+  {									\
+    Color::run(Color::YuvToRgb(standard), typename Color::View<Type1, Dim1>::type(dst, dst.getBuffer()), \
+	       typename Color::View<Type2, Dim2>::type(src, const_cast<Type2 *>(src.getBuffer()))); \
+  }									\
+									\
+  template <class Type1, unsigned Dim1, class Type2, unsigned Dim2>	\
+  void rgbToLab(Memory<Type1, Dim1> &dst, const Memory<Type2, Dim2> &src) \
+  {									\
+    Color::run(Color::RgbToLab(), typename Color::View<Type1, Dim1>::type(dst, dst.getBuffer()), \
+	       typename Color::View<Type2, Dim2>::type(src, const_cast<Type2 *>(src.getBuffer()))); \
+  }									\
+									\
+  template <class Type1, unsigned Dim1, class Type2, unsigned Dim2>	\
+  void labToRgb(Memory<Type1, Dim1> &dst, const Memory<Type2, Dim2> &src) \
+  {									\
+    Color::run(Color::LabToRgb(), typename Color::View<Type1, Dim1>::type(dst, dst.getBuffer()), \
+	       typename Color::View<Type2, Dim2>::type(src, const_cast<Type2 *>(src.getBuffer()))); \
+  }									\
+									\
+  template <class Type, unsigned Dim>					\
+  void rgbToNv12(Memory<unsigned char, 2> &dst, const Memory<Type, Dim> &src, yuv_standard_t standard = YUV_BT601) \
+  {									\
+    Color::run(Color::RgbToYuv(standard), Color::Yuv420(dst, dst.getBuffer(), true), \
+	       typename Color::View<Type, Dim>::type(src, const_cast<Type *>(src.getBuffer()))); \
+  }									\
+									\
+  template <class Type, unsigned Dim>					\
+  void nv12ToRgb(Memory<Type, Dim> &dst, const Memory<unsigned char, 2> &src, yuv_standard_t standard = YUV_BT601) \
+  {									\
+    Color::run(Color::YuvToRgb(standard), typename Color::View<Type, Dim>::type(dst, dst.getBuffer()), \
+	       Color::Yuv420(src, const_cast<unsigned char *>(src.getBuffer()), true)); \
+  }									\
+									\
+  template <class Type, unsigned Dim>					\
+  void rgbToI420(Memory<unsigned char, 2> &dst, const Memory<Type, Dim> &src, yuv_standard_t standard = YUV_BT601) \
+  {									\
+    Color::run(Color::RgbToYuv(standard), Color::Yuv420(dst, dst.getBuffer(), false), \
+	       typename Color::View<Type, Dim>::type(src, const_cast<Type *>(src.getBuffer()))); \
+  }									\
+									\
+  template <class Type, unsigned Dim>					\
+  void i420ToRgb(Memory<Type, Dim> &dst, const Memory<unsigned char, 2> &src, yuv_standard_t standard = YUV_BT601) \
+  {									\
+    Color::run(Color::YuvToRgb(standard), typename Color::View<Type, Dim>::type(dst, dst.getBuffer()), \
+	       Color::Yuv420(src, const_cast<unsigned char *>(src.getBuffer()), false)); \
+  }
+
+/**
+   @fn rgbToYuv(HostMemory<Type1, Dim1> &dst, const HostMemory<Type2, Dim2> &src, yuv_standard_t standard)
+   Convert RGB to YUV.
+
+   @fn yuvToRgb(HostMemory<Type1, Dim1> &dst, const HostMemory<Type2, Dim2> &src, yuv_standard_t standard)
+   Convert YUV to RGB.
+
+   @fn rgbToLab(HostMemory<Type1, Dim1> &dst, const HostMemory<Type2, Dim2> &src)
+   Convert sRGB to CIE L*a*b*.
+
+   @fn labToRgb(HostMemory<Type1, Dim1> &dst, const HostMemory<Type2, Dim2> &src)
+   Convert CIE L*a*b* to sRGB.
+
+   @fn rgbToNv12(HostMemory<unsigned char, 2> &dst, const HostMemory<Type, Dim> &src, yuv_standard_t standard)
+   Convert RGB (or RGBA) to NV12, the destination has size width * (height * 3 / 2).
+
+   @fn nv12ToRgb(HostMemory<Type, Dim> &dst, const HostMemory<unsigned char, 2> &src, yuv_standard_t standard)
+   Convert NV12 to RGB (or RGBA).
+
+   @fn rgbToI420(HostMemory<unsigned char, 2> &dst, const HostMemory<Type, Dim> &src, yuv_standard_t standard)
+   Convert RGB (or RGBA) to I420, the destination has size width * (height * 3 / 2).
+
+   @fn i420ToRgb(HostMemory<Type, Dim> &dst, const HostMemory<unsigned char, 2> &src, yuv_standard_t standard)
+   Convert I420 to RGB (or RGBA).
+*/
+CUDA_COLOR_FUNCTIONS(HostMemory, host)
+
+#ifdef __CUDACC__
+CUDA_COLOR_FUNCTIONS(DeviceMemory, device)
+#endif
+
+#undef CUDA_COLOR_FUNCTIONS
+
+}  // namespace Cuda
+
+
+#endif
@@ -0,0 +1,604 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_COMPRESSION_H
+#define CUDA_COMPRESSION_H
+
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/error.hpp>
+#include <cudatemplates/hostmemory.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+
+
+/**
+   Size of independently compressed blocks (in bytes).
+   Blocks are processed in parallel, so this bounds the granularity of the
+   parallelization.
+*/
+#ifndef CUDA_COMPRESSION_BLOCK
+#define CUDA_COMPRESSION_BLOCK (256 << 10)
+#endif
+
+/**
+   Number of bits of the hash table used to find matches.
+*/
+#ifndef CUDA_COMPRESSION_HASH_BITS
+#define CUDA_COMPRESSION_HASH_BITS 14
+#endif
+
+
+namespace Cuda {
+
+/**
+   Lossless compression of numerical data.
+   The data is split into blocks which are compressed independently (and in
+   parallel if OpenMP is enabled). Each block is filtered before compression:
+   - each element is replaced by its difference to the previous one (with
+     wrap-around, so this is lossless for any bit pattern),
+   - the bytes of the differences are shuffled such that all least
+     significant bytes come first, then all second bytes, and so on.
+   For smooth data such as medical volumes, this produces long runs of
+   small and equal bytes, which are compressed by a fast LZ77 coder (byte
+   aligned tokens in the spirit of LZ4, no entropy coding). Blocks which
+   don't get smaller are stored unmodified.
+
+   Encoded data consists of a header (number of raw bytes, element size,
+   block size, number of blocks), the size of each encoded block and the
+   encoded blocks.
+*/
+namespace Compression {
+
+/** flag in block size which marks a block stored without compression */
+static const uint32_t STORED = 0x80000000u;
+
+/** size of fixed part of header */
+static const size_t HEADER = 20;
+
+/** minimum length of a match */
+static const size_t MIN_MATCH = 4;
+
+/** maximum distance of a match */
+static const size_t MAX_OFFSET = 65535;
+
+/**
+   Get number of blocks.
+*/
+inline size_t
+blocks(size_t bytes)
+{
+  return (bytes + CUDA_COMPRESSION_BLOCK - 1) / CUDA_COMPRESSION_BLOCK;
+}
+
+/**
+   Get maximum size of encoded data.
+   @param bytes number of raw bytes
+*/
+inline size_t
+bound(size_t bytes)
+{
+  return HEADER + blocks(bytes) * 4 + bytes;
+}
+
+static inline uint32_t
+read32(const unsigned char *p)
+{
+  uint32_t x;
+  memcpy(&x, p, 4);
+  return x;
+}
+
+static inline void
+put32(unsigned char *p, uint32_t x)
+{
+  for(int i = 0; i < 4; ++i)
+    p[i] = (unsigned char)(x >> (8 * i));
+}
+
+static inline uint32_t
+get32(const unsigned char *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+   Apply delta and byte shuffle filter.
+   @param dst filtered data
+   @param src raw data
+   @param count number of elements
+*/
+template <class Word>
+void
+filter(unsigned char *dst, const unsigned char *src, size_t count)
+{
+  Word prev = 0;
+
+  for(size_t i = 0; i < count; ++i) {
+    Word x;
+    memcpy(&x, src + i * sizeof(Word), sizeof(Word));
+    Word d = x - prev;
+    prev = x;
+
+    for(size_t b = 0; b < sizeof(Word); ++b)
+      dst[b * count + i] = (unsigned char)(d >> (8 * b));
+  }
+}
+
+/**
+   Undo delta and byte shuffle filter.
+   @param dst raw data
+   @param src filtered data
+   @param count number of elements
+*/
+template <class Word>
+void
+unfilter(unsigned char *dst, const unsigned char *src, size_t count)
+{
+  Word prev = 0;
+
+  for(size_t i = 0; i < count; ++i) {
+    Word d = 0;
+
+    for(size_t b = 0; b < sizeof(Word); ++b)
+      d |= (Word)src[b * count + i] << (8 * b);
+
+    prev += d;
+    memcpy(dst + i * sizeof(Word), &prev, sizeof(Word));
+  }
+}
+
+/**
+   Write length extension of LZ token.
+*/
+static inline unsigned char *
+length(unsigned char *op, size_t n)
+{
+  for(; n >= 255; n -= 255)
+    *op++ = 255;
+
+  *op++ = (unsigned char)n;
+  return op;
+}
+
+/**
+   Write LZ sequence (literals followed by an optional match).
+*/
+static inline unsigned char *
+sequence(unsigned char *op, const unsigned char *literals, size_t lit, size_t offset, size_t match)
+{
+  unsigned char *token = op++;
+  size_t m = match ? match - MIN_MATCH : 0;
+  *token = (unsigned char)(((lit < 15) ? lit : 15) << 4) | ((m < 15) ? m : 15);
+
+  if(lit >= 15)
+    op = length(op, lit - 15);
+
+  memcpy(op, literals, lit);
+  op += lit;
+
+  if(match) {
+    *op++ = (unsigned char)offset;
+    *op++ = (unsigned char)(offset >> 8);
+
+    if(m >= 15)
+      op = length(op, m - 15);
+  }
+
+  return op;
+}
+
+/**
+   LZ compression.
+   @param dst compressed data
+   @param limit maximum size of compressed data
+   @param src raw data
+   @param n number of raw bytes
+   @return size of compressed data, or 0 if it would exceed limit
+*/
+inline size_t
+compress(unsigned char *dst, size_t limit, const unsigned char *src, size_t n)
+{
+  // positions + 1 of previous occurrences, 0 means none:
+  uint32_t table[1 << CUDA_COMPRESSION_HASH_BITS];
+  memset(table, 0, sizeof(table));
+
+  unsigned char *op = dst;
+  const unsigned char *end = dst + limit;
+  size_t anchor = 0, ip = 0;
+
+  // the last bytes are always literals, which simplifies decoding:
+  const size_t match_limit = (n > 12) ? n - 12 : 0, match_end = (n > 5) ? n - 5 : 0;
+
+  while(ip < match_limit) {
+    uint32_t seq = read32(src + ip);
+    uint32_t h = (seq * 2654435761u) >> (32 - CUDA_COMPRESSION_HASH_BITS);
+    size_t ref = table[h];
+    table[h] = ip + 1;
+
+    if((ref == 0) || (ip + 1 - ref > MAX_OFFSET) || (read32(src + ref - 1) != seq)) {
+      // skip faster through incompressible data:
+      ip += 1 + ((ip - anchor) >> 6);
+      continue;
+    }
+
+    --ref;
+    size_t len = MIN_MATCH;
+
+    while((ip + len < match_end) && (src[ref + len] == src[ip + len]))
+      ++len;
+
+    size_t lit = ip - anchor;
+
+    // worst case size of sequence:
+    if(op + 1 + lit + lit / 255 + 3 + len / 255 + 1 > end)
+      return 0;
+
+    op = sequence(op, src + anchor, lit, ip - ref, len);
+    ip += len;
+    anchor = ip;
+  }
+
+  size_t lit = n - anchor;
+
+  if(op + 1 + lit + lit / 255 + 1 > end)
+    return 0;
+
+  op = sequence(op, src + anchor, lit, 0, 0);
+  return op - dst;
+}
+
+/**
+   Read length extension of LZ token.
+*/
+static inline size_t
+length(const unsigned char *&ip, const unsigned char *end, size_t n)
+{
+  if(n < 15)
+    return n;
+
+  for(;;) {
+    if(ip >= end)
+      CUDA_ERROR("corrupt compressed data");
+
+    unsigned char c = *ip++;
+    n += c;
+
+    if(c != 255)
+      return n;
+  }
+}
+
+/**
+   LZ decompression.
+   @param dst raw data
+   @param n number of raw bytes
+   @param src compressed data
+   @param bytes size of compressed data
+*/
+inline void
+decompress(unsigned char *dst, size_t n, const unsigned char *src, size_t bytes)
+{
+  const unsigned char *ip = src, *iend = src + bytes;
+  unsigned char *op = dst, *oend = dst + n;
+
+  for(;;) {
+    if(ip >= iend)
+      CUDA_ERROR("corrupt compressed data");
+
+    unsigned token = *ip++;
+    size_t lit = length(ip, iend, token >> 4);
+
+    if((lit > (size_t)(iend - ip)) || (lit > (size_t)(oend - op)))
+      CUDA_ERROR("corrupt compressed data");
+
+    memcpy(op, ip, lit);
+    ip += lit;
+    op += lit;
+
+    // the last sequence consists of literals only:
+    if(ip == iend)
+      break;
+
+    if(iend - ip < 2)
+      CUDA_ERROR("corrupt compressed data");
+
+    size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    size_t len = length(ip, iend, token & 15) + MIN_MATCH;
+
+    if((offset == 0) || (offset > (size_t)(op - dst)) || (len > (size_t)(oend - op)))
+      CUDA_ERROR("corrupt compressed data");
+
+    const unsigned char *match = op - offset;
+
+    if((offset >= 8) && (len + 8 <= (size_t)(oend - op))) {
+      // copy in words, source is always at least one word behind:
+      for(size_t i = 0; i < len; i += 8)
+	memcpy(op + i, match + i, 8);
+    }
+    else {
+      for(size_t i = 0; i < len; ++i)
+	op[i] = match[i];
+    }
+
+    op += len;
+  }
+
+  if(op != oend)
+    CUDA_ERROR("corrupt compressed data");
+}
+
+/**
+   Apply filter for given element size.
+*/
+inline void
+filter(unsigned char *dst, const unsigned char *src, size_t n, size_t typesize)
+{
+  switch(typesize) {
+  case 2: filter<uint16_t>(dst, src, n / 2); break;
+  case 4: filter<uint32_t>(dst, src, n / 4); break;
+  case 8: filter<uint64_t>(dst, src, n / 8); break;
+  default: filter<uint8_t>(dst, src, n); break;
+  }
+}
+
+/**
+   Undo filter for given element size.
+*/
+inline void
+unfilter(unsigned char *dst, const unsigned char *src, size_t n, size_t typesize)
+{
+  switch(typesize) {
+  case 2: unfilter<uint16_t>(dst, src, n / 2); break;
+  case 4: unfilter<uint32_t>(dst, src, n / 4); break;
+  case 8: unfilter<uint64_t>(dst, src, n / 8); break;
+  default: unfilter<uint8_t>(dst, src, n); break;
+  }
+}
+
+/**
+   Encode data.
+   @param dst encoded data, must provide at least bound(bytes) bytes
+   @param src raw data
+   @param bytes number of raw bytes
+   @param typesize size of elements (or of their components) in bytes, the
+   filter works on elements of 1, 2, 4 or 8 bytes
+   @return size of encoded data
+*/
+inline size_t
+encode(void *dst, const void *src, size_t bytes, size_t typesize)
+{
+  if(((typesize != 2) && (typesize != 4) && (typesize != 8)) || (bytes % typesize != 0))
+    typesize = 1;
+
+  unsigned char *out = (unsigned char *)dst;
+  const unsigned char *in = (const unsigned char *)src;
+  const int count = blocks(bytes);
+  unsigned char *data = out + HEADER + count * 4;
+  std::vector<uint32_t> sizes(count);
+
+  put32(out, (uint32_t)bytes);
+  put32(out + 4, (uint32_t)((uint64_t)bytes >> 32));
+  put32(out + 8, typesize);
+  put32(out + 12, CUDA_COMPRESSION_BLOCK);
+  put32(out + 16, count);
+
+  // blocks are first encoded into their slots of maximum size:
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    std::vector<unsigned char> filtered(CUDA_COMPRESSION_BLOCK);
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for(int i = 0; i < count; ++i) {
+      size_t ofs = (size_t)i * CUDA_COMPRESSION_BLOCK;
+      size_t n = (bytes - ofs < CUDA_COMPRESSION_BLOCK) ? bytes - ofs : CUDA_COMPRESSION_BLOCK;
+      filter(&filtered[0], in + ofs, n, typesize);
+      size_t m = compress(data + ofs, n - 1, &filtered[0], n);
+
+      if(m == 0) {
+	memcpy(data + ofs, in + ofs, n);
+	sizes[i] = n | STORED;
+      }
+      else
+	sizes[i] = m;
+    }
+  }
+
+  // remove gaps between blocks:
+  size_t pos = 0;
+
+  for(int i = 0; i < count; ++i) {
+    size_t n = sizes[i] & ~STORED;
+    memmove(data + pos, data + (size_t)i * CUDA_COMPRESSION_BLOCK, n);
+    put32(out + HEADER + i * 4, sizes[i]);
+    pos += n;
+  }
+
+  return data + pos - out;
+}
+
+/**
+   Get number of raw bytes of encoded data.
+   @param src encoded data
+   @param bytes size of encoded data
+*/
+inline size_t
+size(const void *src, size_t bytes)
+{
+  const unsigned char *in = (const unsigned char *)src;
+
+  if(bytes < HEADER)
+    CUDA_ERROR("corrupt compressed data");
+
+  return get32(in) | ((uint64_t)get32(in + 4) << 32);
+}
+
+/**
+   Decode data.
+   @param dst raw data
+   @param n number of raw bytes (as passed to encode)
+   @param src encoded data
+   @param bytes size of encoded data
+*/
+inline void
+decode(void *dst, size_t n, const void *src, size_t bytes)
+{
+  const unsigned char *in = (const unsigned char *)src;
+  unsigned char *out = (unsigned char *)dst;
+
+  if(size(src, bytes) != n)
+    CUDA_ERROR("size mismatch");
+
+  const size_t typesize = get32(in + 8), block = get32(in + 12);
+  const int count = get32(in + 16);
+
+  if(((typesize != 1) && (typesize != 2) && (typesize != 4) && (typesize != 8)) ||
+     (block == 0) || ((n + block - 1) / block != (size_t)count) || (HEADER + (size_t)count * 4 > bytes) ||
+     (block % typesize != 0) || (n % typesize != 0))
+    CUDA_ERROR("corrupt compressed data");
+
+  // offsets of blocks:
+  std::vector<size_t> ofs(count + 1);
+  ofs[0] = HEADER + count * 4;
+
+  for(int i = 0; i < count; ++i)
+    ofs[i + 1] = ofs[i] + (get32(in + HEADER + i * 4) & ~STORED);
+
+  if(ofs[count] > bytes)
+    CUDA_ERROR("corrupt compressed data");
+
+  // the block size is taken from the data, so don't trust it for allocation:
+  const size_t filtered_bytes = (block < n) ? block : n;
+  bool ok = true;
+
+#ifdef _OPENMP
+#pragma omp parallel reduction(&&:ok)
+#endif
+  {
+    std::vector<unsigned char> filtered;
+
+    // exceptions must not leave the parallel region:
+    try {
+      filtered.resize(filtered_bytes);
+    }
+    catch(...) {
+      ok = false;
+    }
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for(int i = 0; i < count; ++i) {
+      size_t pos = (size_t)i * block;
+      size_t m = (n - pos < block) ? n - pos : block;
+      const unsigned char *p = in + ofs[i];
+
+      if(filtered.size() < m) {
+	ok = false;
+	continue;
+      }
+
+      if(get32(in + HEADER + i * 4) & STORED) {
+	if(ofs[i + 1] - ofs[i] == m)
+	  memcpy(out + pos, p, m);
+	else
+	  ok = false;
+
+	continue;
+      }
+
+      try {
+	decompress(&filtered[0], m, p, ofs[i + 1] - ofs[i]);
+	unfilter(out + pos, &filtered[0], m, typesize);
+      }
+      catch(...) {
+	ok = false;
+      }
+    }
+  }
+
+  if(!ok)
+    CUDA_ERROR("corrupt compressed data");
+}
+
+/**
+   Encode host memory.
+   The element type determines the filter, e.g., a volume of unsigned short
+   values is filtered in 16 bit words. Padded data is packed first, so only
+   the elements are encoded.
+   @param dst encoded data (resized as required)
+   @param src source pointer
+*/
+template <class Type, unsigned Dim>
+void
+encode(std::vector<unsigned char> &dst, const HostMemory<Type, Dim> &src)
+{
+  const size_t bytes = src.getNumElements() * sizeof(Type);
+  dst.resize(bound(bytes));
+  HostMemoryHeap<Type, Dim> *packed = 0;
+  const Type *data = src.getBuffer();
+
+  if(src.getSize() != src.getNumElements()) {
+    packed = new HostMemoryHeap<Type, Dim>(src.size);
+    copy(*packed, src);
+    data = packed->getBuffer();
+  }
+
+  dst.resize(encode(&dst[0], data, bytes, sizeof(Type)));
+  delete packed;
+}
+
+/**
+   Decode into host memory.
+   @param dst destination pointer, must have the size of the encoded data
+   (its pitch may differ from the encoded data, which is packed)
+   @param src encoded data
+*/
+template <class Type, unsigned Dim>
+void
+decode(HostMemory<Type, Dim> &dst, const std::vector<unsigned char> &src)
+{
+  const size_t bytes = dst.getNumElements() * sizeof(Type);
+
+  if(dst.getSize() == dst.getNumElements()) {
+    decode(dst.getBuffer(), bytes, &src[0], src.size());
+    return;
+  }
+
+  HostMemoryHeap<Type, Dim> packed(dst.size);
+  decode(packed.getBuffer(), bytes, &src[0], src.size());
+  copy(dst, packed);
+}
+
+}  // namespace Compression
+
+}  // namespace Cuda
+
+
+#endif
@@ -24,11 +24,29 @@
 
 #include <cudatemplates/copy.hpp>
 #include <cudatemplates/dimension.hpp>
+#include <cudatemplates/half.hpp>
 #include <cudatemplates/hostmemory.hpp>
 
 
 namespace Cuda {
 
+/**
+   Convert consecutive elements on the host.
+   This is the inner loop of the host conversion functions. It is
+   overloaded for element types with faster conversion routines (see
+   half.hpp).
+   @param dst destination pointer
+   @param src source pointer
+   @param n number of elements
+*/
+template <class Type1, class Type2>
+inline void
+convert(Type1 *dst, const Type2 *src, size_t n)
+{
+  for(size_t i = 0; i < n; ++i)
+    dst[i] = src[i];
+}
+
 #ifdef __CUDACC__
 
 template <class Type1, class Type2>
@@ -131,10 +149,7 @@ void
 copy(HostMemory<Type1, Dim> &dst, const HostMemory<Type2, Dim> &src)
 {
   CUDA_CHECK_SIZE;
-  Cuda::Iterator<Dim> src_end = src.end();
-
-  for(Cuda::Iterator<Dim> i = src.begin(); i != src_end; ++i)
-    dst[i] = src[i];
+  copy(dst, src, Size<Dim>(), Size<Dim>(), src.size);
 }
 
 #if defined(__CUDACC__) || defined(__DOXYGEN__)
@@ -181,13 +196,19 @@ copy(HostMemory<Type1, Dim> &dst, const HostMemory<Type2, Dim> &src,
      const Size<Dim> &dst_ofs, const Size<Dim> &src_ofs, const Size<Dim> &size)
 {
   check_bounds(dst, src, dst_ofs, src_ofs, size);
-  Cuda::Iterator<Dim> src_begin(src_ofs, Cuda::Size<Dim>(src_ofs + size));
-  Cuda::Iterator<Dim> src_end = src_begin;
-  src_end.setEnd();
-  Cuda::Iterator<Dim> dst_begin(dst_ofs, Cuda::Size<Dim>(dst_ofs + size));
 
-  for(Cuda::Iterator<Dim> i = src_begin, j = dst_begin; i != src_end; ++i, ++j)
-    dst[j] = src[i];
+  for(unsigned i = Dim; i--;)
+    if(size[i] == 0)
+      return;
+
+  // convert row by row:
+  Size<Dim> rows(size);
+  rows[0] = 1;
+  Cuda::Iterator<Dim> begin(Size<Dim>(), rows), end = begin;
+  end.setEnd();
+
+  for(Cuda::Iterator<Dim> i = begin; i != end; ++i)
+    convert(dst.getBuffer() + dst.getOffset(Size<Dim>(dst_ofs + i)), src.getBuffer() + src.getOffset(Size<Dim>(src_ofs + i)), size[0]);
 }
 
 }  // namespace Cuda
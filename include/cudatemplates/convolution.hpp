@@ -0,0 +1,691 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_CONVOLUTION_H
+#define CUDA_CONVOLUTION_H
+
+
+#include <cmath>
+#include <vector>
+
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememory.hpp>
+#include <cudatemplates/devicememorylinear.hpp>
+#include <cudatemplates/error.hpp>
+#include <cudatemplates/hostmemory.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/reduce.hpp>
+
+
+/**
+   Width (in elements) of the column strips processed by one thread in the
+   host passes along dimensions > 0.
+   The 2 * radius + 1 rows of a strip needed for one output row stay in the
+   first level cache.
+*/
+#ifndef CUDA_CONVOLUTION_STRIP
+#define CUDA_CONVOLUTION_STRIP 256
+#endif
+
+/**
+   Number of consecutive elements accumulated in registers by the host
+   implementation.
+*/
+#ifndef CUDA_CONVOLUTION_REGISTERS
+#define CUDA_CONVOLUTION_REGISTERS 16
+#endif
+
+/**
+   Maximum kernel radius supported by the device implementation.
+*/
+#ifndef CUDA_CONVOLUTION_MAX_RADIUS
+#define CUDA_CONVOLUTION_MAX_RADIUS 16
+#endif
+
+/**
+   Block size of device convolution kernels.
+*/
+#ifndef CUDA_CONVOLUTION_BLOCK_X
+#define CUDA_CONVOLUTION_BLOCK_X 32
+#endif
+
+#ifndef CUDA_CONVOLUTION_BLOCK_Y
+#define CUDA_CONVOLUTION_BLOCK_Y 8
+#endif
+
+/**
+   Call function template with the kernel radius as template argument.
+   Unrolled specializations exist for the radii 1 to 5, 7 and 9
+   (i.e., kernel widths 3 to 11, 15 and 19), all other radii are handled by
+   the generic version (radius 0).
+*/
+#define CUDA_CONVOLUTION_DISPATCH(r, call)	\
+  switch(r) {					\
+  case 1: call(1); break;			\
+  case 2: call(2); break;			\
+  case 3: call(3); break;			\
+  case 4: call(4); break;			\
+  case 5: call(5); break;			\
+  case 7: call(7); break;			\
+  case 9: call(9); break;			\
+  default: call(0); break;			\
+  }
+
+
+namespace Cuda {
+
+namespace Convolution {
+
+/**
+   Separable convolution kernel.
+   This holds one one-dimensional kernel of 2 * radius + 1 taps per
+   dimension. A radius of zero means that no filtering takes place along the
+   respective dimension.
+*/
+template <unsigned Dim>
+class SeparableKernel
+{
+public:
+  /**
+     Default constructor.
+     Creates the identity kernel.
+  */
+  SeparableKernel()
+  {
+    for(unsigned d = Dim; d--;)
+      set(d, 0, 0);
+  }
+
+  /**
+     Constructor.
+     Uses the same one-dimensional kernel for each dimension.
+     @param taps 2 * radius + 1 filter coefficients
+     @param radius kernel radius
+  */
+  SeparableKernel(const float *taps, int radius)
+  {
+    for(unsigned d = Dim; d--;)
+      set(d, taps, radius);
+  }
+
+  /**
+     Set kernel for one dimension.
+     @param d dimension
+     @param taps 2 * radius + 1 filter coefficients
+     @param radius kernel radius
+  */
+  void set(unsigned d, const float *taps, int radius)
+  {
+    if(radius < 0)
+      CUDA_ERROR("invalid kernel radius");
+
+    m_radius[d] = radius;
+
+    if(radius == 0)
+      m_taps[d].assign(1, 1.0f);
+    else
+      m_taps[d].assign(taps, taps + 2 * radius + 1);
+  }
+
+  /**
+     Set normalized Gaussian kernel for one dimension.
+     @param d dimension
+     @param sigma standard deviation
+     @param radius kernel radius, ceil(3 * sigma) if negative
+  */
+  void setGaussian(unsigned d, float sigma, int radius = -1)
+  {
+    if(radius < 0)
+      radius = (int)ceil(3 * sigma);
+
+    std::vector<float> taps(2 * radius + 1);
+    float sum = 0;
+
+    for(int i = -radius; i <= radius; ++i)
+      sum += taps[i + radius] = (sigma > 0) ? exp(-0.5f * i * i / (sigma * sigma)) : (float)(i == 0);
+
+    for(int i = 2 * radius + 1; i--;)
+      taps[i] /= sum;
+
+    set(d, &taps[0], radius);
+  }
+
+  /**
+     Set normalized Gaussian kernel for all dimensions.
+     @param sigma standard deviation
+     @param radius kernel radius, ceil(3 * sigma) if negative
+  */
+  void setGaussian(float sigma, int radius = -1)
+  {
+    for(unsigned d = Dim; d--;)
+      setGaussian(d, sigma, radius);
+  }
+
+  /**
+     Get kernel radius.
+     @param d dimension
+  */
+  inline int getRadius(unsigned d) const { return m_radius[d]; }
+
+  /**
+     Get filter coefficients.
+     @param d dimension
+  */
+  inline const float *getTaps(unsigned d) const { return &m_taps[d][0]; }
+
+private:
+  int m_radius[Dim];
+  std::vector<float> m_taps[Dim];
+};
+
+/**
+   Conversion of the accumulated value to the element type.
+   Integer types are rounded and saturated.
+*/
+template <class Type>
+struct Saturate
+{
+  static __host__ __device__ inline Type apply(float v) { return (Type)v; }
+};
+
+#define CUDA_CONVOLUTION_SATURATE(Type, min, max)			\
+  template <>								\
+  struct Saturate<Type>							\
+  {									\
+    static __host__ __device__ inline Type apply(float v)		\
+    {									\
+      v = floorf(v + 0.5f);						\
+      return (v <= (float)(min)) ? (Type)(min) : (v >= (float)(max)) ? (Type)(max) : (Type)v; \
+    }									\
+  }
+
+CUDA_CONVOLUTION_SATURATE(signed char, -128, 127);
+CUDA_CONVOLUTION_SATURATE(unsigned char, 0, 255);
+CUDA_CONVOLUTION_SATURATE(short, -32768, 32767);
+CUDA_CONVOLUTION_SATURATE(unsigned short, 0, 65535);
+CUDA_CONVOLUTION_SATURATE(int, -2147483647 - 1, 2147483647);
+
+#undef CUDA_CONVOLUTION_SATURATE
+
+/**
+   Compute one output line segment from 2 * radius + 1 input line segments.
+   Blocks of CUDA_CONVOLUTION_REGISTERS consecutive elements are accumulated
+   in registers, which the compiler maps to SIMD registers. With a radius
+   known at compile time the tap loop is unrolled.
+   @param out output line
+   @param in input lines
+   @param n number of elements
+   @param taps filter coefficients
+   @param r kernel radius (only used if R == 0)
+*/
+template <int R, class Type1, class Type2>
+inline void convolveLine(Type1 *out, const Type2 *const *in, size_t n, const float *taps, int r)
+{
+  const int count = 2 * ((R > 0) ? R : r) + 1;
+  size_t x = 0;
+
+  for(; x + CUDA_CONVOLUTION_REGISTERS <= n; x += CUDA_CONVOLUTION_REGISTERS) {
+    float s[CUDA_CONVOLUTION_REGISTERS];
+
+    for(int j = 0; j < CUDA_CONVOLUTION_REGISTERS; ++j)
+      s[j] = 0;
+
+    for(int k = 0; k < count; ++k) {
+      const Type2 *p = in[k] + x;
+      const float t = taps[k];
+
+      for(int j = 0; j < CUDA_CONVOLUTION_REGISTERS; ++j)
+	s[j] += t * (float)p[j];
+    }
+
+    for(int j = 0; j < CUDA_CONVOLUTION_REGISTERS; ++j)
+      out[x + j] = Saturate<Type1>::apply(s[j]);
+  }
+
+  for(; x < n; ++x) {
+    float s = 0;
+
+    for(int k = 0; k < count; ++k)
+      s += taps[k] * (float)in[k][x];
+
+    out[x] = Saturate<Type1>::apply(s);
+  }
+}
+
+/**
+   Filter all rows of host memory (dimension 0).
+   Each thread copies one row at a time into a buffer extended by the border.
+*/
+template <int R, class Type1, class Type2, unsigned Dim>
+void passRows(HostMemory<Type1, Dim> &dst, const HostMemory<Type2, Dim> &src,
+	      const float *taps, int r, border_t border)
+{
+  const int width = (int)src.size[0];
+  int rows = 1;
+
+  for(unsigned i = 1; i < Dim; ++i)
+    rows *= src.size[i];
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    std::vector<Type2> buf(width + 2 * r);
+    std::vector<const Type2 *> in(2 * r + 1);
+
+    for(int k = 2 * r + 1; k--;)
+      in[k] = &buf[k];
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(int y = 0; y < rows; ++y) {
+      const Type2 *p = src.getBuffer() + Reduction::rowOffset(src, Size<Dim>(), src.size, y);
+
+      for(int x = -r; x < width + r; ++x)
+	buf[x + r] = p[border_index(x, width, border)];
+
+      convolveLine<R>(dst.getBuffer() + Reduction::rowOffset(dst, Size<Dim>(), dst.size, y), &in[0], width, taps, r);
+    }
+  }
+}
+
+/**
+   Filter host memory along dimension d > 0.
+   The lines along dimension d are split into strips of
+   CUDA_CONVOLUTION_STRIP elements, each pair (line, strip) is processed by
+   one thread. No transposition is required since the rows of a strip are
+   filtered as a whole.
+*/
+template <int R, class Type1, class Type2, unsigned Dim>
+void passHigher(HostMemory<Type1, Dim> &dst, const HostMemory<Type2, Dim> &src, unsigned d,
+		const float *taps, int r, border_t border)
+{
+  const size_t width = src.size[0];
+  const int n = (int)src.size[d];
+  const size_t strips = (width + CUDA_CONVOLUTION_STRIP - 1) / CUDA_CONVOLUTION_STRIP;
+  size_t lines = 1;
+
+  for(unsigned i = 1; i < Dim; ++i)
+    if(i != d)
+      lines *= src.size[i];
+
+  const int items = (int)(lines * strips);
+  const size_t src_step = src.stride[d - 1], dst_step = dst.stride[d - 1];
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    std::vector<const Type2 *> in(2 * r + 1);
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(int item = 0; item < items; ++item) {
+      size_t x0 = (item % strips) * CUDA_CONVOLUTION_STRIP, l = item / strips;
+      size_t w = (x0 + CUDA_CONVOLUTION_STRIP < width) ? CUDA_CONVOLUTION_STRIP : width - x0;
+      size_t so = x0, dof = x0;
+
+      for(unsigned i = 1; i < Dim; ++i) {
+	if(i == d)
+	  continue;
+
+	so += (l % src.size[i]) * src.stride[i - 1];
+	dof += (l % src.size[i]) * dst.stride[i - 1];
+	l /= src.size[i];
+      }
+
+      const Type2 *p = src.getBuffer() + so;
+      Type1 *q = dst.getBuffer() + dof;
+
+      for(int k = 0; k < n; ++k) {
+	for(int t = 2 * r + 1; t--;)
+	  in[t] = p + border_index(k + t - r, n, border) * src_step;
+
+	convolveLine<R>(q + k * dst_step, &in[0], w, taps, r);
+      }
+    }
+  }
+}
+
+/**
+   Filter host memory along dimension d.
+*/
+template <class Type1, class Type2, unsigned Dim>
+void pass(HostMemory<Type1, Dim> &dst, const HostMemory<Type2, Dim> &src, unsigned d,
+	  const float *taps, int r, border_t border)
+{
+#define CUDA_CONVOLUTION_ROWS(R) passRows<R>(dst, src, taps, r, border)
+#define CUDA_CONVOLUTION_HIGHER(R) passHigher<R>(dst, src, d, taps, r, border)
+
+  if(d == 0)
+    CUDA_CONVOLUTION_DISPATCH(r, CUDA_CONVOLUTION_ROWS)
+  else
+    CUDA_CONVOLUTION_DISPATCH(r, CUDA_CONVOLUTION_HIGHER)
+
+#undef CUDA_CONVOLUTION_ROWS
+#undef CUDA_CONVOLUTION_HIGHER
+}
+
+/**
+   Check arguments of convolution.
+   @return number of one-dimensional passes
+*/
+template <class Type, unsigned Dim>
+int check(const Layout<Type, Dim> &dst, const Layout<Type, Dim> &src, const SeparableKernel<Dim> &kernel)
+{
+  if(dst.size != src.size)
+    CUDA_ERROR("size mismatch");
+
+  int passes = 0;
+
+  for(unsigned d = Dim; d--;)
+    if(kernel.getRadius(d) > 0)
+      ++passes;
+
+  return passes;
+}
+
+#ifdef __CUDACC__
+
+/**
+   Filter coefficients passed to device kernels by value.
+*/
+struct Taps
+{
+  float t[2 * CUDA_CONVOLUTION_MAX_RADIUS + 1];
+};
+
+/**
+   Filter rows (dimension 0) of device memory.
+   Each block loads a tile of CUDA_CONVOLUTION_BLOCK_Y row segments,
+   extended by the border, into shared memory.
+   @param block_ofs offset added to blockIdx.y (for grids with more than 65535
+   rows of blocks)
+*/
+template <int R, class Type1, class Type2, unsigned Dim>
+__global__ void rows_kernel(typename DeviceMemory<Type1, Dim>::KernelData dst,
+			    typename DeviceMemory<Type2, Dim>::KernelData src,
+			    Taps taps, int r, border_t border, size_t rows, size_t block_ofs)
+{
+  __shared__ float tile[CUDA_CONVOLUTION_BLOCK_Y][CUDA_CONVOLUTION_BLOCK_X + 2 * CUDA_CONVOLUTION_MAX_RADIUS];
+
+  if(R > 0)
+    r = R;
+
+  const int width = src.size[0];
+  const int x0 = blockIdx.x * CUDA_CONVOLUTION_BLOCK_X;
+  size_t y = (blockIdx.y + block_ofs) * CUDA_CONVOLUTION_BLOCK_Y + threadIdx.y;
+  const bool active = y < rows;
+  size_t so = 0, dof = 0;
+
+  for(unsigned i = 1; i < Dim; ++i) {
+    so += (y % src.size[i]) * src.stride[i - 1];
+    dof += (y % src.size[i]) * dst.stride[i - 1];
+    y /= src.size[i];
+  }
+
+  for(int i = threadIdx.x; i < CUDA_CONVOLUTION_BLOCK_X + 2 * r; i += CUDA_CONVOLUTION_BLOCK_X)
+    if(active)
+      tile[threadIdx.y][i] = src.data[so + border_index(x0 + i - r, width, border)];
+
+  __syncthreads();
+  const int x = x0 + threadIdx.x;
+
+  if(!active || (x >= width))
+    return;
+
+  float s = 0;
+
+  for(int k = 0; k < 2 * r + 1; ++k)
+    s += taps.t[k] * tile[threadIdx.y][threadIdx.x + k];
+
+  dst.data[dof + x] = Saturate<Type1>::apply(s);
+}
+
+/**
+   Filter device memory along dimension d > 0.
+   Each block loads a tile of CUDA_CONVOLUTION_BLOCK_Y elements along
+   dimension d, extended by the border, and CUDA_CONVOLUTION_BLOCK_X
+   elements along dimension 0 into shared memory.
+   @param segments number of tile segments along dimension d
+   @param block_ofs offset added to blockIdx.y
+*/
+template <int R, class Type1, class Type2, unsigned Dim>
+__global__ void higher_kernel(typename DeviceMemory<Type1, Dim>::KernelData dst,
+			      typename DeviceMemory<Type2, Dim>::KernelData src,
+			      unsigned d, Taps taps, int r, border_t border,
+			      size_t segments, size_t block_ofs)
+{
+  __shared__ float tile[CUDA_CONVOLUTION_BLOCK_Y + 2 * CUDA_CONVOLUTION_MAX_RADIUS][CUDA_CONVOLUTION_BLOCK_X];
+
+  if(R > 0)
+    r = R;
+
+  const int n = src.size[d];
+  const size_t x = blockIdx.x * CUDA_CONVOLUTION_BLOCK_X + threadIdx.x;
+  const bool active = x < src.size[0];
+  const size_t b = blockIdx.y + block_ofs;
+  const int k0 = (b % segments) * CUDA_CONVOLUTION_BLOCK_Y;
+  size_t l = b / segments, so = x, dof = x;
+
+  for(unsigned i = 1; i < Dim; ++i) {
+    if(i == d)
+      continue;
+
+    so += (l % src.size[i]) * src.stride[i - 1];
+    dof += (l % src.size[i]) * dst.stride[i - 1];
+    l /= src.size[i];
+  }
+
+  for(int i = threadIdx.y; i < CUDA_CONVOLUTION_BLOCK_Y + 2 * r; i += CUDA_CONVOLUTION_BLOCK_Y)
+    if(active)
+      tile[i][threadIdx.x] = src.data[so + border_index(k0 + i - r, n, border) * src.stride[d - 1]];
+
+  __syncthreads();
+  const int k = k0 + threadIdx.y;
+
+  if(!active || (k >= n))
+    return;
+
+  float s = 0;
+
+  for(int t = 0; t < 2 * r + 1; ++t)
+    s += taps.t[t] * tile[threadIdx.y + t][threadIdx.x];
+
+  dst.data[dof + k * dst.stride[d - 1]] = Saturate<Type1>::apply(s);
+}
+
+/**
+   Filter device memory along dimension d.
+*/
+template <class Type1, class Type2, unsigned Dim>
+void pass(DeviceMemory<Type1, Dim> &dst, const DeviceMemory<Type2, Dim> &src, unsigned d,
+	  const float *taps, int r, border_t border)
+{
+  if(r > CUDA_CONVOLUTION_MAX_RADIUS)
+    CUDA_ERROR("kernel radius too large");
+
+  Taps t;
+
+  for(int k = 2 * r + 1; k--;)
+    t.t[k] = taps[k];
+
+  size_t rows = 1;
+
+  for(unsigned i = 1; i < Dim; ++i)
+    rows *= src.size[i];
+
+  // number of tiles along the second grid dimension:
+  const size_t tiles = (d == 0) ?
+    (rows + CUDA_CONVOLUTION_BLOCK_Y - 1) / CUDA_CONVOLUTION_BLOCK_Y :
+    (src.size[d] + CUDA_CONVOLUTION_BLOCK_Y - 1) / CUDA_CONVOLUTION_BLOCK_Y * (rows / src.size[d]);
+  const size_t segments = (d == 0) ? 0 : (src.size[d] + CUDA_CONVOLUTION_BLOCK_Y - 1) / CUDA_CONVOLUTION_BLOCK_Y;
+  dim3 block(CUDA_CONVOLUTION_BLOCK_X, CUDA_CONVOLUTION_BLOCK_Y);
+
+  for(size_t ofs = 0; ofs < tiles; ofs += 65535) {
+    dim3 grid((src.size[0] + CUDA_CONVOLUTION_BLOCK_X - 1) / CUDA_CONVOLUTION_BLOCK_X,
+	      (tiles - ofs < 65535) ? tiles - ofs : 65535);
+
+#define CUDA_CONVOLUTION_ROWS(R) rows_kernel<R, Type1, Type2, Dim><<<grid, block>>>(dst, src, t, r, border, rows, ofs)
+#define CUDA_CONVOLUTION_HIGHER(R) higher_kernel<R, Type1, Type2, Dim><<<grid, block>>>(dst, src, d, t, r, border, segments, ofs)
+
+    if(d == 0)
+      CUDA_CONVOLUTION_DISPATCH(r, CUDA_CONVOLUTION_ROWS)
+    else
+      CUDA_CONVOLUTION_DISPATCH(r, CUDA_CONVOLUTION_HIGHER)
+
+#undef CUDA_CONVOLUTION_ROWS
+#undef CUDA_CONVOLUTION_HIGHER
+
+    CUDA_CHECK(cudaGetLastError());
+  }
+}
+
+#endif  // __CUDACC__
+
+/**
+   Apply the one-dimensional passes of a separable convolution.
+   The intermediate results are kept in single precision, they alternate
+   between two temporary buffers, and only the last pass converts to the
+   destination type.
+   @param dst destination
+   @param src source
+   @param tmp two single precision buffers of the same size (the first one is
+   used for more than one pass, the second one for more than two passes)
+   @param kernel separable kernel
+   @param border border mode
+*/
+template <class Mem, class Tmp, unsigned Dim>
+void passes(Mem &dst, const Mem &src, Tmp *tmp, const SeparableKernel<Dim> &kernel, border_t border)
+{
+  unsigned dims[Dim] = { 0 };
+  int n = 0;
+
+  for(unsigned d = 0; d < Dim; ++d)
+    if(kernel.getRadius(d) > 0)
+      dims[n++] = d;
+
+  if(n == 1) {
+    pass(dst, src, dims[0], kernel.getTaps(dims[0]), kernel.getRadius(dims[0]), border);
+    return;
+  }
+
+  pass(tmp[0], src, dims[0], kernel.getTaps(dims[0]), kernel.getRadius(dims[0]), border);
+
+  for(int i = 1; i < n - 1; ++i)
+    pass(tmp[i % 2], tmp[(i - 1) % 2], dims[i], kernel.getTaps(dims[i]), kernel.getRadius(dims[i]), border);
+
+  pass(dst, tmp[(n - 2) % 2], dims[n - 1], kernel.getTaps(dims[n - 1]), kernel.getRadius(dims[n - 1]), border);
+}
+
+}  // namespace Convolution
+
+
+/**
+   Separable convolution of host memory.
+   The source is filtered with one one-dimensional kernel per dimension,
+   border elements are replicated according to the border mode.
+   The rows are filtered from a buffer extended by the border, the higher
+   dimensions are filtered in strips of CUDA_CONVOLUTION_STRIP elements which
+   are small enough to stay in the cache. Rows and strips are processed in
+   parallel (if OpenMP is enabled). Kernels with a radius of 1 to 5, 7 or 9
+   use unrolled specializations.
+   The values are accumulated in single precision. Intermediate results are
+   stored in single precision as well, only the last pass rounds and
+   saturates to the destination type.
+   @param dst destination (must be different from the source)
+   @param src source
+   @param kernel separable kernel
+   @param border border mode
+*/
+template <class Type, unsigned Dim>
+void convolve(HostMemory<Type, Dim> &dst, const HostMemory<Type, Dim> &src,
+	      const Convolution::SeparableKernel<Dim> &kernel, border_t border = BORDER_CLAMP)
+{
+  int count = Convolution::check(dst, src, kernel);
+
+  if(src.getNumElements() == 0)
+    return;
+
+  if(dst.getBuffer() == src.getBuffer())
+    CUDA_ERROR("convolution can't be performed in place");
+
+  if(count == 0) {
+    copy(dst, src);
+    return;
+  }
+
+  HostMemoryHeap<float, Dim> tmp[2];
+
+  for(int i = 0; i < count - 1 && i < 2; ++i)
+    tmp[i].realloc(src.size);
+
+  Convolution::passes<HostMemory<Type, Dim> >(dst, src, tmp, kernel, border);
+}
+
+#if defined(__CUDACC__) || defined(__DOXYGEN__)
+
+/**
+   Separable convolution of device memory.
+   See the host memory version for details. Each pass processes tiles of
+   CUDA_CONVOLUTION_BLOCK_X * CUDA_CONVOLUTION_BLOCK_Y elements, which are
+   loaded (extended by the border) into shared memory. The kernel radius is
+   limited to CUDA_CONVOLUTION_MAX_RADIUS.
+   @param dst destination (must be different from the source)
+   @param src source
+   @param kernel separable kernel
+   @param border border mode
+*/
+template <class Type, unsigned Dim>
+void convolve(DeviceMemory<Type, Dim> &dst, const DeviceMemory<Type, Dim> &src,
+	      const Convolution::SeparableKernel<Dim> &kernel, border_t border = BORDER_CLAMP)
+{
+  int count = Convolution::check(dst, src, kernel);
+
+  if(src.getNumElements() == 0)
+    return;
+
+  if(dst.getBuffer() == src.getBuffer())
+    CUDA_ERROR("convolution can't be performed in place");
+
+  if(count == 0) {
+    copy(dst, src);
+    return;
+  }
+
+  DeviceMemoryLinear<float, Dim> tmp[2];
+
+  for(int i = 0; i < count - 1 && i < 2; ++i)
+    tmp[i].realloc(src.size);
+
+  Convolution::passes<DeviceMemory<Type, Dim> >(dst, src, tmp, kernel, border);
+}
+
+#endif  // defined(__CUDACC__) || defined(__DOXYGEN__)
+
+}  // namespace Cuda
+
+
+#undef CUDA_CONVOLUTION_DISPATCH
+
+
+#endif
@@ -22,6 +22,7 @@
 #define CUDA_COPY_H
 
 #include <stdio.h>
+#include <string.h>
 #include <cudatemplates/array.hpp>
 #include <cudatemplates/devicememory.hpp>
 #include <cudatemplates/devicememorypitched.hpp>
@@ -44,7 +45,19 @@
 cudaMemcpy3D is still very buggy. Use set this to 1 to use cudaMemcpy2D
 instead.
 */
+#ifndef USE_2D_COPY
 #define USE_2D_COPY 1
+#endif
+
+/**
+   Copies by Transfer::Plan use a single cudaMemcpy3D call for three (merged)
+   dimensions. They pass the first element of the region as pointer and no
+   offsets, so this is independent of USE_2D_COPY. Set this to 0 to use one
+   cudaMemcpy2D call per slice instead.
+*/
+#ifndef CUDA_TRANSFER_USE_3D_COPY
+#define CUDA_TRANSFER_USE_3D_COPY 1
+#endif
 
 /*
   There is a possible range checking bug in cudaMemcpy3D,
@@ -57,12 +70,48 @@ instead.
 
 namespace Cuda {
 
+/**
+   Border handling modes.
+   The modes correspond to the texture addressing modes cudaAddressModeClamp,
+   cudaAddressModeMirror and cudaAddressModeWrap.
+*/
 typedef enum {
-  BORDER_CLAMP/*,
-  BORDER_MIRROR,
-  BORDER_REPEAT*/
+  BORDER_CLAMP,   /**< repeat the outermost element */
+  BORDER_MIRROR,  /**< mirror at the border, the outermost element is repeated once */
+  BORDER_REPEAT   /**< continue periodically */
 } border_t;
 
+/**
+   Map an index to the valid range according to the border mode.
+   @param i index, may be outside the valid range
+   @param n number of elements (must be positive)
+   @param border border mode
+   @return index in the range [0, n)
+*/
+__host__ __device__ inline int
+border_index(int i, int n, border_t border)
+{
+  if((i >= 0) && (i < n))
+    return i;
+
+  switch(border) {
+  case BORDER_MIRROR:
+    i %= 2 * n;
+
+    if(i < 0)
+      i += 2 * n;
+
+    return (i < n) ? i : 2 * n - 1 - i;
+
+  case BORDER_REPEAT:
+    i %= n;
+    return (i < 0) ? i + n : i;
+
+  default:
+    return (i < 0) ? 0 : n - 1;
+  }
+}
+
 template<class Type1, class Type2, unsigned Dim>
 static void
 check_bounds(const Layout<Type1, Dim> &dst, const Layout<Type2, Dim> &src,
@@ -89,6 +138,284 @@ check_bounds(const Layout<Type1, Dim> &dst, const Layout<Type2, Dim> &src,
   }
 }
 
+namespace Transfer {
+
+/**
+   Plan for copying strided N-D data by as few memcpy calls as possible.
+   Dimensions of size one are dropped and each dimension which continues the
+   previous one in both source and destination (i.e., its step equals the
+   extent of the previous dimension) is merged into it. The remaining
+   dimensions are handled by a single cudaMemcpy, cudaMemcpy2D or
+   cudaMemcpy3D call each, or by plain memcpy calls in host memory. Loops
+   over calls are only required for more than three remaining dimensions or
+   for steps which aren't representable by cudaMemcpy3D.
+   Dimension 0 must be consecutive in source and destination, all other
+   steps must be positive, otherwise the plan is not valid.
+*/
+template <unsigned Dim>
+struct Plan
+{
+  /** whether the data can be copied by memcpy calls */
+  bool valid;
+
+  /** number of dimensions after merging (0 if there is nothing to copy) */
+  unsigned dims;
+
+  /**
+     Number of array elements.
+     This is at least 3, so the code for cudaMemcpy3D compiles without out of
+     bounds accesses for lower dimensions (it is never executed in that case).
+     Unused elements are initialized to an empty dimension.
+  */
+  enum { DIMS = (Dim < 3) ? 3 : Dim };
+
+  /** size of each dimension, dimension 0 is given in bytes */
+  size_t size[DIMS];
+
+  /** destination and source step of each dimension in bytes (unused for dimension 0) */
+  size_t dpitch[DIMS], spitch[DIMS];
+
+  /**
+     Constructor.
+     @param bytes size of an element in bytes
+     @param _size number of elements in each dimension
+     @param dstep destination step in each dimension (in elements)
+     @param sstep source step in each dimension (in elements)
+  */
+  Plan(size_t bytes, const size_t *_size, const ssize_t *dstep, const ssize_t *sstep):
+    valid(true), dims(1)
+  {
+    for(unsigned i = DIMS; i--;) {
+      size[i] = 1;
+      dpitch[i] = spitch[i] = 0;
+    }
+
+    for(unsigned i = Dim; i--;)
+      if(_size[i] == 0) {
+	dims = 0;
+	return;
+      }
+
+    if((_size[0] > 1) && ((dstep[0] != 1) || (sstep[0] != 1))) {
+      valid = false;
+      return;
+    }
+
+    size[0] = _size[0] * bytes;
+    dpitch[0] = spitch[0] = bytes;
+
+    for(unsigned i = 1; i < Dim; ++i) {
+      if(_size[i] == 1)
+	continue;
+
+      if((dstep[i] <= 0) || (sstep[i] <= 0)) {
+	valid = false;
+	return;
+      }
+
+      size_t d = dstep[i] * bytes, s = sstep[i] * bytes;
+      unsigned j = dims - 1;
+      size_t dnext = (j == 0) ? size[0] : dpitch[j] * size[j];
+      size_t snext = (j == 0) ? size[0] : spitch[j] * size[j];
+
+      if((d == dnext) && (s == snext))
+	size[j] *= _size[i];
+      else {
+	size[dims] = _size[i];
+	dpitch[dims] = d;
+	spitch[dims] = s;
+	++dims;
+      }
+    }
+  }
+
+  /**
+     Execute plan.
+     @param dst destination pointer
+     @param src source pointer
+     @param kind direction of copy
+  */
+  inline void execute(void *dst, const void *src, cudaMemcpyKind kind) const
+  {
+    run(dst, src, kind, false, 0);
+  }
+
+  /**
+     Execute plan asynchronously.
+     The copy is ordered with respect to other work in the given stream.
+     Copies within host memory are performed immediately.
+     @param dst destination pointer
+     @param src source pointer
+     @param kind direction of copy
+     @param stream CUDA stream
+  */
+  inline void execute(void *dst, const void *src, cudaMemcpyKind kind, cudaStream_t stream) const
+  {
+    run(dst, src, kind, true, stream);
+  }
+
+  /**
+     Get number of memcpy calls required to execute the plan.
+     @param kind direction of copy
+  */
+  inline size_t calls(cudaMemcpyKind kind) const
+  {
+    if(dims == 0)
+      return 0;
+
+    size_t outer = 1;
+
+    for(unsigned i = inner(kind); i < dims; ++i)
+      outer *= size[i];
+
+    return outer;
+  }
+
+private:
+  /**
+     Get number of dimensions handled by a single call.
+  */
+  inline unsigned inner(cudaMemcpyKind kind) const
+  {
+    if(kind == cudaMemcpyHostToHost)
+      return 1;
+
+#if CUDA_TRANSFER_USE_3D_COPY
+    if((dims >= 3) && (dpitch[2] % dpitch[1] == 0) && (spitch[2] % spitch[1] == 0))
+      return 3;
+#endif
+
+    return (dims < 2) ? dims : 2;
+  }
+
+  void run(void *dst, const void *src, cudaMemcpyKind kind, bool async, cudaStream_t stream) const
+  {
+    if(!valid)
+      CUDA_ERROR("strided data can't be copied by memcpy");
+
+    if(dims == 0)
+      return;
+
+    const unsigned inner = this->inner(kind);
+    const size_t outer = calls(kind);
+
+    for(size_t o = 0; o < outer; ++o) {
+      char *d = (char *)dst;
+      const char *s = (const char *)src;
+
+      size_t q = o;
+
+      for(unsigned i = inner; i < dims; ++i) {
+	size_t k = q % size[i];
+	q /= size[i];
+	d += k * dpitch[i];
+	s += k * spitch[i];
+      }
+
+      call(inner, d, s, kind, async, stream);
+    }
+  }
+
+  void call(unsigned n, char *d, const char *s, cudaMemcpyKind kind, bool async, cudaStream_t stream) const
+  {
+    if(n == 1) {
+      if(kind == cudaMemcpyHostToHost)
+	memcpy(d, s, size[0]);
+      else if(async) {
+	CUDA_CHECK(cudaMemcpyAsync(d, s, size[0], kind, stream));
+      }
+      else {
+	CUDA_CHECK(cudaMemcpy(d, s, size[0], kind));
+      }
+    }
+    else if(n == 2) {
+      if(async) {
+	CUDA_CHECK(cudaMemcpy2DAsync(d, dpitch[1], s, spitch[1], size[0], size[1], kind, stream));
+      }
+      else {
+	CUDA_CHECK(cudaMemcpy2D(d, dpitch[1], s, spitch[1], size[0], size[1], kind));
+      }
+    }
+    else {
+      cudaMemcpy3DParms p = { 0 };
+      p.srcPtr.ptr = (void *)s;
+      p.srcPtr.pitch = spitch[1];
+      p.srcPtr.xsize = size[0];
+      p.srcPtr.ysize = spitch[2] / spitch[1];
+      p.dstPtr.ptr = (void *)d;
+      p.dstPtr.pitch = dpitch[1];
+      p.dstPtr.xsize = size[0];
+      p.dstPtr.ysize = dpitch[2] / dpitch[1];
+      p.extent.width = size[0];  // no CUDA array involved -> width is given in bytes
+      p.extent.height = size[1];
+      p.extent.depth = size[2];
+      p.kind = kind;
+
+      if(async) {
+	CUDA_CHECK(cudaMemcpy3DAsync(&p, stream));
+      }
+      else {
+	CUDA_CHECK(cudaMemcpy3D(&p));
+      }
+    }
+  }
+};
+
+/**
+   Copy region of pointer-accessible memory.
+   @param dst destination pointer to first element of region
+   @param dst_layout destination layout
+   @param src source pointer to first element of region
+   @param src_layout source layout
+   @param size size of region
+   @param kind direction of copy
+*/
+template<class Type, unsigned Dim>
+void
+copy(Type *dst, const Layout<Type, Dim> &dst_layout, const Type *src, const Layout<Type, Dim> &src_layout,
+     const Size<Dim> &size, cudaMemcpyKind kind)
+{
+  size_t n[Dim];
+  ssize_t dstep[Dim], sstep[Dim];
+
+  for(unsigned i = Dim; i--;) {
+    n[i] = size[i];
+    dstep[i] = (i == 0) ? 1 : dst_layout.stride[i - 1];
+    sstep[i] = (i == 0) ? 1 : src_layout.stride[i - 1];
+  }
+
+  Plan<Dim>(sizeof(Type), n, dstep, sstep).execute(dst, src, kind);
+}
+
+/**
+   Copy region of pointer-accessible memory asynchronously.
+   @param dst destination pointer to first element of region
+   @param dst_layout destination layout
+   @param src source pointer to first element of region
+   @param src_layout source layout
+   @param size size of region
+   @param kind direction of copy
+   @param stream CUDA stream
+*/
+template<class Type, unsigned Dim>
+void
+copy(Type *dst, const Layout<Type, Dim> &dst_layout, const Type *src, const Layout<Type, Dim> &src_layout,
+     const Size<Dim> &size, cudaMemcpyKind kind, cudaStream_t stream)
+{
+  size_t n[Dim];
+  ssize_t dstep[Dim], sstep[Dim];
+
+  for(unsigned i = Dim; i--;) {
+    n[i] = size[i];
+    dstep[i] = (i == 0) ? 1 : dst_layout.stride[i - 1];
+    sstep[i] = (i == 0) ? 1 : src_layout.stride[i - 1];
+  }
+
+  Plan<Dim>(sizeof(Type), n, dstep, sstep).execute(dst, src, kind, stream);
+}
+
+}  // namespace Transfer
+
 /**
    Generic copy method for host and/or device memory.
    It is not recommended to call this function directly since its correct
@@ -104,43 +431,7 @@ copy(Pointer<Type, Dim> &dst, const Pointer<Type, Dim> &src, cudaMemcpyKind kind
 {
   CUDA_STATIC_ASSERT(Dim >= 1);
   CUDA_CHECK_SIZE;
-
-  if(Dim == 1) {
-    CUDA_CHECK(cudaMemcpy(dst.getBuffer(), src.getBuffer(), src.getSize() * sizeof(Type), kind));
-  }
-  else if(Dim == 2) {
-    CUDA_CHECK(cudaMemcpy2D(dst.getBuffer(), dst.getPitch(), src.getBuffer(), src.getPitch(),
-			    src.size[0] * sizeof(Type), src.size[1], kind));
-  }
-  else if(Dim >= 3) {
-#if USE_2D_COPY
-    for (unsigned int slice=0; slice<src.size[2]; slice++)
-    {
-      CUDA_CHECK(cudaMemcpy2D( &dst.getBuffer()[slice * dst.stride[1]], dst.getPitch(),
-                               &src.getBuffer()[slice * src.stride[1]], src.getPitch(),
-                               src.size[0] * sizeof(Type), src.size[1], kind));
-    }
-#else
-    cudaMemcpy3DParms p = { 0 };
-    p.srcPtr.ptr = (void *)src.getBuffer();
-    p.srcPtr.pitch = src.getPitch();
-    p.srcPtr.xsize = src.size[0];
-    p.srcPtr.ysize = src.size[1];
-    p.dstPtr.ptr = (void *)dst.getBuffer();
-    p.dstPtr.pitch = dst.getPitch();
-    p.dstPtr.xsize = dst.size[0];
-    p.dstPtr.ysize = dst.size[1];
-    p.extent.width = src.size[0] * sizeof(Type);  // no CUDA array involved -> width is given in bytes
-    p.extent.height = src.size[1];
-    p.extent.depth = src.size[2];
-
-    for(unsigned i = 3; i < Dim; ++i)
-      p.extent.depth *= src.size[i];
-
-    p.kind = kind;
-    CUDA_CHECK(cudaMemcpy3D(&p));
-#endif
-  }
+  Transfer::copy(dst.getBuffer(), dst, src.getBuffer(), src, src.size, kind);
 }
 
 /**
@@ -162,61 +453,32 @@ copy(Pointer<Type, Dim> &dst, const Pointer<Type, Dim> &src,
      cudaMemcpyKind kind)
 {
   CUDA_STATIC_ASSERT(Dim >= 1);
-  CUDA_STATIC_ASSERT(Dim <= 3);
-
   check_bounds(dst, src, dst_ofs, src_ofs, size);
+  Transfer::copy(dst.getBuffer() + dst.getOffset(dst_ofs), dst, src.getBuffer() + src.getOffset(src_ofs), src,
+		 size, kind);
+}
 
-  if(Dim == 1) {
-    CUDA_CHECK(cudaMemcpy( dst.getBuffer() + dst_ofs[0], src.getBuffer() + src_ofs[0],
-                           size[0] * sizeof(Type), kind));
-  }
-  else if(Dim == 2) {
-    CUDA_CHECK(cudaMemcpy2D( dst.getBuffer() + dst_ofs[0] + dst_ofs[1] * dst.stride[0],
-                             dst.getPitch(), src.getBuffer() + src_ofs[0] + src_ofs[1] * src.stride[0],
-                             src.getPitch(), size[0] * sizeof(Type), size[1], kind));
-  }
-  else if(Dim == 3) {
-
-#if USE_2D_COPY
-  for (unsigned int slice=0; slice<size[2]; slice++)
-  {
-    size_t dst_offset = dst_ofs[0] + dst_ofs[1] * dst.stride[0] + (dst_ofs[2]+slice) * dst.stride[1];
-    size_t src_offset = src_ofs[0] + src_ofs[1] * src.stride[0] + (src_ofs[2]+slice) * src.stride[1];
-    CUDA_CHECK(cudaMemcpy2D( &dst.getBuffer()[dst_offset], dst.getPitch(),
-                             &src.getBuffer()[src_offset], src.getPitch(),
-                             size[0] * sizeof(Type), size[1], kind));
-  }
-#else
-    cudaMemcpy3DParms p = { 0 };
-#if CUDA_USE_OFFSET
-    p.srcPos.x = src_ofs[0] * sizeof(Type);
-    p.srcPos.y = src_ofs[1];
-    p.srcPos.z = src_ofs[2];
-    p.srcPtr.ptr = (void *)src.getBuffer();
-#else
-    p.srcPtr.ptr = (void *)(src.getBuffer() + src_ofs[0] + src_ofs[1] * src.stride[0] + src_ofs[2] * src.stride[1]);
-#endif
-    p.srcPtr.pitch = src.getPitch();
-    p.srcPtr.xsize = src.size[0];
-    p.srcPtr.ysize = src.size[1];
-#if CUDA_USE_OFFSET
-    p.dstPos.x = dst_ofs[0] * sizeof(Type);
-    p.dstPos.y = dst_ofs[1];
-    p.dstPos.z = dst_ofs[2];
-    p.dstPtr.ptr = (void *)dst.getBuffer();
-#else
-    p.dstPtr.ptr = (void *)(dst.getBuffer() + dst_ofs[0] + dst_ofs[1] * dst.stride[0] + dst_ofs[2] * dst.stride[1]);
-#endif
-    p.dstPtr.pitch = dst.getPitch();
-    p.dstPtr.xsize = dst.size[0];
-    p.dstPtr.ysize = dst.size[1];
-    p.extent.width = size[0] * sizeof(Type);  // no CUDA array involved -> width is given in bytes
-    p.extent.height = size[1];
-    p.extent.depth = size[2];
-    p.kind = kind;
-    CUDA_CHECK(cudaMemcpy3D(&p));
-#endif
-  }
+/**
+   Generic asynchronous region copy method for host and/or device memory.
+   The copy is only truly asynchronous if the host memory is page-locked.
+   @param dst generic destination pointer
+   @param src generic source pointer
+   @param dst_ofs destination offset
+   @param src_ofs source offset
+   @param size size of region to be copied
+   @param kind direction of copy
+   @param stream CUDA stream
+*/
+template<class Type, unsigned Dim>
+void
+copy(Pointer<Type, Dim> &dst, const Pointer<Type, Dim> &src,
+     const Size<Dim> &dst_ofs, const Size<Dim> &src_ofs, const Size<Dim> &size,
+     cudaMemcpyKind kind, cudaStream_t stream)
+{
+  CUDA_STATIC_ASSERT(Dim >= 1);
+  check_bounds(dst, src, dst_ofs, src_ofs, size);
+  Transfer::copy(dst.getBuffer() + dst.getOffset(dst_ofs), dst, src.getBuffer() + src.getOffset(src_ofs), src,
+		 size, kind, stream);
 }
 
 /**
@@ -247,6 +509,23 @@ copy(DeviceMemory<Type, Dim> &dst, const HostMemory<Type, Dim> &src,
   copy(dst, src, dst_ofs, src_ofs, size, cudaMemcpyHostToDevice);
 }
 
+/**
+   Copy region from host memory to device memory asynchronously.
+   @param dst destination pointer (device memory)
+   @param src source pointer (host memory)
+   @param dst_ofs destination offset
+   @param src_ofs source offset
+   @param size size of region to be copied
+   @param stream CUDA stream
+*/
+template<class Type, unsigned Dim>
+void
+copy(DeviceMemory<Type, Dim> &dst, const HostMemory<Type, Dim> &src,
+     const Size<Dim> &dst_ofs, const Size<Dim> &src_ofs, const Size<Dim> &size, cudaStream_t stream)
+{
+  copy(dst, src, dst_ofs, src_ofs, size, cudaMemcpyHostToDevice, stream);
+}
+
 /**
    Copy device memory to host memory.
    @param dst destination pointer (host memory)
@@ -275,6 +554,24 @@ copy(HostMemory<Type, Dim> &dst, const DeviceMemory<Type, Dim> &src,
   copy(dst, src, dst_ofs, src_ofs, size, cudaMemcpyDeviceToHost);
 }
 
+/**
+   Copy region from device memory to host memory asynchronously.
+   The data is only available when the stream has been synchronized.
+   @param dst destination pointer (host memory)
+   @param src source pointer (device memory)
+   @param dst_ofs destination offset
+   @param src_ofs source offset
+   @param size size of region to be copied
+   @param stream CUDA stream
+*/
+template<class Type, unsigned Dim>
+void
+copy(HostMemory<Type, Dim> &dst, const DeviceMemory<Type, Dim> &src,
+     const Size<Dim> &dst_ofs, const Size<Dim> &src_ofs, const Size<Dim> &size, cudaStream_t stream)
+{
+  copy(dst, src, dst_ofs, src_ofs, size, cudaMemcpyDeviceToHost, stream);
+}
+
 /**
    Copy device memory to device memory.
    @param dst destination pointer (device memory)
@@ -904,6 +1201,28 @@ copy(Symbol<Type, Dim> &dst, const DeviceMemory<Type, Dim> &src)
 }
 
 //------------------------------------------------------------------------------
+/**
+   Find the destination position of the interior element which is replicated
+   to the border element at destination position pos in dimension i.
+*/
+template<unsigned Dim>
+static size_t
+border_source(size_t pos, unsigned i,
+	      const Size<Dim> &dst_ofs, const SSize<Dim> &src_ofs,
+	      const Size<Dim> &dst_ofs2, const Size<Dim> &src_ofs2, const Size<Dim> &size2,
+	      const Size<Dim> &src_size, border_t border)
+{
+  // source index of the border element and the element it is mapped to:
+  ssize_t s = src_ofs[i] + (ssize_t)pos - (ssize_t)dst_ofs[i];
+  s = border_index((int)s, (int)src_size[i], border) - (ssize_t)src_ofs2[i];
+
+  // the replicated element must have been copied as part of the interior:
+  if((s < 0) || (s >= (ssize_t)size2[i]))
+    CUDA_ERROR("border exceeds copied region");
+
+  return dst_ofs2[i] + s;
+}
+
 /**
    Generic copy method with border handling.
    @param dst destination
@@ -972,17 +1291,8 @@ copy(TypeDst &dst, const TypeSrc &src,
 
     if(src_ofs[i] < 0) {
       for(unsigned j = -src_ofs[i]; j--;) {
-	// find region to be copied according to border mode:
-	switch(border) {
-	case BORDER_CLAMP:
-	  src_ofs3[i] = dst_ofs2[i];
-	  break;
-
-	default:
-	  CUDA_ERROR("border mode not yet implemented");
-	}
-
 	dst_ofs3[i] = dst_ofs2[i] - 1 - j;
+	src_ofs3[i] = border_source(dst_ofs3[i], i, dst_ofs, src_ofs, dst_ofs2, src_ofs2, size2, src.size, border);
 	size3[i] = 1;
 	copy(dst, dst, dst_ofs3, src_ofs3, size3);
       }
@@ -990,17 +1300,8 @@ copy(TypeDst &dst, const TypeSrc &src,
 
     if(src_ofs[i] + size[i] >= src.size[i]) {
       for(unsigned j = src_ofs[i] + size[i] - src.size[i]; j--;) {
-	// find region to be copied according to border mode:
-	switch(border) {
-	case BORDER_CLAMP:
-	  src_ofs3[i] = dst_ofs2[i] + size2[i] - 1;
-	  break;
-
-	default:
-	  CUDA_ERROR("border mode not yet implemented");
-	}
-
 	dst_ofs3[i] = dst_ofs2[i] + size2[i] + j;
+	src_ofs3[i] = border_source(dst_ofs3[i], i, dst_ofs, src_ofs, dst_ofs2, src_ofs2, size2, src.size, border);
 	size3[i] = 1;
 	copy(dst, dst, dst_ofs3, src_ofs3, size3);
       }
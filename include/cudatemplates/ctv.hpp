@@ -0,0 +1,950 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_CTV_H
+#define CUDA_CTV_H
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include <cudatemplates/compression.hpp>
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememory.hpp>
+#include <cudatemplates/error.hpp>
+#include <cudatemplates/half.hpp>
+#include <cudatemplates/hostmemory.hpp>
+#include <cudatemplates/hostmemoryreference.hpp>
+
+
+/**
+   Alignment of header, chunks and chunk table in .ctv files (in bytes).
+   This must be a multiple of the logical block size of the file system for
+   O_DIRECT access.
+*/
+#ifndef CUDA_CTV_ALIGN
+#define CUDA_CTV_ALIGN 4096
+#endif
+
+/**
+   Default size of chunks in .ctv files (in bytes).
+   This also bounds the size of the staging buffer used for I/O.
+*/
+#ifndef CUDA_CTV_CHUNK
+#define CUDA_CTV_CHUNK (4 << 20)
+#endif
+
+
+namespace Cuda {
+
+/**
+   Native file format for multidimensional data.
+   A .ctv file stores the element type, the number of dimensions, the size,
+   the spacing and the region of interest of a Layout, followed by the data
+   split into chunks. Each chunk is a packed block of the data (chunks are
+   arranged on a regular grid, dimension 0 varying fastest) and starts at a
+   multiple of CUDA_CTV_ALIGN bytes in the file. A table of the offsets and
+   sizes of all chunks follows the last chunk. Data is stored in the byte
+   order of the machine which wrote the file.
+   Reading and writing stream through a staging buffer of the size of one
+   chunk, so arbitrarily large data can be transferred between files and
+   host or device memory without a full-size intermediate buffer.
+*/
+namespace Ctv {
+
+/**
+   Kind of element components.
+*/
+typedef enum {
+  KIND_OPAQUE,    /**< unknown type, only the size is checked */
+  KIND_UNSIGNED,  /**< unsigned integer */
+  KIND_SIGNED,    /**< signed integer */
+  KIND_FLOAT,     /**< floating point (IEEE 754, including half precision) */
+  KIND_BFLOAT     /**< bfloat16 */
+} kind_t;
+
+/**
+   Compression of chunks.
+*/
+typedef enum {
+  CODEC_RAW,  /**< uncompressed */
+  CODEC_LZ    /**< delta and byte shuffle filter, LZ compression (see Compression) */
+} codec_t;
+
+/**
+   Description of the element type.
+*/
+struct TypeTag
+{
+  uint32_t kind;        /**< kind of components (see kind_t) */
+  uint32_t components;  /**< number of components */
+  uint32_t bytes;       /**< size of element in bytes */
+
+  inline bool operator==(const TypeTag &t) const
+  {
+    return (kind == t.kind) && (components == t.components) && (bytes == t.bytes);
+  }
+
+  inline bool operator!=(const TypeTag &t) const { return !(*this == t); }
+};
+
+/**
+   Type tag of an element type.
+   Types without specialization are stored as opaque data.
+*/
+template <class Type>
+struct Element
+{
+  static inline TypeTag tag() { TypeTag t = { KIND_OPAQUE, 1, sizeof(Type) }; return t; }
+};
+
+#define CUDA_CTV_ELEMENT(Type, kind, components)			\
+template <>								\
+struct Element<Type>							\
+{									\
+  static inline TypeTag tag() { TypeTag t = { kind, components, sizeof(Type) }; return t; } \
+};
+
+#define CUDA_CTV_ELEMENT_VECTOR(Scalar, kind)	\
+CUDA_CTV_ELEMENT(Scalar ## 1, kind, 1)		\
+CUDA_CTV_ELEMENT(Scalar ## 2, kind, 2)		\
+CUDA_CTV_ELEMENT(Scalar ## 3, kind, 3)		\
+CUDA_CTV_ELEMENT(Scalar ## 4, kind, 4)
+
+CUDA_CTV_ELEMENT(char, KIND_SIGNED, 1)
+CUDA_CTV_ELEMENT(signed char, KIND_SIGNED, 1)
+CUDA_CTV_ELEMENT(unsigned char, KIND_UNSIGNED, 1)
+CUDA_CTV_ELEMENT(short, KIND_SIGNED, 1)
+CUDA_CTV_ELEMENT(unsigned short, KIND_UNSIGNED, 1)
+CUDA_CTV_ELEMENT(int, KIND_SIGNED, 1)
+CUDA_CTV_ELEMENT(unsigned int, KIND_UNSIGNED, 1)
+CUDA_CTV_ELEMENT(float, KIND_FLOAT, 1)
+CUDA_CTV_ELEMENT(double, KIND_FLOAT, 1)
+CUDA_CTV_ELEMENT_VECTOR(char, KIND_SIGNED)
+CUDA_CTV_ELEMENT_VECTOR(uchar, KIND_UNSIGNED)
+CUDA_CTV_ELEMENT_VECTOR(short, KIND_SIGNED)
+CUDA_CTV_ELEMENT_VECTOR(ushort, KIND_UNSIGNED)
+CUDA_CTV_ELEMENT_VECTOR(int, KIND_SIGNED)
+CUDA_CTV_ELEMENT_VECTOR(uint, KIND_UNSIGNED)
+CUDA_CTV_ELEMENT_VECTOR(float, KIND_FLOAT)
+CUDA_CTV_ELEMENT(half, KIND_FLOAT, 1)
+CUDA_CTV_ELEMENT(bfloat16, KIND_BFLOAT, 1)
+CUDA_CTV_ELEMENT_VECTOR(half, KIND_FLOAT)
+CUDA_CTV_ELEMENT_VECTOR(bfloat16_, KIND_BFLOAT)
+
+#undef CUDA_CTV_ELEMENT_VECTOR
+#undef CUDA_CTV_ELEMENT
+
+/**
+   Options for file access.
+*/
+struct Options
+{
+  /** bypass the page cache (O_DIRECT), if supported by the system */
+  bool direct;
+
+  /** give the kernel hints for sequential readahead */
+  bool readahead;
+
+  /** approximate size of chunks created when writing (in bytes) */
+  size_t chunk_bytes;
+
+  /** compression of chunks created when writing */
+  codec_t codec;
+
+  Options():
+    direct(false), readahead(true), chunk_bytes(CUDA_CTV_CHUNK), codec(CODEC_RAW)
+  {
+  }
+};
+
+/**
+   Round up to multiple of CUDA_CTV_ALIGN.
+*/
+inline uint64_t
+align(uint64_t n)
+{
+  return (n + CUDA_CTV_ALIGN - 1) / CUDA_CTV_ALIGN * CUDA_CTV_ALIGN;
+}
+
+/**
+   File header.
+*/
+struct Header
+{
+  /** element type */
+  TypeTag type;
+
+  /** compression of chunks */
+  uint32_t codec;
+
+  /** size in each dimension */
+  std::vector<uint64_t> size;
+
+  /** spacing in each dimension */
+  std::vector<double> spacing;
+
+  /** offset of region of interest */
+  std::vector<uint64_t> region_ofs;
+
+  /** size of region of interest */
+  std::vector<uint64_t> region_size;
+
+  /** size of (inner) chunks in each dimension */
+  std::vector<uint64_t> chunk;
+
+  /** offset of chunk table in file */
+  uint64_t table_offset;
+
+  /**
+     Get number of dimensions.
+  */
+  inline unsigned getDim() const { return size.size(); }
+
+  /**
+     Get number of chunks.
+  */
+  inline size_t getChunkCount() const
+  {
+    size_t n = 1;
+
+    for(unsigned i = getDim(); i--;)
+      n *= (size[i] + chunk[i] - 1) / chunk[i];
+
+    return n;
+  }
+
+  /**
+     Get region covered by chunk.
+     @param index index of chunk
+     @param ofs offset of chunk (in elements)
+     @param extent size of chunk (chunks at the upper borders may be smaller)
+     @return number of elements in chunk
+  */
+  inline size_t getChunk(size_t index, size_t *ofs, size_t *extent) const
+  {
+    size_t n = 1;
+
+    for(unsigned i = 0; i < getDim(); ++i) {
+      size_t count = (size[i] + chunk[i] - 1) / chunk[i];
+      ofs[i] = (index % count) * chunk[i];
+      extent[i] = (ofs[i] + chunk[i] <= size[i]) ? chunk[i] : size[i] - ofs[i];
+      index /= count;
+      n *= extent[i];
+    }
+
+    return n;
+  }
+};
+
+/**
+   Location and size of a chunk in the file.
+*/
+struct Entry
+{
+  uint64_t offset;  /**< offset in file */
+  uint64_t bytes;   /**< number of stored bytes */
+};
+
+/**
+   Base class for reading and writing .ctv files.
+   This holds the file descriptor, the header, the chunk table and the
+   (aligned) staging buffer.
+*/
+class File
+{
+public:
+  /**
+     Get file header.
+  */
+  inline const Header &getHeader() const { return header; }
+
+  /**
+     Get number of chunks.
+  */
+  inline size_t getChunkCount() const { return table.size(); }
+
+  /**
+     Hint that a chunk will be read soon.
+     This has no effect if readahead is disabled or O_DIRECT is used.
+     @param index index of chunk
+  */
+  inline void prefetch(size_t index)
+  {
+#ifdef POSIX_FADV_WILLNEED
+    if(options.readahead && !options.direct && (index < table.size()))
+      posix_fadvise(fd, table[index].offset, table[index].bytes, POSIX_FADV_WILLNEED);
+#endif
+  }
+
+protected:
+  int fd;
+  Options options;
+  Header header;
+  std::vector<Entry> table;
+
+  File(const char *filename, int flags, const Options &_options):
+    fd(-1), options(_options)
+  {
+    for(int i = 2; i--;) {
+      staging[i] = 0;
+      staging_bytes[i] = 0;
+    }
+
+#ifdef O_DIRECT
+    if(options.direct)
+      flags |= O_DIRECT;
+#else
+    options.direct = false;
+#endif
+
+    fd = open(filename, flags, 0644);
+
+    if(fd < 0)
+      CUDA_ERROR("can't open file");
+  }
+
+  ~File()
+  {
+    if(fd >= 0)
+      ::close(fd);
+
+    for(int i = 2; i--;)
+      ::free(staging[i]);
+  }
+
+  /**
+     Get staging buffer of at least the given size.
+     The buffer is aligned and its size is rounded up to CUDA_CTV_ALIGN
+     bytes, as required for O_DIRECT access.
+     @param bytes required size
+     @param slot 0 for raw chunk data, 1 for compressed chunk data
+  */
+  void *buffer(size_t bytes, int slot = 0)
+  {
+    bytes = align(bytes);
+
+    if(bytes > staging_bytes[slot]) {
+      ::free(staging[slot]);
+      staging[slot] = 0;
+      staging_bytes[slot] = 0;
+
+      if(posix_memalign(&staging[slot], CUDA_CTV_ALIGN, bytes) != 0)
+	CUDA_ERROR("out of memory");
+
+      staging_bytes[slot] = bytes;
+    }
+
+    return staging[slot];
+  }
+
+  /**
+     Get element size used by the compression filter.
+  */
+  inline size_t typesize() const
+  {
+    return (header.type.bytes % header.type.components == 0) ? header.type.bytes / header.type.components : 1;
+  }
+
+  /**
+     Read from file.
+     With O_DIRECT, the buffer, offset and size must be aligned, reads
+     beyond the end of the file are allowed then.
+  */
+  void readAt(void *data, size_t bytes, uint64_t offset, size_t required)
+  {
+    char *p = (char *)data;
+    size_t done = 0;
+
+    while(done < bytes) {
+      ssize_t n = pread(fd, p + done, bytes - done, offset + done);
+
+      if(n < 0) {
+	if(errno == EINTR)
+	  continue;
+
+	CUDA_ERROR("read error");
+      }
+
+      if(n == 0)
+	break;
+
+      done += n;
+    }
+
+    if(done < required)
+      CUDA_ERROR("unexpected end of file");
+  }
+
+  /**
+     Write to file.
+  */
+  void writeAt(const void *data, size_t bytes, uint64_t offset)
+  {
+    const char *p = (const char *)data;
+    size_t done = 0;
+
+    while(done < bytes) {
+      ssize_t n = pwrite(fd, p + done, bytes - done, offset + done);
+
+      if(n < 0) {
+	if(errno == EINTR)
+	  continue;
+
+	CUDA_ERROR("write error");
+      }
+
+      done += n;
+    }
+  }
+
+  /**
+     Check element type and size of memory layout.
+  */
+  template <class Type, unsigned Dim>
+  void check(const Layout<Type, Dim> &layout) const
+  {
+    if(header.type != Element<Type>::tag())
+      CUDA_ERROR("element type mismatch");
+
+    if(header.getDim() != Dim)
+      CUDA_ERROR("dimension mismatch");
+
+    for(unsigned i = Dim; i--;)
+      if(header.size[i] != layout.size[i])
+	CUDA_ERROR("size mismatch");
+  }
+
+  /**
+     Check if a chunk is stored contiguously in the given layout.
+     In this case, it can be transferred without staging.
+  */
+  template <class Type, unsigned Dim>
+  static bool contiguous(const Layout<Type, Dim> &layout, const size_t *extent)
+  {
+    size_t n = extent[0];
+
+    for(unsigned i = 1; i < Dim; ++i) {
+      if((extent[i] > 1) && (layout.stride[i - 1] != n))
+	return false;
+
+      n *= extent[i];
+    }
+
+    return true;
+  }
+
+private:
+  void *staging[2];
+  size_t staging_bytes[2];
+
+  // no copies:
+  File(const File &);
+  File &operator=(const File &);
+};
+
+/**
+   Reader for .ctv files.
+*/
+class Reader: public File
+{
+public:
+  /**
+     Constructor.
+     Opens the file and reads header and chunk table.
+     @param filename name of file
+     @param _options options for file access
+  */
+  Reader(const char *filename, const Options &_options = Options()):
+    File(filename, O_RDONLY, _options)
+  {
+    char *p = (char *)buffer(CUDA_CTV_ALIGN);
+    readAt(p, CUDA_CTV_ALIGN, 0, 48);
+    const char *q = p;
+
+    if(memcmp(q, "CTV1", 4) != 0)
+      CUDA_ERROR("not a .ctv file");
+
+    q += 4;
+    uint32_t endian, version, dim;
+    get(q, endian);
+    get(q, version);
+
+    if(endian != 0x01020304)
+      CUDA_ERROR("byte order of file not supported");
+
+    if(version != 1)
+      CUDA_ERROR("file version not supported");
+
+    get(q, dim);
+    get(q, header.type.kind);
+    get(q, header.type.components);
+    get(q, header.type.bytes);
+    get(q, header.codec);
+
+    if(header.codec > CODEC_LZ)
+      CUDA_ERROR("compression not supported");
+
+    uint64_t count;
+    get(q, count);
+    get(q, header.table_offset);
+
+    if((dim == 0) || (48 + dim * 40 > CUDA_CTV_ALIGN))
+      CUDA_ERROR("invalid number of dimensions");
+
+    header.size.resize(dim);
+    header.spacing.resize(dim);
+    header.region_ofs.resize(dim);
+    header.region_size.resize(dim);
+    header.chunk.resize(dim);
+
+    for(unsigned i = 0; i < dim; ++i) {
+      get(q, header.size[i]);
+      get(q, header.spacing[i]);
+      get(q, header.region_ofs[i]);
+      get(q, header.region_size[i]);
+      get(q, header.chunk[i]);
+
+      if(header.chunk[i] == 0)
+	CUDA_ERROR("invalid chunk size");
+    }
+
+    if(count != header.getChunkCount())
+      CUDA_ERROR("invalid number of chunks");
+
+    // chunk table:
+    size_t bytes = count * sizeof(Entry);
+    table.resize(count);
+    p = (char *)buffer(bytes);
+    readAt(p, align(bytes), header.table_offset, bytes);
+
+    if(count > 0)
+      memcpy(&table[0], p, bytes);
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    if(options.readahead && !options.direct)
+      posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  }
+
+  /**
+     Get layout of data stored in file.
+     The returned layout can be used to allocate memory for reading.
+  */
+  template <class Type, unsigned Dim>
+  Layout<Type, Dim> getLayout() const
+  {
+    Size<Dim> s;
+
+    for(unsigned i = Dim; i--;)
+      s[i] = (i < header.getDim()) ? header.size[i] : 0;
+
+    Layout<Type, Dim> layout(s);
+    check(layout);
+
+    for(unsigned i = Dim; i--;) {
+      layout.spacing[i] = header.spacing[i];
+      layout.region_ofs[i] = header.region_ofs[i];
+      layout.region_size[i] = header.region_size[i];
+    }
+
+    return layout;
+  }
+
+  /**
+     Read chunk into staging buffer.
+     @param index index of chunk
+     @return pointer to packed (and decompressed) chunk data
+  */
+  const void *readChunk(size_t index)
+  {
+    if(index >= table.size())
+      CUDA_ERROR("out of bounds");
+
+    size_t ofs[CUDA_CTV_ALIGN / 40], extent[CUDA_CTV_ALIGN / 40];
+    size_t bytes = header.getChunk(index, ofs, extent) * header.type.bytes;
+    void *p = buffer(bytes);
+    fetch(index, p, bytes);
+    return p;
+  }
+
+  /**
+     Read chunk into given memory.
+     @param index index of chunk
+     @param dst destination of packed (and decompressed) chunk data
+  */
+  void readChunk(size_t index, void *dst)
+  {
+    if(index >= table.size())
+      CUDA_ERROR("out of bounds");
+
+    size_t ofs[CUDA_CTV_ALIGN / 40], extent[CUDA_CTV_ALIGN / 40];
+    fetch(index, dst, header.getChunk(index, ofs, extent) * header.type.bytes);
+  }
+
+  /**
+     Read entire data into host memory.
+     Spacing and region of interest of the memory layout are not modified.
+     @param dst destination pointer
+  */
+  template <class Type, unsigned Dim>
+  inline void read(HostMemory<Type, Dim> &dst) { read(dst, cudaMemcpyHostToHost); }
+
+  /**
+     Read entire data into device memory.
+     Spacing and region of interest of the memory layout are not modified.
+     @param dst destination pointer
+  */
+  template <class Type, unsigned Dim>
+  inline void read(DeviceMemory<Type, Dim> &dst) { read(dst, cudaMemcpyHostToDevice); }
+
+private:
+  template <class T>
+  static inline void get(const char *&q, T &x)
+  {
+    memcpy(&x, q, sizeof(T));
+    q += sizeof(T);
+  }
+
+  /**
+     Read and decompress chunk.
+     @param index index of chunk
+     @param dst destination of packed chunk data
+     @param bytes size of packed chunk data
+  */
+  void fetch(size_t index, void *dst, size_t bytes)
+  {
+    if(index >= table.size())
+      CUDA_ERROR("out of bounds");
+
+    const Entry &entry = table[index];
+
+    if(header.codec == CODEC_RAW) {
+      if(entry.bytes != bytes)
+	CUDA_ERROR("invalid chunk size");
+
+      if(!options.direct) {
+	readAt(dst, bytes, entry.offset, bytes);
+	return;
+      }
+
+      void *p = buffer(bytes);
+      readAt(p, align(bytes), entry.offset, bytes);
+
+      if(p != dst)
+	memcpy(dst, p, bytes);
+
+      return;
+    }
+
+    void *p = buffer(entry.bytes, 1);
+    readAt(p, options.direct ? align(entry.bytes) : entry.bytes, entry.offset, entry.bytes);
+    Compression::decode(dst, bytes, p, entry.bytes);
+  }
+
+  template <class Type, unsigned Dim>
+  void read(Pointer<Type, Dim> &dst, cudaMemcpyKind kind)
+  {
+    check(dst);
+    size_t ofs[Dim], extent[Dim];
+
+    for(size_t c = 0; c < table.size(); ++c) {
+      prefetch(c + 1);
+      size_t bytes = header.getChunk(c, ofs, extent) * sizeof(Type);
+      Size<Dim> o, e;
+
+      for(unsigned i = Dim; i--;) {
+	o[i] = ofs[i];
+	e[i] = extent[i];
+      }
+
+      if((kind == cudaMemcpyHostToHost) && (!options.direct || (header.codec != CODEC_RAW)) && contiguous(dst, extent)) {
+	fetch(c, dst.getBuffer() + dst.getOffset(o), bytes);
+	continue;
+      }
+
+      HostMemoryReference<Type, Dim> chunk(e, (Type *)readChunk(c));
+      copy(dst, chunk, o, Size<Dim>(), e, kind);
+    }
+  }
+};
+
+/**
+   Writer for .ctv files.
+   The chunk table and the final header are written by close() or by the
+   destructor.
+*/
+class Writer: public File
+{
+public:
+  /**
+     Constructor.
+     Creates the file. Chunks extend over entire rows (and planes, ...) as
+     long as they don't exceed the chunk size given in the options, unless
+     the chunk size is given explicitly.
+     @param filename name of file
+     @param layout size, spacing and region of interest of data
+     @param _options options for file access
+     @param chunk size of chunks in each dimension (zero for automatic)
+  */
+  template <class Type, unsigned Dim>
+  Writer(const char *filename, const Layout<Type, Dim> &layout, const Options &_options = Options(),
+	 const Size<Dim> &chunk = Size<Dim>()):
+    File(filename, O_WRONLY | O_CREAT | O_TRUNC, _options),
+    offset(CUDA_CTV_ALIGN), closed(false)
+  {
+    header.type = Element<Type>::tag();
+    header.codec = options.codec;
+    header.table_offset = 0;
+    size_t bytes = sizeof(Type);
+
+    for(unsigned i = 0; i < Dim; ++i) {
+      header.size.push_back(layout.size[i]);
+      header.spacing.push_back(layout.spacing[i]);
+      header.region_ofs.push_back(layout.region_ofs[i]);
+      header.region_size.push_back(layout.region_size[i]);
+      header.chunk.push_back((layout.size[i] > 0) ? layout.size[i] : 1);
+      bytes *= header.chunk[i];
+    }
+
+    // reduce chunk size, starting with the outermost dimension:
+    for(unsigned i = Dim; i--;) {
+      if(chunk[i] > 0) {
+	bytes = bytes / header.chunk[i] * chunk[i];
+	header.chunk[i] = chunk[i];
+      }
+      else if(bytes > options.chunk_bytes) {
+	size_t inner = bytes / header.chunk[i];
+	header.chunk[i] = (options.chunk_bytes > inner) ? options.chunk_bytes / inner : 1;
+	bytes = inner * header.chunk[i];
+      }
+    }
+
+    table.resize(header.getChunkCount());
+  }
+
+  /**
+     Destructor.
+  */
+  ~Writer()
+  {
+    try {
+      close();
+    }
+    catch(...) {
+    }
+  }
+
+  /**
+     Write chunk from packed data.
+     Chunks may be written in any order, but each one only once.
+     @param index index of chunk
+     @param data packed chunk data
+  */
+  void writeChunk(size_t index, const void *data)
+  {
+    if(index >= table.size())
+      CUDA_ERROR("out of bounds");
+
+    size_t ofs[CUDA_CTV_ALIGN / 40], extent[CUDA_CTV_ALIGN / 40];
+    size_t bytes = header.getChunk(index, ofs, extent) * header.type.bytes;
+    put(index, data, bytes);
+  }
+
+  /**
+     Write entire data from host memory.
+     @param src source pointer
+  */
+  template <class Type, unsigned Dim>
+  inline void write(const HostMemory<Type, Dim> &src) { write(src, cudaMemcpyHostToHost); }
+
+  /**
+     Write entire data from device memory.
+     @param src source pointer
+  */
+  template <class Type, unsigned Dim>
+  inline void write(const DeviceMemory<Type, Dim> &src) { write(src, cudaMemcpyDeviceToHost); }
+
+  /**
+     Write chunk table and header and close file.
+  */
+  void close()
+  {
+    if(closed)
+      return;
+
+    closed = true;
+
+    // chunk table:
+    size_t bytes = table.size() * sizeof(Entry);
+    char *p = (char *)buffer(bytes);
+    memset(p, 0, align(bytes));
+
+    if(!table.empty())
+      memcpy(p, &table[0], bytes);
+    header.table_offset = offset;
+    writeAt(p, options.direct ? align(bytes) : bytes, offset);
+
+    // header:
+    p = (char *)buffer(CUDA_CTV_ALIGN);
+    memset(p, 0, CUDA_CTV_ALIGN);
+    char *q = p;
+    memcpy(q, "CTV1", 4);
+    q += 4;
+    put(q, (uint32_t)0x01020304);
+    put(q, (uint32_t)1);
+    put(q, (uint32_t)header.getDim());
+    put(q, header.type.kind);
+    put(q, header.type.components);
+    put(q, header.type.bytes);
+    put(q, header.codec);
+    put(q, (uint64_t)table.size());
+    put(q, header.table_offset);
+
+    for(unsigned i = 0; i < header.getDim(); ++i) {
+      put(q, header.size[i]);
+      put(q, header.spacing[i]);
+      put(q, header.region_ofs[i]);
+      put(q, header.region_size[i]);
+      put(q, header.chunk[i]);
+    }
+
+    writeAt(p, CUDA_CTV_ALIGN, 0);
+  }
+
+private:
+  /** offset of next chunk */
+  uint64_t offset;
+
+  bool closed;
+
+  template <class T>
+  static inline void put(char *&q, const T &x)
+  {
+    memcpy(q, &x, sizeof(T));
+    q += sizeof(T);
+  }
+
+  /**
+     Write chunk data and add it to the chunk table.
+  */
+  void put(size_t index, const void *data, size_t bytes)
+  {
+    if(closed)
+      CUDA_ERROR("file already closed");
+
+    if(index >= table.size())
+      CUDA_ERROR("out of bounds");
+
+    if(header.codec != CODEC_RAW) {
+      void *p = buffer(Compression::bound(bytes), 1);
+      bytes = Compression::encode(p, data, bytes, typesize());
+      data = p;
+    }
+
+    if(options.direct) {
+      // data must be aligned and padded:
+      void *p = buffer(bytes);
+
+      if(p != data)
+	memcpy(p, data, bytes);
+
+      memset((char *)p + bytes, 0, align(bytes) - bytes);
+      writeAt(p, align(bytes), offset);
+    }
+    else
+      writeAt(data, bytes, offset);
+
+    table[index].offset = offset;
+    table[index].bytes = bytes;
+    offset += align(bytes);
+  }
+
+  template <class Type, unsigned Dim>
+  void write(const Pointer<Type, Dim> &src, cudaMemcpyKind kind)
+  {
+    check(src);
+    size_t ofs[Dim], extent[Dim];
+
+    for(size_t c = 0; c < table.size(); ++c) {
+      size_t bytes = header.getChunk(c, ofs, extent) * sizeof(Type);
+      Size<Dim> o, e;
+
+      for(unsigned i = Dim; i--;) {
+	o[i] = ofs[i];
+	e[i] = extent[i];
+      }
+
+      if((kind == cudaMemcpyHostToHost) && !options.direct && contiguous(src, extent)) {
+	put(c, src.getBuffer() + src.getOffset(o), bytes);
+	continue;
+      }
+
+      HostMemoryReference<Type, Dim> chunk(e, (Type *)buffer(bytes));
+      copy(chunk, src, Size<Dim>(), o, e, kind);
+      put(c, chunk.getBuffer(), bytes);
+    }
+  }
+};
+
+/**
+   Save host or device memory to .ctv file.
+   @param filename name of file
+   @param src source pointer
+   @param options options for file access
+*/
+template <class Memory>
+void
+save(const char *filename, const Memory &src, const Options &options = Options())
+{
+  Writer writer(filename, src, options);
+  writer.write(src);
+  writer.close();
+}
+
+/**
+   Load .ctv file into host or device memory.
+   The memory must have the size of the stored data.
+   @param filename name of file
+   @param dst destination pointer
+   @param options options for file access
+*/
+template <class Memory>
+void
+load(const char *filename, Memory &dst, const Options &options = Options())
+{
+  Reader reader(filename, options);
+  reader.read(dst);
+}
+
+}  // namespace Ctv
+
+}  // namespace Cuda
+
+
+#endif
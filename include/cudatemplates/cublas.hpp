@@ -60,7 +60,7 @@ public:
   typedef T value_type;
   typedef unsigned size_type;
 
-  inline int inc() const { return 1; }  // not yet used
+  inline int inc() const { return m_inc; }
   inline operator T*() { return m_devicePtr; }
   inline operator const T*() const { return m_devicePtr; }
 
@@ -72,11 +72,12 @@ public:
   */
 
   Vector():
-    m_devicePtr(0), m_size(0)
+    m_size(0), m_inc(1), m_devicePtr(0), m_owner(true)
   {
   }
 
-  Vector(size_type size)
+  Vector(size_type size):
+    m_inc(1), m_owner(true)
   {
     CUBLAS_CHECK(cublasAlloc(size, sizeof(T), (void **)&m_devicePtr));
     m_size = size;
@@ -89,42 +90,156 @@ public:
 
   ~Vector()
   {
-    CUBLAS_CHECK(cublasFree(m_devicePtr));
+    if(m_owner)
+      CUBLAS_CHECK(cublasFree(m_devicePtr));
+
     m_devicePtr = 0;
     m_size = 0;
   }
 
 
+  /**
+     Set all elements to zero.
+     This is done in device memory, no host buffer is involved.
+  */
   void makeZero() {
-    void* zeros = calloc(m_size, sizeof(T));
-    CUBLAS_CHECK(cublasSetVector(m_size, sizeof(T), zeros, 1, m_devicePtr, 1));
-    free(zeros);
+    if(m_size == 0)
+      return;
+
+    CUDA_CHECK(cudaMemset2D(m_devicePtr, m_inc * sizeof(T), 0, sizeof(T), m_size));
   }
 
 
   void setValues(const T *values)
   {
-    CUBLAS_CHECK(cublasSetVector(m_size, sizeof(T), values, 1, m_devicePtr, 1));
+    CUBLAS_CHECK(cublasSetVector(m_size, sizeof(T), values, 1, m_devicePtr, m_inc));
   }
 
+  /**
+     Download vector to a newly allocated host array.
+     The caller is responsible for deleting the returned array.
+  */
   const T* getValues(void)
   {
     T* v = new T[m_size];
-    CUBLAS_CHECK(cublasGetVector(m_size, sizeof(T), m_devicePtr, 1, v, 1));
+    getValues(v);
     return v;
   }
 
+  /**
+     Download vector to a given host array.
+     @param v host array with at least getSize() elements
+  */
+  void getValues(T *v) const
+  {
+    CUBLAS_CHECK(cublasGetVector(m_size, sizeof(T), m_devicePtr, m_inc, v, 1));
+  }
+
   const size_type getSize() const
   {
     return m_size;
   }
 
+protected:
+  /**
+     Constructor for vectors referring to existing device memory.
+     The memory is not freed by the destructor.
+     @param devicePtr pointer to first element
+     @param size number of elements
+     @param inc distance between consecutive elements
+  */
+  Vector(T *devicePtr, size_type size, int inc):
+    m_size(size), m_inc(inc), m_devicePtr(devicePtr), m_owner(false)
+  {
+  }
+
 private:
   size_type m_size;
+  int m_inc;
   T *m_devicePtr;
+  bool m_owner;
 };
 
 
+/**
+   Vector referring to existing device memory.
+   This allows CUBLAS operations on DeviceMemory objects without copying the
+   data into a separately allocated BLAS vector. Rows and columns of
+   two-dimensional device memory (including pitched memory) can be accessed
+   by means of an element increment.
+*/
+template <class T>
+class VectorReference: public Vector<T>
+{
+public:
+  typedef typename Vector<T>::size_type size_type;
+
+  /**
+     Constructor.
+     @param devicePtr pointer to first element in device memory
+     @param size number of elements
+     @param inc distance between consecutive elements
+  */
+  VectorReference(T *devicePtr, size_type size, int inc = 1):
+    Vector<T>(devicePtr, size, inc)
+  {
+  }
+
+  /**
+     Constructor.
+     @param mem one-dimensional device memory
+  */
+  VectorReference(DeviceMemory<T, 1> &mem):
+    Vector<T>(mem.getBuffer(), mem.size[0], 1)
+  {
+  }
+
+  /**
+     Copy constructor.
+     This creates another reference to the same device memory.
+  */
+  VectorReference(const VectorReference &v):
+    Vector<T>(const_cast<T *>((const T *)v), v.getSize(), v.inc())
+  {
+  }
+};
+
+/**
+   Get reference to row of two-dimensional device memory.
+   @param mem device memory
+   @param y row index
+   @return vector referring to the contiguous elements of row y
+*/
+template <class T>
+VectorReference<T> row(DeviceMemory<T, 2> &mem, size_t y)
+{
+  if(y >= mem.size[1])
+    CUDA_ERROR("out of bounds");
+
+  return VectorReference<T>(mem.getBuffer() + y * mem.stride[0], mem.size[0], 1);
+}
+
+/**
+   Get reference to column of two-dimensional device memory.
+   @param mem device memory
+   @param x column index
+   @return vector referring to the elements of column x (increment is the pitch)
+*/
+template <class T>
+VectorReference<T> column(DeviceMemory<T, 2> &mem, size_t x)
+{
+  if(x >= mem.size[0])
+    CUDA_ERROR("out of bounds");
+
+  return VectorReference<T>(mem.getBuffer() + x, mem.size[1], mem.stride[0]);
+}
+
+
+/**
+   Matrix in device memory.
+   The matrix has getHeight() rows and getWidth() columns and is stored in
+   column-major order, element (i, j) is found at position i + j * getLd().
+*/
 template <class T>
 class Matrix
 {
@@ -135,29 +250,37 @@ public:
   inline operator T*() { return m_devicePtr; }
   inline operator const T*() const { return m_devicePtr; }
 	
+  /**
+     Access element (i, j) in column-major order.
+     The reference points to device memory, it can't be dereferenced on the host.
+  */
   inline T &operator()(size_type i, size_type j) {
-    return m_devicePtr[i * m_width + j];
+    return m_devicePtr[i + j * m_ld];
   }
 	
-  inline T &operator()(size_type i, size_type j) const {
-    return m_devicePtr[i * m_width + j];
+  inline const T &operator()(size_type i, size_type j) const {
+    return m_devicePtr[i + j * m_ld];
   }
 	
   Matrix():
-    m_width(0), m_height(0), m_devicePtr(0)
+    m_width(0), m_height(0), m_ld(0), m_devicePtr(0), m_owner(true)
   {
   }
 	
-  Matrix(size_type width, size_type height)
+  Matrix(size_type width, size_type height):
+    m_owner(true)
   {
     CUBLAS_CHECK(cublasAlloc(width * height, sizeof(T), (void **)&m_devicePtr));
     m_width = width;
     m_height = height;
+    m_ld = height;
   }
 	
   ~Matrix()
   {
-    CUBLAS_CHECK(cublasFree(m_devicePtr));
+    if(m_owner)
+      CUBLAS_CHECK(cublasFree(m_devicePtr));
+
     m_width = 0;
     m_height = 0;
     m_devicePtr = 0;
@@ -171,9 +294,22 @@ public:
   }
   */
 
+  /**
+     Upload matrix.
+     @param values host array in column-major order (getHeight() x getWidth())
+  */
   void setValues(const T *values)
   {
-    CUBLAS_CHECK(cublasSetMatrix(m_height, m_width, sizeof(T), values, m_width, m_devicePtr, m_width));
+    CUBLAS_CHECK(cublasSetMatrix(m_height, m_width, sizeof(T), values, m_height, m_devicePtr, m_ld));
+  }
+
+  /**
+     Download matrix.
+     @param values host array in column-major order (getHeight() x getWidth())
+  */
+  void getValues(T *values) const
+  {
+    CUBLAS_CHECK(cublasGetMatrix(m_height, m_width, sizeof(T), m_devicePtr, m_ld, values, m_height));
   }
 	
   const size_type getWidth() const
@@ -185,11 +321,76 @@ public:
   {
     return m_height;
   }
+
+  /**
+     Get leading dimension.
+     @return distance (in elements) between consecutive columns
+  */
+  const size_type getLd() const
+  {
+    return m_ld;
+  }
+
+protected:
+  /**
+     Constructor for matrices referring to existing device memory.
+     The memory is not freed by the destructor.
+  */
+  Matrix(T *devicePtr, size_type width, size_type height, size_type ld):
+    m_width(width), m_height(height), m_ld(ld), m_devicePtr(devicePtr), m_owner(false)
+  {
+  }
 	
 private:
   size_type m_width;
   size_type m_height;
+  size_type m_ld;
   T *m_devicePtr;
+  bool m_owner;
+};
+
+
+/**
+   Matrix referring to existing device memory.
+   The first dimension of the device memory is interpreted as the matrix rows
+   (i.e., the column-major element order of CUBLAS), the pitch of the device
+   memory is used as leading dimension.
+*/
+template <class T>
+class MatrixReference: public Matrix<T>
+{
+public:
+  typedef typename Matrix<T>::size_type size_type;
+
+  /**
+     Constructor.
+     @param devicePtr pointer to first element in device memory
+     @param width number of columns
+     @param height number of rows
+     @param ld leading dimension
+  */
+  MatrixReference(T *devicePtr, size_type width, size_type height, size_type ld):
+    Matrix<T>(devicePtr, width, height, ld)
+  {
+  }
+
+  /**
+     Constructor.
+     @param mem two-dimensional device memory
+  */
+  MatrixReference(DeviceMemory<T, 2> &mem):
+    Matrix<T>(mem.getBuffer(), mem.size[1], mem.size[0], mem.stride[0])
+  {
+  }
+
+  /**
+     Copy constructor.
+     This creates another reference to the same device memory.
+  */
+  MatrixReference(const MatrixReference &m):
+    Matrix<T>(const_cast<T *>((const T *)m), m.getWidth(), m.getHeight(), m.getLd())
+  {
+  }
 };
 
 #include "cublas/blas1_float.hpp"
@@ -199,7 +400,8 @@ private:
 #include "cublas/blas3_float.hpp"
 
 template <class T>
-	Vector<T>::Vector(const Vector<T> &v) {
+	Vector<T>::Vector(const Vector<T> &v):
+	m_inc(1), m_owner(true) {
 	CUBLAS_CHECK(cublasAlloc(v.m_size, sizeof(T), (void **)&m_devicePtr));
 	m_size = v.m_size;
 	copy(v, *this);
@@ -27,7 +27,8 @@
 
 void gemv(char type, complex alpha, const Matrix<complex> &A, const Vector<complex> &x, complex beta, Vector<complex> &y)
 {
-  assert(x.getSize() == y.getSize());
-  assert(x.getSize() == A.getWidth());
-  cublasCgemv(type, A.getHeight(), A.getWidth(), alpha, A, x.getSize(), x, x.inc(), beta, y, y.inc());
+  bool n = (type == 'n') || (type == 'N');
+  assert(x.getSize() == (n ? A.getWidth() : A.getHeight()));
+  assert(y.getSize() == (n ? A.getHeight() : A.getWidth()));
+  cublasCgemv(type, A.getHeight(), A.getWidth(), alpha, A, A.getLd(), x, x.inc(), beta, y, y.inc());
 }
@@ -27,7 +27,8 @@
 
 void gemv(char type, float alpha, const Matrix<float> &A, const Vector<float> &x, float beta, Vector<float> &y)
 {
-  assert(x.getSize() == y.getSize());
-  assert(x.getSize() == A.getWidth());
-  cublasSgemv(type, A.getHeight(), A.getWidth(), alpha, A, x.getSize(), x, x.inc(), beta, y, y.inc());
+  bool n = (type == 'n') || (type == 'N');
+  assert(x.getSize() == (n ? A.getWidth() : A.getHeight()));
+  assert(y.getSize() == (n ? A.getHeight() : A.getWidth()));
+  cublasSgemv(type, A.getHeight(), A.getWidth(), alpha, A, A.getLd(), x, x.inc(), beta, y, y.inc());
 }
@@ -23,3 +23,10 @@
   Note to cudatemplates developers:
   don't modify this file directly, modify the corresponding "*.hpp.in" file instead and re-run cmake!
 */
+
+
+void gemm(char transa, char transb, float alpha, const Matrix<float> &A, const Matrix<float> &B, float beta, Matrix<float> &C)
+{
+  int k = ((transa == 'n') || (transa == 'N')) ? A.getWidth() : A.getHeight();
+  cublasSgemm(transa, transb, C.getHeight(), C.getWidth(), k, alpha, A, A.getLd(), B, B.getLd(), beta, C, C.getLd());
+}
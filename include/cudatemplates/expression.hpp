@@ -0,0 +1,598 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_EXPRESSION_H
+#define CUDA_EXPRESSION_H
+
+
+#include <cudatemplates/devicememory.hpp>
+#include <cudatemplates/error.hpp>
+#include <cudatemplates/hostmemory.hpp>
+#include <cudatemplates/staticassert.hpp>
+
+
+namespace Cuda {
+
+/**
+   Lazy elementwise expressions.
+   The arithmetic operators +, -, * and / applied to HostMemory or
+   DeviceMemory objects (or scalars) don't compute anything, they build an
+   expression tree instead. The tree is evaluated in a single pass when it is
+   assigned to a destination by means of Cuda::expr(), e.g.:
+   \code
+   Cuda::expr(a) = b * c + d;
+   \endcode
+   This avoids temporary images and reads and writes each element only once.
+   Host expressions are evaluated row by row (rows are distributed among
+   threads if OpenMP is enabled), the inner loop over a row is simple enough
+   to be vectorized by the compiler. Device expressions are evaluated by a
+   single kernel generated for the given expression type, which requires the
+   evaluating code to be compiled by nvcc.
+   All operands must have the same size and element type and must reside in
+   the same memory space.
+*/
+namespace Expr {
+
+/**
+   Tag for expressions in host memory.
+*/
+struct HostSpace {};
+
+/**
+   Tag for expressions in device memory.
+*/
+struct DeviceSpace {};
+
+/**
+   Tag for scalars, which can be combined with any memory space.
+*/
+struct AnySpace {};
+
+/**
+   Memory space of the combination of two expressions.
+   This is undefined (and therefore causes a compile-time error) if host and
+   device expressions are mixed.
+*/
+template <class S1, class S2> struct CommonSpace;
+template <class S> struct CommonSpace<S, S> { typedef S type; };
+template <class S> struct CommonSpace<S, AnySpace> { typedef S type; };
+template <class S> struct CommonSpace<AnySpace, S> { typedef S type; };
+template <> struct CommonSpace<AnySpace, AnySpace> { typedef AnySpace type; };
+
+template <class T> struct Identity { typedef T type; };
+
+/**
+   Leaf node referring to the data of a HostMemory or DeviceMemory object.
+   At most three dimensions are supported. Missing dimensions are treated as
+   size 1.
+*/
+template <class Type, class Space>
+struct Terminal
+{
+  typedef Type value_type;
+  typedef Space space;
+
+  const Type *data;
+  size_t size[3];
+  size_t stride[2];
+
+  template <unsigned Dim>
+  Terminal(const Layout<Type, Dim> &layout, const Type *buffer):
+    data(buffer)
+  {
+    CUDA_STATIC_ASSERT(Dim <= 3);
+
+    for(unsigned i = 0; i < 3; ++i)
+      size[i] = (i < Dim) ? layout.size[i] : 1;
+
+    stride[0] = (Dim > 1) ? layout.stride[0] : 0;
+    stride[1] = (Dim > 2) ? layout.stride[1] : 0;
+  }
+
+  inline const size_t *getSize() const { return size; }
+
+  __host__ __device__ inline Type operator()(size_t x, size_t y, size_t z) const
+  {
+    return data[x + y * stride[0] + z * stride[1]];
+  }
+
+  /**
+     Accessor for the elements of a single row.
+  */
+  struct Row
+  {
+    const Type *p;
+    inline Type operator[](size_t x) const { return p[x]; }
+  };
+
+  inline Row row(size_t y, size_t z) const
+  {
+    Row r = { data + y * stride[0] + z * stride[1] };
+    return r;
+  }
+};
+
+/**
+   Leaf node representing a constant.
+*/
+template <class Type>
+struct Scalar
+{
+  typedef Type value_type;
+  typedef AnySpace space;
+
+  Type value;
+
+  Scalar(Type v): value(v) {}
+
+  inline const size_t *getSize() const { return 0; }
+
+  __host__ __device__ inline Type operator()(size_t, size_t, size_t) const { return value; }
+
+  struct Row
+  {
+    Type value;
+    inline Type operator[](size_t) const { return value; }
+  };
+
+  inline Row row(size_t, size_t) const
+  {
+    Row r = { value };
+    return r;
+  }
+};
+
+/**
+   Node combining two subexpressions by a binary operation.
+*/
+template <class Op, class L, class R>
+struct Binary
+{
+  typedef typename L::value_type value_type;
+  typedef typename CommonSpace<typename L::space, typename R::space>::type space;
+
+  L l;
+  R r;
+
+  Binary(const L &_l, const R &_r):
+    l(_l), r(_r)
+  {
+    const size_t *s1 = l.getSize(), *s2 = r.getSize();
+
+    if((s1 != 0) && (s2 != 0))
+      for(int i = 3; i--;)
+	if(s1[i] != s2[i])
+	  CUDA_ERROR("size mismatch");
+  }
+
+  inline const size_t *getSize() const
+  {
+    const size_t *s = l.getSize();
+    return (s != 0) ? s : r.getSize();
+  }
+
+  __host__ __device__ inline value_type operator()(size_t x, size_t y, size_t z) const
+  {
+    return Op::apply(l(x, y, z), r(x, y, z));
+  }
+
+  struct Row
+  {
+    typename L::Row l;
+    typename R::Row r;
+    inline value_type operator[](size_t x) const { return Op::apply(l[x], r[x]); }
+  };
+
+  inline Row row(size_t y, size_t z) const
+  {
+    Row rw = { l.row(y, z), r.row(y, z) };
+    return rw;
+  }
+};
+
+/**
+   Node applying a unary operation to a subexpression.
+*/
+template <class Op, class E>
+struct Unary
+{
+  typedef typename E::value_type value_type;
+  typedef typename E::space space;
+
+  E e;
+
+  Unary(const E &_e): e(_e) {}
+
+  inline const size_t *getSize() const { return e.getSize(); }
+
+  __host__ __device__ inline value_type operator()(size_t x, size_t y, size_t z) const
+  {
+    return Op::apply(e(x, y, z));
+  }
+
+  struct Row
+  {
+    typename E::Row e;
+    inline value_type operator[](size_t x) const { return Op::apply(e[x]); }
+  };
+
+  inline Row row(size_t y, size_t z) const
+  {
+    Row r = { e.row(y, z) };
+    return r;
+  }
+};
+
+struct Add { template <class T> __host__ __device__ static inline T apply(T a, T b) { return a + b; } };
+struct Sub { template <class T> __host__ __device__ static inline T apply(T a, T b) { return a - b; } };
+struct Mul { template <class T> __host__ __device__ static inline T apply(T a, T b) { return a * b; } };
+struct Div { template <class T> __host__ __device__ static inline T apply(T a, T b) { return a / b; } };
+struct Neg { template <class T> __host__ __device__ static inline T apply(T a) { return -a; } };
+
+/**
+   Wrapper for expression nodes.
+   Only objects of this type (and HostMemory, DeviceMemory and scalars) are
+   accepted by the overloaded operators.
+*/
+template <class E>
+struct Expression
+{
+  typedef typename E::value_type value_type;
+  typedef typename E::space space;
+
+  E node;
+
+  Expression(const E &e): node(e) {}
+};
+
+/**
+   Convert operands into expression nodes.
+*/
+template <class E>
+inline const E &node(const Expression<E> &e) { return e.node; }
+
+template <class Type, unsigned Dim>
+inline Terminal<Type, HostSpace> node(const HostMemory<Type, Dim> &mem)
+{
+  return Terminal<Type, HostSpace>(mem, mem.getBuffer());
+}
+
+template <class Type, unsigned Dim>
+inline Terminal<Type, DeviceSpace> node(const DeviceMemory<Type, Dim> &mem)
+{
+  return Terminal<Type, DeviceSpace>(mem, mem.getBuffer());
+}
+
+template <class Type, unsigned Dim>
+struct HostNode { typedef Terminal<Type, HostSpace> type; };
+
+template <class Type, unsigned Dim>
+struct DeviceNode { typedef Terminal<Type, DeviceSpace> type; };
+
+#if defined(__CUDACC__) || defined(__DOXYGEN__)
+
+template <class Type, class E>
+__global__ void evaluate_kernel(Type *dst, size_t size0, size_t size1, size_t size2,
+				size_t stride0, size_t stride1, E e)
+{
+  size_t x = threadIdx.x + blockIdx.x * blockDim.x;
+  size_t y = threadIdx.y + blockIdx.y * blockDim.y;
+
+  if((x >= size0) || (y >= size1))
+    return;
+
+  for(size_t z = 0; z < size2; ++z)
+    dst[x + y * stride0 + z * stride1] = e(x, y, z);
+}
+
+#endif  // defined(__CUDACC__) || defined(__DOXYGEN__)
+
+/**
+   Check size of destination against size of expression.
+*/
+template <class Type, unsigned Dim>
+void checkSize(const Layout<Type, Dim> &dst, const size_t *size)
+{
+  CUDA_STATIC_ASSERT(Dim <= 3);
+
+  if(size == 0)
+    return;
+
+  for(unsigned i = 0; i < 3; ++i)
+    if(size[i] != ((i < Dim) ? dst.size[i] : 1))
+      CUDA_ERROR("size mismatch");
+}
+
+/**
+   Evaluate expression into host memory.
+*/
+template <class Type, unsigned Dim, class E>
+void evaluate(HostMemory<Type, Dim> &dst, const E &e)
+{
+  checkSize(dst, e.getSize());
+  Terminal<Type, HostSpace> d(dst, dst.getBuffer());
+  Type *buffer = dst.getBuffer();
+  const int rows = (int)(d.size[1] * d.size[2]);
+  const size_t width = d.size[0];
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for(int i = 0; i < rows; ++i) {
+    size_t y = i % d.size[1], z = i / d.size[1];
+    Type *p = buffer + y * d.stride[0] + z * d.stride[1];
+    typename E::Row r = e.row(y, z);
+
+    for(size_t x = 0; x < width; ++x)
+      p[x] = r[x];
+  }
+}
+
+#if defined(__CUDACC__) || defined(__DOXYGEN__)
+
+/**
+   Evaluate expression into device memory.
+   Since this function calls a CUDA kernel, it is only available if the file
+   from which this function is called is compiled by nvcc.
+*/
+template <class Type, unsigned Dim, class E>
+void evaluate(DeviceMemory<Type, Dim> &dst, const E &e)
+{
+  checkSize(dst, e.getSize());
+  Terminal<Type, DeviceSpace> d(dst, dst.getBuffer());
+  dim3 blockDim((Dim == 1) ? 256 : 16, (Dim == 1) ? 1 : 16);
+  dim3 gridDim((d.size[0] + blockDim.x - 1) / blockDim.x, (d.size[1] + blockDim.y - 1) / blockDim.y);
+  evaluate_kernel<<<gridDim, blockDim>>>(dst.getBuffer(), d.size[0], d.size[1], d.size[2], d.stride[0], d.stride[1], e);
+  CUDA_CHECK(cudaGetLastError());
+}
+
+#endif  // defined(__CUDACC__) || defined(__DOXYGEN__)
+
+template <class Type, unsigned Dim, class Space> struct Memory;
+template <class Type, unsigned Dim> struct Memory<Type, Dim, HostSpace> { typedef HostMemory<Type, Dim> type; };
+template <class Type, unsigned Dim> struct Memory<Type, Dim, DeviceSpace> { typedef DeviceMemory<Type, Dim> type; };
+
+/**
+   Destination of an expression.
+   Assigning an expression to this object evaluates the expression and
+   writes the result to the referenced memory.
+*/
+template <class Type, unsigned Dim, class Space>
+class Target
+{
+public:
+  typedef Type value_type;
+  typedef typename Memory<Type, Dim, Space>::type Mem;
+
+  Target(Mem &mem): m(mem) {}
+
+  template <class E>
+  Target &operator=(const Expression<E> &e)
+  {
+    (void)sizeof(typename CommonSpace<Space, typename E::space>::type);  // no host/device mix
+    evaluate(m, e.node);
+    return *this;
+  }
+
+  /**
+     Copy host memory, e.g. Cuda::expr(a) = b.
+  */
+  template <unsigned Dim2>
+  Target &operator=(const HostMemory<Type, Dim2> &src)
+  {
+    return *this = Expression<Terminal<Type, HostSpace> >(node(src));
+  }
+
+  /**
+     Copy device memory, e.g. Cuda::expr(a) = b.
+  */
+  template <unsigned Dim2>
+  Target &operator=(const DeviceMemory<Type, Dim2> &src)
+  {
+    return *this = Expression<Terminal<Type, DeviceSpace> >(node(src));
+  }
+
+  /**
+     Assign a constant to all elements.
+  */
+  Target &operator=(const value_type &v)
+  {
+    evaluate(m, Scalar<value_type>(v));
+    return *this;
+  }
+
+#define CUDA_EXPRESSION_COMPOUND(op, Op)				\
+  template <class E>							\
+  Target &operator op(const Expression<E> &e)				\
+  {									\
+    typedef Terminal<value_type, Space> D;				\
+    evaluate(m, Binary<Op, D, E>(D(m, m.getBuffer()), e.node));		\
+    return *this;							\
+  }									\
+									\
+  Target &operator op(const value_type &v)				\
+  {									\
+    typedef Terminal<value_type, Space> D;				\
+    evaluate(m, Binary<Op, D, Scalar<value_type> >(D(m, m.getBuffer()), v)); \
+    return *this;							\
+  }									\
+									\
+  template <unsigned Dim2>						\
+  Target &operator op(const HostMemory<value_type, Dim2> &src)		\
+  {									\
+    return *this op Expression<Terminal<value_type, HostSpace> >(node(src)); \
+  }									\
+									\
+  template <unsigned Dim2>						\
+  Target &operator op(const DeviceMemory<value_type, Dim2> &src)	\
+  {									\
+    return *this op Expression<Terminal<value_type, DeviceSpace> >(node(src)); \
+  }
+
+  CUDA_EXPRESSION_COMPOUND(+=, Add)
+  CUDA_EXPRESSION_COMPOUND(-=, Sub)
+  CUDA_EXPRESSION_COMPOUND(*=, Mul)
+  CUDA_EXPRESSION_COMPOUND(/=, Div)
+
+#undef CUDA_EXPRESSION_COMPOUND
+
+private:
+  Mem &m;
+};
+
+}  // namespace Expr
+
+
+/**
+   Use host memory as destination of an expression.
+   @param mem host memory
+   @return object to which an expression can be assigned
+*/
+template <class Type, unsigned Dim>
+inline Expr::Target<Type, Dim, Expr::HostSpace> expr(HostMemory<Type, Dim> &mem)
+{
+  return Expr::Target<Type, Dim, Expr::HostSpace>(mem);
+}
+
+/**
+   Use device memory as destination of an expression.
+   @param mem device memory
+   @return object to which an expression can be assigned
+*/
+template <class Type, unsigned Dim>
+inline Expr::Target<Type, Dim, Expr::DeviceSpace> expr(DeviceMemory<Type, Dim> &mem)
+{
+  return Expr::Target<Type, Dim, Expr::DeviceSpace>(mem);
+}
+
+
+/*
+  Operators building the expression tree.
+  Overloads with expression and scalar operands only are defined in namespace
+  Expr, where argument-dependent lookup finds them, overloads with HostMemory
+  or DeviceMemory operands are defined in namespace Cuda.
+*/
+
+namespace Expr {
+
+#define CUDA_EXPRESSION_BINARY(op, Op)					\
+template <class E1, class E2>						\
+inline Expression<Binary<Op, E1, E2> >					\
+operator op(const Expression<E1> &e1, const Expression<E2> &e2)	\
+{									\
+  return Binary<Op, E1, E2>(e1.node, e2.node);				\
+}									\
+									\
+template <class E>							\
+inline Expression<Binary<Op, E, Scalar<typename E::value_type> > >	\
+operator op(const Expression<E> &e, typename Expression<E>::value_type s) \
+{									\
+  return Binary<Op, E, Scalar<typename E::value_type> >(e.node, s);	\
+}									\
+									\
+template <class E>							\
+inline Expression<Binary<Op, Scalar<typename E::value_type>, E> >	\
+operator op(typename Expression<E>::value_type s, const Expression<E> &e) \
+{									\
+  return Binary<Op, Scalar<typename E::value_type>, E>(s, e.node);	\
+}
+
+CUDA_EXPRESSION_BINARY(+, Add)
+CUDA_EXPRESSION_BINARY(-, Sub)
+CUDA_EXPRESSION_BINARY(*, Mul)
+CUDA_EXPRESSION_BINARY(/, Div)
+
+#undef CUDA_EXPRESSION_BINARY
+
+template <class E>
+inline Expression<Unary<Neg, E> >
+operator-(const Expression<E> &e)
+{
+  return Unary<Neg, E>(e.node);
+}
+
+}  // namespace Expr
+
+#define CUDA_EXPRESSION_BINARY(op, Op)					\
+CUDA_EXPRESSION_BINARY_MEMORY(op, Op, HostMemory, HostNode)		\
+CUDA_EXPRESSION_BINARY_MEMORY(op, Op, DeviceMemory, DeviceNode)
+
+#define CUDA_EXPRESSION_BINARY_MEMORY(op, Op, Mem, Node)		\
+template <class Type, unsigned Dim1, unsigned Dim2>			\
+inline Expr::Expression<Expr::Binary<Expr::Op, typename Expr::Node<Type, Dim1>::type, typename Expr::Node<Type, Dim2>::type> > \
+operator op(const Mem<Type, Dim1> &m1, const Mem<Type, Dim2> &m2)	\
+{									\
+  return Expr::Binary<Expr::Op, typename Expr::Node<Type, Dim1>::type, typename Expr::Node<Type, Dim2>::type>(Expr::node(m1), Expr::node(m2)); \
+}									\
+									\
+template <class E, class Type, unsigned Dim>				\
+inline Expr::Expression<Expr::Binary<Expr::Op, E, typename Expr::Node<Type, Dim>::type> > \
+operator op(const Expr::Expression<E> &e, const Mem<Type, Dim> &m)	\
+{									\
+  return Expr::Binary<Expr::Op, E, typename Expr::Node<Type, Dim>::type>(e.node, Expr::node(m)); \
+}									\
+									\
+template <class E, class Type, unsigned Dim>				\
+inline Expr::Expression<Expr::Binary<Expr::Op, typename Expr::Node<Type, Dim>::type, E> > \
+operator op(const Mem<Type, Dim> &m, const Expr::Expression<E> &e)	\
+{									\
+  return Expr::Binary<Expr::Op, typename Expr::Node<Type, Dim>::type, E>(Expr::node(m), e.node); \
+}									\
+									\
+template <class Type, unsigned Dim>					\
+inline Expr::Expression<Expr::Binary<Expr::Op, typename Expr::Node<Type, Dim>::type, Expr::Scalar<Type> > > \
+operator op(const Mem<Type, Dim> &m, typename Expr::Identity<Type>::type s) \
+{									\
+  return Expr::Binary<Expr::Op, typename Expr::Node<Type, Dim>::type, Expr::Scalar<Type> >(Expr::node(m), s); \
+}									\
+									\
+template <class Type, unsigned Dim>					\
+inline Expr::Expression<Expr::Binary<Expr::Op, Expr::Scalar<Type>, typename Expr::Node<Type, Dim>::type> > \
+operator op(typename Expr::Identity<Type>::type s, const Mem<Type, Dim> &m) \
+{									\
+  return Expr::Binary<Expr::Op, Expr::Scalar<Type>, typename Expr::Node<Type, Dim>::type>(s, Expr::node(m)); \
+}
+
+CUDA_EXPRESSION_BINARY(+, Add)
+CUDA_EXPRESSION_BINARY(-, Sub)
+CUDA_EXPRESSION_BINARY(*, Mul)
+CUDA_EXPRESSION_BINARY(/, Div)
+
+#undef CUDA_EXPRESSION_BINARY
+#undef CUDA_EXPRESSION_BINARY_MEMORY
+
+template <class Type, unsigned Dim>
+inline Expr::Expression<Expr::Unary<Expr::Neg, typename Expr::HostNode<Type, Dim>::type> >
+operator-(const HostMemory<Type, Dim> &m)
+{
+  return Expr::Unary<Expr::Neg, typename Expr::HostNode<Type, Dim>::type>(Expr::node(m));
+}
+
+template <class Type, unsigned Dim>
+inline Expr::Expression<Expr::Unary<Expr::Neg, typename Expr::DeviceNode<Type, Dim>::type> >
+operator-(const DeviceMemory<Type, Dim> &m)
+{
+  return Expr::Unary<Expr::Neg, typename Expr::DeviceNode<Type, Dim>::type>(Expr::node(m));
+}
+
+}  // namespace Cuda
+
+
+#endif
@@ -0,0 +1,390 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_HALF_H
+#define CUDA_HALF_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cuda_runtime.h>
+#include <vector_types.h>
+
+/*
+  The F16C instructions are used for host conversions if CUDA_HALF_USE_F16C
+  is defined. This is done automatically if the compiler targets a processor
+  which supports them (e.g., gcc -mf16c or -march=native).
+*/
+#if !defined(CUDA_HALF_USE_F16C) && defined(__F16C__)
+#define CUDA_HALF_USE_F16C
+#endif
+
+#ifdef CUDA_HALF_USE_F16C
+#include <immintrin.h>
+#endif
+
+
+namespace Cuda {
+
+/**
+   Conversion between 32 bit floating point numbers and 16 bit formats.
+   Half precision (IEEE 754 binary16) has 5 exponent and 10 mantissa bits,
+   bfloat16 keeps the 8 exponent bits of float and truncates the mantissa to
+   7 bits. All conversions from float round to nearest even and preserve
+   infinity and NaN, so the host and device paths give identical results
+   (except for the payload of NaNs).
+*/
+namespace Float16 {
+
+/**
+   Reinterpret float as integer.
+*/
+__host__ __device__ inline uint32_t bits(float f)
+{
+  union { float f; uint32_t u; } x;
+  x.f = f;
+  return x.u;
+}
+
+/**
+   Reinterpret integer as float.
+*/
+__host__ __device__ inline float value(uint32_t u)
+{
+  union { float f; uint32_t u; } x;
+  x.u = u;
+  return x.f;
+}
+
+/**
+   Convert float to half precision in software.
+   @param f value
+   @return bit pattern of half precision value
+*/
+__host__ __device__ inline uint16_t fromFloatSoftware(float f)
+{
+  uint32_t x = bits(f);
+  uint32_t sign = (x >> 16) & 0x8000;
+  uint32_t a = x & 0x7fffffff;
+
+  // infinity and NaN (keep NaN quiet):
+  if(a >= 0x7f800000)
+    return sign | 0x7c00 | ((a > 0x7f800000) ? (0x200 | ((a >> 13) & 0x3ff)) : 0);
+
+  // overflow (values from 65520 on round to infinity):
+  if(a >= 0x477ff000)
+    return sign | 0x7c00;
+
+  // subnormal result or zero:
+  if(a < 0x38800000) {
+    if(a < 0x33000000)
+      return sign;
+
+    uint32_t e = a >> 23;
+    uint32_t m = (a & 0x7fffff) | 0x800000;
+    uint32_t shift = 126 - e;
+    uint32_t r = m >> shift, rem = m & ((1u << shift) - 1), tie = 1u << (shift - 1);
+
+    if((rem > tie) || ((rem == tie) && (r & 1)))
+      ++r;
+
+    return sign | r;
+  }
+
+  // normal result (rounding may carry into the exponent):
+  uint32_t r = (a - 0x38000000) >> 13, rem = a & 0x1fff;
+
+  if((rem > 0x1000) || ((rem == 0x1000) && (r & 1)))
+    ++r;
+
+  return sign | r;
+}
+
+/**
+   Convert half precision to float in software.
+   @param h bit pattern of half precision value
+   @return value
+*/
+__host__ __device__ inline float toFloatSoftware(uint16_t h)
+{
+  uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+  uint32_t e = (h >> 10) & 0x1f, m = h & 0x3ff;
+
+  // infinity and NaN (make NaN quiet):
+  if(e == 0x1f)
+    return value(sign | 0x7f800000 | (m << 13) | (m ? 0x400000 : 0));
+
+  if(e == 0) {
+    if(m == 0)
+      return value(sign);
+
+    // normalize subnormal value:
+    e = 113;
+
+    do {
+      m <<= 1;
+      --e;
+    } while(!(m & 0x400));
+
+    return value(sign | (e << 23) | ((m & 0x3ff) << 13));
+  }
+
+  return value(sign | ((e + 112) << 23) | (m << 13));
+}
+
+/**
+   Convert float to half precision.
+   Device code uses the conversion instruction of the GPU, host code uses
+   F16C if enabled.
+   @param f value
+   @return bit pattern of half precision value
+*/
+__host__ __device__ inline uint16_t fromFloat(float f)
+{
+#ifdef __CUDA_ARCH__
+  unsigned short h;
+  asm("cvt.rn.f16.f32 %0, %1;" : "=h"(h) : "f"(f));
+  return h;
+#elif defined(CUDA_HALF_USE_F16C)
+  return _cvtss_sh(f, 0);
+#else
+  return fromFloatSoftware(f);
+#endif
+}
+
+/**
+   Convert half precision to float.
+   @param h bit pattern of half precision value
+   @return value
+*/
+__host__ __device__ inline float toFloat(uint16_t h)
+{
+#ifdef __CUDA_ARCH__
+  float f;
+  asm("cvt.f32.f16 %0, %1;" : "=f"(f) : "h"((unsigned short)h));
+  return f;
+#elif defined(CUDA_HALF_USE_F16C)
+  return _cvtsh_ss(h);
+#else
+  return toFloatSoftware(h);
+#endif
+}
+
+/**
+   Convert float to bfloat16.
+   @param f value
+   @return bit pattern of bfloat16 value
+*/
+__host__ __device__ inline uint16_t fromFloatBF16(float f)
+{
+  uint32_t x = bits(f);
+
+  if((x & 0x7fffffff) > 0x7f800000)
+    return (x >> 16) | 0x40;
+
+  return (x + 0x7fff + ((x >> 16) & 1)) >> 16;
+}
+
+/**
+   Convert bfloat16 to float.
+   @param b bit pattern of bfloat16 value
+   @return value
+*/
+__host__ __device__ inline float toFloatBF16(uint16_t b)
+{
+  return value((uint32_t)b << 16);
+}
+
+}  // namespace Float16
+
+/**
+   Half precision floating point number.
+   Values are stored in IEEE 754 binary16 format and converted to and from
+   float implicitly, so arithmetic is done in single precision. Storing
+   intermediate data in this format halves memory footprint and bandwidth.
+*/
+struct half
+{
+  /** bit pattern */
+  uint16_t x;
+
+  /** Default constructor (leaves the value uninitialized). */
+  __host__ __device__ inline half() {}
+
+  /** Constructor. */
+  __host__ __device__ inline half(float f): x(Float16::fromFloat(f)) {}
+
+  /** Convert to float. */
+  __host__ __device__ inline operator float() const { return Float16::toFloat(x); }
+
+  /**
+     Create value from bit pattern.
+  */
+  static __host__ __device__ inline half fromBits(uint16_t b) { half h; h.x = b; return h; }
+};
+
+/**
+   Brain floating point number.
+   This format has the same range as float, but only 8 significant bits.
+*/
+struct bfloat16
+{
+  /** bit pattern */
+  uint16_t x;
+
+  /** Default constructor (leaves the value uninitialized). */
+  __host__ __device__ inline bfloat16() {}
+
+  /** Constructor. */
+  __host__ __device__ inline bfloat16(float f): x(Float16::fromFloatBF16(f)) {}
+
+  /** Convert to float. */
+  __host__ __device__ inline operator float() const { return Float16::toFloatBF16(x); }
+
+  /**
+     Create value from bit pattern.
+  */
+  static __host__ __device__ inline bfloat16 fromBits(uint16_t b) { bfloat16 h; h.x = b; return h; }
+};
+
+/*
+  Vector types in the style of the CUDA vector types (e.g., half4 for
+  float4), which can be used with pack() and unpack() and are converted to
+  and from the corresponding float vector types.
+*/
+#define CUDA_HALF_VECTOR(Vec, Scalar)					\
+struct Vec ## 1								\
+{									\
+  Scalar x;								\
+  __host__ __device__ inline Vec ## 1() {}				\
+  __host__ __device__ inline Vec ## 1(const float1 &v): x(v.x) {}	\
+  __host__ __device__ inline operator float1() const { float1 v; v.x = x; return v; } \
+};									\
+									\
+struct Vec ## 2								\
+{									\
+  Scalar x, y;								\
+  __host__ __device__ inline Vec ## 2() {}				\
+  __host__ __device__ inline Vec ## 2(const float2 &v): x(v.x), y(v.y) {} \
+  __host__ __device__ inline operator float2() const { float2 v; v.x = x; v.y = y; return v; } \
+};									\
+									\
+struct Vec ## 3								\
+{									\
+  Scalar x, y, z;							\
+  __host__ __device__ inline Vec ## 3() {}				\
+  __host__ __device__ inline Vec ## 3(const float3 &v): x(v.x), y(v.y), z(v.z) {} \
+  __host__ __device__ inline operator float3() const { float3 v; v.x = x; v.y = y; v.z = z; return v; } \
+};									\
+									\
+struct Vec ## 4								\
+{									\
+  Scalar x, y, z, w;							\
+  __host__ __device__ inline Vec ## 4() {}				\
+  __host__ __device__ inline Vec ## 4(const float4 &v): x(v.x), y(v.y), z(v.z), w(v.w) {} \
+  __host__ __device__ inline operator float4() const { float4 v; v.x = x; v.y = y; v.z = z; v.w = w; return v; } \
+};
+
+CUDA_HALF_VECTOR(half, half)
+CUDA_HALF_VECTOR(bfloat16_, bfloat16)
+
+#undef CUDA_HALF_VECTOR
+
+/**
+   Convert consecutive floats to half precision on the host.
+   This is used by the host conversion functions in convert.hpp and
+   processes 16 (AVX-512) or 8 (F16C) elements per instruction if enabled.
+   @param dst destination pointer
+   @param src source pointer
+   @param n number of elements
+*/
+inline void convert(half *dst, const float *src, size_t n)
+{
+  size_t i = 0;
+
+#ifdef CUDA_HALF_USE_F16C
+#ifdef __AVX512F__
+  for(; i + 16 <= n; i += 16)
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm512_maskz_cvtps_ph(0xffff, _mm512_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+#endif
+
+  for(; i + 8 <= n; i += 8)
+    _mm_storeu_si128((__m128i *)(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+#endif
+
+  for(; i < n; ++i)
+    dst[i] = src[i];
+}
+
+/**
+   Convert consecutive half precision values to float on the host.
+   @param dst destination pointer
+   @param src source pointer
+   @param n number of elements
+*/
+inline void convert(float *dst, const half *src, size_t n)
+{
+  size_t i = 0;
+
+#ifdef CUDA_HALF_USE_F16C
+#ifdef __AVX512F__
+  for(; i + 16 <= n; i += 16)
+    _mm512_storeu_ps(dst + i, _mm512_maskz_cvtph_ps(0xffff, _mm256_loadu_si256((const __m256i *)(src + i))));
+#endif
+
+  for(; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(src + i))));
+#endif
+
+  for(; i < n; ++i)
+    dst[i] = src[i];
+}
+
+/**
+   Convert consecutive floats to bfloat16 on the host.
+   The conversion only involves integer operations on the bit patterns and
+   is vectorized by the compiler.
+   @param dst destination pointer
+   @param src source pointer
+   @param n number of elements
+*/
+inline void convert(bfloat16 *dst, const float *src, size_t n)
+{
+  for(size_t i = 0; i < n; ++i)
+    dst[i].x = Float16::fromFloatBF16(src[i]);
+}
+
+/**
+   Convert consecutive bfloat16 values to float on the host.
+   @param dst destination pointer
+   @param src source pointer
+   @param n number of elements
+*/
+inline void convert(float *dst, const bfloat16 *src, size_t n)
+{
+  for(size_t i = 0; i < n; ++i)
+    dst[i] = Float16::toFloatBF16(src[i].x);
+}
+
+}  // namespace Cuda
+
+
+#endif
@@ -0,0 +1,295 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_HISTOGRAM_H
+#define CUDA_HISTOGRAM_H
+
+
+#include <cstring>
+#include <vector>
+
+#include <cudatemplates/devicememory.hpp>
+#include <cudatemplates/error.hpp>
+#include <cudatemplates/hostmemory.hpp>
+#include <cudatemplates/reduce.hpp>
+
+
+/**
+   Maximum number of bins for which device histograms are accumulated in
+   shared memory.
+*/
+#ifndef CUDA_HISTOGRAM_SHARED_BINS
+#define CUDA_HISTOGRAM_SHARED_BINS 1024
+#endif
+
+
+namespace Cuda {
+
+namespace Histogram {
+
+/**
+   Default value range of histograms.
+   Values v with min <= v < max are counted.
+*/
+template <class Type> struct Range { static double min() { return 0; } static double max() { return 1; } };
+template <> struct Range<unsigned char> { static double min() { return 0; } static double max() { return 256; } };
+template <> struct Range<unsigned short> { static double min() { return 0; } static double max() { return 65536; } };
+
+/**
+   Mapping of values to bins.
+*/
+template <class Type>
+struct Binning
+{
+  float ofs, scale;
+  int bins;
+
+  Binning(double min, double max, int _bins):
+    ofs((float)min), scale((float)(_bins / (max - min))), bins(_bins)
+  {
+    if(!(max > min))
+      CUDA_ERROR("invalid histogram range");
+  }
+
+  /**
+     Get bin index.
+     @return bin index or -1 if value is out of range
+  */
+  __host__ __device__ inline int operator()(Type v) const
+  {
+    float f = ((float)v - ofs) * scale;
+    return ((f >= 0) && (f < bins)) ? (int)f : -1;
+  }
+};
+
+/**
+   Add the values of one row to a (thread-private) histogram.
+*/
+template <class Type>
+inline void addRow(unsigned *hist, const Type *p, size_t n, const Binning<Type> &binning)
+{
+  for(size_t i = 0; i < n; ++i) {
+    int b = binning(p[i]);
+
+    if(b >= 0)
+      ++hist[b];
+  }
+}
+
+/**
+   Specialization for the full range of 8 bit values.
+   Four interleaved sub-histograms avoid stalls when consecutive pixels fall
+   into the same bin.
+*/
+inline void addRow8(unsigned *hist, const unsigned char *p, size_t n)
+{
+  unsigned sub[4][256];
+  memset(sub, 0, sizeof(sub));
+  size_t i = 0;
+
+  for(; i + 4 <= n; i += 4) {
+    ++sub[0][p[i]];
+    ++sub[1][p[i + 1]];
+    ++sub[2][p[i + 2]];
+    ++sub[3][p[i + 3]];
+  }
+
+  for(; i < n; ++i)
+    ++sub[0][p[i]];
+
+  for(int b = 0; b < 256; ++b)
+    hist[b] += sub[0][b] + sub[1][b] + sub[2][b] + sub[3][b];
+}
+
+template <class Type>
+inline bool fullRange8(const Binning<Type> &) { return false; }
+
+inline bool fullRange8(const Binning<unsigned char> &binning)
+{
+  return (binning.bins == 256) && (binning.ofs == 0) && (binning.scale == 1);
+}
+
+#ifdef __CUDACC__
+
+template <class Type, unsigned Dim>
+__global__ void histogram_kernel(typename DeviceMemory<Type, Dim>::KernelData src, Reduction::Region<Dim> region,
+				 size_t count, Binning<Type> binning, unsigned *hist)
+{
+  __shared__ unsigned s[CUDA_HISTOGRAM_SHARED_BINS];
+  bool shared = binning.bins <= CUDA_HISTOGRAM_SHARED_BINS;
+
+  if(shared) {
+    for(int b = threadIdx.x; b < binning.bins; b += blockDim.x)
+      s[b] = 0;
+
+    __syncthreads();
+  }
+
+  for(size_t i = threadIdx.x + blockIdx.x * blockDim.x; i < count; i += blockDim.x * gridDim.x) {
+    size_t o = 0, j = i;
+
+    for(unsigned d = 0; d < Dim; ++d) {
+      o += (region.ofs[d] + j % region.size[d]) * ((d == 0) ? 1 : src.stride[d - 1]);
+      j /= region.size[d];
+    }
+
+    int b = binning(src.data[o]);
+
+    if(b < 0)
+      continue;
+
+    if(shared)
+      atomicAdd(&s[b], 1);
+    else
+      atomicAdd(&hist[b], 1);
+  }
+
+  if(shared) {
+    __syncthreads();
+
+    for(int b = threadIdx.x; b < binning.bins; b += blockDim.x)
+      if(s[b] > 0)
+	atomicAdd(&hist[b], s[b]);
+  }
+}
+
+#endif  // __CUDACC__
+
+}  // namespace Histogram
+
+
+/**
+   Compute histogram of host memory.
+   Only the region of interest (region_ofs and region_size) of the source is
+   taken into account. The rows of the region are distributed among threads
+   (if OpenMP is enabled), each of which accumulates a private histogram;
+   these are merged at the end.
+   @param src source image
+   @param hist histogram, the number of bins is given by its size
+   @param min lower limit of values to be counted
+   @param max upper limit (exclusive) of values to be counted
+*/
+template <class Type, unsigned Dim>
+void histogram(const HostMemory<Type, Dim> &src, HostMemory<unsigned, 1> &hist, double min, double max)
+{
+  Reduction::checkRegion(src, src.region_ofs, src.region_size);
+  Histogram::Binning<Type> binning(min, max, hist.size[0]);
+  const bool full8 = Histogram::fullRange8(binning);
+  const int bins = binning.bins;
+  int rows = 1;
+
+  for(unsigned i = 1; i < Dim; ++i)
+    rows *= src.region_size[i];
+
+  unsigned *h = hist.getBuffer();
+  memset(h, 0, bins * sizeof(unsigned));
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    std::vector<unsigned> local(bins, 0);
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(int r = 0; r < rows; ++r) {
+      const Type *p = src.getBuffer() + Reduction::rowOffset(src, src.region_ofs, src.region_size, r);
+
+      if(full8)
+	Histogram::addRow8(&local[0], (const unsigned char *)p, src.region_size[0]);
+      else
+	Histogram::addRow(&local[0], p, src.region_size[0], binning);
+    }
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+    for(int b = 0; b < bins; ++b)
+      h[b] += local[b];
+  }
+}
+
+/**
+   Compute histogram of host memory over the default value range.
+   The default range is [0, 256) for unsigned char, [0, 65536) for unsigned
+   short and [0, 1) for all other types.
+   @param src source image
+   @param hist histogram
+*/
+template <class Type, unsigned Dim>
+void histogram(const HostMemory<Type, Dim> &src, HostMemory<unsigned, 1> &hist)
+{
+  histogram(src, hist, Histogram::Range<Type>::min(), Histogram::Range<Type>::max());
+}
+
+#if defined(__CUDACC__) || defined(__DOXYGEN__)
+
+/**
+   Compute histogram of device memory.
+   Each block accumulates a histogram in shared memory (if the number of bins
+   doesn't exceed CUDA_HISTOGRAM_SHARED_BINS), which is added to the result
+   by atomic operations. This requires a GPU with compute capability 1.2.
+   @param src source image
+   @param hist histogram, the number of bins is given by its size
+   @param min lower limit of values to be counted
+   @param max upper limit (exclusive) of values to be counted
+*/
+template <class Type, unsigned Dim>
+void histogram(const DeviceMemory<Type, Dim> &src, DeviceMemory<unsigned, 1> &hist, double min, double max)
+{
+  Reduction::checkRegion(src, src.region_ofs, src.region_size);
+  Histogram::Binning<Type> binning(min, max, hist.size[0]);
+  size_t count = 1;
+
+  for(unsigned i = 0; i < Dim; ++i)
+    count *= src.region_size[i];
+
+  CUDA_CHECK(cudaMemset(hist.getBuffer(), 0, hist.size[0] * sizeof(unsigned)));
+  size_t blocks = (count + 256 * 64 - 1) / (256 * 64);
+
+  if(blocks == 0)
+    return;
+
+  if(blocks > 256)
+    blocks = 256;
+
+  Histogram::histogram_kernel<Type, Dim><<<blocks, 256>>>(src, Reduction::Region<Dim>(src.region_ofs, src.region_size),
+							  count, binning, hist.getBuffer());
+  CUDA_CHECK(cudaGetLastError());
+}
+
+/**
+   Compute histogram of device memory over the default value range.
+   @param src source image
+   @param hist histogram
+*/
+template <class Type, unsigned Dim>
+void histogram(const DeviceMemory<Type, Dim> &src, DeviceMemory<unsigned, 1> &hist)
+{
+  histogram(src, hist, Histogram::Range<Type>::min(), Histogram::Range<Type>::max());
+}
+
+#endif  // defined(__CUDACC__) || defined(__DOXYGEN__)
+
+}  // namespace Cuda
+
+
+#endif
@@ -0,0 +1,869 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_HOSTBLAS_H
+#define CUDA_HOSTBLAS_H
+
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef CUDA_HOSTBLAS_USE_CBLAS
+extern "C" {
+#include <cblas.h>
+}
+#endif
+
+#include <cudatemplates/error.hpp>
+#include <cudatemplates/hostmemory.hpp>
+
+
+/**
+   Block size (in elements) used for cache blocking in the host
+   implementation of gemm. A block of A (block x block elements) plus one
+   column block of B and C should fit into the L2 cache.
+*/
+#ifndef CUDA_HOSTBLAS_BLOCK
+#define CUDA_HOSTBLAS_BLOCK 128
+#endif
+
+
+namespace Cuda {
+namespace BLAS {
+
+/**
+   Host implementation of the Cuda::BLAS interface.
+   This namespace provides the same vector and matrix classes and the same
+   free functions as the CUBLAS wrapper in cublas.hpp, but all data lives in
+   CPU memory and all operations are executed on the host. Numerical code
+   which is written against these names (e.g., by means of a namespace alias)
+   can therefore be run and benchmarked on the CPU without modification.
+   If CUDA_HOSTBLAS_USE_CBLAS is defined, the float and double functions are
+   forwarded to an external CBLAS implementation, otherwise blocked loops
+   suitable for automatic vectorization are used.
+   Matrices are stored in column-major order, as in CUBLAS.
+*/
+namespace Host {
+
+/**
+   Initialization.
+   Provided for compatibility with Cuda::BLAS::init(), nothing to be done.
+*/
+static inline void init()
+{
+}
+
+template <class T>
+class Vector
+{
+public:
+  typedef T value_type;
+  typedef unsigned size_type;
+
+  inline int inc() const { return m_inc; }
+  inline operator T*() { return m_hostPtr; }
+  inline operator const T*() const { return m_hostPtr; }
+
+  inline T &operator()(size_type i) { return m_hostPtr[i * m_inc]; }
+  inline const T &operator()(size_type i) const { return m_hostPtr[i * m_inc]; }
+
+  Vector():
+    m_size(0), m_inc(1), m_hostPtr(0), m_owner(true)
+  {
+  }
+
+  Vector(size_type size):
+    m_size(size), m_inc(1), m_hostPtr(0), m_owner(true)
+  {
+    alloc();
+    makeZero();
+  }
+
+  Vector(const Vector &v):
+    m_size(v.m_size), m_inc(1), m_hostPtr(0), m_owner(true)
+  {
+    alloc();
+    v.getValues(m_hostPtr);
+  }
+
+  ~Vector()
+  {
+    if(m_owner)
+      ::free(m_hostPtr);
+
+    m_hostPtr = 0;
+    m_size = 0;
+  }
+
+  void makeZero()
+  {
+    if(m_inc == 1) {
+      memset(m_hostPtr, 0, m_size * sizeof(T));
+      return;
+    }
+
+    for(size_type i = 0; i < m_size; ++i)
+      m_hostPtr[i * m_inc] = 0;
+  }
+
+  void setValues(const T *values)
+  {
+    if(m_inc == 1) {
+      memcpy(m_hostPtr, values, m_size * sizeof(T));
+      return;
+    }
+
+    for(size_type i = 0; i < m_size; ++i)
+      m_hostPtr[i * m_inc] = values[i];
+  }
+
+  /**
+     Copy vector to a newly allocated array.
+     The caller is responsible for deleting the returned array.
+  */
+  const T* getValues(void)
+  {
+    T* v = new T[m_size];
+    getValues(v);
+    return v;
+  }
+
+  /**
+     Copy vector to a given array.
+     @param v array with at least getSize() elements
+  */
+  void getValues(T *v) const
+  {
+    if(m_inc == 1) {
+      memcpy(v, m_hostPtr, m_size * sizeof(T));
+      return;
+    }
+
+    for(size_type i = 0; i < m_size; ++i)
+      v[i] = m_hostPtr[i * m_inc];
+  }
+
+  const size_type getSize() const
+  {
+    return m_size;
+  }
+
+protected:
+  /**
+     Constructor for vectors referring to existing host memory.
+     The memory is not freed by the destructor.
+  */
+  Vector(T *hostPtr, size_type size, int inc):
+    m_size(size), m_inc(inc), m_hostPtr(hostPtr), m_owner(false)
+  {
+  }
+
+private:
+  size_type m_size;
+  int m_inc;
+  T *m_hostPtr;
+  bool m_owner;
+
+  void alloc()
+  {
+    if(m_size == 0)
+      return;
+
+    m_hostPtr = (T *)malloc(m_size * sizeof(T));
+
+    if(m_hostPtr == 0)
+      CUDA_ERROR("out of memory");
+  }
+
+  Vector &operator=(const Vector &);
+};
+
+
+/**
+   Vector referring to existing host memory.
+   See Cuda::BLAS::VectorReference.
+*/
+template <class T>
+class VectorReference: public Vector<T>
+{
+public:
+  typedef typename Vector<T>::size_type size_type;
+
+  /**
+     Constructor.
+     @param hostPtr pointer to first element
+     @param size number of elements
+     @param inc distance between consecutive elements
+  */
+  VectorReference(T *hostPtr, size_type size, int inc = 1):
+    Vector<T>(hostPtr, size, inc)
+  {
+  }
+
+  /**
+     Constructor.
+     @param mem one-dimensional host memory
+  */
+  VectorReference(HostMemory<T, 1> &mem):
+    Vector<T>(mem.getBuffer(), mem.size[0], 1)
+  {
+  }
+
+  /**
+     Copy constructor.
+     This creates another reference to the same host memory.
+  */
+  VectorReference(const VectorReference &v):
+    Vector<T>(const_cast<T *>((const T *)v), v.getSize(), v.inc())
+  {
+  }
+};
+
+/**
+   Get reference to row of two-dimensional host memory.
+   @param mem host memory
+   @param y row index
+*/
+template <class T>
+VectorReference<T> row(HostMemory<T, 2> &mem, size_t y)
+{
+  if(y >= mem.size[1])
+    CUDA_ERROR("out of bounds");
+
+  return VectorReference<T>(mem.getBuffer() + y * mem.stride[0], mem.size[0], 1);
+}
+
+/**
+   Get reference to column of two-dimensional host memory.
+   @param mem host memory
+   @param x column index
+*/
+template <class T>
+VectorReference<T> column(HostMemory<T, 2> &mem, size_t x)
+{
+  if(x >= mem.size[0])
+    CUDA_ERROR("out of bounds");
+
+  return VectorReference<T>(mem.getBuffer() + x, mem.size[1], mem.stride[0]);
+}
+
+
+/**
+   Matrix in host memory.
+   The matrix has getHeight() rows and getWidth() columns and is stored in
+   column-major order, i.e., element (i, j) is found at position
+   i + j * getLd().
+*/
+template <class T>
+class Matrix
+{
+public:
+  typedef T value_type;
+  typedef unsigned size_type;
+
+  inline operator T*() { return m_hostPtr; }
+  inline operator const T*() const { return m_hostPtr; }
+
+  inline T &operator()(size_type i, size_type j) {
+    return m_hostPtr[i + j * m_ld];
+  }
+
+  inline const T &operator()(size_type i, size_type j) const {
+    return m_hostPtr[i + j * m_ld];
+  }
+
+  Matrix():
+    m_width(0), m_height(0), m_ld(0), m_hostPtr(0), m_owner(true)
+  {
+  }
+
+  Matrix(size_type width, size_type height):
+    m_width(width), m_height(height), m_ld(height), m_hostPtr(0), m_owner(true)
+  {
+    if(width * height == 0)
+      return;
+
+    m_hostPtr = (T *)calloc(width * height, sizeof(T));
+
+    if(m_hostPtr == 0)
+      CUDA_ERROR("out of memory");
+  }
+
+  ~Matrix()
+  {
+    if(m_owner)
+      ::free(m_hostPtr);
+
+    m_width = 0;
+    m_height = 0;
+    m_hostPtr = 0;
+  }
+
+  /**
+     Set matrix elements.
+     @param values array in column-major order (getHeight() x getWidth())
+  */
+  void setValues(const T *values)
+  {
+    if(m_ld == m_height) {
+      memcpy(m_hostPtr, values, m_width * m_height * sizeof(T));
+      return;
+    }
+
+    for(size_type j = 0; j < m_width; ++j)
+      memcpy(m_hostPtr + j * m_ld, values + j * m_height, m_height * sizeof(T));
+  }
+
+  /**
+     Get matrix elements.
+     @param values array in column-major order (getHeight() x getWidth())
+  */
+  void getValues(T *values) const
+  {
+    for(size_type j = 0; j < m_width; ++j)
+      memcpy(values + j * m_height, m_hostPtr + j * m_ld, m_height * sizeof(T));
+  }
+
+  const size_type getWidth() const
+  {
+    return m_width;
+  }
+
+  const size_type getHeight() const
+  {
+    return m_height;
+  }
+
+  /**
+     Get leading dimension.
+     @return distance (in elements) between consecutive columns
+  */
+  const size_type getLd() const
+  {
+    return m_ld;
+  }
+
+protected:
+  /**
+     Constructor for matrices referring to existing host memory.
+     The memory is not freed by the destructor.
+  */
+  Matrix(T *hostPtr, size_type width, size_type height, size_type ld):
+    m_width(width), m_height(height), m_ld(ld), m_hostPtr(hostPtr), m_owner(false)
+  {
+  }
+
+private:
+  size_type m_width;
+  size_type m_height;
+  size_type m_ld;
+  T *m_hostPtr;
+  bool m_owner;
+
+  Matrix(const Matrix &);
+  Matrix &operator=(const Matrix &);
+};
+
+
+/**
+   Matrix referring to existing host memory.
+   See Cuda::BLAS::MatrixReference.
+*/
+template <class T>
+class MatrixReference: public Matrix<T>
+{
+public:
+  typedef typename Matrix<T>::size_type size_type;
+
+  /**
+     Constructor.
+     @param hostPtr pointer to first element
+     @param width number of columns
+     @param height number of rows
+     @param ld leading dimension
+  */
+  MatrixReference(T *hostPtr, size_type width, size_type height, size_type ld):
+    Matrix<T>(hostPtr, width, height, ld)
+  {
+  }
+
+  /**
+     Constructor.
+     @param mem two-dimensional host memory
+  */
+  MatrixReference(HostMemory<T, 2> &mem):
+    Matrix<T>(mem.getBuffer(), mem.size[1], mem.size[0], mem.stride[0])
+  {
+  }
+
+  /**
+     Copy constructor.
+     This creates another reference to the same host memory.
+  */
+  MatrixReference(const MatrixReference &m):
+    Matrix<T>(const_cast<T *>((const T *)m), m.getWidth(), m.getHeight(), m.getLd())
+  {
+  }
+};
+
+
+/*
+  Level 1.
+  The reductions use four independent partial results so that the compiler
+  can keep several vector registers busy.
+  As in CUBLAS, iamax and iamin return 1-based indices, or 0 for empty
+  vectors.
+*/
+
+template <class T>
+int iamax(const Vector<T> &x)
+{
+  const T *px = x;
+  int n = x.getSize(), incx = x.inc(), imax = 0;
+
+  if(n == 0)
+    return 0;
+
+  T vmax = -1;
+
+  for(int i = 0; i < n; ++i) {
+    T v = std::abs(px[i * incx]);
+
+    if(v > vmax) {
+      vmax = v;
+      imax = i;
+    }
+  }
+
+  return imax + 1;
+}
+
+template <class T>
+int iamin(const Vector<T> &x)
+{
+  const T *px = x;
+  int n = x.getSize(), incx = x.inc(), imin = 0;
+
+  if(n == 0)
+    return 0;
+
+  T vmin = std::abs(px[0]);
+
+  for(int i = 1; i < n; ++i) {
+    T v = std::abs(px[i * incx]);
+
+    if(v < vmin) {
+      vmin = v;
+      imin = i;
+    }
+  }
+
+  return imin + 1;
+}
+
+template <class T>
+T asum(const Vector<T> &x)
+{
+  const T *px = x;
+  int n = x.getSize(), incx = x.inc();
+  T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  int i = 0;
+
+  if(incx == 1) {
+    for(; i + 4 <= n; i += 4) {
+      s0 += std::abs(px[i    ]);
+      s1 += std::abs(px[i + 1]);
+      s2 += std::abs(px[i + 2]);
+      s3 += std::abs(px[i + 3]);
+    }
+  }
+
+  for(; i < n; ++i)
+    s0 += std::abs(px[i * incx]);
+
+  return (s0 + s1) + (s2 + s3);
+}
+
+template <class T>
+void axpy(T alpha, const Vector<T> &x, Vector<T> &y)
+{
+  assert(x.getSize() == y.getSize());
+  const T *px = x;
+  T *py = y;
+  int n = x.getSize(), incx = x.inc(), incy = y.inc();
+
+  if((incx == 1) && (incy == 1)) {
+    for(int i = 0; i < n; ++i)
+      py[i] += alpha * px[i];
+  }
+  else {
+    for(int i = 0; i < n; ++i)
+      py[i * incy] += alpha * px[i * incx];
+  }
+}
+
+template <class T>
+void copy(const Vector<T> &x, Vector<T> &y)
+{
+  assert(x.getSize() == y.getSize());
+  const T *px = x;
+  T *py = y;
+  int n = x.getSize(), incx = x.inc(), incy = y.inc();
+
+  if((incx == 1) && (incy == 1)) {
+    memcpy(py, px, n * sizeof(T));
+  }
+  else {
+    for(int i = 0; i < n; ++i)
+      py[i * incy] = px[i * incx];
+  }
+}
+
+template <class T>
+T dot(const Vector<T> &x, const Vector<T> &y)
+{
+  assert(x.getSize() == y.getSize());
+  const T *px = x, *py = y;
+  int n = x.getSize(), incx = x.inc(), incy = y.inc();
+  T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  int i = 0;
+
+  if((incx == 1) && (incy == 1)) {
+    for(; i + 4 <= n; i += 4) {
+      s0 += px[i    ] * py[i    ];
+      s1 += px[i + 1] * py[i + 1];
+      s2 += px[i + 2] * py[i + 2];
+      s3 += px[i + 3] * py[i + 3];
+    }
+  }
+
+  for(; i < n; ++i)
+    s0 += px[i * incx] * py[i * incy];
+
+  return (s0 + s1) + (s2 + s3);
+}
+
+template <class T>
+T nrm2(const Vector<T> &x)
+{
+  const T *px = x;
+  int n = x.getSize(), incx = x.inc();
+  T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  int i = 0;
+
+  if(incx == 1) {
+    for(; i + 4 <= n; i += 4) {
+      s0 += px[i    ] * px[i    ];
+      s1 += px[i + 1] * px[i + 1];
+      s2 += px[i + 2] * px[i + 2];
+      s3 += px[i + 3] * px[i + 3];
+    }
+  }
+
+  for(; i < n; ++i)
+    s0 += px[i * incx] * px[i * incx];
+
+  return std::sqrt((s0 + s1) + (s2 + s3));
+}
+
+template <class T>
+void scal(T alpha, Vector<T> &x)
+{
+  T *px = x;
+  int n = x.getSize(), incx = x.inc();
+
+  for(int i = 0; i < n; ++i)
+    px[i * incx] *= alpha;
+}
+
+template <class T>
+void swap(Vector<T> &x, Vector<T> &y)
+{
+  assert(x.getSize() == y.getSize());
+  T *px = x, *py = y;
+  int n = x.getSize(), incx = x.inc(), incy = y.inc();
+
+  for(int i = 0; i < n; ++i) {
+    T t = px[i * incx];
+    px[i * incx] = py[i * incy];
+    py[i * incy] = t;
+  }
+}
+
+
+/*
+  Level 2.
+*/
+
+/**
+   Matrix-vector product y = alpha * op(A) * x + beta * y.
+   @param type 'n' for op(A) = A, 't' or 'c' for op(A) = transpose(A)
+*/
+template <class T>
+void gemv(char type, T alpha, const Matrix<T> &A, const Vector<T> &x, T beta, Vector<T> &y)
+{
+  const bool trans = (type != 'n') && (type != 'N');
+  const int m = A.getHeight(), n = A.getWidth(), lda = A.getLd();
+  assert(x.getSize() == (unsigned)(trans ? m : n));
+  assert(y.getSize() == (unsigned)(trans ? n : m));
+
+  const T *pa = A, *px = x;
+  T *py = y;
+  const int incx = x.inc(), incy = y.inc();
+
+  if(!trans) {
+    // y = beta * y, then accumulate columns of A (contiguous, axpy form):
+    for(int i = 0; i < m; ++i)
+      py[i * incy] = (beta == T(0)) ? T(0) : beta * py[i * incy];
+
+    for(int j = 0; j < n; ++j) {
+      const T *a = pa + (size_t)j * lda;
+      T t = alpha * px[j * incx];
+
+      if(incy == 1) {
+	for(int i = 0; i < m; ++i)
+	  py[i] += a[i] * t;
+      }
+      else {
+	for(int i = 0; i < m; ++i)
+	  py[i * incy] += a[i] * t;
+      }
+    }
+  }
+  else {
+    // each element of y is a dot product with a contiguous column of A:
+    for(int j = 0; j < n; ++j) {
+      const T *a = pa + (size_t)j * lda;
+      T s0 = 0, s1 = 0;
+      int i = 0;
+
+      if(incx == 1) {
+	for(; i + 2 <= m; i += 2) {
+	  s0 += a[i    ] * px[i    ];
+	  s1 += a[i + 1] * px[i + 1];
+	}
+      }
+
+      for(; i < m; ++i)
+	s0 += a[i] * px[i * incx];
+
+      T yj = (beta == T(0)) ? T(0) : beta * py[j * incy];
+      py[j * incy] = yj + alpha * (s0 + s1);
+    }
+  }
+}
+
+
+/*
+  Level 3.
+*/
+
+/**
+   Matrix-matrix product C = alpha * op(A) * op(B) + beta * C.
+   The product is computed in cache-sized blocks. In the non-transposed case
+   the innermost loop runs over a contiguous column of A and C. Columns of C
+   are distributed among threads if OpenMP is enabled.
+   @param transa 'n' for op(A) = A, 't' or 'c' for op(A) = transpose(A)
+   @param transb 'n' for op(B) = B, 't' or 'c' for op(B) = transpose(B)
+*/
+template <class T>
+void gemm(char transa, char transb, T alpha, const Matrix<T> &A, const Matrix<T> &B, T beta, Matrix<T> &C)
+{
+  const bool ta = (transa != 'n') && (transa != 'N');
+  const bool tb = (transb != 'n') && (transb != 'N');
+  const int m = C.getHeight(), n = C.getWidth();
+  const int k = ta ? A.getHeight() : A.getWidth();
+  const int lda = A.getLd(), ldb = B.getLd(), ldc = C.getLd();
+  assert((unsigned)m == (ta ? A.getWidth() : A.getHeight()));
+  assert((unsigned)k == (tb ? B.getWidth() : B.getHeight()));
+  assert((unsigned)n == (tb ? B.getHeight() : B.getWidth()));
+
+  const T *pa = A, *pb = B;
+  T *pc = C;
+  const int BS = CUDA_HOSTBLAS_BLOCK;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for(int jb = 0; jb < n; jb += BS) {
+    const int je = (jb + BS < n) ? jb + BS : n;
+
+    // scale block of C by beta:
+    for(int j = jb; j < je; ++j) {
+      T *c = pc + (size_t)j * ldc;
+
+      if(beta == T(0)) {
+	for(int i = 0; i < m; ++i)
+	  c[i] = 0;
+      }
+      else if(beta != T(1)) {
+	for(int i = 0; i < m; ++i)
+	  c[i] *= beta;
+      }
+    }
+
+    for(int pb0 = 0; pb0 < k; pb0 += BS) {
+      const int pe = (pb0 + BS < k) ? pb0 + BS : k;
+
+      for(int ib = 0; ib < m; ib += BS) {
+	const int ie = (ib + BS < m) ? ib + BS : m;
+
+	for(int j = jb; j < je; ++j) {
+	  T *c = pc + (size_t)j * ldc;
+
+	  if(!ta) {
+	    // four columns of A at once to reduce load/store traffic on C:
+	    int p = pb0;
+
+	    for(; p + 4 <= pe; p += 4) {
+	      const T *a0 = pa + (size_t)p * lda, *a1 = a0 + lda, *a2 = a1 + lda, *a3 = a2 + lda;
+	      T t0 = alpha * (tb ? pb[j + (size_t)p * ldb] : pb[p + (size_t)j * ldb]);
+	      T t1 = alpha * (tb ? pb[j + (size_t)(p + 1) * ldb] : pb[p + 1 + (size_t)j * ldb]);
+	      T t2 = alpha * (tb ? pb[j + (size_t)(p + 2) * ldb] : pb[p + 2 + (size_t)j * ldb]);
+	      T t3 = alpha * (tb ? pb[j + (size_t)(p + 3) * ldb] : pb[p + 3 + (size_t)j * ldb]);
+
+	      for(int i = ib; i < ie; ++i)
+		c[i] += (a0[i] * t0 + a1[i] * t1) + (a2[i] * t2 + a3[i] * t3);
+	    }
+
+	    for(; p < pe; ++p) {
+	      const T *a = pa + (size_t)p * lda;
+	      T t = alpha * (tb ? pb[j + (size_t)p * ldb] : pb[p + (size_t)j * ldb]);
+
+	      for(int i = ib; i < ie; ++i)
+		c[i] += a[i] * t;
+	    }
+	  }
+	  else {
+	    for(int i = ib; i < ie; ++i) {
+	      const T *a = pa + (size_t)i * lda;
+	      T s = 0;
+
+	      if(!tb) {
+		const T *b = pb + (size_t)j * ldb;
+
+		for(int p = pb0; p < pe; ++p)
+		  s += a[p] * b[p];
+	      }
+	      else {
+		for(int p = pb0; p < pe; ++p)
+		  s += a[p] * pb[j + (size_t)p * ldb];
+	      }
+
+	      c[i] += alpha * s;
+	    }
+	  }
+	}
+      }
+    }
+  }
+}
+
+
+#ifdef CUDA_HOSTBLAS_USE_CBLAS
+
+/*
+  Overloads forwarding to CBLAS.
+  Non-template functions take precedence over the generic templates above.
+*/
+
+#define CUDA_HOSTBLAS_CBLAS(type, t)					\
+inline int iamax(const Vector<type> &x)					\
+{									\
+  if(x.getSize() == 0)							\
+    return 0;								\
+									\
+  return (int)cblas_i ## t ## amax(x.getSize(), x, x.inc()) + 1;	\
+}									\
+									\
+inline type asum(const Vector<type> &x)					\
+{									\
+  return cblas_ ## t ## asum(x.getSize(), x, x.inc());			\
+}									\
+									\
+inline void axpy(type alpha, const Vector<type> &x, Vector<type> &y)	\
+{									\
+  assert(x.getSize() == y.getSize());					\
+  cblas_ ## t ## axpy(x.getSize(), alpha, x, x.inc(), y, y.inc());	\
+}									\
+									\
+inline void copy(const Vector<type> &x, Vector<type> &y)		\
+{									\
+  assert(x.getSize() == y.getSize());					\
+  cblas_ ## t ## copy(x.getSize(), x, x.inc(), y, y.inc());		\
+}									\
+									\
+inline type dot(const Vector<type> &x, const Vector<type> &y)		\
+{									\
+  assert(x.getSize() == y.getSize());					\
+  return cblas_ ## t ## dot(x.getSize(), x, x.inc(), y, y.inc());	\
+}									\
+									\
+inline type nrm2(const Vector<type> &x)					\
+{									\
+  return cblas_ ## t ## nrm2(x.getSize(), x, x.inc());			\
+}									\
+									\
+inline void scal(type alpha, Vector<type> &x)				\
+{									\
+  cblas_ ## t ## scal(x.getSize(), alpha, x, x.inc());			\
+}									\
+									\
+inline void swap(Vector<type> &x, Vector<type> &y)			\
+{									\
+  assert(x.getSize() == y.getSize());					\
+  cblas_ ## t ## swap(x.getSize(), x, x.inc(), y, y.inc());		\
+}									\
+									\
+inline void gemv(char type_, type alpha, const Matrix<type> &A, const Vector<type> &x, type beta, Vector<type> &y) \
+{									\
+  bool trans = (type_ != 'n') && (type_ != 'N');			\
+  cblas_ ## t ## gemv(CblasColMajor, trans ? CblasTrans : CblasNoTrans, \
+		      A.getHeight(), A.getWidth(), alpha, A, A.getLd(), \
+		      x, x.inc(), beta, y, y.inc());			\
+}									\
+									\
+inline void gemm(char transa, char transb, type alpha, const Matrix<type> &A, const Matrix<type> &B, type beta, Matrix<type> &C) \
+{									\
+  bool ta = (transa != 'n') && (transa != 'N');				\
+  bool tb = (transb != 'n') && (transb != 'N');				\
+  cblas_ ## t ## gemm(CblasColMajor,					\
+		      ta ? CblasTrans : CblasNoTrans,			\
+		      tb ? CblasTrans : CblasNoTrans,			\
+		      C.getHeight(), C.getWidth(), ta ? A.getHeight() : A.getWidth(), \
+		      alpha, A, A.getLd(), B, B.getLd(),	\
+		      beta, C, C.getLd());				\
+}
+
+CUDA_HOSTBLAS_CBLAS(float, s)
+CUDA_HOSTBLAS_CBLAS(double, d)
+
+#undef CUDA_HOSTBLAS_CBLAS
+
+#endif  // CUDA_HOSTBLAS_USE_CBLAS
+
+}  // namespace Host
+}  // namespace BLAS
+}  // namespace Cuda
+
+
+#endif
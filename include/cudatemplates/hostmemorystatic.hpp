@@ -0,0 +1,343 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_HOSTMEMORYSTATIC_H
+#define CUDA_HOSTMEMORYSTATIC_H
+
+
+#include <string.h>
+
+#include <cudatemplates/convert.hpp>
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/hostmemory.hpp>
+#include <cudatemplates/staticlayout.hpp>
+
+
+namespace Cuda {
+
+/**
+   Representation of CPU memory with size known at compile time.
+   The data is stored within the object itself, therefore no allocation is
+   performed, and small blocks (e.g., tiles or filter kernels) can be placed
+   on the stack. The copy functions below detect this class and use loops with
+   compile-time bounds, which the compiler can fully unroll and vectorize.
+*/
+template <class Type, unsigned S0, unsigned S1 = 0, unsigned S2 = 0, unsigned S3 = 0>
+class HostMemoryStatic:
+    virtual public Layout<Type, StaticSize<S0, S1, S2, S3>::Dim>,
+    virtual public Pointer<Type, StaticSize<S0, S1, S2, S3>::Dim>,
+    public HostMemory<Type, StaticSize<S0, S1, S2, S3>::Dim>,
+    public StaticLayout<Type, S0, S1, S2, S3>
+{
+public:
+  typedef StaticSize<S0, S1, S2, S3> Static;
+
+  enum { Dim = Static::Dim };
+
+  /**
+     Constructor.
+  */
+  inline HostMemoryStatic():
+    Layout<Type, Dim>(Static::size()),
+    Pointer<Type, Dim>(Static::size()),
+    HostMemory<Type, Dim>(Static::size())
+  {
+    this->buffer = data;
+  }
+
+  /**
+     Copy constructor.
+     @param x memory object to be copied
+  */
+  inline HostMemoryStatic(const HostMemoryStatic<Type, S0, S1, S2, S3> &x):
+    Layout<Type, Dim>(x),
+    Pointer<Type, Dim>(x),
+    HostMemory<Type, Dim>(x),
+    StaticLayout<Type, S0, S1, S2, S3>(x)
+  {
+    this->buffer = data;
+    copy(*this, x);
+  }
+
+  /**
+     Constructor from host memory of same size.
+     @param x host memory data, possibly of different data type
+  */
+  template <class Type2>
+  inline HostMemoryStatic(const HostMemory<Type2, Dim> &x):
+    Layout<Type, Dim>(Static::size()),
+    Pointer<Type, Dim>(Static::size()),
+    HostMemory<Type, Dim>(Static::size())
+  {
+    this->buffer = data;
+    copy(*this, x);
+  }
+
+  /**
+     Assignment operator.
+     The layout is fixed, so only the data is copied.
+     @param x memory object to be copied
+  */
+  inline HostMemoryStatic &operator=(const HostMemoryStatic<Type, S0, S1, S2, S3> &x)
+  {
+    copy(*this, x);
+    return *this;
+  }
+
+  /**
+     Array index operator.
+     @param i index
+     @return value at index i
+  */
+  inline Type &operator[](size_t i) { return data[i]; }
+
+  /**
+     Array index operator.
+     @param i index
+     @return value at index i
+  */
+  inline Type &operator[](const SizeBase<Dim> &i) { return data[this->getOffset(i)]; }
+
+  /**
+     Array index operator.
+     @param i index
+     @return value at index i (constant)
+  */
+  inline const Type &operator[](size_t i) const { return data[i]; }
+
+  /**
+     Array index operator.
+     @param i index
+     @return value at index i (constant)
+  */
+  inline const Type &operator[](const SizeBase<Dim> &i) const { return data[this->getOffset(i)]; }
+
+  /**
+     Get offset for given index.
+     @param index index for which to compute offset
+     @return offset (in elements) for given index
+  */
+  inline size_t getOffset(const SizeBase<Dim> &index) const
+  {
+    return StaticLayout<Type, S0, S1, S2, S3>::getOffset(index);
+  }
+
+  /**
+     Get buffer pointer.
+     @return buffer pointer (constant)
+  */
+  inline const Type *getBuffer() const { return data; }
+
+  /**
+     Get buffer pointer.
+     @return buffer pointer
+  */
+  inline Type *getBuffer() { return data; }
+
+private:
+  Type data[Static::Count];
+};
+
+namespace Unrolled {
+
+/**
+   Get row, slice and volume strides of a layout.
+   Missing dimensions are set to zero, since they have no effect on the offset.
+*/
+template <class Type, unsigned Dim>
+inline void
+strides(size_t *s, const Layout<Type, Dim> &layout)
+{
+  s[0] = s[1] = s[2] = 0;
+
+  for(unsigned i = Dim - 1; i--;)
+    s[i] = layout.stride[i];
+}
+
+/**
+   Copy (and convert) row of static length.
+   The element-wise loop is only vectorized at higher optimization levels,
+   therefore rows of the same type are copied by memcpy with a constant size,
+   which the compiler expands into a few moves.
+*/
+template <unsigned N, class Type1, class Type2>
+struct Row
+{
+  static inline void copy(Type1 *dst, const Type2 *src)
+  {
+    for(unsigned x = 0; x < N; ++x)
+      dst[x] = src[x];
+  }
+};
+
+template <unsigned N, class Type>
+struct Row<N, Type, Type>
+{
+  static inline void copy(Type *dst, const Type *src) { memcpy(dst, src, N * sizeof(Type)); }
+};
+
+/**
+   Copy packed block of static size from strided data.
+   Rows have a compile-time length of Static::Size0.
+*/
+template <class Static, class Type1, class Type2>
+inline void
+gather(Type1 *dst, const Type2 *src, const size_t *stride)
+{
+  for(unsigned w = 0; w < Static::Size3; ++w)
+    for(unsigned z = 0; z < Static::Size2; ++z)
+      for(unsigned y = 0; y < Static::Size1; ++y)
+	Row<Static::Size0, Type1, Type2>::copy(dst + Static::offset(0, y, z, w),
+					       src + y * stride[0] + z * stride[1] + w * stride[2]);
+}
+
+/**
+   Copy packed block of static size to strided data.
+   Rows have a compile-time length of Static::Size0.
+*/
+template <class Static, class Type1, class Type2>
+inline void
+scatter(Type1 *dst, const size_t *stride, const Type2 *src)
+{
+  for(unsigned w = 0; w < Static::Size3; ++w)
+    for(unsigned z = 0; z < Static::Size2; ++z)
+      for(unsigned y = 0; y < Static::Size1; ++y)
+	Row<Static::Size0, Type1, Type2>::copy(dst + y * stride[0] + z * stride[1] + w * stride[2],
+					       src + Static::offset(0, y, z, w));
+}
+
+/**
+   Check whether the given region covers the entire static block.
+*/
+template <class Static, unsigned Dim>
+inline bool
+covers(const Size<Dim> &ofs, const Size<Dim> &size)
+{
+  return (ofs == Size<Dim>()) && (size == Static::size());
+}
+
+}  // namespace Unrolled
+
+/**
+   Copy (and convert) data between host memory blocks of the same static size.
+   @param dst destination pointer
+   @param src source pointer
+*/
+template<class Type1, class Type2, unsigned S0, unsigned S1, unsigned S2, unsigned S3>
+void
+copy(HostMemoryStatic<Type1, S0, S1, S2, S3> &dst, const HostMemoryStatic<Type2, S0, S1, S2, S3> &src)
+{
+  Unrolled::Row<StaticSize<S0, S1, S2, S3>::Count, Type1, Type2>::copy(dst.getBuffer(), src.getBuffer());
+}
+
+/**
+   Copy (and convert) host memory to host memory of static size.
+   @param dst destination pointer
+   @param src source pointer
+*/
+template<class Type1, class Type2, unsigned S0, unsigned S1, unsigned S2, unsigned S3>
+void
+copy(HostMemoryStatic<Type1, S0, S1, S2, S3> &dst, const HostMemory<Type2, StaticSize<S0, S1, S2, S3>::Dim> &src)
+{
+  CUDA_CHECK_SIZE;
+  size_t stride[3];
+  Unrolled::strides(stride, src);
+  Unrolled::gather<StaticSize<S0, S1, S2, S3> >(dst.getBuffer(), src.getBuffer(), stride);
+}
+
+/**
+   Copy (and convert) host memory of static size to host memory.
+   @param dst destination pointer
+   @param src source pointer
+*/
+template<class Type1, class Type2, unsigned S0, unsigned S1, unsigned S2, unsigned S3>
+void
+copy(HostMemory<Type1, StaticSize<S0, S1, S2, S3>::Dim> &dst, const HostMemoryStatic<Type2, S0, S1, S2, S3> &src)
+{
+  CUDA_CHECK_SIZE;
+  size_t stride[3];
+  Unrolled::strides(stride, dst);
+  Unrolled::scatter<StaticSize<S0, S1, S2, S3> >(dst.getBuffer(), stride, src.getBuffer());
+}
+
+/**
+   Copy (and convert) region of host memory to host memory of static size.
+   If the region covers the entire destination (the typical case of
+   extracting a tile), a loop with compile-time bounds is used.
+   @param dst destination pointer
+   @param src source pointer
+   @param dst_ofs destination offset
+   @param src_ofs source offset
+   @param size size of region to be copied
+*/
+template<class Type1, class Type2, unsigned S0, unsigned S1, unsigned S2, unsigned S3>
+void
+copy(HostMemoryStatic<Type1, S0, S1, S2, S3> &dst, const HostMemory<Type2, StaticSize<S0, S1, S2, S3>::Dim> &src,
+     const Size<StaticSize<S0, S1, S2, S3>::Dim> &dst_ofs, const Size<StaticSize<S0, S1, S2, S3>::Dim> &src_ofs,
+     const Size<StaticSize<S0, S1, S2, S3>::Dim> &size)
+{
+  typedef StaticSize<S0, S1, S2, S3> Static;
+  HostMemory<Type1, Static::Dim> &d = dst;
+
+  if(!Unrolled::covers<Static>(dst_ofs, size)) {
+    copy(d, src, dst_ofs, src_ofs, size);
+    return;
+  }
+
+  check_bounds(dst, src, dst_ofs, src_ofs, size);
+  size_t stride[3];
+  Unrolled::strides(stride, src);
+  Unrolled::gather<Static>(dst.getBuffer(), src.getBuffer() + src.getOffset(src_ofs), stride);
+}
+
+/**
+   Copy (and convert) region of host memory of static size to host memory.
+   If the region covers the entire source (the typical case of writing back a
+   tile), a loop with compile-time bounds is used.
+   @param dst destination pointer
+   @param src source pointer
+   @param dst_ofs destination offset
+   @param src_ofs source offset
+   @param size size of region to be copied
+*/
+template<class Type1, class Type2, unsigned S0, unsigned S1, unsigned S2, unsigned S3>
+void
+copy(HostMemory<Type1, StaticSize<S0, S1, S2, S3>::Dim> &dst, const HostMemoryStatic<Type2, S0, S1, S2, S3> &src,
+     const Size<StaticSize<S0, S1, S2, S3>::Dim> &dst_ofs, const Size<StaticSize<S0, S1, S2, S3>::Dim> &src_ofs,
+     const Size<StaticSize<S0, S1, S2, S3>::Dim> &size)
+{
+  typedef StaticSize<S0, S1, S2, S3> Static;
+  const HostMemory<Type2, Static::Dim> &s = src;
+
+  if(!Unrolled::covers<Static>(src_ofs, size)) {
+    copy(dst, s, dst_ofs, src_ofs, size);
+    return;
+  }
+
+  check_bounds(dst, src, dst_ofs, src_ofs, size);
+  size_t stride[3];
+  Unrolled::strides(stride, dst);
+  Unrolled::scatter<Static>(dst.getBuffer() + dst.getOffset(dst_ofs), stride, src.getBuffer());
+}
+
+}  // namespace Cuda
+
+
+#endif
@@ -21,10 +21,329 @@
 #ifndef CUDA_IMAGE_H
 #define CUDA_IMAGE_H
 
+#include <cmath>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include <cudatemplates/copy.hpp>
 
+/**
+   Number of rows converted by a thread at once when image data is ingested
+   into the host memory of an Image.
+*/
+#ifndef CUDA_INGEST_ROWS
+#define CUDA_INGEST_ROWS 16
+#endif
+
 namespace Cuda {
 
+  /** Modified regions of an image.
+   * The regions are kept as a short list of rectangles. A new rectangle is
+   * merged with an existing one if their bounding box contains no other
+   * pixels (e.g., if one contains the other, or if they are adjacent with a
+   * common edge), so merging never adds unmodified pixels to a transfer.
+   * If the list gets too long or most of the image is modified, the entire
+   * image is marked, since a single transfer is cheaper then.
+   */
+  class DirtyRegions
+  {
+  public:
+    enum {
+      MAX_REGIONS = 32,  /**< Maximum number of rectangles before they are merged into their bounding box.*/
+      FULL_PERCENT = 50  /**< Modified area (in percent) above which the entire image is transferred.*/
+    };
+
+    /** Rectangular region. */
+    struct Region
+    {
+      Cuda::Size<2> ofs;   /**< Offset of region.*/
+      Cuda::Size<2> size;  /**< Size of region.*/
+
+      /** Get number of pixels in region. */
+      inline size_t area() const { return size[0] * size[1]; }
+    };
+
+    /** Constructor.
+     * @param extent size of the image
+     */
+    inline DirtyRegions(const Cuda::Size<2> &extent = Cuda::Size<2>()) :
+      extent_(extent),
+      area_(0)
+      {
+      }
+
+    /** Mark the entire image as modified. */
+    inline void addAll()
+      {
+	regions_.resize(1);
+	regions_[0].ofs = Cuda::Size<2>();
+	regions_[0].size = extent_;
+	area_ = extent_[0] * extent_[1];
+      }
+
+    /** Mark region as modified.
+     * The region is clipped to the image.
+     * @param ofs offset of modified region
+     * @param size size of modified region
+     */
+    inline void add(const Cuda::Size<2> &ofs, const Cuda::Size<2> &size)
+      {
+	Region r;
+
+	for(int i = 2; i--;) {
+	  r.ofs[i] = (ofs[i] < extent_[i]) ? ofs[i] : extent_[i];
+	  r.size[i] = (size[i] < extent_[i] - r.ofs[i]) ? size[i] : extent_[i] - r.ofs[i];
+	}
+
+	if(r.area() == 0 || full())
+	  return;
+
+	// merge with existing regions until the bounding box would cover clean pixels:
+	for(size_t i = 0; i < regions_.size();) {
+	  Region b = bounds(r, regions_[i]);
+
+	  if(b.area() <= r.area() + regions_[i].area() - overlap(r, regions_[i])) {
+	    area_ -= regions_[i].area();
+	    regions_[i] = regions_.back();
+	    regions_.pop_back();
+	    r = b;
+	    i = 0;
+	  }
+	  else
+	    ++i;
+	}
+
+	regions_.push_back(r);
+	area_ += r.area();
+
+	if(regions_.size() > MAX_REGIONS) {
+	  for(size_t i = regions_.size() - 1; i--;)
+	    regions_[0] = bounds(regions_[0], regions_[i + 1]);
+
+	  regions_.resize(1);
+	  area_ = regions_[0].area();
+	}
+
+	if(area_ * 100 > extent_[0] * extent_[1] * FULL_PERCENT)
+	  addAll();
+      }
+
+    /** Mark image as unmodified. */
+    inline void clear()
+      {
+	regions_.clear();
+	area_ = 0;
+      }
+
+    /** Get flag if any region is modified. */
+    inline bool empty() const { return regions_.empty(); }
+
+    /** Get flag if the entire image is modified. */
+    inline bool full() const { return (regions_.size() == 1) && (area_ == extent_[0] * extent_[1]); }
+
+    /** Get number of modified pixels. */
+    inline size_t area() const { return area_; }
+
+    /** Get list of modified regions. */
+    inline const std::vector<Region> &regions() const { return regions_; }
+
+  private:
+    /** Get bounding box of two regions. */
+    static inline Region bounds(const Region &a, const Region &b)
+      {
+	Region r;
+
+	for(int i = 2; i--;) {
+	  size_t e0 = a.ofs[i] + a.size[i], e1 = b.ofs[i] + b.size[i];
+	  r.ofs[i] = (a.ofs[i] < b.ofs[i]) ? a.ofs[i] : b.ofs[i];
+	  r.size[i] = ((e0 > e1) ? e0 : e1) - r.ofs[i];
+	}
+
+	return r;
+      }
+
+    /** Get number of pixels common to two regions. */
+    static inline size_t overlap(const Region &a, const Region &b)
+      {
+	size_t n = 1;
+
+	for(int i = 2; i--;) {
+	  size_t e0 = a.ofs[i] + a.size[i], e1 = b.ofs[i] + b.size[i];
+	  size_t o = (a.ofs[i] > b.ofs[i]) ? a.ofs[i] : b.ofs[i];
+	  size_t e = (e0 < e1) ? e0 : e1;
+	  n *= (e > o) ? e - o : 0;
+	}
+
+	return n;
+      }
+
+    Cuda::Size<2> extent_;         /**< Size of the image.*/
+    size_t area_;                  /**< Sum of the areas of all regions.*/
+    std::vector<Region> regions_;  /**< Modified regions.*/
+  };
+
+  /** Conversion of raw image data into the pixel type of an Image.
+   * Integer samples of up to 32 bits, typically 8 to 16 bits (mono or packed
+   * color with three or four channels), are normalized to the range [0, 1].
+   */
+  namespace Ingestion {
+
+    /** Output pixel traits.
+     * Scalar pixel types take the first channel, vector types take as many
+     * channels as they have (mono input is replicated, a missing alpha
+     * channel is set to one).
+     */
+    template <class Type>
+    struct Output
+    {
+      enum { channels = 1 };
+      static inline void store(Type &p, const float *c) { p = static_cast<Type>(c[0]); }
+    };
+
+    template <>
+    struct Output<float3>
+    {
+      enum { channels = 3 };
+      static inline void store(float3 &p, const float *c) { p.x = c[0]; p.y = c[1]; p.z = c[2]; }
+    };
+
+    template <>
+    struct Output<float4>
+    {
+      enum { channels = 4 };
+      static inline void store(float4 &p, const float *c) { p.x = c[0]; p.y = c[1]; p.z = c[2]; p.w = c[3]; }
+    };
+
+    /** Convert a single row.
+     * The number of input channels is a template parameter, so the channel
+     * loop is unrolled and the row loop can be vectorized.
+     * @return number of pixels converted
+     */
+    template <unsigned Channels, class Type, class SrcType>
+    inline unsigned row(Type *dst, const SrcType *src, unsigned width, float scale)
+      {
+	for(unsigned x = 0; x < width; ++x) {
+	  float c[4];
+
+	  for(unsigned k = 0; k < 4; ++k)
+	    c[k] = (k < Channels) ? src[x * Channels + k] * scale : (k == 3) ? 1.0f : c[Channels - 1];
+
+	  Output<Type>::store(dst[x], c);
+	}
+
+	return width;
+      }
+
+#ifdef __SSE2__
+    /** Convert a row of 8-bit mono data to float with SSE2. */
+    template <>
+    inline unsigned row<1>(float *dst, const unsigned char *src, unsigned width, float scale)
+      {
+	const __m128 k = _mm_set1_ps(scale);
+	const __m128i z = _mm_setzero_si128();
+	unsigned x = 0;
+
+	for(; x + 16 <= width; x += 16) {
+	  __m128i v = _mm_loadu_si128((const __m128i *)(src + x));
+	  __m128i lo = _mm_unpacklo_epi8(v, z), hi = _mm_unpackhi_epi8(v, z);
+	  _mm_storeu_ps(dst + x     , _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, z)), k));
+	  _mm_storeu_ps(dst + x +  4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, z)), k));
+	  _mm_storeu_ps(dst + x +  8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, z)), k));
+	  _mm_storeu_ps(dst + x + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, z)), k));
+	}
+
+	for(; x < width; ++x)
+	  dst[x] = src[x] * scale;
+
+	return width;
+      }
+
+    /** Convert a row of 10 to 16-bit mono data to float with SSE2. */
+    template <>
+    inline unsigned row<1>(float *dst, const unsigned short *src, unsigned width, float scale)
+      {
+	const __m128 k = _mm_set1_ps(scale);
+	const __m128i z = _mm_setzero_si128();
+	unsigned x = 0;
+
+	for(; x + 8 <= width; x += 8) {
+	  __m128i v = _mm_loadu_si128((const __m128i *)(src + x));
+	  _mm_storeu_ps(dst + x    , _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(v, z)), k));
+	  _mm_storeu_ps(dst + x + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(v, z)), k));
+	}
+
+	for(; x < width; ++x)
+	  dst[x] = src[x] * scale;
+
+	return width;
+      }
+#endif
+
+    /** Convert rows [y0, y1) of raw image data.
+     * The rows are split into bands of CUDA_INGEST_ROWS rows which are
+     * processed in parallel if OpenMP is enabled.
+     * @param dst destination buffer
+     * @param dstride destination row stride (in elements)
+     * @param src source data
+     * @param step source row size (in bytes)
+     * @param width number of pixels per row
+     * @param y0 first row
+     * @param y1 end of rows
+     * @param channels number of source channels (1, 3 or 4)
+     * @param bits number of significant bits per source sample
+     */
+    template <class Type, class SrcType>
+    void convert(Type *dst, size_t dstride, const SrcType *src, size_t step,
+		 unsigned width, unsigned y0, unsigned y1, unsigned channels, unsigned bits)
+      {
+	if((channels != 1) && (channels != 3) && (channels != 4))
+	  CUDA_ERROR("unsupported number of channels");
+
+	if((bits == 0) || (bits > 8 * sizeof(SrcType)))
+	  CUDA_ERROR("unsupported number of bits");
+
+	// 2^bits - 1 without overflow for 32 bit samples:
+	const float scale = 1.0f / (std::ldexp(1.0f, (int)bits) - 1);
+	const int bands = (y1 - y0 + CUDA_INGEST_ROWS - 1) / CUDA_INGEST_ROWS;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if(bands > 1)
+#endif
+	for(int b = 0; b < bands; ++b) {
+	  unsigned yb = y0 + b * CUDA_INGEST_ROWS;
+	  unsigned ye = (yb + CUDA_INGEST_ROWS < y1) ? yb + CUDA_INGEST_ROWS : y1;
+
+	  for(unsigned y = yb; y < ye; ++y) {
+	    Type *d = dst + y * dstride;
+	    const SrcType *s = (const SrcType *)((const char *)src + y * step);
+
+	    switch(channels) {
+	    case 1: row<1>(d, s, width, scale); break;
+	    case 3: row<3>(d, s, width, scale); break;
+	    case 4: row<4>(d, s, width, scale); break;
+	    }
+	  }
+	}
+      }
+
+    /** Get number of rows converted before an asynchronous upload is started. */
+    inline unsigned chunk()
+      {
+#ifdef _OPENMP
+	return CUDA_INGEST_ROWS * omp_get_max_threads();
+#else
+	return CUDA_INGEST_ROWS;
+#endif
+      }
+  }
+
   /** Image. 
    * Image representation or similar data structures on device and host memory.
    *
@@ -58,9 +377,7 @@ namespace Cuda {
       interleaved_(false),
       hostEntity_(NULL),
       deviceEntity_(NULL),
-      imageAvailable_(false), 
-      hostModified_(false),
-      deviceModified_(false)
+      imageAvailable_(false)
       {
       }
 #endif
@@ -72,9 +389,7 @@ namespace Cuda {
      */
     inline Image(HostType* inputHost) :
       nChannels_(0),
-      interleaved_(false),
-      hostModified_(true),
-      deviceModified_(false)
+      interleaved_(false)
       {
 	assert(inputHost != NULL);
 	hostEntity_ = inputHost;
@@ -83,6 +398,8 @@ namespace Cuda {
 	Cuda::copy(*deviceEntity_, *hostEntity_);
 	
 	imageAvailable_ = true;
+	hostModified_ = DirtyRegions(hostEntity_->size);
+	deviceModified_ = DirtyRegions(hostEntity_->size);
       }
 
     /** Constructor.
@@ -92,9 +409,7 @@ namespace Cuda {
      */
     inline Image(DeviceType* inputDevice) :
       nChannels_(0),
-      interleaved_(false),
-      hostModified_(false),
-      deviceModified_(true)
+      interleaved_(false)
       {
 	assert(inputDevice != NULL);
 	deviceEntity_ = inputDevice;
@@ -103,6 +418,8 @@ namespace Cuda {
 	Cuda::copy(*hostEntity_, *deviceEntity_);
 
 	imageAvailable_ = true;
+	hostModified_ = DirtyRegions(deviceEntity_->size);
+	deviceModified_ = DirtyRegions(deviceEntity_->size);
       }
 
 
@@ -113,9 +430,7 @@ namespace Cuda {
      */
     inline Image(HostType* inputHost, DeviceType* inputDevice) :
       nChannels_(0),
-      interleaved_(false),
-      hostModified_(false),
-      deviceModified_(false)
+      interleaved_(false)
       {
 	// Check if sizes are equal. No guarantee that data is equal
 	// but at least better than nothing...
@@ -124,6 +439,8 @@ namespace Cuda {
 	deviceEntity_ = inputDevice;
 	imageAvailable_ = true;
 	assert(hostEntity_ != NULL && deviceEntity_ != NULL);
+	hostModified_ = DirtyRegions(hostEntity_->size);
+	deviceModified_ = DirtyRegions(hostEntity_->size);
       }
 
     virtual ~Image()
@@ -142,29 +459,98 @@ namespace Cuda {
      * @param[in] widthStep row size (default = width). (e.g. IplImage::widthStep if used as OpenCV connector)
      */
     inline void updateHostBuffer(unsigned char* data, int width, int height, uint widthStep = 0)
+      {
+	updateHostBuffer((const unsigned char *)data, width, height, 1, 8, widthStep);
+      }
+
+    /** Updates the data on the host side from raw integer samples.
+     * The samples are normalized to [0, 1] according to the number of
+     * significant bits (e.g., 10 or 12 bits stored in unsigned short),
+     * the pitch of the host memory is respected.
+     * @param[in] data pixel data (unsigned char or unsigned short samples).
+     * @param[in] width image width.
+     * @param[in] height image height.
+     * @param[in] channels number of interleaved channels (1, 3 or 4).
+     * @param[in] bits number of significant bits per sample.
+     * @param[in] widthStep row size in bytes (default = width * channels * sizeof(SrcType)).
+     */
+    template <class SrcType>
+    inline void updateHostBuffer(const SrcType* data, int width, int height, unsigned channels, unsigned bits,
+				 size_t widthStep = 0)
       {
 	if(data == NULL)
 	  return;
-	if(widthStep == 0)
-	  widthStep = width;
 
 	assert(hostEntity_ != NULL && deviceEntity_ != NULL);
-	Cuda::Size<2> size = hostEntity_->size;
-	// copy and norm single pixel values
-	PixelType* buffer = hostEntity_->getBuffer();
-
-	for(unsigned y = 0; y < size[1]; ++y)
-	{
-	  for(unsigned x = 0; x < size[0]; ++x)
-	  {
-	    buffer[(size[0] * y)+x] = 
-	      static_cast<PixelType>(data[(widthStep * y)+x])/255.0f;
-	  }
-	}
-	hostModified_ = true;
+	Cuda::Size<2> size = checkInput(width, height, channels, widthStep, sizeof(SrcType));
+	Ingestion::convert(hostEntity_->getBuffer(), hostEntity_->stride[0], data, widthStep,
+			   size[0], 0, size[1], channels, bits);
+	hostModified_.addAll();
 	this->updateDeviceEntity();
       }
 
+    /** Updates the data on the host side from raw integer samples and uploads it asynchronously.
+     * The rows are uploaded in chunks as soon as they are converted, so
+     * if the host memory is page-locked (e.g., HostMemoryLocked), the
+     * upload of each chunk overlaps with the conversion of the next one.
+     * The host memory must not be modified before the stream has been
+     * synchronized.
+     * @param[in] data pixel data (unsigned char or unsigned short samples).
+     * @param[in] width image width.
+     * @param[in] height image height.
+     * @param[in] channels number of interleaved channels (1, 3 or 4).
+     * @param[in] bits number of significant bits per sample.
+     * @param[in] widthStep row size in bytes (0 = width * channels * sizeof(SrcType)).
+     * @param[in] stream CUDA stream
+     */
+    template <class SrcType>
+    inline void updateHostBuffer(const SrcType* data, int width, int height, unsigned channels, unsigned bits,
+				 size_t widthStep, cudaStream_t stream)
+      {
+	if(data == NULL)
+	  return;
+
+	assert(hostEntity_ != NULL && deviceEntity_ != NULL);
+	Cuda::Size<2> size = checkInput(width, height, channels, widthStep, sizeof(SrcType));
+	const unsigned chunk = Ingestion::chunk();
+
+	for(unsigned y = 0; y < size[1]; y += chunk) {
+	  unsigned n = (y + chunk < size[1]) ? chunk : size[1] - y;
+	  Ingestion::convert(hostEntity_->getBuffer(), hostEntity_->stride[0], data, widthStep,
+			     size[0], y, y + n, channels, bits);
+	  Cuda::copy(*deviceEntity_, *hostEntity_, Cuda::Size<2>(0, y), Cuda::Size<2>(0, y),
+		     Cuda::Size<2>(size[0], n), stream);
+	}
+
+	hostModified_.clear();
+      }
+
+    /** Mark the entire host memory as modified.
+     * The next request for the device memory copies the entire image.
+     */
+    inline void setHostModified() { hostModified_.addAll(); }
+
+    /** Mark a region of the host memory as modified.
+     * Only the modified regions are copied on the next request for the
+     * device memory.
+     * @param ofs offset of modified region
+     * @param size size of modified region
+     */
+    inline void setHostModified(const Cuda::Size<2> &ofs, const Cuda::Size<2> &size) { hostModified_.add(ofs, size); }
+
+    /** Mark the entire device memory as modified.
+     * The next request for the host memory copies the entire image.
+     */
+    inline void setDeviceModified() { deviceModified_.addAll(); }
+
+    /** Mark a region of the device memory as modified.
+     * Only the modified regions are copied on the next request for the
+     * host memory.
+     * @param ofs offset of modified region
+     * @param size size of modified region
+     */
+    inline void setDeviceModified(const Cuda::Size<2> &ofs, const Cuda::Size<2> &size) { deviceModified_.add(ofs, size); }
+
     // getters --------------------------------------------------------------------
 
     /** Get the CudaTemplates reprensetation of the host memory.
@@ -175,7 +561,21 @@ namespace Cuda {
     inline HostType* getHostEntity()
       { 
 	assert(hostEntity_ != NULL && deviceEntity_ != NULL);
-	if(deviceModified_) updateHostEntity();
+	if(!deviceModified_.empty()) updateHostEntity();
+	return hostEntity_;
+      }
+
+    /** Get the CudaTemplates reprensetation of the host memory.
+     * The modified regions of the device memory are copied
+     * asynchronously in the given stream, the host memory must not be
+     * accessed before the stream has been synchronized.
+     * @param stream CUDA stream
+     * @return templated host memory
+    */
+    inline HostType* getHostEntity(cudaStream_t stream)
+      { 
+	assert(hostEntity_ != NULL && deviceEntity_ != NULL);
+	if(!deviceModified_.empty()) updateHostEntity(stream);
 	return hostEntity_;
       }
 
@@ -187,7 +587,22 @@ namespace Cuda {
     inline DeviceType* getDeviceEntity() 
       { 
 	assert(hostEntity_ != NULL && deviceEntity_ != NULL);
-	if(hostModified_) this->updateDeviceEntity();
+	if(!hostModified_.empty()) this->updateDeviceEntity();
+	return deviceEntity_;
+      }
+
+    /** Get the CudaTemplates reprensetation of the device memory.
+     * The modified regions of the host memory are copied
+     * asynchronously in the given stream, so kernels launched in the
+     * same stream see the updated data. The host memory must not be
+     * modified before the stream has been synchronized.
+     * @param stream CUDA stream
+     * @return templated device memory
+    */
+    inline DeviceType* getDeviceEntity(cudaStream_t stream)
+      { 
+	assert(hostEntity_ != NULL && deviceEntity_ != NULL);
+	if(!hostModified_.empty()) this->updateDeviceEntity(stream);
 	return deviceEntity_;
       }
 
@@ -199,7 +614,7 @@ namespace Cuda {
     inline PixelType*  getHostBuffer()
       { 
 	assert(hostEntity_ != NULL && deviceEntity_ != NULL);
-	if(deviceModified_) this->updateHostEntity();
+	if(!deviceModified_.empty()) this->updateHostEntity();
 	return hostEntity_->getBuffer();
       }
     /** Get the templated pixel reprensetation of the device memory.
@@ -210,7 +625,7 @@ namespace Cuda {
     inline PixelType* getDeviceBuffer()
       {
 	assert(hostEntity_ != NULL && deviceEntity_ != NULL);
-	if(hostModified_) this->updateDeviceEntity();
+	if(!hostModified_.empty()) this->updateDeviceEntity();
 	return deviceEntity_->getBuffer(); 
       }
 
@@ -244,11 +659,20 @@ namespace Cuda {
     /** Get flag if host instance was modified.
      * @return true if the host memory was modified and not synchronized with the device memory.
      */
-    inline bool hostModified() const { return hostModified_; }
+    inline bool hostModified() const { return !hostModified_.empty(); }
     /** Get flag if device instance was modified.
      * @return true if the device memory was modified and not synchronized with the host memory.
     */
-    inline bool deviceModified() const { return deviceModified_; }
+    inline bool deviceModified() const { return !deviceModified_.empty(); }
+
+    /** Get modified regions of host instance.
+     * @return regions of the host memory not synchronized with the device memory.
+     */
+    inline const DirtyRegions &hostModifiedRegions() const { return hostModified_; }
+    /** Get modified regions of device instance.
+     * @return regions of the device memory not synchronized with the host memory.
+     */
+    inline const DirtyRegions &deviceModifiedRegions() const { return deviceModified_; }
 
 
     /** Get Number of channels.
@@ -268,26 +692,83 @@ namespace Cuda {
 
   protected:
     
-    /** Updates the host memory with the device memory */
+    /** Checks the size of raw input data.
+     * @param width image width.
+     * @param height image height.
+     * @param channels number of interleaved channels.
+     * @param widthStep row size in bytes (set to the default if zero).
+     * @param bytes size of a sample in bytes.
+     * @return size of the image.
+     */
+    inline Cuda::Size<2> checkInput(int width, int height, unsigned channels, size_t &widthStep, size_t bytes) const
+      {
+	Cuda::Size<2> size = hostEntity_->size;
+
+	if(((size_t)width != size[0]) || ((size_t)height != size[1]))
+	  CUDA_ERROR("size mismatch");
+
+	if(widthStep == 0)
+	  widthStep = width * channels * bytes;
+
+	return size;
+      }
+
+    /** Updates the modified regions of the host memory with the device memory */
     inline void updateHostEntity()
       {
-	Cuda::copy(*hostEntity_, *deviceEntity_);
-	deviceModified_ = false;
+	if(deviceModified_.full())
+	  Cuda::copy(*hostEntity_, *deviceEntity_);
+	else
+	  for(size_t i = 0; i < deviceModified_.regions().size(); ++i) {
+	    const DirtyRegions::Region &r = deviceModified_.regions()[i];
+	    Cuda::copy(*hostEntity_, *deviceEntity_, r.ofs, r.ofs, r.size);
+	  }
+
+	deviceModified_.clear();
+      }
+
+    /** Updates the modified regions of the host memory with the device memory asynchronously */
+    inline void updateHostEntity(cudaStream_t stream)
+      {
+	for(size_t i = 0; i < deviceModified_.regions().size(); ++i) {
+	  const DirtyRegions::Region &r = deviceModified_.regions()[i];
+	  Cuda::copy(*hostEntity_, *deviceEntity_, r.ofs, r.ofs, r.size, stream);
+	}
+
+	deviceModified_.clear();
       }
 
-    /** Updates the device memory with the host memory */
+    /** Updates the modified regions of the device memory with the host memory */
     inline void updateDeviceEntity()
       {
-	Cuda::copy(*deviceEntity_, *hostEntity_);
-	hostModified_ = false;
+	if(hostModified_.full())
+	  Cuda::copy(*deviceEntity_, *hostEntity_);
+	else
+	  for(size_t i = 0; i < hostModified_.regions().size(); ++i) {
+	    const DirtyRegions::Region &r = hostModified_.regions()[i];
+	    Cuda::copy(*deviceEntity_, *hostEntity_, r.ofs, r.ofs, r.size);
+	  }
+
+	hostModified_.clear();
+      }
+
+    /** Updates the modified regions of the device memory with the host memory asynchronously */
+    inline void updateDeviceEntity(cudaStream_t stream)
+      {
+	for(size_t i = 0; i < hostModified_.regions().size(); ++i) {
+	  const DirtyRegions::Region &r = hostModified_.regions()[i];
+	  Cuda::copy(*deviceEntity_, *hostEntity_, r.ofs, r.ofs, r.size, stream);
+	}
+
+	hostModified_.clear();
       }
 
     HostType* hostEntity_;     /**< CudaTemplate representation of host memory.*/
     DeviceType* deviceEntity_; /**< CudaTemplate representation of device memory.*/
     
     bool imageAvailable_; /**< Flag if host and device representations are available.*/
-    bool hostModified_;   /**< Flag if host representation was modified.*/
-    bool deviceModified_; /**< Flag if device representation was modified.*/
+    DirtyRegions hostModified_;   /**< Regions of host representation which were modified.*/
+    DirtyRegions deviceModified_; /**< Regions of device representation which were modified.*/
 
   private:
 
@@ -0,0 +1,696 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_IMAGEIO_H
+#define CUDA_IMAGEIO_H
+
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#ifdef CUDA_IMAGEIO_USE_PNG
+#include <png.h>
+#endif
+
+#include <cudatemplates/error.hpp>
+#include <cudatemplates/hostmemory.hpp>
+
+
+namespace Cuda {
+
+/**
+   Reading and writing of images.
+   Images are decoded directly into the rows of caller-provided host memory
+   (which may be padded), the pixel type of the memory determines the
+   expected number of channels and the bit depth:
+   - unsigned char, uchar3, uchar4: 8 bit gray, RGB, RGBA
+   - unsigned short, ushort3, ushort4: 16 bit gray, RGB, RGBA
+   - float, float3, float4: floating point gray, RGB, RGBA
+   RGB data can be read into four-channel memory, the alpha channel is set
+   to the maximum value then.
+
+   Supported formats are binary PGM/PPM (8 and 16 bit), PFM (floating point)
+   and, if CUDA_IMAGEIO_USE_PNG is defined (requires libpng), PNG.
+   The format is determined from the file content when reading and from the
+   file name extension when writing.
+*/
+namespace ImageIO {
+
+/**
+   Image file format.
+*/
+typedef enum {
+  FORMAT_UNKNOWN,
+  FORMAT_PNM,  /**< binary PGM (P5) or PPM (P6) */
+  FORMAT_PFM,  /**< gray (Pf) or color (PF) portable float map */
+  FORMAT_PNG   /**< portable network graphics */
+} format_t;
+
+/**
+   Pixel type traits.
+*/
+template <class Type>
+struct Pixel;
+
+#define CUDA_IMAGEIO_PIXEL(Type, C, n, maxval)	\
+template <>					\
+struct Pixel<Type>				\
+{						\
+  typedef C Component;				\
+  enum { channels = n };			\
+  static inline C max() { return maxval; }	\
+};
+
+CUDA_IMAGEIO_PIXEL(unsigned char, unsigned char, 1, 255)
+CUDA_IMAGEIO_PIXEL(uchar1, unsigned char, 1, 255)
+CUDA_IMAGEIO_PIXEL(uchar3, unsigned char, 3, 255)
+CUDA_IMAGEIO_PIXEL(uchar4, unsigned char, 4, 255)
+CUDA_IMAGEIO_PIXEL(unsigned short, unsigned short, 1, 65535)
+CUDA_IMAGEIO_PIXEL(ushort1, unsigned short, 1, 65535)
+CUDA_IMAGEIO_PIXEL(ushort3, unsigned short, 3, 65535)
+CUDA_IMAGEIO_PIXEL(ushort4, unsigned short, 4, 65535)
+CUDA_IMAGEIO_PIXEL(float, float, 1, 1.0f)
+CUDA_IMAGEIO_PIXEL(float1, float, 1, 1.0f)
+CUDA_IMAGEIO_PIXEL(float3, float, 3, 1.0f)
+CUDA_IMAGEIO_PIXEL(float4, float, 4, 1.0f)
+
+#undef CUDA_IMAGEIO_PIXEL
+
+/**
+   Properties of an image file.
+*/
+struct Info
+{
+  format_t format;
+  Size<2> size;
+
+  /** number of channels (1 or 3 for PNM/PFM, 1 to 4 for PNG) */
+  unsigned channels;
+
+  /** bits per channel (8 or 16 for integer data, 32 for floating point data) */
+  unsigned bits;
+
+  /** byte order of 16 bit or floating point data */
+  bool little_endian;
+
+  Info(): format(FORMAT_UNKNOWN), channels(0), bits(0), little_endian(false) {}
+};
+
+/**
+   Check byte order of host.
+*/
+inline bool
+hostLittleEndian()
+{
+  const uint16_t x = 1;
+  return *(const unsigned char *)&x == 1;
+}
+
+/**
+   Reverse byte order of elements.
+*/
+inline void
+swap(void *data, size_t count, size_t bytes)
+{
+  unsigned char *p = (unsigned char *)data;
+
+  for(size_t i = 0; i < count; ++i, p += bytes)
+    for(size_t j = 0; j < bytes / 2; ++j) {
+      unsigned char t = p[j];
+      p[j] = p[bytes - 1 - j];
+      p[bytes - 1 - j] = t;
+    }
+}
+
+/**
+   Closes file when leaving scope.
+*/
+class File
+{
+public:
+  File(const char *filename, const char *mode): fp(fopen(filename, mode))
+  {
+    if(fp == 0)
+      CUDA_ERROR("can't open file");
+  }
+
+  ~File() { fclose(fp); }
+
+  inline operator FILE *() const { return fp; }
+
+private:
+  FILE *fp;
+
+  File(const File &);
+  File &operator=(const File &);
+};
+
+/**
+   Read number from PNM/PFM header, skipping whitespace and comments.
+*/
+inline std::string
+token(FILE *fp)
+{
+  std::string s;
+  int c;
+
+  for(;;) {
+    c = getc(fp);
+
+    if(c == '#')
+      while((c != EOF) && (c != '\n'))
+	c = getc(fp);
+    else if((c == EOF) || !isspace(c))
+      break;
+  }
+
+  // the whitespace character after the token is consumed, which is the
+  // single separator between the header and the pixel data:
+  while((c != EOF) && !isspace(c)) {
+    s += (char)c;
+    c = getc(fp);
+  }
+
+  if(s.empty())
+    CUDA_ERROR("invalid image header");
+
+  return s;
+}
+
+/**
+   Read header of PNM/PFM file.
+   The file position is set to the beginning of the pixel data.
+*/
+inline Info
+readHeader(FILE *fp)
+{
+  Info info;
+  int c0 = getc(fp), c1 = getc(fp);
+
+  if(c0 == 'P') {
+    switch(c1) {
+    case '5': info.format = FORMAT_PNM; info.channels = 1; break;
+    case '6': info.format = FORMAT_PNM; info.channels = 3; break;
+    case 'f': info.format = FORMAT_PFM; info.channels = 1; break;
+    case 'F': info.format = FORMAT_PFM; info.channels = 3; break;
+    }
+  }
+
+  if(info.format == FORMAT_UNKNOWN)
+    return info;
+
+  int w = atoi(token(fp).c_str()), h = atoi(token(fp).c_str());
+
+  if((w <= 0) || (h <= 0))
+    CUDA_ERROR("invalid image size");
+
+  info.size = Size<2>(w, h);
+
+  if(info.format == FORMAT_PNM) {
+    int maxval = atoi(token(fp).c_str());
+
+    if((maxval <= 0) || (maxval > 65535))
+      CUDA_ERROR("invalid maximum value");
+
+    info.bits = (maxval < 256) ? 8 : 16;
+    info.little_endian = false;
+  }
+  else {
+    // the sign of the scale factor gives the byte order:
+    info.bits = 32;
+    info.little_endian = atof(token(fp).c_str()) < 0;
+  }
+
+  return info;
+}
+
+#ifdef CUDA_IMAGEIO_USE_PNG
+
+/**
+   Destroys libpng read structures when leaving scope.
+*/
+struct PngReader
+{
+  png_structp png;
+  png_infop info;
+
+  PngReader(FILE *fp): png(png_create_read_struct(PNG_LIBPNG_VER_STRING, 0, 0, 0)), info(0)
+  {
+    if(png == 0)
+      CUDA_ERROR("can't create PNG reader");
+
+    info = png_create_info_struct(png);
+
+    if(info == 0) {
+      png_destroy_read_struct(&png, 0, 0);
+      CUDA_ERROR("can't create PNG reader");
+    }
+
+    png_init_io(png, fp);
+  }
+
+  ~PngReader() { png_destroy_read_struct(&png, &info, 0); }
+};
+
+#endif
+
+/**
+   Get properties of image file.
+   @param filename name of file
+*/
+inline Info
+info(const char *filename)
+{
+  File fp(filename, "rb");
+  Info i = readHeader(fp);
+
+#ifdef CUDA_IMAGEIO_USE_PNG
+  if(i.format == FORMAT_UNKNOWN) {
+    rewind(fp);
+    unsigned char sig[8];
+
+    if((fread(sig, 1, 8, fp) == 8) && (png_sig_cmp(sig, 0, 8) == 0)) {
+      PngReader r(fp);
+      png_set_sig_bytes(r.png, 8);
+
+      if(setjmp(png_jmpbuf(r.png)))
+	CUDA_ERROR("can't read PNG file");
+
+      png_read_info(r.png, r.info);
+      i.format = FORMAT_PNG;
+      i.size = Size<2>(png_get_image_width(r.png, r.info), png_get_image_height(r.png, r.info));
+      i.channels = png_get_channels(r.png, r.info);
+      i.bits = (png_get_bit_depth(r.png, r.info) == 16) ? 16 : 8;
+      i.little_endian = false;
+
+      if(png_get_color_type(r.png, r.info) == PNG_COLOR_TYPE_PALETTE)
+	i.channels = 3;
+    }
+  }
+#endif
+
+  if(i.format == FORMAT_UNKNOWN)
+    CUDA_ERROR("unknown image format");
+
+  return i;
+}
+
+/**
+   Get size of image file.
+   This can be used to allocate memory before reading the image.
+   @param filename name of file
+*/
+inline Size<2>
+size(const char *filename)
+{
+  return info(filename).size;
+}
+
+/**
+   Get format from file name extension.
+*/
+inline format_t
+format(const char *filename)
+{
+  const char *ext = strrchr(filename, '.');
+  std::string s;
+
+  if(ext != 0)
+    for(++ext; *ext; ++ext)
+      s += (char)tolower(*ext);
+
+  if((s == "pgm") || (s == "ppm") || (s == "pnm"))
+    return FORMAT_PNM;
+
+  if(s == "pfm")
+    return FORMAT_PFM;
+
+  if(s == "png")
+    return FORMAT_PNG;
+
+  return FORMAT_UNKNOWN;
+}
+
+/**
+   Check if file data matches pixel type.
+*/
+template <class Type>
+void
+check(const Info &info, const HostMemory<Type, 2> &dst)
+{
+  typedef typename Pixel<Type>::Component Component;
+
+  if(dst.size != info.size)
+    CUDA_ERROR("image size mismatch");
+
+  if((info.channels != (unsigned)Pixel<Type>::channels) && !((info.channels == 3) && (Pixel<Type>::channels == 4)))
+    CUDA_ERROR("number of channels mismatch");
+
+  if(((info.bits == 32) != (Component(0.5) != 0)) || ((info.bits != 32) && (info.bits != 8 * sizeof(Component))))
+    CUDA_ERROR("pixel type mismatch");
+}
+
+/**
+   Expand RGB to RGBA in place.
+   @param row row of image, containing width RGB pixels at the beginning
+   @param width number of pixels
+   @param alpha value of alpha channel
+*/
+template <class Component>
+void
+expand(Component *row, size_t width, Component alpha)
+{
+  for(size_t x = width; x--;) {
+    Component r = row[3 * x], g = row[3 * x + 1], b = row[3 * x + 2];
+    row[4 * x] = r;
+    row[4 * x + 1] = g;
+    row[4 * x + 2] = b;
+    row[4 * x + 3] = alpha;
+  }
+}
+
+/**
+   Read PNM/PFM pixel data into rows of host memory.
+*/
+template <class Type>
+void
+readPixels(FILE *fp, const Info &info, HostMemory<Type, 2> &dst)
+{
+  typedef typename Pixel<Type>::Component Component;
+  const size_t width = info.size[0], count = width * info.channels;
+  const bool swapped = (sizeof(Component) > 1) && (info.little_endian != hostLittleEndian());
+
+  for(size_t y = 0; y < info.size[1]; ++y) {
+    // PFM rows are stored bottom to top:
+    size_t row = (info.format == FORMAT_PFM) ? info.size[1] - 1 - y : y;
+    Component *p = (Component *)(dst.getBuffer() + row * dst.stride[0]);
+
+    if(fread(p, sizeof(Component), count, fp) != count)
+      CUDA_ERROR("unexpected end of file");
+
+    if(swapped)
+      swap(p, count, sizeof(Component));
+
+    if(info.channels < (unsigned)Pixel<Type>::channels)
+      expand(p, width, Pixel<Type>::max());
+  }
+}
+
+#ifdef CUDA_IMAGEIO_USE_PNG
+
+/**
+   Read PNG pixel data into rows of host memory.
+*/
+template <class Type>
+void
+readPng(FILE *fp, HostMemory<Type, 2> &dst)
+{
+  typedef typename Pixel<Type>::Component Component;
+  std::vector<png_bytep> rows(dst.size[1]);
+
+  for(size_t y = rows.size(); y--;)
+    rows[y] = (png_bytep)(dst.getBuffer() + y * dst.stride[0]);
+
+  PngReader r(fp);
+
+  if(setjmp(png_jmpbuf(r.png)))
+    CUDA_ERROR("can't read PNG file");
+
+  png_read_info(r.png, r.info);
+  int color = png_get_color_type(r.png, r.info);
+  int bits = png_get_bit_depth(r.png, r.info);
+
+  // convert to the requested pixel type:
+  if(color == PNG_COLOR_TYPE_PALETTE)
+    png_set_palette_to_rgb(r.png);
+
+  if((color == PNG_COLOR_TYPE_GRAY) && (bits < 8))
+    png_set_expand_gray_1_2_4_to_8(r.png);
+
+  if(color & PNG_COLOR_MASK_ALPHA) {
+    if((Pixel<Type>::channels & 1) == 1)
+      png_set_strip_alpha(r.png);
+  }
+  else if(Pixel<Type>::channels == 4)
+    png_set_filler(r.png, 0xffff, PNG_FILLER_AFTER);
+
+  if((bits == 16) && hostLittleEndian())
+    png_set_swap(r.png);
+
+  // let png_read_image() combine the passes of interlaced images:
+  png_set_interlace_handling(r.png);
+  png_read_update_info(r.png, r.info);
+
+  if((png_get_image_width(r.png, r.info) != dst.size[0]) || (png_get_image_height(r.png, r.info) != dst.size[1]))
+    CUDA_ERROR("image size mismatch");
+
+  if((Component(0.5) != 0) || (png_get_rowbytes(r.png, r.info) != dst.size[0] * sizeof(Type)))
+    CUDA_ERROR("pixel type mismatch");
+
+  png_read_image(r.png, &rows[0]);
+  png_read_end(r.png, 0);
+}
+
+/**
+   Write PNG file from rows of host memory.
+*/
+template <class Type>
+void
+writePng(FILE *fp, const HostMemory<Type, 2> &src)
+{
+  typedef typename Pixel<Type>::Component Component;
+  static const int types[] = { 0, PNG_COLOR_TYPE_GRAY, PNG_COLOR_TYPE_GRAY_ALPHA, PNG_COLOR_TYPE_RGB, PNG_COLOR_TYPE_RGB_ALPHA };
+
+  if(Component(0.5) != 0)
+    CUDA_ERROR("PNG doesn't support floating point data");
+
+  std::vector<png_bytep> rows(src.size[1]);
+
+  for(size_t y = rows.size(); y--;)
+    rows[y] = (png_bytep)(src.getBuffer() + y * src.stride[0]);
+
+  png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, 0, 0, 0);
+  png_infop info = png ? png_create_info_struct(png) : 0;
+
+  if(info == 0) {
+    png_destroy_write_struct(&png, 0);
+    CUDA_ERROR("can't create PNG writer");
+  }
+
+  if(setjmp(png_jmpbuf(png))) {
+    png_destroy_write_struct(&png, &info);
+    CUDA_ERROR("can't write PNG file");
+  }
+
+  png_init_io(png, fp);
+  png_set_IHDR(png, info, src.size[0], src.size[1], 8 * sizeof(Component), types[Pixel<Type>::channels],
+	       PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(png, info);
+
+  if((sizeof(Component) == 2) && hostLittleEndian())
+    png_set_swap(png);
+
+  png_write_image(png, &rows[0]);
+  png_write_end(png, 0);
+  png_destroy_write_struct(&png, &info);
+}
+
+#endif
+
+/**
+   Read image file into host memory.
+   The memory must have the size of the image (see size()) and a pixel type
+   matching the image data.
+   @param filename name of file
+   @param dst destination pointer
+*/
+template <class Type>
+void
+load(const char *filename, HostMemory<Type, 2> &dst)
+{
+  File fp(filename, "rb");
+  Info i = readHeader(fp);
+
+  if(i.format != FORMAT_UNKNOWN) {
+    check(i, dst);
+    readPixels(fp, i, dst);
+    return;
+  }
+
+#ifdef CUDA_IMAGEIO_USE_PNG
+  rewind(fp);
+  readPng(fp, dst);
+#else
+  CUDA_ERROR("unknown image format");
+#endif
+}
+
+/**
+   Write host memory to image file.
+   The format is determined by the file name extension (".pgm", ".ppm",
+   ".pnm", ".pfm" or ".png"). PNM files store one or three channels, the
+   alpha channel of four-channel data is dropped. PFM files require floating
+   point data.
+   @param filename name of file
+   @param src source pointer
+*/
+template <class Type>
+void
+save(const char *filename, const HostMemory<Type, 2> &src)
+{
+  typedef typename Pixel<Type>::Component Component;
+  const format_t f = format(filename);
+  const bool is_float = Component(0.5) != 0;
+
+#ifdef CUDA_IMAGEIO_USE_PNG
+  if(f == FORMAT_PNG) {
+    File fp(filename, "wb");
+    writePng(fp, src);
+    return;
+  }
+#endif
+
+  if((f != FORMAT_PNM) && (f != FORMAT_PFM))
+    CUDA_ERROR("unsupported image format");
+
+  if(is_float != (f == FORMAT_PFM))
+    CUDA_ERROR("pixel type not supported by image format");
+
+  const unsigned channels = (Pixel<Type>::channels == 1) ? 1 : 3;
+  const size_t width = src.size[0], count = width * channels;
+  const bool swapped = (sizeof(Component) == 2) && hostLittleEndian();
+  File fp(filename, "wb");
+
+  if(f == FORMAT_PNM)
+    fprintf(fp, "P%c\n%u %u\n%u\n", (channels == 1) ? '5' : '6', (unsigned)src.size[0], (unsigned)src.size[1],
+	    (unsigned)Pixel<Type>::max());
+  else
+    fprintf(fp, "P%c\n%u %u\n%s\n", (channels == 1) ? 'f' : 'F', (unsigned)src.size[0], (unsigned)src.size[1],
+	    hostLittleEndian() ? "-1.0" : "1.0");
+
+  // rows which need conversion are written from a temporary row:
+  std::vector<Component> tmp((swapped || (channels != (unsigned)Pixel<Type>::channels)) ? count : 0);
+
+  for(size_t y = 0; y < src.size[1]; ++y) {
+    size_t row = (f == FORMAT_PFM) ? src.size[1] - 1 - y : y;
+    const Component *p = (const Component *)(src.getBuffer() + row * src.stride[0]);
+
+    if(!tmp.empty()) {
+      for(size_t x = 0; x < width; ++x)
+	for(unsigned c = 0; c < channels; ++c)
+	  tmp[x * channels + c] = p[x * Pixel<Type>::channels + c];
+
+      if(swapped)
+	swap(&tmp[0], count, sizeof(Component));
+
+      p = &tmp[0];
+    }
+
+    if(fwrite(p, sizeof(Component), count, fp) != count)
+      CUDA_ERROR("write error");
+  }
+}
+
+/**
+   Read several image files in parallel.
+   Each image is decoded by one thread, so this scales with the number of
+   images rather than with their size.
+   @param filenames names of files
+   @param images destination pointers
+*/
+template <class Type>
+void
+load(const std::vector<std::string> &filenames, const std::vector<HostMemory<Type, 2> *> &images)
+{
+  if(filenames.size() != images.size())
+    CUDA_ERROR("number of images mismatch");
+
+  const int n = filenames.size();
+  int failed = n;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for(int i = 0; i < n; ++i) {
+    // exceptions must not leave the parallel region:
+    try {
+      load(filenames[i].c_str(), *images[i]);
+    }
+    catch(...) {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+      if(i < failed)
+	failed = i;
+    }
+  }
+
+  // repeat first failure to report its error:
+  if(failed < n)
+    load(filenames[failed].c_str(), *images[failed]);
+}
+
+/**
+   Write several image files in parallel.
+   @param filenames names of files
+   @param images source pointers
+*/
+template <class Type>
+void
+save(const std::vector<std::string> &filenames, const std::vector<const HostMemory<Type, 2> *> &images)
+{
+  if(filenames.size() != images.size())
+    CUDA_ERROR("number of images mismatch");
+
+  const int n = filenames.size();
+  int failed = n;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for(int i = 0; i < n; ++i) {
+    try {
+      save(filenames[i].c_str(), *images[i]);
+    }
+    catch(...) {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+      if(i < failed)
+	failed = i;
+    }
+  }
+
+  if(failed < n)
+    save(filenames[failed].c_str(), *images[failed]);
+}
+
+}  // namespace ImageIO
+
+}  // namespace Cuda
+
+
+#endif
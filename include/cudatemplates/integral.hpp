@@ -0,0 +1,288 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_INTEGRAL_H
+#define CUDA_INTEGRAL_H
+
+
+#include <cudatemplates/devicememory.hpp>
+#include <cudatemplates/error.hpp>
+#include <cudatemplates/hostmemory.hpp>
+#include <cudatemplates/reduce.hpp>
+
+
+/**
+   Number of elements per row segment processed by one thread in the
+   second (column) pass of host integral images.
+*/
+#ifndef CUDA_INTEGRAL_SEGMENT
+#define CUDA_INTEGRAL_SEGMENT 1024
+#endif
+
+/**
+   Number of threads per block for device integral images (power of two).
+*/
+#ifndef CUDA_INTEGRAL_THREADS
+#define CUDA_INTEGRAL_THREADS 256
+#endif
+
+
+namespace Cuda {
+
+namespace Integral {
+
+/**
+   Check that the destination has the size of the source region.
+*/
+template <class Type1, class Type2, unsigned Dim>
+void checkSize(const Layout<Type1, Dim> &dst, const Layout<Type2, Dim> &src)
+{
+  Reduction::checkRegion(src, src.region_ofs, src.region_size);
+
+  for(unsigned i = Dim; i--;)
+    if(dst.size[i] != src.region_size[i])
+      CUDA_ERROR("size mismatch");
+}
+
+/**
+   Accumulate along dimension d (d > 0) of host memory.
+   Every line along dimension d is independent, and every line consists of
+   contiguous rows, which are split into segments. Each pair (line, segment)
+   is processed by one thread.
+*/
+template <class Type, unsigned Dim>
+void accumulate(HostMemory<Type, Dim> &dst, unsigned d)
+{
+  size_t width = dst.size[0], inner = 1, outer = 1;
+
+  for(unsigned i = 1; i < d; ++i)
+    inner *= dst.size[i];
+
+  for(unsigned i = d + 1; i < Dim; ++i)
+    outer *= dst.size[i];
+
+  const size_t segments = (width + CUDA_INTEGRAL_SEGMENT - 1) / CUDA_INTEGRAL_SEGMENT;
+  const size_t step = dst.stride[d - 1];  // distance between consecutive elements along d
+  const int items = (int)(outer * inner * segments);
+  Type *buffer = dst.getBuffer();
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for(int item = 0; item < items; ++item) {
+    size_t seg = item % segments, line = item / segments;
+    size_t x0 = seg * CUDA_INTEGRAL_SEGMENT;
+    size_t n = (x0 + CUDA_INTEGRAL_SEGMENT < width) ? CUDA_INTEGRAL_SEGMENT : width - x0;
+
+    // position of line (inner rows below d, outer coordinates above d):
+    size_t o = x0, l = line;
+
+    for(unsigned i = 1; i < Dim; ++i) {
+      if(i == d)
+	continue;
+
+      o += (l % dst.size[i]) * dst.stride[i - 1];
+      l /= dst.size[i];
+    }
+
+    Type *p = buffer + o;
+
+    for(size_t k = 1; k < dst.size[d]; ++k) {
+      Type *q = p + step;
+
+      for(size_t x = 0; x < n; ++x)
+	q[x] += p[x];
+
+      p = q;
+    }
+  }
+}
+
+#ifdef __CUDACC__
+
+/**
+   Inclusive scan of each row of the source region.
+   One block processes one row in segments of blockDim.x elements.
+*/
+template <class Type1, class Type2, unsigned Dim>
+__global__ void scan_rows_kernel(typename DeviceMemory<Type1, Dim>::KernelData dst,
+				 typename DeviceMemory<Type2, Dim>::KernelData src,
+				 Reduction::Region<Dim> region, size_t rows)
+{
+  __shared__ Type1 s[CUDA_INTEGRAL_THREADS];
+  size_t r = blockIdx.x + blockIdx.y * gridDim.x;
+
+  if(r >= rows)
+    return;
+
+  size_t so = region.ofs[0], dof = 0, j = r;
+
+  for(unsigned i = 1; i < Dim; ++i) {
+    so += (region.ofs[i] + j % region.size[i]) * src.stride[i - 1];
+    dof += (j % region.size[i]) * dst.stride[i - 1];
+    j /= region.size[i];
+  }
+
+  Type1 carry = 0;
+  unsigned t = threadIdx.x;
+
+  for(size_t x0 = 0; x0 < region.size[0]; x0 += CUDA_INTEGRAL_THREADS) {
+    size_t x = x0 + t;
+    s[t] = (x < region.size[0]) ? (Type1)src.data[so + x] : (Type1)0;
+    __syncthreads();
+
+    for(unsigned k = 1; k < CUDA_INTEGRAL_THREADS; k *= 2) {
+      Type1 v = (t >= k) ? s[t - k] : (Type1)0;
+      __syncthreads();
+      s[t] += v;
+      __syncthreads();
+    }
+
+    if(x < region.size[0])
+      dst.data[dof + x] = s[t] + carry;
+
+    carry += s[CUDA_INTEGRAL_THREADS - 1];
+    __syncthreads();
+  }
+}
+
+/**
+   Accumulate along dimension d, one thread per line.
+   Neighbouring threads process neighbouring lines, so accesses are coalesced.
+*/
+template <class Type, unsigned Dim>
+__global__ void accumulate_kernel(typename DeviceMemory<Type, Dim>::KernelData dst, unsigned d, size_t lines)
+{
+  size_t line = threadIdx.x + blockDim.x * (blockIdx.x + blockIdx.y * gridDim.x);
+
+  if(line >= lines)
+    return;
+
+  size_t o = line % dst.size[0], l = line / dst.size[0];
+
+  for(unsigned i = 1; i < Dim; ++i) {
+    if(i == d)
+      continue;
+
+    o += (l % dst.size[i]) * dst.stride[i - 1];
+    l /= dst.size[i];
+  }
+
+  Type *p = dst.data + o;
+  Type s = *p;
+
+  for(size_t k = 1; k < dst.size[d]; ++k) {
+    p += dst.stride[d - 1];
+    s += *p;
+    *p = s;
+  }
+}
+
+/**
+   Two-dimensional grid for the given number of blocks.
+*/
+static inline dim3 grid(size_t blocks)
+{
+  dim3 g((blocks < 65535) ? (unsigned)blocks : 65535);
+  g.y = (unsigned)((blocks + g.x - 1) / g.x);
+  return g;
+}
+
+#endif  // __CUDACC__
+
+}  // namespace Integral
+
+
+/**
+   Compute integral image (summed-area table) of host memory.
+   Each element of the destination is the sum of all source elements with
+   lower or equal coordinates within the source region of interest
+   (region_ofs and region_size). In the first pass, the rows are scanned
+   in parallel, each further pass accumulates along one of the higher
+   dimensions, processing independent row segments in parallel.
+   @param dst destination, its size must equal the source region size
+   @param src source
+*/
+template <class Type1, class Type2, unsigned Dim>
+void integral(HostMemory<Type1, Dim> &dst, const HostMemory<Type2, Dim> &src)
+{
+  Integral::checkSize(dst, src);
+  int rows = 1;
+
+  for(unsigned i = 1; i < Dim; ++i)
+    rows *= dst.size[i];
+
+  const size_t width = dst.size[0];
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for(int r = 0; r < rows; ++r) {
+    const Type2 *p = src.getBuffer() + Reduction::rowOffset(src, src.region_ofs, src.region_size, r);
+    Type1 *q = dst.getBuffer() + Reduction::rowOffset(dst, Size<Dim>(), dst.size, r);
+    Type1 s = 0;
+
+    for(size_t x = 0; x < width; ++x)
+      q[x] = s += (Type1)p[x];
+  }
+
+  for(unsigned d = 1; d < Dim; ++d)
+    Integral::accumulate(dst, d);
+}
+
+#if defined(__CUDACC__) || defined(__DOXYGEN__)
+
+/**
+   Compute integral image (summed-area table) of device memory.
+   See the host memory version for details. The rows are scanned by one block
+   each, the higher dimensions are accumulated by one thread per line.
+   @param dst destination, its size must equal the source region size
+   @param src source
+*/
+template <class Type1, class Type2, unsigned Dim>
+void integral(DeviceMemory<Type1, Dim> &dst, const DeviceMemory<Type2, Dim> &src)
+{
+  Integral::checkSize(dst, src);
+  size_t rows = 1;
+
+  for(unsigned i = 1; i < Dim; ++i)
+    rows *= dst.size[i];
+
+  if((rows == 0) || (dst.size[0] == 0))
+    return;
+
+  Integral::scan_rows_kernel<Type1, Type2, Dim><<<Integral::grid(rows), CUDA_INTEGRAL_THREADS>>>
+    (dst, src, Reduction::Region<Dim>(src.region_ofs, src.region_size), rows);
+  CUDA_CHECK(cudaGetLastError());
+
+  for(unsigned d = 1; d < Dim; ++d) {
+    size_t lines = dst.size[0] * rows / dst.size[d];
+    size_t blocks = (lines + CUDA_INTEGRAL_THREADS - 1) / CUDA_INTEGRAL_THREADS;
+    Integral::accumulate_kernel<Type1, Dim><<<Integral::grid(blocks), CUDA_INTEGRAL_THREADS>>>(dst, d, lines);
+    CUDA_CHECK(cudaGetLastError());
+  }
+}
+
+#endif  // defined(__CUDACC__) || defined(__DOXYGEN__)
+
+}  // namespace Cuda
+
+
+#endif
@@ -0,0 +1,360 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_OUTOFCOREARRAY_H
+#define CUDA_OUTOFCOREARRAY_H
+
+
+#include <list>
+#include <map>
+
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/ctv.hpp>
+#include <cudatemplates/devicememory.hpp>
+#include <cudatemplates/error.hpp>
+#include <cudatemplates/hostmemory.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/iterator.hpp>
+#include <cudatemplates/layout.hpp>
+
+
+/**
+   Default size of the chunk cache of out-of-core arrays (in bytes).
+*/
+#ifndef CUDA_OUTOFCORE_CACHE
+#define CUDA_OUTOFCORE_CACHE (256 << 20)
+#endif
+
+/**
+   Number of chunks for which readahead is requested when sequential access
+   is detected.
+*/
+#ifndef CUDA_OUTOFCORE_PREFETCH
+#define CUDA_OUTOFCORE_PREFETCH 4
+#endif
+
+
+namespace Cuda {
+
+/**
+   Multidimensional array stored in a chunked file.
+   The data is read from a .ctv file (see Ctv) on demand. Decoded chunks are
+   kept in a cache of limited size, the least recently used chunk is evicted
+   if the cache is full. The array therefore allows to process data which
+   doesn't fit into memory, e.g., by copying one tile after the other to
+   host or device memory (see copy()).
+
+   If consecutive accesses visit chunks at a constant distance in the chunk
+   grid (e.g., when a dataset is traversed slice by slice), the operating
+   system is asked to read ahead the next chunks in this direction.
+
+   The Layout of this class describes the stored data, its stride is the
+   stride of the packed data (no memory of this size is allocated).
+*/
+template <class Type, unsigned Dim>
+class OutOfCoreArray: public Layout<Type, Dim>
+{
+public:
+  /**
+     Constructor.
+     Opens the file and reads size, spacing and region of interest.
+     @param filename name of .ctv file
+     @param cache_bytes maximum size of cached chunks (at least one chunk
+     is always cached)
+     @param options options for file access
+  */
+  OutOfCoreArray(const char *filename, size_t cache_bytes = CUDA_OUTOFCORE_CACHE,
+		 const Ctv::Options &options = Ctv::Options()):
+    reader(filename, options), last(0), step(0), hits(0), misses(0)
+  {
+    Layout<Type, Dim>::operator=(reader.getLayout<Type, Dim>());
+    const Ctv::Header &header = reader.getHeader();
+    size_t chunk_bytes = sizeof(Type);
+
+    for(unsigned i = 0; i < Dim; ++i) {
+      chunk[i] = header.chunk[i];
+      grid[i] = (this->size[i] + chunk[i] - 1) / chunk[i];
+      chunk_bytes *= chunk[i];
+    }
+
+    capacity = cache_bytes / chunk_bytes;
+
+    if(capacity == 0)
+      capacity = 1;
+  }
+
+  /**
+     Destructor.
+  */
+  ~OutOfCoreArray()
+  {
+    for(typename Cache::iterator i = cache.begin(); i != cache.end(); ++i)
+      delete i->second.data;
+  }
+
+  /**
+     Get element.
+     Access to single elements is convenient, but slow compared to copying
+     entire regions.
+     @param index index of element
+  */
+  Type operator[](const SizeBase<Dim> &index)
+  {
+    Size<Dim> c, ofs;
+
+    for(unsigned i = Dim; i--;) {
+      if(index[i] >= this->size[i])
+	CUDA_ERROR("out of bounds");
+
+      c[i] = index[i] / chunk[i];
+      ofs[i] = index[i] - c[i] * chunk[i];
+    }
+
+    return (*get(c))[ofs];
+  }
+
+  /**
+     Copy region to host or device memory.
+     All chunks which intersect the region are loaded (and cached).
+     @param dst destination pointer
+     @param dst_ofs offset of region in destination
+     @param src_ofs offset of region in this array
+     @param _size size of region
+  */
+  template <class Memory>
+  void read(Memory &dst, const Size<Dim> &dst_ofs, const Size<Dim> &src_ofs, const Size<Dim> &_size)
+  {
+    dst.checkBounds(dst_ofs, _size);
+    this->checkBounds(src_ofs, _size);
+
+    for(unsigned i = Dim; i--;)
+      if(_size[i] == 0)
+	return;
+
+    // range of chunks intersecting the region:
+    Size<Dim> first, count, c;
+
+    for(unsigned i = Dim; i--;) {
+      first[i] = src_ofs[i] / chunk[i];
+      count[i] = (src_ofs[i] + _size[i] - 1) / chunk[i] - first[i] + 1;
+    }
+
+    // dimension 0 varies fastest, just as in the file:
+    Iterator<Dim> k(Size<Dim>(), count), end(Size<Dim>(), count);
+    end.setEnd();
+
+    for(; k != end; ++k) {
+      Size<Dim> cofs, dofs, rsize;
+
+      for(unsigned i = Dim; i--;) {
+	c[i] = first[i] + k[i];
+	size_t lo = c[i] * chunk[i], hi = lo + chunk[i];
+
+	if(lo < src_ofs[i])
+	  lo = src_ofs[i];
+
+	if(hi > src_ofs[i] + _size[i])
+	  hi = src_ofs[i] + _size[i];
+
+	cofs[i] = lo - c[i] * chunk[i];
+	dofs[i] = dst_ofs[i] + lo - src_ofs[i];
+	rsize[i] = hi - lo;
+      }
+
+      copy(dst, *get(c), dofs, cofs, rsize);
+    }
+  }
+
+  /**
+     Get chunk containing the given grid position.
+     The returned memory is valid until the next access to this array.
+     @param c position of chunk in chunk grid
+  */
+  const HostMemoryHeap<Type, Dim> *get(const Size<Dim> &c)
+  {
+    size_t index = 0;
+
+    for(unsigned i = Dim; i--;)
+      index = index * grid[i] + c[i];
+
+    access(index);
+    typename Cache::iterator i = cache.find(index);
+
+    if(i != cache.end()) {
+      // move to front of LRU list:
+      lru.splice(lru.begin(), lru, i->second.position);
+      ++hits;
+      return i->second.data;
+    }
+
+    ++misses;
+    size_t ofs[Dim], extent[Dim];
+    reader.getHeader().getChunk(index, ofs, extent);
+    Size<Dim> s;
+
+    for(unsigned k = Dim; k--;)
+      s[k] = extent[k];
+
+    HostMemoryHeap<Type, Dim> *data = 0;
+
+    if(cache.size() >= capacity) {
+      // evict least recently used chunk, reuse its memory if possible:
+      typename Cache::iterator j = cache.find(lru.back());
+      data = j->second.data;
+      lru.pop_back();
+      cache.erase(j);
+
+      if(data->size != s) {
+	delete data;
+	data = 0;
+      }
+    }
+
+    if(data == 0)
+      data = new HostMemoryHeap<Type, Dim>(s);
+
+    try {
+      reader.readChunk(index, data->getBuffer());
+    }
+    catch(...) {
+      delete data;
+      throw;
+    }
+
+    lru.push_front(index);
+    Entry &entry = cache[index];
+    entry.data = data;
+    entry.position = lru.begin();
+    return data;
+  }
+
+  /** Get size of chunks. */
+  inline Size<Dim> getChunkSize() const { return chunk; }
+
+  /** Get maximum number of cached chunks. */
+  inline size_t getCapacity() const { return capacity; }
+
+  /** Get number of chunk accesses served from the cache. */
+  inline size_t getHits() const { return hits; }
+
+  /** Get number of chunks read from the file. */
+  inline size_t getMisses() const { return misses; }
+
+private:
+  struct Entry
+  {
+    HostMemoryHeap<Type, Dim> *data;
+    std::list<size_t>::iterator position;
+  };
+
+  typedef std::map<size_t, Entry> Cache;
+
+  Ctv::Reader reader;
+
+  /** size of chunks */
+  Size<Dim> chunk;
+
+  /** number of chunks in each dimension */
+  Size<Dim> grid;
+
+  /** maximum number of cached chunks */
+  size_t capacity;
+
+  /** cached chunks */
+  Cache cache;
+
+  /** indices of cached chunks, most recently used first */
+  std::list<size_t> lru;
+
+  /** index of previously accessed chunk */
+  size_t last;
+
+  /** difference between the two previously accessed chunk indices */
+  ptrdiff_t step;
+
+  size_t hits, misses;
+
+  /**
+     Track chunk accesses and request readahead for sequential access.
+  */
+  void access(size_t index)
+  {
+    if(index == last)
+      return;
+
+    ptrdiff_t d = (ptrdiff_t)index - (ptrdiff_t)last;
+
+    if(d == step) {
+      for(int k = 1; k <= CUDA_OUTOFCORE_PREFETCH; ++k) {
+	ptrdiff_t next = (ptrdiff_t)index + k * d;
+
+	if((next < 0) || ((size_t)next >= reader.getChunkCount()))
+	  break;
+
+	if(cache.find(next) == cache.end())
+	  reader.prefetch(next);
+      }
+    }
+
+    last = index;
+    step = d;
+  }
+
+  // no copies:
+  OutOfCoreArray(const OutOfCoreArray &);
+  OutOfCoreArray &operator=(const OutOfCoreArray &);
+};
+
+/**
+   Copy region from out-of-core array to host memory.
+   @param dst destination pointer
+   @param src source array
+   @param dst_ofs offset of region in destination
+   @param src_ofs offset of region in source
+   @param size size of region
+*/
+template <class Type, unsigned Dim>
+void
+copy(HostMemory<Type, Dim> &dst, OutOfCoreArray<Type, Dim> &src,
+     const Size<Dim> &dst_ofs, const Size<Dim> &src_ofs, const Size<Dim> &size)
+{
+  src.read(dst, dst_ofs, src_ofs, size);
+}
+
+/**
+   Copy region from out-of-core array to device memory.
+   @param dst destination pointer
+   @param src source array
+   @param dst_ofs offset of region in destination
+   @param src_ofs offset of region in source
+   @param size size of region
+*/
+template <class Type, unsigned Dim>
+void
+copy(DeviceMemory<Type, Dim> &dst, OutOfCoreArray<Type, Dim> &src,
+     const Size<Dim> &dst_ofs, const Size<Dim> &src_ofs, const Size<Dim> &size)
+{
+  src.read(dst, dst_ofs, src_ofs, size);
+}
+
+}  // namespace Cuda
+
+
+#endif
@@ -0,0 +1,364 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_PERMUTE_H
+#define CUDA_PERMUTE_H
+
+
+#ifdef __SSE2__
+#include <xmmintrin.h>
+#endif
+
+#include <cudatemplates/devicememory.hpp>
+#include <cudatemplates/error.hpp>
+#include <cudatemplates/hostmemory.hpp>
+#include <cudatemplates/view.hpp>
+
+
+/**
+   Tile size of the device transpose kernel.
+   Each block of CUDA_PERMUTE_TILE x CUDA_PERMUTE_ROWS threads transposes a
+   tile of CUDA_PERMUTE_TILE x CUDA_PERMUTE_TILE elements.
+*/
+#ifndef CUDA_PERMUTE_TILE
+#define CUDA_PERMUTE_TILE 32
+#endif
+
+#ifndef CUDA_PERMUTE_ROWS
+#define CUDA_PERMUTE_ROWS 8
+#endif
+
+/**
+   Size of the cache blocks of the host transpose (in tiles per dimension).
+*/
+#ifndef CUDA_PERMUTE_BLOCK
+#define CUDA_PERMUTE_BLOCK 4
+#endif
+
+
+namespace Cuda {
+
+namespace Permutation {
+
+/**
+   Description of a permutation as a set of transposed planes.
+   The destination elements are consecutive in dimension 0, the source
+   elements in dimension "axis". If axis is 0, no transpose is required,
+   otherwise each plane spanned by the dimensions 0 and axis is transposed.
+   The remaining dimensions are enumerated by a linear index.
+*/
+template <class Type, unsigned Dim>
+struct Planes
+{
+  View<Type, Dim> dst;
+  View<const Type, Dim> src;
+  unsigned axis;
+  size_t count;
+
+  Planes(const View<Type, Dim> &_dst, const View<Type, Dim> &_src, const unsigned *axes)
+  {
+    View<Type, Dim> s = _src.permute(axes);
+    Striding::checkSize(_dst, s);
+    dst = _dst;
+    src.location = s.location;
+    src.data = s.data;
+    axis = 0;
+    count = 1;
+
+    for(unsigned i = Dim; i--;) {
+      src.size[i] = s.size[i];
+      src.step[i] = s.step[i];
+
+      if((s.step[i] == 1) && (s.size[i] > 1))
+	axis = i;
+    }
+
+    // no transpose is required if the destination isn't contiguous:
+    if((dst.step[0] != 1) || (src.step[0] == 1))
+      axis = 0;
+
+    for(unsigned i = 1; i < Dim; ++i)
+      if(i != axis)
+	count *= dst.size[i];
+  }
+
+  /**
+     Get offsets of given plane.
+  */
+  __host__ __device__ inline void offset(size_t p, ssize_t &dofs, ssize_t &sofs) const
+  {
+    dofs = sofs = 0;
+
+    for(unsigned i = 1; i < Dim; ++i)
+      if(i != axis) {
+	ssize_t k = p % dst.size[i];
+	p /= dst.size[i];
+	dofs += k * dst.step[i];
+	sofs += k * src.step[i];
+      }
+  }
+};
+
+#ifdef __SSE2__
+
+/**
+   Transpose a full tile of 4 byte elements by 4 x 4 blocks in SSE registers.
+*/
+template <int T>
+inline void tile4(float *dst, ssize_t dstep, const float *src, ssize_t sstep)
+{
+  for(int x = 0; x < T; x += 4)
+    for(int y = 0; y < T; y += 4) {
+      const float *s = src + x * sstep + y;
+      __m128 r0 = _mm_loadu_ps(s), r1 = _mm_loadu_ps(s + sstep);
+      __m128 r2 = _mm_loadu_ps(s + 2 * sstep), r3 = _mm_loadu_ps(s + 3 * sstep);
+      _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+      float *d = dst + y * dstep + x;
+      _mm_storeu_ps(d, r0);
+      _mm_storeu_ps(d + dstep, r1);
+      _mm_storeu_ps(d + 2 * dstep, r2);
+      _mm_storeu_ps(d + 3 * dstep, r3);
+    }
+}
+
+#endif
+
+/**
+   Transpose a tile of at most T x T elements through a local buffer.
+   The source is read along its consecutive dimension (y) and the
+   destination is written along its consecutive dimension (x), so each
+   cache line is touched only once per tile. For full tiles the loop bounds
+   are known at compile time, which allows the compiler to unroll the loops.
+   Full tiles of 4 byte elements are transposed in SSE registers instead.
+*/
+template <int T, class Type>
+inline void tile(Type *dst, ssize_t dstep, const Type *src, ssize_t sstep, int nx, int ny)
+{
+  Type buf[T][T];
+
+#ifdef __SSE2__
+  if((sizeof(Type) == 4) && (nx == T) && (ny == T)) {
+    tile4<T>((float *)dst, dstep, (const float *)src, sstep);
+    return;
+  }
+#endif
+
+  if((nx == T) && (ny == T)) {
+    for(int x = 0; x < T; ++x)
+      for(int y = 0; y < T; ++y)
+	buf[y][x] = src[x * sstep + y];
+
+    for(int y = 0; y < T; ++y)
+      for(int x = 0; x < T; ++x)
+	dst[y * dstep + x] = buf[y][x];
+  }
+  else {
+    for(int x = 0; x < nx; ++x)
+      for(int y = 0; y < ny; ++y)
+	buf[y][x] = src[x * sstep + y];
+
+    for(int y = 0; y < ny; ++y)
+      for(int x = 0; x < nx; ++x)
+	dst[y * dstep + x] = buf[y][x];
+  }
+}
+
+/**
+   Permute host memory.
+   The planes are cut into blocks of CUDA_PERMUTE_BLOCK x CUDA_PERMUTE_BLOCK
+   tiles, which fit into the level 1 cache and are distributed among threads
+   (if OpenMP is enabled).
+*/
+template <class Type, unsigned Dim>
+void host(const Planes<Type, Dim> &p)
+{
+  if(p.axis == 0) {
+    Striding::host(p.dst, p.src);
+    return;
+  }
+
+  enum { T = (sizeof(Type) <= 4) ? 16 : 8, B = T * CUDA_PERMUTE_BLOCK };
+  const size_t nx = p.dst.size[0], ny = p.dst.size[p.axis];
+  const ssize_t dstep = p.dst.step[p.axis], sstep = p.src.step[0];
+  const size_t bx = (nx + B - 1) / B, by = (ny + B - 1) / B;
+  const ssize_t blocks = (ssize_t)(p.count * bx * by);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if(blocks > 1)
+#endif
+  for(ssize_t b = 0; b < blocks; ++b) {
+    ssize_t dofs, sofs;
+    p.offset(b / (bx * by), dofs, sofs);
+    const size_t x0 = (b % bx) * B, y0 = (b / bx % by) * B;
+    const size_t x1 = (x0 + B < nx) ? x0 + B : nx, y1 = (y0 + B < ny) ? y0 + B : ny;
+
+    for(size_t y = y0; y < y1; y += T)
+      for(size_t x = x0; x < x1; x += T)
+	tile<T>(p.dst.data + dofs + y * dstep + x, dstep, p.src.data + sofs + x * sstep + y, sstep,
+		(x + T < x1) ? T : (int)(x1 - x), (y + T < y1) ? T : (int)(y1 - y));
+  }
+}
+
+#ifdef __CUDACC__
+
+/**
+   Transpose kernel.
+   Each block reads a tile into shared memory along the consecutive source
+   dimension and writes it along the consecutive destination dimension, so
+   both global memory accesses are coalesced. The tile is padded by one
+   column to avoid shared memory bank conflicts. The planes and tile rows
+   are enumerated by blockIdx.y.
+*/
+template <class Type, unsigned Dim>
+__global__ void transpose_kernel(Planes<Type, Dim> p, unsigned tiles_y, size_t rows)
+{
+  __shared__ Type buf[CUDA_PERMUTE_TILE][CUDA_PERMUTE_TILE + 1];
+  const size_t nx = p.dst.size[0], ny = p.dst.size[p.axis];
+  const ssize_t dstep = p.dst.step[p.axis], sstep = p.src.step[0];
+
+  for(size_t r = blockIdx.y; r < rows; r += gridDim.y) {
+    ssize_t dofs, sofs;
+    p.offset(r / tiles_y, dofs, sofs);
+    size_t x0 = blockIdx.x * CUDA_PERMUTE_TILE, y0 = (r % tiles_y) * CUDA_PERMUTE_TILE;
+
+    // read tile, source is consecutive in y:
+    for(unsigned i = threadIdx.y; i < CUDA_PERMUTE_TILE; i += CUDA_PERMUTE_ROWS) {
+      size_t x = x0 + i, y = y0 + threadIdx.x;
+
+      if((x < nx) && (y < ny))
+	buf[i][threadIdx.x] = p.src.data[sofs + x * sstep + y];
+    }
+
+    __syncthreads();
+
+    // write tile, destination is consecutive in x:
+    for(unsigned i = threadIdx.y; i < CUDA_PERMUTE_TILE; i += CUDA_PERMUTE_ROWS) {
+      size_t x = x0 + threadIdx.x, y = y0 + i;
+
+      if((x < nx) && (y < ny))
+	p.dst.data[dofs + y * dstep + x] = buf[threadIdx.x][i];
+    }
+
+    __syncthreads();
+  }
+}
+
+/**
+   Permute device memory.
+*/
+template <class Type, unsigned Dim>
+void device(const Planes<Type, Dim> &p)
+{
+  if(p.axis == 0) {
+    Striding::device(p.dst, p.src);
+    return;
+  }
+
+  const size_t nx = p.dst.size[0], ny = p.dst.size[p.axis];
+
+  if((nx == 0) || (ny == 0) || (p.count == 0))
+    return;
+
+  unsigned tiles_x = (nx + CUDA_PERMUTE_TILE - 1) / CUDA_PERMUTE_TILE;
+  unsigned tiles_y = (ny + CUDA_PERMUTE_TILE - 1) / CUDA_PERMUTE_TILE;
+  size_t rows = tiles_y * p.count;
+
+  if(tiles_x > 65535)
+    CUDA_ERROR("data too large");
+
+  dim3 gridDim(tiles_x, (rows < 65535) ? rows : 65535);
+  dim3 blockDim(CUDA_PERMUTE_TILE, CUDA_PERMUTE_ROWS);
+  transpose_kernel<<<gridDim, blockDim>>>(p, tiles_y, rows);
+  CUDA_CHECK(cudaGetLastError());
+}
+
+#endif  // __CUDACC__
+
+}  // namespace Permutation
+
+
+/**
+   Permute axes of views.
+   Dimension i of the destination is dimension axes[i] of the source. If the
+   permutation moves the consecutive source dimension, planes are transposed
+   tile by tile (through a local buffer on the host and through shared memory
+   on the device), otherwise this is a plain strided copy. Both views must
+   refer to the same kind of memory, views of device memory can only be
+   permuted in code compiled by nvcc.
+   @param dst destination view
+   @param src source view
+   @param axes permutation of 0 ... Dim - 1
+*/
+template<class Type, unsigned Dim>
+void
+permute(const View<Type, Dim> &dst, const View<Type, Dim> &src, const unsigned *axes)
+{
+  if(dst.location != src.location)
+    CUDA_ERROR("permutation between host and device memory not supported");
+
+  Permutation::Planes<Type, Dim> p(dst, src, axes);
+
+  if(dst.location == MEMORY_HOST)
+    Permutation::host(p);
+  else {
+#ifdef __CUDACC__
+    Permutation::device(p);
+#else
+    CUDA_ERROR("device memory can only be permuted in code compiled by nvcc");
+#endif
+  }
+}
+
+/**
+   Permute axes of host memory.
+   @param dst destination pointer
+   @param src source pointer
+   @param axes permutation of 0 ... Dim - 1
+*/
+template<class Type, unsigned Dim>
+void
+permute(HostMemory<Type, Dim> &dst, const HostMemory<Type, Dim> &src, const unsigned *axes)
+{
+  permute(View<Type, Dim>(dst), View<Type, Dim>(src), axes);
+}
+
+#if defined(__CUDACC__) || defined(__DOXYGEN__)
+
+/**
+   Permute axes of device memory.
+   Since this function calls a CUDA kernel, it is only available if the file
+   from which this function is called is compiled by nvcc.
+   @param dst destination pointer
+   @param src source pointer
+   @param axes permutation of 0 ... Dim - 1
+*/
+template<class Type, unsigned Dim>
+void
+permute(DeviceMemory<Type, Dim> &dst, const DeviceMemory<Type, Dim> &src, const unsigned *axes)
+{
+  permute(View<Type, Dim>(dst), View<Type, Dim>(src), axes);
+}
+
+#endif  // defined(__CUDACC__) || defined(__DOXYGEN__)
+
+}  // namespace Cuda
+
+
+#endif
@@ -0,0 +1,612 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_PYRAMID_H
+#define CUDA_PYRAMID_H
+
+
+#include <vector>
+
+#include <cudatemplates/convolution.hpp>
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememory.hpp>
+#include <cudatemplates/devicememorylinear.hpp>
+#include <cudatemplates/devicememoryreference.hpp>
+#include <cudatemplates/error.hpp>
+#include <cudatemplates/hostmemory.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/hostmemoryreference.hpp>
+
+
+/**
+   Alignment (in bytes) of the pitch and start address of pyramid levels.
+*/
+#ifndef CUDA_PYRAMID_ALIGNMENT
+#define CUDA_PYRAMID_ALIGNMENT 128
+#endif
+
+/**
+   Minimum size of the coarsest pyramid level in each dimension when the
+   number of levels is determined automatically.
+*/
+#ifndef CUDA_PYRAMID_MIN_SIZE
+#define CUDA_PYRAMID_MIN_SIZE 8
+#endif
+
+/**
+   Number of threads per block for device resampling.
+*/
+#ifndef CUDA_PYRAMID_THREADS
+#define CUDA_PYRAMID_THREADS 256
+#endif
+
+
+namespace Cuda {
+
+/**
+   Pyramid types.
+*/
+typedef enum {
+  PYRAMID_GAUSSIAN,  /**< low-pass filtered levels */
+  PYRAMID_LAPLACIAN  /**< band-pass filtered levels, the coarsest level is low-pass filtered */
+} pyramid_t;
+
+namespace Resample {
+
+/**
+   Weights of the binomial filter (1 4 6 4 1) / 16 used for downsampling.
+*/
+__host__ __device__ inline float down(int k)
+{
+  return (k == 2) ? 0.375f : ((k == 1) || (k == 3)) ? 0.25f : 0.0625f;
+}
+
+/**
+   Weights of the source elements j - 1, j, j + 1 contributing to destination
+   element 2 * j + parity when upsampling.
+   This is the binomial filter applied to the source with zeros inserted,
+   multiplied by two.
+*/
+__host__ __device__ inline float up(int parity, int k)
+{
+  return parity ? ((k == 0) ? 0.0f : 0.5f) : ((k == 1) ? 0.75f : 0.125f);
+}
+
+/**
+   Check that the coarse size is half the fine size (rounded up).
+*/
+template <class Type1, class Type2, unsigned Dim>
+void check(const Layout<Type1, Dim> &coarse, const Layout<Type2, Dim> &fine)
+{
+  for(unsigned i = Dim; i--;)
+    if(coarse.size[i] != (fine.size[i] + 1) / 2)
+      CUDA_ERROR("size mismatch");
+}
+
+/**
+   Upsample host memory and store or subtract the result.
+   The rows of the source contributing to a destination row are combined
+   first, the resulting row is then interpolated.
+*/
+template <class Type1, class Type2, unsigned Dim>
+void expand(HostMemory<Type1, Dim> &dst, const HostMemory<Type2, Dim> &src, border_t border, bool subtract)
+{
+  check(src, dst);
+  const int width = src.size[0], w2 = dst.size[0];
+  int rows = 1, count = 1;
+
+  for(unsigned i = 1; i < Dim; ++i) {
+    rows *= dst.size[i];
+    count *= 3;
+  }
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    std::vector<float> buf(width + 2), weights(count);
+    std::vector<const Type2 *> in(count);
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(int y = 0; y < rows; ++y) {
+      // source rows contributing to destination row y:
+      for(int t = 0; t < count; ++t) {
+	size_t o = 0, j = y, u = t;
+	float w = 1;
+
+	for(unsigned i = 1; i < Dim; ++i) {
+	  int c = j % dst.size[i], k = u % 3;
+	  o += border_index((c >> 1) + k - 1, src.size[i], border) * src.stride[i - 1];
+	  w *= up(c & 1, k);
+	  j /= dst.size[i];
+	  u /= 3;
+	}
+
+	in[t] = src.getBuffer() + o;
+	weights[t] = w;
+      }
+
+      Convolution::convolveLine<0>(&buf[1], &in[0], width, &weights[0], (count - 1) / 2);
+      buf[0] = buf[1 + border_index(-1, width, border)];
+      buf[width + 1] = buf[1 + border_index(width, width, border)];
+      Type1 *q = dst.getBuffer() + Reduction::rowOffset(dst, Size<Dim>(), dst.size, y);
+
+      for(int x = 0; x < w2; ++x) {
+	const float *p = &buf[x >> 1];
+	float v = (x & 1) ? 0.5f * (p[1] + p[2]) : 0.125f * (p[0] + p[2]) + 0.75f * p[1];
+	q[x] = Convolution::Saturate<Type1>::apply(subtract ? (float)q[x] - v : v);
+      }
+    }
+  }
+}
+
+#ifdef __CUDACC__
+
+/**
+   Downsample device memory, one thread per destination element.
+*/
+template <class Type1, class Type2, unsigned Dim>
+__global__ void downsample_kernel(typename DeviceMemory<Type1, Dim>::KernelData dst,
+				  typename DeviceMemory<Type2, Dim>::KernelData src,
+				  border_t border, size_t count)
+{
+  size_t i = threadIdx.x + blockDim.x * (blockIdx.x + blockIdx.y * gridDim.x);
+
+  if(i >= count)
+    return;
+
+  int c[Dim];
+  size_t o = 0;
+
+  for(unsigned d = 0; d < Dim; ++d) {
+    c[d] = i % dst.size[d];
+    o += c[d] * ((d == 0) ? 1 : dst.stride[d - 1]);
+    i /= dst.size[d];
+  }
+
+  int taps = 1;
+
+  for(unsigned d = 0; d < Dim; ++d)
+    taps *= 5;
+
+  float s = 0;
+
+  for(int t = 0; t < taps; ++t) {
+    size_t so = 0;
+    int u = t;
+    float w = 1;
+
+    for(unsigned d = 0; d < Dim; ++d) {
+      int k = u % 5;
+      so += border_index(2 * c[d] + k - 2, src.size[d], border) * ((d == 0) ? 1 : src.stride[d - 1]);
+      w *= down(k);
+      u /= 5;
+    }
+
+    s += w * src.data[so];
+  }
+
+  dst.data[o] = Convolution::Saturate<Type1>::apply(s);
+}
+
+/**
+   Upsample device memory and store or subtract the result, one thread per
+   destination element.
+*/
+template <class Type1, class Type2, unsigned Dim>
+__global__ void expand_kernel(typename DeviceMemory<Type1, Dim>::KernelData dst,
+			      typename DeviceMemory<Type2, Dim>::KernelData src,
+			      border_t border, size_t count, bool subtract)
+{
+  size_t i = threadIdx.x + blockDim.x * (blockIdx.x + blockIdx.y * gridDim.x);
+
+  if(i >= count)
+    return;
+
+  int c[Dim];
+  size_t o = 0;
+
+  for(unsigned d = 0; d < Dim; ++d) {
+    c[d] = i % dst.size[d];
+    o += c[d] * ((d == 0) ? 1 : dst.stride[d - 1]);
+    i /= dst.size[d];
+  }
+
+  int taps = 1;
+
+  for(unsigned d = 0; d < Dim; ++d)
+    taps *= 3;
+
+  float s = 0;
+
+  for(int t = 0; t < taps; ++t) {
+    size_t so = 0;
+    int u = t;
+    float w = 1;
+
+    for(unsigned d = 0; d < Dim; ++d) {
+      int k = u % 3;
+      so += border_index((c[d] >> 1) + k - 1, src.size[d], border) * ((d == 0) ? 1 : src.stride[d - 1]);
+      w *= up(c[d] & 1, k);
+      u /= 3;
+    }
+
+    s += w * src.data[so];
+  }
+
+  dst.data[o] = Convolution::Saturate<Type1>::apply(subtract ? (float)dst.data[o] - s : s);
+}
+
+/**
+   Two-dimensional grid for the given number of elements.
+*/
+static inline dim3 grid(size_t count)
+{
+  size_t blocks = (count + CUDA_PYRAMID_THREADS - 1) / CUDA_PYRAMID_THREADS;
+  dim3 g((blocks < 65535) ? (unsigned)blocks : 65535);
+  g.y = (unsigned)((blocks + g.x - 1) / g.x);
+  return g;
+}
+
+/**
+   Upsample device memory and store or subtract the result.
+*/
+template <class Type1, class Type2, unsigned Dim>
+void expand(DeviceMemory<Type1, Dim> &dst, const DeviceMemory<Type2, Dim> &src, border_t border, bool subtract)
+{
+  check(src, dst);
+  size_t count = dst.getSize() / dst.stride[0] * dst.size[0];
+
+  if(count == 0)
+    return;
+
+  expand_kernel<Type1, Type2, Dim><<<grid(count), CUDA_PYRAMID_THREADS>>>(dst, src, border, count, subtract);
+  CUDA_CHECK(cudaGetLastError());
+}
+
+#endif  // __CUDACC__
+
+/**
+   Memory block holding all levels of a pyramid.
+*/
+template <class Reference>
+struct Pool;
+
+template <class Type, unsigned Dim>
+struct Pool<HostMemoryReference<Type, Dim> >
+{
+  typedef HostMemoryHeap<Type, 1> type;
+};
+
+template <class Type, unsigned Dim>
+struct Pool<DeviceMemoryReference<Type, Dim> >
+{
+  typedef DeviceMemoryLinear<Type, 1> type;
+};
+
+}  // namespace Resample
+
+
+/**
+   Downsample host memory by a factor of two in each dimension.
+   Blurring with the binomial filter (1 4 6 4 1) / 16 and decimation are
+   fused: the source rows contributing to a destination row are combined
+   first (vectorized across the row), only every other element of the result
+   is filtered horizontally. Destination rows are processed in parallel (if
+   OpenMP is enabled).
+   @param dst destination, its size must be half the source size (rounded up)
+   @param src source
+   @param border border mode
+*/
+template <class Type1, class Type2, unsigned Dim>
+void downsample(HostMemory<Type1, Dim> &dst, const HostMemory<Type2, Dim> &src, border_t border = BORDER_CLAMP)
+{
+  Resample::check(dst, src);
+  const int width = src.size[0], w2 = dst.size[0];
+  int rows = 1, count = 1;
+
+  for(unsigned i = 1; i < Dim; ++i) {
+    rows *= dst.size[i];
+    count *= 5;
+  }
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    std::vector<float> buf(width + 4), weights(count);
+    std::vector<const Type2 *> in(count);
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(int y = 0; y < rows; ++y) {
+      // source rows contributing to destination row y:
+      for(int t = 0; t < count; ++t) {
+	size_t o = 0, j = y, u = t;
+	float w = 1;
+
+	for(unsigned i = 1; i < Dim; ++i) {
+	  int k = u % 5;
+	  o += border_index(2 * (int)(j % dst.size[i]) + k - 2, src.size[i], border) * src.stride[i - 1];
+	  w *= Resample::down(k);
+	  j /= dst.size[i];
+	  u /= 5;
+	}
+
+	in[t] = src.getBuffer() + o;
+	weights[t] = w;
+      }
+
+      Convolution::convolveLine<0>(&buf[2], &in[0], width, &weights[0], (count - 1) / 2);
+
+      for(int k = 0; k < 2; ++k) {
+	buf[k] = buf[2 + border_index(k - 2, width, border)];
+	buf[width + 2 + k] = buf[2 + border_index(width + k, width, border)];
+      }
+
+      Type1 *q = dst.getBuffer() + Reduction::rowOffset(dst, Size<Dim>(), dst.size, y);
+
+      for(int x = 0; x < w2; ++x) {
+	const float *p = &buf[2 * x];
+	q[x] = Convolution::Saturate<Type1>::apply(0.0625f * (p[0] + p[4]) + 0.25f * (p[1] + p[3]) + 0.375f * p[2]);
+      }
+    }
+  }
+}
+
+/**
+   Upsample host memory by a factor of two in each dimension.
+   This inserts zeros between the source elements and applies the binomial
+   filter (1 4 6 4 1) / 8, i.e., the inverse of downsample().
+   @param dst destination, the source size must be half its size (rounded up)
+   @param src source
+   @param border border mode
+*/
+template <class Type1, class Type2, unsigned Dim>
+void upsample(HostMemory<Type1, Dim> &dst, const HostMemory<Type2, Dim> &src, border_t border = BORDER_CLAMP)
+{
+  Resample::expand(dst, src, border, false);
+}
+
+#if defined(__CUDACC__) || defined(__DOXYGEN__)
+
+/**
+   Downsample device memory by a factor of two in each dimension.
+   See the host memory version for details. Each thread computes one
+   destination element directly from the 5^Dim contributing source elements.
+   @param dst destination, its size must be half the source size (rounded up)
+   @param src source
+   @param border border mode
+*/
+template <class Type1, class Type2, unsigned Dim>
+void downsample(DeviceMemory<Type1, Dim> &dst, const DeviceMemory<Type2, Dim> &src, border_t border = BORDER_CLAMP)
+{
+  Resample::check(dst, src);
+  size_t count = dst.getSize() / dst.stride[0] * dst.size[0];
+
+  if(count == 0)
+    return;
+
+  Resample::downsample_kernel<Type1, Type2, Dim><<<Resample::grid(count), CUDA_PYRAMID_THREADS>>>(dst, src, border, count);
+  CUDA_CHECK(cudaGetLastError());
+}
+
+/**
+   Upsample device memory by a factor of two in each dimension.
+   See the host memory version for details.
+   @param dst destination, the source size must be half its size (rounded up)
+   @param src source
+   @param border border mode
+*/
+template <class Type1, class Type2, unsigned Dim>
+void upsample(DeviceMemory<Type1, Dim> &dst, const DeviceMemory<Type2, Dim> &src, border_t border = BORDER_CLAMP)
+{
+  Resample::expand(dst, src, border, false);
+}
+
+#endif  // defined(__CUDACC__) || defined(__DOXYGEN__)
+
+
+/**
+   Gaussian or Laplacian image pyramid.
+   All levels are allocated in one memory block, with the pitch and start
+   address of each level aligned to CUDA_PYRAMID_ALIGNMENT bytes. Levels are
+   computed when they are accessed for the first time after the base level
+   has been changed.
+   Each level of a Laplacian pyramid is the difference between the
+   corresponding level of the Gaussian pyramid and the upsampled next coarser
+   level, so the element type should be signed. A Laplacian level is computed
+   together with all finer levels.
+   The template parameter Reference selects host
+   (HostMemoryReference<Type, Dim>) or device memory
+   (DeviceMemoryReference<Type, Dim>, requires compilation by nvcc).
+*/
+template <class Type, unsigned Dim, class Reference = HostMemoryReference<Type, Dim> >
+class Pyramid
+{
+public:
+  /**
+     Constructor.
+     @param size size of the base level
+     @param levels number of levels, if zero, levels are added until the
+     next level would be smaller than CUDA_PYRAMID_MIN_SIZE in some dimension
+     @param type pyramid type
+     @param border border mode for filtering
+  */
+  Pyramid(const Size<Dim> &size, unsigned levels = 0,
+	  pyramid_t type = PYRAMID_GAUSSIAN, border_t border = BORDER_CLAMP):
+    m_type(type), m_border(border)
+  {
+    // layout of levels:
+    std::vector<Layout<Type, Dim> > layout;
+    std::vector<size_t> ofs;
+    Layout<Type, Dim> l(size);
+    const size_t align = (CUDA_PYRAMID_ALIGNMENT % sizeof(Type) == 0) ? CUDA_PYRAMID_ALIGNMENT / sizeof(Type) : 1;
+    size_t total = 0;
+
+    for(;;) {
+      l.setPitch((l.size[0] + align - 1) / align * align * sizeof(Type));
+      layout.push_back(l);
+      ofs.push_back(total);
+      total += (l.getSize() + align - 1) / align * align;
+
+      if(layout.size() == levels)
+	break;
+
+      bool last = false;
+
+      for(unsigned i = Dim; i--;) {
+	l.size[i] = (l.size[i] + 1) / 2;
+	l.spacing[i] *= 2;
+
+	if((levels == 0) && (l.size[i] < CUDA_PYRAMID_MIN_SIZE))
+	  last = true;
+      }
+
+      if(last)
+	break;
+    }
+
+    // allocate pool and align start address:
+    m_pool.realloc(Size<1>(total + align));
+    Type *p = m_pool.getBuffer();
+    size_t a = (size_t)p % (align * sizeof(Type));
+
+    if((a > 0) && (a % sizeof(Type) == 0))
+      p += align - a / sizeof(Type);
+
+    for(size_t i = 0; i < layout.size(); ++i)
+      m_level.push_back(Reference(layout[i], p + ofs[i]));
+
+    m_state.assign(m_level.size(), STATE_EMPTY);
+    m_state[0] = STATE_GAUSSIAN;
+  }
+
+  /**
+     Get number of levels.
+  */
+  inline unsigned getLevels() const { return m_level.size(); }
+
+  /**
+     Get pyramid type.
+  */
+  inline pyramid_t getType() const { return m_type; }
+
+  /**
+     Get base level for writing.
+     This invalidates all other levels.
+  */
+  Reference &base()
+  {
+    m_state.assign(m_state.size(), STATE_EMPTY);
+    m_state[0] = STATE_GAUSSIAN;
+    return m_level[0];
+  }
+
+  /**
+     Copy data to the base level.
+     This invalidates all other levels.
+     @param src source, its size must be the size of the base level
+  */
+  template <class Memory>
+  void setBase(const Memory &src)
+  {
+    copy(base(), src);
+  }
+
+  /**
+     Get level.
+     The level and all levels it depends on are computed if necessary.
+     @param i level index (0 is the base level)
+  */
+  Reference &operator[](unsigned i)
+  {
+    if(i >= m_level.size())
+      CUDA_ERROR("invalid pyramid level");
+
+    if(m_type == PYRAMID_GAUSSIAN) {
+      gaussian(i);
+      return m_level[i];
+    }
+
+    // Laplacian level k needs Gaussian level k + 1, which is computed from
+    // Gaussian level k, therefore levels are converted from fine to coarse:
+    for(unsigned k = 0; k <= i; ++k) {
+      if(m_state[k] == STATE_LAPLACIAN)
+	continue;
+
+      if(k + 1 < m_level.size()) {
+	gaussian(k + 1);
+	Resample::expand(m_level[k], m_level[k + 1], m_border, true);
+      }
+      else
+	gaussian(k);
+
+      m_state[k] = STATE_LAPLACIAN;
+    }
+
+    return m_level[i];
+  }
+
+  /**
+     Compute all levels.
+  */
+  void build()
+  {
+    for(unsigned i = 0; i < m_level.size(); ++i)
+      (*this)[i];
+  }
+
+private:
+  typedef enum { STATE_EMPTY, STATE_GAUSSIAN, STATE_LAPLACIAN } state_t;
+
+  pyramid_t m_type;
+  border_t m_border;
+  typename Resample::Pool<Reference>::type m_pool;
+  std::vector<Reference> m_level;
+  std::vector<state_t> m_state;
+
+  /**
+     Make sure that level i contains the Gaussian level.
+     Level i - 1 is still a Gaussian level if level i has not yet been
+     computed.
+  */
+  void gaussian(unsigned i)
+  {
+    if(m_state[i] != STATE_EMPTY)
+      return;
+
+    gaussian(i - 1);
+    downsample(m_level[i], m_level[i - 1], m_border);
+    m_state[i] = STATE_GAUSSIAN;
+  }
+
+  // pyramids are not copyable:
+  Pyramid(const Pyramid &);
+  Pyramid &operator=(const Pyramid &);
+};
+
+}  // namespace Cuda
+
+
+#endif
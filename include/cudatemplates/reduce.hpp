@@ -0,0 +1,693 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_REDUCE_H
+#define CUDA_REDUCE_H
+
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <cudatemplates/devicememory.hpp>
+#include <cudatemplates/error.hpp>
+#include <cudatemplates/hostmemory.hpp>
+
+#ifdef __CUDACC__
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememorylinear.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#endif
+
+
+/**
+   Number of leaf ranges into which a host reduction is split.
+   The partial results are combined in a fixed order, so the result doesn't
+   depend on the number of threads.
+*/
+#ifndef CUDA_REDUCE_CHUNKS
+#define CUDA_REDUCE_CHUNKS 64
+#endif
+
+/**
+   Number of elements below which a row is summed up directly in pairwise
+   summation.
+*/
+#ifndef CUDA_REDUCE_PAIRWISE_BLOCK
+#define CUDA_REDUCE_PAIRWISE_BLOCK 128
+#endif
+
+/**
+   Number of threads per block for device reductions (must be a power of two).
+*/
+#ifndef CUDA_REDUCE_THREADS
+#define CUDA_REDUCE_THREADS 256
+#endif
+
+
+namespace Cuda {
+
+/**
+   Reductions over host and device memory.
+   A reduction is described by an operation class which provides
+   - typedefs result_type (intermediate result) and value_type (final result),
+   - result_type init() const,
+   - void add(result_type &r, Type v, size_t index) const,
+     where index is the linear index of the element within the region,
+   - void combine(result_type &r, const result_type &s) const,
+     which merges the intermediate result s into r,
+   - void row(result_type &r, const Type *p, size_t n, size_t index) const
+     for the contiguous elements of a row (host only),
+   - value_type result(const result_type &r) const.
+   init, add and combine must also be available in device code for device
+   reductions, and result_type must be a plain struct or scalar type.
+*/
+namespace Reduction {
+
+/**
+   Summation algorithm.
+*/
+enum summation_t {
+  SUMMATION_NAIVE,     /**< plain summation with several partial sums */
+  SUMMATION_PAIRWISE,  /**< recursive pairwise summation, O(log n) error growth */
+  SUMMATION_KAHAN      /**< compensated summation (don't compile with -ffast-math) */
+};
+
+/**
+   Type used for accumulating values of the given type.
+*/
+template <class Type> struct Accumulator { typedef Type type; };
+template <> struct Accumulator<char> { typedef long long type; };
+template <> struct Accumulator<signed char> { typedef long long type; };
+template <> struct Accumulator<unsigned char> { typedef unsigned long long type; };
+template <> struct Accumulator<short> { typedef long long type; };
+template <> struct Accumulator<unsigned short> { typedef unsigned long long type; };
+template <> struct Accumulator<int> { typedef long long type; };
+template <> struct Accumulator<unsigned int> { typedef unsigned long long type; };
+
+template <class Type>
+__host__ __device__ inline Type absolute(Type v) { return (v < 0) ? -v : v; }
+
+/**
+   Intermediate result of summation.
+   c is the Kahan compensation term (the represented value is sum - c).
+*/
+template <class Acc>
+struct SumResult
+{
+  Acc sum, c;
+};
+
+/**
+   Summation of f(v) over all elements, f is defined by the template
+   parameter F. Elements are converted to the accumulator type before f is
+   applied, so squares of small integer types don't overflow.
+*/
+template <class Type, class F, class Acc = typename Accumulator<Type>::type>
+struct SumOf
+{
+  typedef SumResult<Acc> result_type;
+  typedef Acc value_type;
+
+  summation_t summation;
+
+  SumOf(summation_t s = SUMMATION_PAIRWISE): summation(s) {}
+
+  __host__ __device__ inline result_type init() const
+  {
+    result_type r;
+    r.sum = 0;
+    r.c = 0;
+    return r;
+  }
+
+  __host__ __device__ inline void kahan(result_type &r, Acc v) const
+  {
+    Acc y = v - r.c;
+    Acc t = r.sum + y;
+    r.c = (t - r.sum) - y;
+    r.sum = t;
+  }
+
+  __host__ __device__ inline void add(result_type &r, Type v, size_t) const
+  {
+    if(summation == SUMMATION_KAHAN)
+      kahan(r, F::apply((Acc)v));
+    else
+      r.sum += F::apply((Acc)v);
+  }
+
+  __host__ __device__ inline void combine(result_type &r, const result_type &s) const
+  {
+    if(summation == SUMMATION_KAHAN) {
+      kahan(r, s.sum);
+      kahan(r, -s.c);
+    }
+    else
+      r.sum += s.sum;
+  }
+
+  /**
+     Sum up contiguous elements using four independent partial sums.
+  */
+  static Acc block(const Type *p, size_t n)
+  {
+    Acc s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+
+    for(; i + 4 <= n; i += 4) {
+      s0 += F::apply((Acc)p[i]);
+      s1 += F::apply((Acc)p[i + 1]);
+      s2 += F::apply((Acc)p[i + 2]);
+      s3 += F::apply((Acc)p[i + 3]);
+    }
+
+    for(; i < n; ++i)
+      s0 += F::apply((Acc)p[i]);
+
+    return (s0 + s1) + (s2 + s3);
+  }
+
+  static Acc pairwise(const Type *p, size_t n)
+  {
+    if(n <= CUDA_REDUCE_PAIRWISE_BLOCK)
+      return block(p, n);
+
+    size_t h = (n / 2 + 7) & ~(size_t)7;  // keep blocks aligned
+    return pairwise(p, h) + pairwise(p + h, n - h);
+  }
+
+  void row(result_type &r, const Type *p, size_t n, size_t) const
+  {
+    switch(summation) {
+    case SUMMATION_NAIVE:
+      r.sum += block(p, n);
+      break;
+
+    case SUMMATION_PAIRWISE:
+      r.sum += pairwise(p, n);
+      break;
+
+    case SUMMATION_KAHAN:
+      for(size_t i = 0; i < n; ++i)
+	kahan(r, F::apply((Acc)p[i]));
+      break;
+    }
+  }
+
+  inline value_type result(const result_type &r) const { return r.sum - r.c; }
+};
+
+struct Identity { template <class T> __host__ __device__ static inline T apply(T v) { return v; } };
+struct Abs { template <class T> __host__ __device__ static inline T apply(T v) { return absolute(v); } };
+struct Square { template <class T> __host__ __device__ static inline T apply(T v) { return v * v; } };
+
+/**
+   Sum of all elements.
+*/
+template <class Type, class Acc = typename Accumulator<Type>::type>
+struct Sum: public SumOf<Type, Identity, Acc>
+{
+  Sum(summation_t s = SUMMATION_PAIRWISE): SumOf<Type, Identity, Acc>(s) {}
+};
+
+/**
+   Sum of absolute values (L1 norm).
+*/
+template <class Type, class Acc = typename Accumulator<Type>::type>
+struct Norm1: public SumOf<Type, Abs, Acc>
+{
+  Norm1(summation_t s = SUMMATION_PAIRWISE): SumOf<Type, Abs, Acc>(s) {}
+};
+
+/**
+   Euclidean (L2) norm.
+*/
+template <class Type, class Acc = typename Accumulator<Type>::type>
+struct Norm2: public SumOf<Type, Square, Acc>
+{
+  typedef SumOf<Type, Square, Acc> base;
+  typedef double value_type;
+
+  Norm2(summation_t s = SUMMATION_PAIRWISE): base(s) {}
+
+  inline value_type result(const typename base::result_type &r) const { return sqrt((double)base::result(r)); }
+};
+
+/**
+   Intermediate result of comparison-based reductions.
+*/
+template <class Type>
+struct Extremum
+{
+  Type value;
+  size_t index;
+};
+
+/**
+   Minimum or maximum (of absolute values if Abs is given as F).
+   The index of the first occurrence is tracked as well. NaN values are
+   ignored (as by fmin and fmax); if there are no other values, the result
+   is NaN.
+   @param Greater true for maximum, false for minimum
+*/
+template <class Type, bool Greater, class F = Identity>
+struct Compare
+{
+  typedef Extremum<Type> result_type;
+  typedef Type value_type;
+
+  Type initial;
+
+  Compare():
+    initial(Greater ? (std::numeric_limits<Type>::is_integer ? std::numeric_limits<Type>::min() : -std::numeric_limits<Type>::max())
+	    : std::numeric_limits<Type>::max())
+  {
+  }
+
+  __host__ __device__ inline result_type init() const
+  {
+    result_type r;
+    r.value = initial;
+    r.index = (size_t)-1;
+    return r;
+  }
+
+  __host__ __device__ static inline bool better(Type a, Type b) { return Greater ? (a > b) : (a < b); }
+
+  __host__ __device__ inline void add(result_type &r, Type v, size_t index) const
+  {
+    v = F::apply(v);
+
+    // skip NaN:
+    if(v != v)
+      return;
+
+    if(better(v, r.value) || (r.index == (size_t)-1)) {
+      r.value = v;
+      r.index = index;
+    }
+  }
+
+  /**
+     Combine intermediate results.
+     Ties are resolved in favour of the smaller index, so the result doesn't
+     depend on the order of combination.
+  */
+  __host__ __device__ inline void combine(result_type &r, const result_type &s) const
+  {
+    if(s.index == (size_t)-1)
+      return;
+
+    if((r.index == (size_t)-1) || better(s.value, r.value) || ((s.value == r.value) && (s.index < r.index))) {
+      r.value = s.value;
+      r.index = s.index;
+    }
+  }
+
+  void row(result_type &r, const Type *p, size_t n, size_t index) const
+  {
+    if(n == 0)
+      return;
+
+    // find the extremum in a loop without index tracking first
+    // (a NaN in m is replaced by the next value, so NaN is skipped):
+    Type m = F::apply(p[0]);
+
+    for(size_t i = 1; i < n; ++i) {
+      Type v = F::apply(p[i]);
+      m = (better(v, m) || (m != m)) ? v : m;
+    }
+
+    // only NaN in this row:
+    if(m != m)
+      return;
+
+    if(!(better(m, r.value) || (r.index == (size_t)-1)))
+      return;
+
+    size_t i = 0;
+
+    while((i < n) && (F::apply(p[i]) != m))
+      ++i;
+
+    r.value = m;
+    r.index = index + i;
+  }
+
+  inline value_type result(const result_type &r) const
+  {
+    // no value other than NaN:
+    if((r.index == (size_t)-1) && std::numeric_limits<Type>::has_quiet_NaN)
+      return std::numeric_limits<Type>::quiet_NaN();
+
+    return r.value;
+  }
+};
+
+/**
+   Wrapper for operations whose intermediate result is of interest, e.g.,
+   the index of the extremum.
+*/
+template <class Op>
+struct Identify: public Op
+{
+  typedef typename Op::result_type value_type;
+  inline value_type result(const typename Op::result_type &r) const { return r; }
+};
+
+template <class Type> struct Min: public Compare<Type, false> {};
+template <class Type> struct Max: public Compare<Type, true> {};
+template <class Type> struct NormInf: public Compare<Type, true, Abs> {};
+
+/**
+   Convert linear index within region to position.
+*/
+template <unsigned Dim>
+Size<Dim> position(size_t index, const Size<Dim> &ofs, const Size<Dim> &size)
+{
+  Size<Dim> pos;
+
+  for(unsigned i = 0; i < Dim; ++i) {
+    pos[i] = ofs[i] + index % size[i];
+    index /= size[i];
+  }
+
+  return pos;
+}
+
+/**
+   Check that region lies within layout.
+*/
+template <class Type, unsigned Dim>
+void checkRegion(const Layout<Type, Dim> &layout, const Size<Dim> &ofs, const Size<Dim> &size)
+{
+  for(unsigned i = Dim; i--;)
+    if(ofs[i] + size[i] > layout.size[i])
+      CUDA_ERROR("out of bounds");
+}
+
+/**
+   Offset of row r (counted in the dimensions 1...Dim-1) within region.
+*/
+template <class Type, unsigned Dim>
+size_t rowOffset(const Layout<Type, Dim> &layout, const Size<Dim> &ofs, const Size<Dim> &size, size_t r)
+{
+  size_t o = ofs[0];
+
+  for(unsigned i = 1; i < Dim; ++i) {
+    o += (ofs[i] + r % size[i]) * layout.stride[i - 1];
+    r /= size[i];
+  }
+
+  return o;
+}
+
+/**
+   Pairwise reduction of the rows [first, last) of a region.
+*/
+template <class Type, unsigned Dim, class Op>
+typename Op::result_type
+reduceRows(const HostMemory<Type, Dim> &mem, const Op &op,
+	   const Size<Dim> &ofs, const Size<Dim> &size, size_t first, size_t last)
+{
+  if(last - first == 1) {
+    typename Op::result_type r = op.init();
+    op.row(r, mem.getBuffer() + rowOffset(mem, ofs, size, first), size[0], first * size[0]);
+    return r;
+  }
+
+  size_t mid = first + (last - first) / 2;
+  typename Op::result_type r = reduceRows(mem, op, ofs, size, first, mid);
+  op.combine(r, reduceRows(mem, op, ofs, size, mid, last));
+  return r;
+}
+
+/**
+   Region passed to device kernels.
+*/
+template <unsigned Dim>
+struct Region
+{
+  size_t ofs[Dim], size[Dim];
+
+  Region(const Size<Dim> &_ofs, const Size<Dim> &_size)
+  {
+    for(unsigned i = Dim; i--;) {
+      ofs[i] = _ofs[i];
+      size[i] = _size[i];
+    }
+  }
+};
+
+#ifdef __CUDACC__
+
+template <class Type, unsigned Dim, class Op>
+__global__ void reduce_kernel(typename DeviceMemory<Type, Dim>::KernelData src, Region<Dim> region,
+			      size_t count, Op op, typename Op::result_type *partial)
+{
+  __shared__ typename Op::result_type s[CUDA_REDUCE_THREADS];
+  typename Op::result_type r = op.init();
+
+  // each block processes a contiguous range of elements:
+  size_t n = (count + gridDim.x - 1) / gridDim.x;
+  size_t first = blockIdx.x * n, last = (first + n < count) ? first + n : count;
+
+  for(size_t i = first + threadIdx.x; i < last; i += CUDA_REDUCE_THREADS) {
+    size_t o = 0, j = i;
+
+    for(unsigned d = 0; d < Dim; ++d) {
+      o += (region.ofs[d] + j % region.size[d]) * ((d == 0) ? 1 : src.stride[d - 1]);
+      j /= region.size[d];
+    }
+
+    op.add(r, src.data[o], i);
+  }
+
+  s[threadIdx.x] = r;
+  __syncthreads();
+
+  // tree reduction in shared memory:
+  for(unsigned k = CUDA_REDUCE_THREADS / 2; k > 0; k /= 2) {
+    if(threadIdx.x < k)
+      op.combine(s[threadIdx.x], s[threadIdx.x + k]);
+
+    __syncthreads();
+  }
+
+  if(threadIdx.x == 0)
+    partial[blockIdx.x] = s[0];
+}
+
+#endif  // __CUDACC__
+
+}  // namespace Reduction
+
+
+/**
+   Reduce a region of host memory.
+   The rows of the region are split into a fixed number of ranges, which are
+   processed in parallel if OpenMP is enabled. Within each range, rows are
+   combined pairwise; within each row, the operation's row method works on
+   contiguous memory. Padding given by the layout's stride is skipped.
+   @param mem host memory
+   @param op reduction operation
+   @param ofs offset of region
+   @param size size of region
+   @return result of reduction
+*/
+template <class Type, unsigned Dim, class Op>
+typename Op::value_type
+reduce(const HostMemory<Type, Dim> &mem, const Op &op, const Size<Dim> &ofs, const Size<Dim> &size)
+{
+  Reduction::checkRegion(mem, ofs, size);
+  size_t rows = 1;
+
+  for(unsigned i = 1; i < Dim; ++i)
+    rows *= size[i];
+
+  if((rows == 0) || (size[0] == 0))
+    return op.result(op.init());
+
+  int chunks = (rows < CUDA_REDUCE_CHUNKS) ? (int)rows : CUDA_REDUCE_CHUNKS;
+  std::vector<typename Op::result_type> partial(chunks);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for(int c = 0; c < chunks; ++c)
+    partial[c] = Reduction::reduceRows(mem, op, ofs, size, rows * c / chunks, rows * (c + 1) / chunks);
+
+  // combine partial results pairwise:
+  for(int k = 1; k < chunks; k *= 2)
+    for(int c = 0; c + k < chunks; c += 2 * k)
+      op.combine(partial[c], partial[c + k]);
+
+  return op.result(partial[0]);
+}
+
+/**
+   Reduce host memory.
+   @param mem host memory
+   @param op reduction operation
+   @return result of reduction
+*/
+template <class Type, unsigned Dim, class Op>
+typename Op::value_type
+reduce(const HostMemory<Type, Dim> &mem, const Op &op)
+{
+  return reduce(mem, op, Size<Dim>(), mem.size);
+}
+
+#if defined(__CUDACC__) || defined(__DOXYGEN__)
+
+/**
+   Reduce a region of device memory.
+   Each block reduces a contiguous range of elements in shared memory, the
+   partial results of the blocks are combined on the host.
+   Since this function calls a CUDA kernel, it is only available if the file
+   from which this function is called is compiled by nvcc.
+   @param mem device memory
+   @param op reduction operation
+   @param ofs offset of region
+   @param size size of region
+   @return result of reduction
+*/
+template <class Type, unsigned Dim, class Op>
+typename Op::value_type
+reduce(const DeviceMemory<Type, Dim> &mem, const Op &op, const Size<Dim> &ofs, const Size<Dim> &size)
+{
+  Reduction::checkRegion(mem, ofs, size);
+  size_t count = 1;
+
+  for(unsigned i = 0; i < Dim; ++i)
+    count *= size[i];
+
+  if(count == 0)
+    return op.result(op.init());
+
+  size_t blocks = (count + CUDA_REDUCE_THREADS * 16 - 1) / (CUDA_REDUCE_THREADS * 16);
+
+  if(blocks > 1024)
+    blocks = 1024;
+
+  DeviceMemoryLinear1D<typename Op::result_type> dpartial(blocks);
+  Reduction::reduce_kernel<Type, Dim, Op><<<blocks, CUDA_REDUCE_THREADS>>>(mem, Reduction::Region<Dim>(ofs, size), count, op, dpartial.getBuffer());
+  CUDA_CHECK(cudaGetLastError());
+  HostMemoryHeap1D<typename Op::result_type> hpartial(dpartial);
+  typename Op::result_type *partial = hpartial.getBuffer();
+
+  for(size_t i = 1; i < blocks; ++i)
+    op.combine(partial[0], partial[i]);
+
+  return op.result(partial[0]);
+}
+
+/**
+   Reduce device memory.
+   @param mem device memory
+   @param op reduction operation
+   @return result of reduction
+*/
+template <class Type, unsigned Dim, class Op>
+typename Op::value_type
+reduce(const DeviceMemory<Type, Dim> &mem, const Op &op)
+{
+  return reduce(mem, op, Size<Dim>(), mem.size);
+}
+
+#endif  // defined(__CUDACC__) || defined(__DOXYGEN__)
+
+
+/*
+  Convenience functions for the most common reductions.
+  They are defined for HostMemory and (if compiled by nvcc) DeviceMemory.
+  The position of the extremum returned by argmin and argmax is the first
+  one in memory order. NaN values are ignored; if all values are NaN, NaN
+  is returned at position 0.
+*/
+
+#define CUDA_REDUCE_FUNCTIONS(Mem)					\
+template <class Type, unsigned Dim>					\
+typename Reduction::Accumulator<Type>::type				\
+sum(const Mem<Type, Dim> &mem, Reduction::summation_t summation = Reduction::SUMMATION_PAIRWISE) \
+{									\
+  return reduce(mem, Reduction::Sum<Type>(summation));			\
+}									\
+									\
+template <class Type, unsigned Dim>					\
+Type min(const Mem<Type, Dim> &mem)					\
+{									\
+  return reduce(mem, Reduction::Min<Type>());				\
+}									\
+									\
+template <class Type, unsigned Dim>					\
+Type max(const Mem<Type, Dim> &mem)					\
+{									\
+  return reduce(mem, Reduction::Max<Type>());				\
+}									\
+									\
+template <class Type, unsigned Dim>					\
+Type argmin(const Mem<Type, Dim> &mem, Size<Dim> &pos)			\
+{									\
+  Reduction::Extremum<Type> r = reduce(mem, Reduction::Identify<Reduction::Min<Type> >()); \
+  pos = Reduction::position((r.index == (size_t)-1) ? 0 : r.index, Size<Dim>(), mem.size); \
+  return Reduction::Min<Type>().result(r);				\
+}									\
+									\
+template <class Type, unsigned Dim>					\
+Type argmax(const Mem<Type, Dim> &mem, Size<Dim> &pos)			\
+{									\
+  Reduction::Extremum<Type> r = reduce(mem, Reduction::Identify<Reduction::Max<Type> >()); \
+  pos = Reduction::position((r.index == (size_t)-1) ? 0 : r.index, Size<Dim>(), mem.size); \
+  return Reduction::Max<Type>().result(r);				\
+}									\
+									\
+template <class Type, unsigned Dim>					\
+typename Reduction::Accumulator<Type>::type				\
+norm1(const Mem<Type, Dim> &mem, Reduction::summation_t summation = Reduction::SUMMATION_PAIRWISE) \
+{									\
+  return reduce(mem, Reduction::Norm1<Type>(summation));		\
+}									\
+									\
+template <class Type, unsigned Dim>					\
+double norm2(const Mem<Type, Dim> &mem, Reduction::summation_t summation = Reduction::SUMMATION_PAIRWISE) \
+{									\
+  return reduce(mem, Reduction::Norm2<Type>(summation));		\
+}									\
+									\
+template <class Type, unsigned Dim>					\
+Type normInf(const Mem<Type, Dim> &mem)					\
+{									\
+  return reduce(mem, Reduction::NormInf<Type>());			\
+}
+
+CUDA_REDUCE_FUNCTIONS(HostMemory)
+
+#if defined(__CUDACC__) || defined(__DOXYGEN__)
+CUDA_REDUCE_FUNCTIONS(DeviceMemory)
+#endif
+
+#undef CUDA_REDUCE_FUNCTIONS
+
+}  // namespace Cuda
+
+
+#endif
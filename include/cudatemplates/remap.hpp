@@ -0,0 +1,387 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_REMAP_H
+#define CUDA_REMAP_H
+
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <cudatemplates/convolution.hpp>
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememory.hpp>
+#include <cudatemplates/devicememorylinear.hpp>
+#include <cudatemplates/error.hpp>
+#include <cudatemplates/hostmemory.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/hostmemoryreference.hpp>
+#include <cudatemplates/staticassert.hpp>
+
+
+/**
+   Tile size (in elements along dimension 0 and 1) for host remapping.
+*/
+#ifndef CUDA_REMAP_TILE_X
+#define CUDA_REMAP_TILE_X 64
+#endif
+
+#ifndef CUDA_REMAP_TILE_Y
+#define CUDA_REMAP_TILE_Y 16
+#endif
+
+/**
+   Number of threads per block for device remapping.
+*/
+#ifndef CUDA_REMAP_THREADS
+#define CUDA_REMAP_THREADS 256
+#endif
+
+
+namespace Cuda {
+
+namespace Remapping {
+
+/**
+   Fixed-point map entry.
+   If ofs is non-negative, it is the offset of the first of the 2^Dim source
+   elements used for interpolation, and the others are found at ofs + 1,
+   ofs + stride[0] etc. Otherwise, at least one of these elements is outside
+   the source and the offsets of all elements are found in the border table
+   at position (-1 - ofs) * 2^Dim.
+*/
+template <unsigned Dim>
+struct Entry
+{
+  int ofs;
+  unsigned char frac[Dim];
+};
+
+/**
+   Interpolate from the source elements described by a map entry.
+   @param data source data
+   @param e map entry
+   @param step distance between consecutive elements in each dimension
+   @param border border table
+*/
+template <class Type, unsigned Dim>
+__host__ __device__ inline float interpolate(const Type *data, const Entry<Dim> &e, const size_t *step, const int *border)
+{
+  float s = 0;
+
+  for(int t = 0; t < (1 << Dim); ++t) {
+    float w = 1;
+    size_t o = 0;
+
+    for(unsigned d = 0; d < Dim; ++d) {
+      int k = (t >> d) & 1;
+      w *= (k ? e.frac[d] : 256 - e.frac[d]) * (1.0f / 256);
+      o += k * step[d];
+    }
+
+    s += w * (float)data[(e.ofs >= 0) ? e.ofs + o : border[(-1 - e.ofs) * (1 << Dim) + t]];
+  }
+
+  return s;
+}
+
+/**
+   Source strides passed to device kernels.
+*/
+template <unsigned Dim>
+struct Step
+{
+  size_t step[Dim];
+};
+
+#ifdef __CUDACC__
+
+template <class Type, unsigned Dim>
+__global__ void remap_kernel(typename DeviceMemory<Type, Dim>::KernelData dst,
+			     typename DeviceMemory<Type, Dim>::KernelData src,
+			     typename DeviceMemory<Entry<Dim>, Dim>::KernelData map,
+			     const int *border, Step<Dim> step, size_t count)
+{
+  size_t i = threadIdx.x + blockDim.x * (blockIdx.x + blockIdx.y * gridDim.x);
+
+  if(i >= count)
+    return;
+
+  size_t o = 0, m = 0;
+
+  for(unsigned d = 0; d < Dim; ++d) {
+    size_t c = i % dst.size[d];
+    o += c * ((d == 0) ? 1 : dst.stride[d - 1]);
+    m += c * ((d == 0) ? 1 : map.stride[d - 1]);
+    i /= dst.size[d];
+  }
+
+  dst.data[o] = Convolution::Saturate<Type>::apply(interpolate(src.data, map.data[m], step.step, border));
+}
+
+#endif  // __CUDACC__
+
+}  // namespace Remapping
+
+
+/**
+   Geometric transformation by a precomputed map.
+   The map gives the source coordinates of each destination element, using
+   the texture convention (unnormalized, element centers at i + 0.5).
+   It is converted once into a fixed-point representation consisting of the
+   offset of the first source element and an 8 bit fraction per dimension,
+   which is then used for bilinear (or trilinear) interpolation in each
+   application. Elements near the border are handled by a separate table of
+   source offsets computed according to the border mode.
+   The offsets depend on the source layout, the source given to the
+   application operators must therefore have the same size and pitch as the
+   layout given to the constructor.
+*/
+template <class Type, unsigned Dim>
+class Remap
+{
+public:
+  /**
+     Constructor.
+     @param src layout of the source
+     @param map Dim coordinate maps, all of the size of the destination
+     @param border border mode
+  */
+  Remap(const Layout<Type, Dim> &src, const HostMemory<float, Dim> *const map[Dim], border_t border = BORDER_CLAMP)
+  {
+    init(src, map, border);
+  }
+
+  /**
+     Constructor for two-dimensional data.
+     @param src layout of the source
+     @param map_x map of x coordinates
+     @param map_y map of y coordinates
+     @param border border mode
+  */
+  Remap(const Layout<Type, Dim> &src, const HostMemory<float, 2> &map_x, const HostMemory<float, 2> &map_y,
+	border_t border = BORDER_CLAMP)
+  {
+    CUDA_STATIC_ASSERT(Dim == 2);
+    const HostMemory<float, 2> *map[] = { &map_x, &map_y };
+    init(src, map, border);
+  }
+
+  /**
+     Get size of destination.
+  */
+  inline const Size<Dim> &getSize() const { return m_map.size; }
+
+  /**
+     Apply map to host memory.
+     The destination is processed in tiles of CUDA_REMAP_TILE_X *
+     CUDA_REMAP_TILE_Y elements, which are distributed among threads (if
+     OpenMP is enabled). Tiles map to compact source regions, which improves
+     cache usage for rotations and similar transformations.
+     @param dst destination
+     @param src source
+  */
+  void operator()(HostMemory<Type, Dim> &dst, const HostMemory<Type, Dim> &src) const
+  {
+    check(dst, src);
+    const size_t tx = (dst.size[0] + CUDA_REMAP_TILE_X - 1) / CUDA_REMAP_TILE_X;
+    const size_t ty = (Dim < 2) ? 1 : (dst.size[1] + CUDA_REMAP_TILE_Y - 1) / CUDA_REMAP_TILE_Y;
+    size_t outer = 1;
+
+    for(unsigned i = 2; i < Dim; ++i)
+      outer *= dst.size[i];
+
+    const int tiles = (int)(tx * ty * outer);
+    const Remapping::Entry<Dim> *map = m_map.getBuffer();
+    const int *border = m_border.empty() ? 0 : &m_border[0];
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 4)
+#endif
+    for(int tile = 0; tile < tiles; ++tile) {
+      size_t x0 = (tile % tx) * CUDA_REMAP_TILE_X, l = tile / tx;
+      size_t y0 = (l % ty) * CUDA_REMAP_TILE_Y;
+      l /= ty;
+      size_t w = std::min((size_t)CUDA_REMAP_TILE_X, dst.size[0] - x0);
+      size_t h = (Dim < 2) ? 1 : std::min((size_t)CUDA_REMAP_TILE_Y, dst.size[(Dim < 2) ? 0 : 1] - y0);
+      size_t dof = x0, mof = x0;
+
+      for(unsigned i = 2; i < Dim; ++i) {
+	dof += (l % dst.size[i]) * dst.stride[i - 1];
+	mof += (l % dst.size[i]) * m_map.stride[i - 1];
+	l /= dst.size[i];
+      }
+
+      for(size_t y = y0; y < y0 + h; ++y) {
+	Type *q = dst.getBuffer() + dof + ((Dim < 2) ? 0 : y * dst.stride[0]);
+	const Remapping::Entry<Dim> *e = map + mof + ((Dim < 2) ? 0 : y * m_map.stride[0]);
+
+	for(size_t x = 0; x < w; ++x)
+	  q[x] = Convolution::Saturate<Type>::apply(Remapping::interpolate(src.getBuffer(), e[x], m_step, border));
+      }
+    }
+  }
+
+#if defined(__CUDACC__) || defined(__DOXYGEN__)
+
+  /**
+     Apply map to device memory.
+     The map is copied to device memory on first use.
+     @param dst destination
+     @param src source
+  */
+  void operator()(DeviceMemory<Type, Dim> &dst, const DeviceMemory<Type, Dim> &src) const
+  {
+    check(dst, src);
+
+    if(m_device_map.getBuffer() == 0) {
+      m_device_map.realloc(m_map.size);
+      copy(m_device_map, m_map);
+
+      if(!m_border.empty()) {
+	HostMemoryReference<int, 1> b(Size<1>(m_border.size()), const_cast<int *>(&m_border[0]));
+	m_device_border.realloc(b.size);
+	copy(m_device_border, b);
+      }
+    }
+
+    size_t count = 1;
+
+    for(unsigned i = Dim; i--;)
+      count *= dst.size[i];
+
+    if(count == 0)
+      return;
+
+    Remapping::Step<Dim> step;
+
+    for(unsigned i = Dim; i--;)
+      step.step[i] = m_step[i];
+
+    size_t blocks = (count + CUDA_REMAP_THREADS - 1) / CUDA_REMAP_THREADS;
+    dim3 grid((blocks < 65535) ? (unsigned)blocks : 65535);
+    grid.y = (unsigned)((blocks + grid.x - 1) / grid.x);
+    Remapping::remap_kernel<Type, Dim><<<grid, CUDA_REMAP_THREADS>>>(dst, src, m_device_map, m_device_border.getBuffer(), step, count);
+    CUDA_CHECK(cudaGetLastError());
+  }
+
+#endif  // defined(__CUDACC__) || defined(__DOXYGEN__)
+
+private:
+  Size<Dim> m_src_size;
+  size_t m_step[Dim];
+  HostMemoryHeap<Remapping::Entry<Dim>, Dim> m_map;
+  std::vector<int> m_border;
+  mutable DeviceMemoryLinear<Remapping::Entry<Dim>, Dim> m_device_map;
+  mutable DeviceMemoryLinear<int, 1> m_device_border;
+
+  // remaps own device memory and are not copyable:
+  Remap(const Remap &);
+  Remap &operator=(const Remap &);
+
+  void init(const Layout<Type, Dim> &src, const HostMemory<float, Dim> *const map[Dim], border_t border)
+  {
+    m_src_size = src.size;
+
+    for(unsigned d = Dim; d--;) {
+      m_step[d] = (d == 0) ? 1 : src.stride[d - 1];
+
+      if(map[d]->size != map[0]->size)
+	CUDA_ERROR("size mismatch");
+    }
+
+    if(src.getSize() > 0x7fffffff)
+      CUDA_ERROR("source too large for remapping");
+
+    m_map.realloc(map[0]->size);
+    size_t count = 1;
+
+    for(unsigned d = Dim; d--;)
+      count *= m_map.size[d];
+
+    for(size_t i = 0; i < count; ++i) {
+      // position in destination (and maps):
+      Size<Dim> p;
+      size_t j = i;
+
+      for(unsigned d = 0; d < Dim; ++d) {
+	p[d] = j % m_map.size[d];
+	j /= m_map.size[d];
+      }
+
+      Remapping::Entry<Dim> &e = m_map[p];
+      int i0[Dim];
+      bool inside = true;
+
+      for(unsigned d = 0; d < Dim; ++d) {
+	float x = (*map[d])[p] - 0.5f;
+	float f = floorf(x);
+	int a = (int)floorf((x - f) * 256 + 0.5f);
+	i0[d] = (int)f;
+
+	if(a == 256) {
+	  ++i0[d];
+	  a = 0;
+	}
+
+	e.frac[d] = (unsigned char)a;
+	inside = inside && (i0[d] >= 0) && (i0[d] + 1 < (int)src.size[d]);
+      }
+
+      if(inside) {
+	e.ofs = 0;
+
+	for(unsigned d = Dim; d--;)
+	  e.ofs += i0[d] * (int)m_step[d];
+
+	continue;
+      }
+
+      // border element, store offsets of all source elements:
+      e.ofs = -1 - (int)(m_border.size() >> Dim);
+
+      for(int t = 0; t < (1 << Dim); ++t) {
+	int o = 0;
+
+	for(unsigned d = Dim; d--;)
+	  o += border_index(i0[d] + ((t >> d) & 1), src.size[d], border) * (int)m_step[d];
+
+	m_border.push_back(o);
+      }
+    }
+  }
+
+  template <class Memory>
+  void check(const Memory &dst, const Memory &src) const
+  {
+    if((dst.size != m_map.size) || (src.size != m_src_size))
+      CUDA_ERROR("size mismatch");
+
+    for(unsigned d = 1; d < Dim; ++d)
+      if(src.stride[d - 1] != m_step[d])
+	CUDA_ERROR("source layout differs from layout used for map");
+  }
+};
+
+}  // namespace Cuda
+
+
+#endif
@@ -0,0 +1,383 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_SAMPLER_H
+#define CUDA_SAMPLER_H
+
+
+#include <cmath>
+
+#include <cudatemplates/array.hpp>
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/hostmemory.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/staticassert.hpp>
+
+
+/**
+   Number of samples processed at once by batch sampling.
+*/
+#ifndef CUDA_SAMPLER_BLOCK
+#define CUDA_SAMPLER_BLOCK 64
+#endif
+
+
+namespace Cuda {
+
+/**
+   Filter modes.
+   FILTER_NEAREST and FILTER_LINEAR correspond to cudaFilterModePoint and
+   cudaFilterModeLinear.
+*/
+typedef enum {
+  FILTER_NEAREST,  /**< nearest neighbour */
+  FILTER_LINEAR,   /**< linear interpolation */
+  FILTER_CUBIC     /**< cubic convolution (Catmull-Rom spline) */
+} filter_t;
+
+namespace Sampling {
+
+/**
+   Number of taps per dimension.
+*/
+template <filter_t Filter> struct Taps;
+template <> struct Taps<FILTER_NEAREST> { enum { value = 1 }; };
+template <> struct Taps<FILTER_LINEAR> { enum { value = 2 }; };
+template <> struct Taps<FILTER_CUBIC> { enum { value = 4 }; };
+
+/**
+   Addressing mode with the border mode known at compile time.
+*/
+template <border_t Border>
+struct Address
+{
+  static inline int apply(int i, int n) { return border_index(i, n, Border); }
+};
+
+template <>
+struct Address<BORDER_CLAMP>
+{
+  static inline int apply(int i, int n)
+  {
+    // written as min/max to be vectorizable:
+    i = (i > 0) ? i : 0;
+    return (i < n - 1) ? i : n - 1;
+  }
+};
+
+/**
+   Round towards minus infinity.
+   Unlike floorf(), this is vectorized by the compiler without SSE4.1.
+*/
+inline int floorInt(float x)
+{
+  int i = (int)x;
+  return i - (x < (float)i);
+}
+
+/**
+   Compute element offsets and weights along one dimension.
+   The texel centers are located at i + 0.5, as on the GPU.
+   @param x unnormalized coordinate
+   @param n number of elements
+   @param step distance between consecutive elements
+   @param fixed_point whether linear weights are quantized to 8 fractional
+   bits, as done by the texture units
+   @param ofs offsets (one per tap, spaced by m)
+   @param w weights (one per tap, spaced by m)
+   @param m spacing of offsets and weights
+*/
+template <filter_t Filter, border_t Border>
+struct Weights;
+
+template <border_t Border>
+struct Weights<FILTER_NEAREST, Border>
+{
+  static inline void apply(float x, int n, size_t step, bool, size_t *ofs, float *w, size_t)
+  {
+    *ofs = Address<Border>::apply(floorInt(x), n) * step;
+    *w = 1;
+  }
+};
+
+template <border_t Border>
+struct Weights<FILTER_LINEAR, Border>
+{
+  static inline void apply(float x, int n, size_t step, bool fixed_point, size_t *ofs, float *w, size_t m)
+  {
+    x -= 0.5f;
+    int f = floorInt(x);
+    float a = x - f;
+    a = fixed_point ? (float)(int)(a * 256 + 0.5f) * (1.0f / 256) : a;
+    ofs[0] = Address<Border>::apply(f, n) * step;
+    ofs[m] = Address<Border>::apply(f + 1, n) * step;
+    w[0] = 1 - a;
+    w[m] = a;
+  }
+};
+
+template <border_t Border>
+struct Weights<FILTER_CUBIC, Border>
+{
+  static inline void apply(float x, int n, size_t step, bool, size_t *ofs, float *w, size_t m)
+  {
+    x -= 0.5f;
+    int f = floorInt(x);
+    float t = x - f, t2 = t * t, t3 = t2 * t;
+
+    for(int k = 0; k < 4; ++k)
+      ofs[k * m] = Address<Border>::apply(f - 1 + k, n) * step;
+
+    w[0] = -0.5f * t3 + t2 - 0.5f * t;
+    w[m] = 1.5f * t3 - 2.5f * t2 + 1;
+    w[2 * m] = -1.5f * t3 + 2 * t2 + 0.5f * t;
+    w[3 * m] = 0.5f * (t3 - t2);
+  }
+};
+
+}  // namespace Sampling
+
+
+/**
+   Texture-like sampling of host memory.
+   This computes the same values as texture fetches on the GPU with
+   cudaReadModeElementType, including the texel center convention, the
+   addressing modes (given as border_t) and the reduced precision of the
+   interpolation weights in linear filter mode (can be switched off by the
+   fixed_point flag). Cubic filtering has no hardware equivalent.
+   Batch sampling first computes the offsets and weights of a block of
+   samples dimension by dimension, these loops are vectorized by the
+   compiler; the elements are then gathered and blended.
+*/
+template <class Type, unsigned Dim>
+class Sampler
+{
+public:
+  /** filter mode */
+  filter_t filter;
+
+  /** addressing mode */
+  border_t border;
+
+  /** whether coordinates are normalized to the range [0, 1) */
+  bool normalized;
+
+  /** whether linear weights are quantized to 8 fractional bits */
+  bool fixed_point;
+
+  /**
+     Constructor.
+     The sampler refers to the given memory, which must persist.
+     @param mem host memory
+     @param _filter filter mode
+     @param _border addressing mode
+     @param _normalized whether coordinates are normalized
+  */
+  Sampler(const HostMemory<Type, Dim> &mem, filter_t _filter = FILTER_LINEAR, border_t _border = BORDER_CLAMP,
+	  bool _normalized = false):
+    filter(_filter), border(_border), normalized(_normalized), fixed_point(true)
+  {
+    init(mem);
+  }
+
+  /**
+     Constructor.
+     The sampler keeps a host copy of the array.
+     @param array CUDA array
+     @param _filter filter mode
+     @param _border addressing mode
+     @param _normalized whether coordinates are normalized
+  */
+  Sampler(const Array<Type, Dim> &array, filter_t _filter = FILTER_LINEAR, border_t _border = BORDER_CLAMP,
+	  bool _normalized = false):
+    filter(_filter), border(_border), normalized(_normalized), fixed_point(true),
+    m_copy(array.size)
+  {
+    copy(m_copy, array);
+    init(m_copy);
+  }
+
+  /**
+     Sample at given position.
+     @param coord coordinates (Dim values)
+  */
+  float operator()(const float *coord) const
+  {
+    float r;
+    const float *c[Dim];
+
+    for(unsigned d = Dim; d--;)
+      c[d] = coord + d;
+
+    sample<1>(&r, c, 1);
+    return r;
+  }
+
+  /**
+     Sample one-dimensional data.
+  */
+  inline float operator()(float x) const
+  {
+    CUDA_STATIC_ASSERT(Dim == 1);
+    return (*this)(&x);
+  }
+
+  /**
+     Sample two-dimensional data.
+  */
+  inline float operator()(float x, float y) const
+  {
+    CUDA_STATIC_ASSERT(Dim == 2);
+    float c[] = { x, y };
+    return (*this)(c);
+  }
+
+  /**
+     Sample three-dimensional data.
+  */
+  inline float operator()(float x, float y, float z) const
+  {
+    CUDA_STATIC_ASSERT(Dim == 3);
+    float c[] = { x, y, z };
+    return (*this)(c);
+  }
+
+  /**
+     Sample at many positions.
+     The blocks of samples are distributed among threads (if OpenMP is
+     enabled).
+     @param result n results
+     @param coord Dim arrays of n coordinates each
+     @param n number of samples
+  */
+  void operator()(float *result, const float *const coord[Dim], size_t n) const
+  {
+    const int blocks = (int)((n + CUDA_SAMPLER_BLOCK - 1) / CUDA_SAMPLER_BLOCK);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if(blocks > 16)
+#endif
+    for(int b = 0; b < blocks; ++b) {
+      size_t s0 = (size_t)b * CUDA_SAMPLER_BLOCK;
+      const float *c[Dim];
+
+      for(unsigned d = Dim; d--;)
+	c[d] = coord[d] + s0;
+
+      sample<CUDA_SAMPLER_BLOCK>(result + s0, c, (n - s0 < CUDA_SAMPLER_BLOCK) ? n - s0 : CUDA_SAMPLER_BLOCK);
+    }
+  }
+
+private:
+  const Type *m_data;
+  size_t m_size[Dim], m_step[Dim];
+  HostMemoryHeap<Type, Dim> m_copy;
+
+  // samplers may refer to their own copy of the data and are not copyable:
+  Sampler(const Sampler &);
+  Sampler &operator=(const Sampler &);
+
+  void init(const HostMemory<Type, Dim> &mem)
+  {
+    m_data = mem.getBuffer();
+
+    for(unsigned d = Dim; d--;) {
+      m_size[d] = mem.size[d];
+      m_step[d] = (d == 0) ? 1 : mem.stride[d - 1];
+    }
+  }
+
+  /**
+     Sample a block of at most N positions.
+  */
+  template <int N>
+  void sample(float *result, const float *const *coord, size_t n) const
+  {
+#define CUDA_SAMPLER_BORDER(F)						\
+    switch(border) {							\
+    case BORDER_MIRROR: sampleBlock<N, F, BORDER_MIRROR>(result, coord, n); break; \
+    case BORDER_REPEAT: sampleBlock<N, F, BORDER_REPEAT>(result, coord, n); break; \
+    default: sampleBlock<N, F, BORDER_CLAMP>(result, coord, n); break;	\
+    }
+
+    switch(filter) {
+    case FILTER_LINEAR: CUDA_SAMPLER_BORDER(FILTER_LINEAR); break;
+    case FILTER_CUBIC: CUDA_SAMPLER_BORDER(FILTER_CUBIC); break;
+    default: CUDA_SAMPLER_BORDER(FILTER_NEAREST); break;
+    }
+
+#undef CUDA_SAMPLER_BORDER
+  }
+
+  template <int N, filter_t Filter, border_t Border>
+  void sampleBlock(float *result, const float *const *coord, size_t n) const
+  {
+    enum { T = Sampling::Taps<Filter>::value };
+    size_t ofs[Dim][T][N];
+    float w[Dim][T][N], acc[N];
+
+    // offsets and weights per dimension:
+    for(unsigned d = 0; d < Dim; ++d) {
+      const float *c = coord[d];
+      const float scale = normalized ? (float)m_size[d] : 1.0f;
+      const int size = (int)m_size[d];
+      const size_t step = m_step[d];
+
+      for(size_t s = 0; s < n; ++s)
+	Sampling::Weights<Filter, Border>::apply(c[s] * scale, size, step, fixed_point, &ofs[d][0][s], &w[d][0][s], N);
+    }
+
+    for(size_t s = 0; s < n; ++s)
+      acc[s] = 0;
+
+    // gather and blend all T^Dim combinations of taps:
+    int combinations = 1;
+
+    for(unsigned d = Dim; d--;)
+      combinations *= T;
+
+    for(int t = 0; t < combinations; ++t) {
+      int k[Dim];
+
+      for(unsigned d = 0, u = t; d < Dim; ++d, u /= T)
+	k[d] = u % T;
+
+      for(size_t s = 0; s < n; ++s) {
+	size_t o = ofs[0][k[0]][s];
+	float v = w[0][k[0]][s];
+
+	for(unsigned d = 1; d < Dim; ++d) {
+	  o += ofs[d][k[d]][s];
+	  v *= w[d][k[d]][s];
+	}
+
+	acc[s] += v * (float)m_data[o];
+      }
+    }
+
+    for(size_t s = 0; s < n; ++s)
+      result[s] = acc[s];
+  }
+};
+
+}  // namespace Cuda
+
+
+#endif
@@ -301,10 +301,27 @@ class Spacing : public VectorBase<float, Dim>
 
 /**
    Generic size template.
+   This is used for more than three dimensions.
 */
 template <unsigned Dim>
 class Size: public SizeBase<Dim>
 {
+public:
+  /**
+     Default constructor.
+  */
+  Size() {}
+
+  /**
+     Copy constructor with type conversion.
+     @param v vector to be copied
+  */
+  template <class T>
+  Size(const VectorBase<T, Dim> &v)
+  {
+    for(unsigned i = Dim; i--;)
+      (*this)[i] = v[i];
+  }
 };
 
 /**
@@ -0,0 +1,127 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_STATICLAYOUT_H
+#define CUDA_STATICLAYOUT_H
+
+
+#include <cudatemplates/layout.hpp>
+#include <cudatemplates/staticassert.hpp>
+
+
+namespace Cuda {
+
+/**
+   Size known at compile time.
+   Up to four dimensions are supported, the number of dimensions is given by
+   the number of nonzero template arguments. The data is packed (there is no
+   padding), the strides follow the convention of Layout::stride.
+*/
+template <unsigned S0, unsigned S1 = 0, unsigned S2 = 0, unsigned S3 = 0>
+struct StaticSize
+{
+  CUDA_STATIC_ASSERT(S0 > 0);
+  CUDA_STATIC_ASSERT((S1 > 0) || ((S2 == 0) && (S3 == 0)));
+  CUDA_STATIC_ASSERT((S2 > 0) || (S3 == 0));
+
+  enum {
+    /** number of dimensions */
+    Dim = (S1 == 0) ? 1 : (S2 == 0) ? 2 : (S3 == 0) ? 3 : 4,
+
+    /** size in each dimension */
+    Size0 = S0,
+    Size1 = (S1 == 0) ? 1 : S1,
+    Size2 = (S2 == 0) ? 1 : S2,
+    Size3 = (S3 == 0) ? 1 : S3,
+
+    /** step of dimensions 1, 2 and 3 */
+    Stride0 = Size0,
+    Stride1 = Stride0 * Size1,
+    Stride2 = Stride1 * Size2,
+
+    /** total number of elements */
+    Count = Stride2 * Size3
+  };
+
+  /**
+     Get size as Size object.
+  */
+  static Size<Dim> size()
+  {
+    Size<Dim> s;
+    const size_t sz[] = { Size0, Size1, Size2, Size3 };
+
+    for(unsigned i = Dim; i--;)
+      s[i] = sz[i];
+
+    return s;
+  }
+
+  /**
+     Get offset for given index.
+     Since the strides are compile-time constants, the compiler can fold the
+     offset computation into the addressing of unrolled loops.
+  */
+  static __host__ __device__ inline size_t offset(size_t x, size_t y = 0, size_t z = 0, size_t w = 0)
+  {
+    return x + y * Stride0 + z * Stride1 + w * Stride2;
+  }
+};
+
+/**
+   Layout with size known at compile time.
+   This is a regular Layout (and can be used wherever a Layout is expected),
+   but additionally provides the size and strides as compile-time constants
+   through the Static type.
+   Note that the templated constructors of the memory classes take any object
+   as a source of data to be copied; use StaticLayout::Static::size() to
+   create dynamic memory of the same size.
+*/
+template <class Type, unsigned S0, unsigned S1 = 0, unsigned S2 = 0, unsigned S3 = 0>
+class StaticLayout: virtual public Layout<Type, StaticSize<S0, S1, S2, S3>::Dim>
+{
+public:
+  /** compile-time size */
+  typedef StaticSize<S0, S1, S2, S3> Static;
+
+  /**
+     Constructor.
+  */
+  StaticLayout():
+    Layout<Type, Static::Dim>(Static::size())
+  {
+  }
+
+  /**
+     Get offset for given index.
+     @param index index for which to compute offset
+     @return offset (in elements) for given index
+  */
+  inline size_t getOffset(const SizeBase<Static::Dim> &index) const
+  {
+    return Static::offset(index[0], (Static::Dim > 1) ? index[1 % Static::Dim] : 0,
+			  (Static::Dim > 2) ? index[2 % Static::Dim] : 0, (Static::Dim > 3) ? index[3 % Static::Dim] : 0);
+  }
+};
+
+}  // namespace Cuda
+
+
+#endif
@@ -0,0 +1,603 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUDA_VIEW_H
+#define CUDA_VIEW_H
+
+
+#include <cstring>
+
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememory.hpp>
+#include <cudatemplates/devicememorylinear.hpp>
+#include <cudatemplates/error.hpp>
+#include <cudatemplates/hostmemory.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/staticassert.hpp>
+
+
+/**
+   Number of threads per block of device copy kernels for views.
+*/
+#ifndef CUDA_VIEW_THREADS
+#define CUDA_VIEW_THREADS 256
+#endif
+
+
+namespace Cuda {
+
+/**
+   Location of memory referenced by a view.
+*/
+typedef enum {
+  MEMORY_HOST,   /**< host memory */
+  MEMORY_DEVICE  /**< device memory */
+} memory_t;
+
+/**
+   View of host or device memory with arbitrary strides.
+   A view refers to existing memory (it doesn't own or copy any data) and
+   describes its elements by a pointer to the first element and a step (in
+   elements, possibly negative or zero) per dimension. Unlike Layout, where
+   the elements of dimension 0 are always consecutive, this makes it possible
+   to describe regions of interest, flipped and permuted axes, subsampled
+   data and single channels of interleaved data without copying. Views are
+   plain values and can be passed to kernels.
+   Since a view behaves like a pointer, a constant view still allows to
+   modify the data it refers to.
+*/
+template <class Type, unsigned Dim>
+class View
+{
+  CUDA_STATIC_ASSERT(Dim > 0);
+
+public:
+  /** location of the data */
+  memory_t location;
+
+  /** pointer to first element */
+  Type *data;
+
+  /** number of elements in each dimension */
+  size_t size[Dim];
+
+  /** step between consecutive elements in each dimension (in elements) */
+  ssize_t step[Dim];
+
+  /**
+     Default constructor.
+  */
+  View():
+    location(MEMORY_HOST), data(0)
+  {
+    for(unsigned i = Dim; i--;) {
+      size[i] = 0;
+      step[i] = 0;
+    }
+  }
+
+  /**
+     Constructor.
+     @param _location location of the data
+     @param _data pointer to first element
+     @param _size number of elements in each dimension
+     @param _step step in each dimension
+  */
+  View(memory_t _location, Type *_data, const Size<Dim> &_size, const ssize_t *_step):
+    location(_location), data(_data)
+  {
+    for(unsigned i = Dim; i--;) {
+      size[i] = _size[i];
+      step[i] = _step[i];
+    }
+  }
+
+  /**
+     Constructor.
+     Creates a view of host memory.
+     @param mem host memory
+     @param roi if true, the view is restricted to the region of interest of
+     the memory layout
+  */
+  View(const HostMemory<Type, Dim> &mem, bool roi = false):
+    location(MEMORY_HOST)
+  {
+    init(mem, const_cast<Type *>(mem.getBuffer()), roi);
+  }
+
+  /**
+     Constructor.
+     Creates a view of device memory.
+     @param mem device memory
+     @param roi if true, the view is restricted to the region of interest of
+     the memory layout
+  */
+  View(const DeviceMemory<Type, Dim> &mem, bool roi = false):
+    location(MEMORY_DEVICE)
+  {
+    init(mem, const_cast<Type *>(mem.getBuffer()), roi);
+  }
+
+  /**
+     Get number of elements.
+  */
+  size_t getNumElements() const
+  {
+    size_t n = 1;
+
+    for(unsigned i = Dim; i--;)
+      n *= size[i];
+
+    return n;
+  }
+
+  /**
+     Get offset for given index.
+     @param index index for which to compute offset
+     @return offset (in elements) relative to the first element
+  */
+  ssize_t getOffset(const SizeBase<Dim> &index) const
+  {
+    ssize_t o = 0;
+
+    for(unsigned i = Dim; i--;)
+      o += (ssize_t)index[i] * step[i];
+
+    return o;
+  }
+
+  /**
+     Array index operator (host memory only).
+     @param i index
+     @return value at index i
+  */
+  inline Type &operator[](const SizeBase<Dim> &i) const { return data[getOffset(i)]; }
+
+  /**
+     Restrict view to a region.
+     @param ofs offset of region
+     @param _size size of region
+  */
+  View region(const Size<Dim> &ofs, const Size<Dim> &_size) const
+  {
+    View v(*this);
+
+    for(unsigned i = Dim; i--;) {
+      if(ofs[i] + _size[i] > size[i])
+	CUDA_ERROR("out of bounds");
+
+      v.size[i] = _size[i];
+    }
+
+    if(v.getNumElements() > 0)
+      v.data += getOffset(ofs);
+
+    return v;
+  }
+
+  /**
+     Reverse order of elements in given dimension.
+     @param d dimension
+  */
+  View flip(unsigned d) const
+  {
+    View v(*this);
+
+    if(size[d] > 0) {
+      v.data += (ssize_t)(size[d] - 1) * step[d];
+      v.step[d] = -step[d];
+    }
+
+    return v;
+  }
+
+  /**
+     Take every k-th element in given dimension.
+     @param d dimension
+     @param k step
+     @param ofs index of first element
+  */
+  View subsample(unsigned d, size_t k, size_t ofs = 0) const
+  {
+    if((k == 0) || (ofs > size[d]))
+      CUDA_ERROR("invalid subsampling");
+
+    View v(*this);
+    v.size[d] = (size[d] - ofs + k - 1) / k;
+    v.step[d] = step[d] * (ssize_t)k;
+
+    if(v.size[d] > 0)
+      v.data += (ssize_t)ofs * step[d];
+
+    return v;
+  }
+
+  /**
+     Permute axes.
+     Dimension i of the resulting view is dimension axes[i] of this view.
+     @param axes permutation of 0 ... Dim - 1
+  */
+  View permute(const unsigned *axes) const
+  {
+    View v(*this);
+    unsigned used = 0;
+
+    for(unsigned i = Dim; i--;) {
+      if((axes[i] >= Dim) || (used & (1 << axes[i])))
+	CUDA_ERROR("invalid permutation");
+
+      used |= 1 << axes[i];
+      v.size[i] = size[axes[i]];
+      v.step[i] = step[axes[i]];
+    }
+
+    return v;
+  }
+
+  /**
+     Swap dimensions 0 and 1.
+  */
+  View transpose() const
+  {
+    CUDA_STATIC_ASSERT(Dim >= 2);
+    View v(*this);
+    v.size[0] = size[1];
+    v.size[1] = size[0];
+    v.step[0] = step[1];
+    v.step[1] = step[0];
+    return v;
+  }
+
+  /**
+     Get view with one dimension removed.
+     @param d dimension to be removed
+     @param i index in dimension d
+  */
+  View<Type, Dim - 1> slice(unsigned d, size_t i) const
+  {
+    CUDA_STATIC_ASSERT(Dim >= 2);
+
+    if(i >= size[d])
+      CUDA_ERROR("out of bounds");
+
+    View<Type, Dim - 1> v;
+    v.location = location;
+    v.data = data + (ssize_t)i * step[d];
+
+    for(unsigned j = 0, k = 0; j < Dim; ++j)
+      if(j != d) {
+	v.size[k] = size[j];
+	v.step[k++] = step[j];
+      }
+
+    return v;
+  }
+
+  /**
+     Get view of a single channel of interleaved data.
+     For example, the channels of a View<uchar4, Dim> are available as
+     View<unsigned char, Dim>.
+     @param c channel index
+  */
+  template <class Scalar>
+  View<Scalar, Dim> channel(unsigned c) const
+  {
+    CUDA_STATIC_ASSERT(sizeof(Type) % sizeof(Scalar) == 0);
+
+    if(c >= sizeof(Type) / sizeof(Scalar))
+      CUDA_ERROR("invalid channel");
+
+    View<Scalar, Dim> v;
+    v.location = location;
+    v.data = reinterpret_cast<Scalar *>(data) + c;
+
+    for(unsigned i = Dim; i--;) {
+      v.size[i] = size[i];
+      v.step[i] = step[i] * (ssize_t)(sizeof(Type) / sizeof(Scalar));
+    }
+
+    return v;
+  }
+
+private:
+  void init(const Layout<Type, Dim> &layout, Type *buffer, bool roi)
+  {
+    data = buffer;
+
+    for(unsigned i = Dim; i--;) {
+      size[i] = layout.size[i];
+      step[i] = (i == 0) ? 1 : layout.stride[i - 1];
+    }
+
+    if(roi)
+      *this = region(layout.region_ofs, layout.region_size);
+  }
+};
+
+namespace Striding {
+
+/**
+   Check if views have the same size.
+*/
+template <class Type1, class Type2, unsigned Dim>
+void checkSize(const View<Type1, Dim> &dst, const View<Type2, Dim> &src)
+{
+  for(unsigned i = Dim; i--;)
+    if(dst.size[i] != src.size[i])
+      CUDA_ERROR("size mismatch");
+}
+
+/**
+   Direction of copy between views.
+*/
+inline cudaMemcpyKind kind(memory_t dst, memory_t src)
+{
+  if(dst == MEMORY_HOST)
+    return (src == MEMORY_HOST) ? cudaMemcpyHostToHost : cudaMemcpyDeviceToHost;
+
+  return (src == MEMORY_HOST) ? cudaMemcpyHostToDevice : cudaMemcpyDeviceToDevice;
+}
+
+/**
+   Check if view can be copied to or from contiguous memory by memcpy calls.
+*/
+template <class Type, unsigned Dim>
+bool rows(const View<Type, Dim> &v)
+{
+  for(unsigned i = Dim; i--;)
+    if((v.size[i] > 1) && ((i == 0) ? (v.step[i] != 1) : (v.step[i] <= 0)))
+      return false;
+
+  return true;
+}
+
+/**
+   Copy or convert views of host memory.
+   The rows (dimension 0) are distributed among threads (if OpenMP is
+   enabled). Rows of consecutive elements are copied by plain loops, which
+   are vectorized (or replaced by memcpy) by the compiler.
+*/
+template <class Type1, class Type2, unsigned Dim>
+void host(const View<Type1, Dim> &dst, const View<Type2, Dim> &src)
+{
+  checkSize(dst, src);
+  const size_t n = dst.size[0];
+  const ssize_t dstep = dst.step[0], sstep = src.step[0];
+  size_t rows = 1;
+
+  for(unsigned i = 1; i < Dim; ++i)
+    rows *= dst.size[i];
+
+  if((n == 0) || (rows == 0))
+    return;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if(n * rows > 65536)
+#endif
+  for(ssize_t r = 0; r < (ssize_t)rows; ++r) {
+    ssize_t dofs = 0, sofs = 0;
+
+    size_t q = r;
+
+    for(unsigned i = 1; i < Dim; q /= dst.size[i++]) {
+      ssize_t k = q % dst.size[i];
+      dofs += k * dst.step[i];
+      sofs += k * src.step[i];
+    }
+
+    Type1 *d = dst.data + dofs;
+    const Type2 *s = src.data + sofs;
+
+    if((dstep == 1) && (sstep == 1)) {
+      for(size_t x = 0; x < n; ++x)
+	d[x] = s[x];
+    }
+    else {
+      for(size_t x = 0; x < n; ++x)
+	d[x * dstep] = s[x * sstep];
+    }
+  }
+}
+
+#ifdef __CUDACC__
+
+/**
+   Copy or convert views of device memory, one element per thread.
+*/
+template <class Type1, class Type2, unsigned Dim>
+__global__ void view_kernel(View<Type1, Dim> dst, View<Type2, Dim> src, size_t count)
+{
+  for(size_t i = threadIdx.x + blockIdx.x * blockDim.x; i < count; i += blockDim.x * gridDim.x) {
+    ssize_t dofs = 0, sofs = 0;
+    size_t q = i;
+
+    for(unsigned d = 0; d < Dim; ++d) {
+      ssize_t k = q % dst.size[d];
+      q /= dst.size[d];
+      dofs += k * dst.step[d];
+      sofs += k * src.step[d];
+    }
+
+    dst.data[dofs] = src.data[sofs];
+  }
+}
+
+template <class Type1, class Type2, unsigned Dim>
+void device(const View<Type1, Dim> &dst, const View<Type2, Dim> &src)
+{
+  checkSize(dst, src);
+  size_t count = dst.getNumElements();
+
+  if(count == 0)
+    return;
+
+  size_t blocks = (count + CUDA_VIEW_THREADS - 1) / CUDA_VIEW_THREADS;
+
+  if(blocks > 65535)
+    blocks = 65535;
+
+  view_kernel<<<blocks, CUDA_VIEW_THREADS>>>(dst, src, count);
+  CUDA_CHECK(cudaGetLastError());
+}
+
+#endif  // __CUDACC__
+
+}  // namespace Striding
+
+
+/**
+   Copy views of host and/or device memory.
+   If the elements of dimension 0 are consecutive in both views, the data is
+   copied by as few memcpy calls as possible (see Transfer::Plan). Otherwise,
+   views of host memory are copied element by element or staged through a
+   contiguous host buffer, views of device memory are copied by a kernel,
+   which is only available if the calling file is compiled by nvcc.
+   @param dst destination view
+   @param src source view
+*/
+template<class Type, unsigned Dim>
+void
+copy(const View<Type, Dim> &dst, const View<Type, Dim> &src)
+{
+  Striding::checkSize(dst, src);
+  Transfer::Plan<Dim> plan(sizeof(Type), dst.size, dst.step, src.step);
+
+  if(plan.valid) {
+    plan.execute(dst.data, src.data, Striding::kind(dst.location, src.location));
+    return;
+  }
+
+  if((dst.location == MEMORY_HOST) && (src.location == MEMORY_HOST)) {
+    Striding::host(dst, src);
+    return;
+  }
+
+  Size<Dim> size;
+
+  for(unsigned i = Dim; i--;)
+    size[i] = dst.size[i];
+
+  if((dst.location == MEMORY_HOST) && Striding::rows(src)) {
+    HostMemoryHeap<Type, Dim> tmp(size);
+    copy(View<Type, Dim>(tmp), src);
+    Striding::host(dst, View<Type, Dim>(tmp));
+  }
+  else if((src.location == MEMORY_HOST) && Striding::rows(dst)) {
+    HostMemoryHeap<Type, Dim> tmp(size);
+    Striding::host(View<Type, Dim>(tmp), src);
+    copy(dst, View<Type, Dim>(tmp));
+  }
+  else {
+#ifdef __CUDACC__
+    if(dst.location == MEMORY_HOST) {
+      DeviceMemoryLinear<Type, Dim> tmp(size);
+      Striding::device(View<Type, Dim>(tmp), src);
+      copy(dst, View<Type, Dim>(tmp));
+    }
+    else if(src.location == MEMORY_HOST) {
+      DeviceMemoryLinear<Type, Dim> tmp(size);
+      copy(View<Type, Dim>(tmp), src);
+      Striding::device(dst, View<Type, Dim>(tmp));
+    }
+    else
+      Striding::device(dst, src);
+#else
+    CUDA_ERROR("strided views of device memory can only be copied in code compiled by nvcc");
+#endif
+  }
+}
+
+/**
+   Convert views of host memory or views of device memory.
+   The element types are converted by assignment. Conversion of views of
+   device memory calls a kernel and is only available if the calling file is
+   compiled by nvcc.
+   @param dst destination view
+   @param src source view
+*/
+template<class Type1, class Type2, unsigned Dim>
+void
+copy(const View<Type1, Dim> &dst, const View<Type2, Dim> &src)
+{
+  if((dst.location == MEMORY_HOST) && (src.location == MEMORY_HOST))
+    Striding::host(dst, src);
+  else if((dst.location == MEMORY_DEVICE) && (src.location == MEMORY_DEVICE)) {
+#ifdef __CUDACC__
+    Striding::device(dst, src);
+#else
+    CUDA_ERROR("views of device memory can only be converted in code compiled by nvcc");
+#endif
+  }
+  else
+    CUDA_ERROR("conversion between host and device memory not supported");
+}
+
+/**
+   Copy or convert view to host memory.
+   @param dst destination pointer (host memory)
+   @param src source view
+*/
+template<class Type1, class Type2, unsigned Dim>
+void
+copy(HostMemory<Type1, Dim> &dst, const View<Type2, Dim> &src)
+{
+  copy(View<Type1, Dim>(dst), src);
+}
+
+/**
+   Copy or convert view to device memory.
+   @param dst destination pointer (device memory)
+   @param src source view
+*/
+template<class Type1, class Type2, unsigned Dim>
+void
+copy(DeviceMemory<Type1, Dim> &dst, const View<Type2, Dim> &src)
+{
+  copy(View<Type1, Dim>(dst), src);
+}
+
+/**
+   Copy or convert host memory to view.
+   @param dst destination view
+   @param src source pointer (host memory)
+*/
+template<class Type1, class Type2, unsigned Dim>
+void
+copy(const View<Type1, Dim> &dst, const HostMemory<Type2, Dim> &src)
+{
+  copy(dst, View<Type2, Dim>(src));
+}
+
+/**
+   Copy or convert device memory to view.
+   @param dst destination view
+   @param src source pointer (device memory)
+*/
+template<class Type1, class Type2, unsigned Dim>
+void
+copy(const View<Type1, Dim> &dst, const DeviceMemory<Type2, Dim> &src)
+{
+  copy(dst, View<Type2, Dim>(src));
+}
+
+}  // namespace Cuda
+
+
+#endif
@@ -0,0 +1,174 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+
+#include <cudatemplates/batch.hpp>
+#include <cudatemplates/batchcopy.hpp>
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememorypitched.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+
+using namespace std;
+
+
+typedef Cuda::Batch<float, 2, Cuda::HostMemoryHeap<float, 3> > HostBatch;
+typedef Cuda::Batch<float, 2> DeviceBatch;
+
+const size_t WIDTH  = 37;  // item width (not a multiple of the alignment)
+const size_t HEIGHT = 20;  // item height
+const size_t FRAMES = 50;  // number of simulated frames
+
+
+/**
+   Fill item with values depending on item index.
+*/
+void
+fill(HostBatch &batch, size_t i)
+{
+  Cuda::View<float, 2> v = batch[i];
+
+  for(size_t y = 0; y < HEIGHT; ++y)
+    for(size_t x = 0; x < WIDTH; ++x)
+      v.data[x * v.step[0] + y * v.step[1]] = i * 1000 + y * WIDTH + x;
+}
+
+/**
+   Check item contents.
+*/
+bool
+verify(HostBatch &batch, size_t i, size_t value)
+{
+  Cuda::View<float, 2> v = batch[i];
+
+  for(size_t y = 0; y < HEIGHT; ++y)
+    for(size_t x = 0; x < WIDTH; ++x)
+      if(v.data[x * v.step[0] + y * v.step[1]] != value * 1000 + y * WIDTH + x)
+	return false;
+
+  return true;
+}
+
+int
+main()
+{
+  try {
+    Cuda::Size<2> size(WIDTH, HEIGHT);
+
+    // growth within capacity doesn't reallocate:
+    HostBatch batch(size, 0, 4);
+    const float *buffer = batch.getStorage().getBuffer();
+
+    for(size_t i = 0; i < 4; ++i)
+      fill(batch, batch.acquire());
+
+    if((batch.getCount() != 4) || (batch.getStorage().getBuffer() != buffer)) {
+      cerr << "unexpected reallocation\n";
+      return 1;
+    }
+
+    // growth beyond capacity doubles the capacity and preserves items:
+    fill(batch, batch.acquire());
+
+    if(batch.getCapacity() != 8) {
+      cerr << "unexpected capacity " << batch.getCapacity() << endl;
+      return 1;
+    }
+
+    for(size_t i = 0; i < 5; ++i) {
+      if(!verify(batch, i, i)) {
+	cerr << "item " << i << " not preserved\n";
+	return 1;
+      }
+    }
+
+    // released slots are recycled across frames:
+    size_t reallocations = 0;
+    buffer = batch.getStorage().getBuffer();
+
+    for(size_t f = 0; f < FRAMES; ++f) {
+      batch.release(f % 5);
+      batch.release((f + 2) % 5);
+      batch.acquire();
+      batch.acquire();
+
+      if(batch.getStorage().getBuffer() != buffer)
+	++reallocations;
+    }
+
+    if((batch.getCount() != 5) || (batch.getFree() != 0) || (reallocations != 0)) {
+      cerr << "free list failed\n";
+      return 1;
+    }
+
+    // device batch has items aligned like the rows of pitched memory:
+    DeviceBatch batch_d(size, 5);
+    size_t pitch = batch_d.getStorage().stride[0] * sizeof(float);
+    cout << "device row pitch: " << pitch << " bytes, item pitch: "
+	 << batch_d.getStorage().stride[1] * sizeof(float) << " bytes\n";
+
+    for(size_t i = 0; i < batch_d.getCount(); ++i) {
+      if((size_t)(batch_d.getItemBuffer(i) - batch_d.getItemBuffer(0)) * sizeof(float) % pitch != 0) {
+	cerr << "item " << i << " not aligned\n";
+	return 1;
+      }
+    }
+
+    // batched copy between batches:
+    HostBatch batch2(size, 5);
+    Cuda::Batching::Queue<float, float, 2> queue(Cuda::MEMORY_HOST);
+    queue.add(batch2, batch);
+    queue.execute();
+
+    for(size_t i = 0; i < 5; ++i) {
+      if(!verify(batch2, i, i)) {
+	cerr << "batched copy of item " << i << " failed\n";
+	return 1;
+      }
+    }
+
+    // host -> device -> host via storage:
+    HostBatch batch3(size, 5);
+    copy(batch_d.getStorage(), batch.getStorage(), Cuda::Size<3>(), Cuda::Size<3>(), Cuda::Size<3>(WIDTH, HEIGHT, 5));
+    copy(batch3.getStorage(), batch_d.getStorage(), Cuda::Size<3>(), Cuda::Size<3>(), Cuda::Size<3>(WIDTH, HEIGHT, 5));
+
+    for(size_t i = 0; i < 5; ++i) {
+      if(!verify(batch3, i, i)) {
+	cerr << "device round trip of item " << i << " failed\n";
+	return 1;
+      }
+    }
+
+    // shrinking keeps the capacity:
+    batch.resize(2);
+
+    if((batch.getCapacity() != 8) || (batch.getStorage().getBuffer() != buffer)) {
+      cerr << "shrinking reallocated\n";
+      return 1;
+    }
+  }
+  catch(const exception &e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  cout << "batch test passed\n";
+  return 0;
+}
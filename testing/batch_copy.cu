@@ -0,0 +1,122 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/time.h>
+
+#include <iostream>
+
+#include <cudatemplates/batchcopy.hpp>
+#include <cudatemplates/convert.hpp>
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememorypitched.hpp>
+#include <cudatemplates/devicememoryreference.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+
+using namespace std;
+
+
+const int SIZE    = 2048;  // size of source image
+const int PATCH   =   32;  // size of patches
+const int PATCHES = 4096;  // number of patches
+
+
+double
+operator-(const struct timeval &t1, const struct timeval &t2)
+{
+  return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
+}
+
+/**
+   Get offset of patch in source image.
+*/
+inline Cuda::Size<2>
+offset(int i)
+{
+  return Cuda::Size<2>((i * 193) % (SIZE - PATCH), (i * 311) % (SIZE - PATCH));
+}
+
+/**
+   Check stack of patches.
+*/
+template <class Type>
+bool
+check(const Cuda::HostMemory<Type, 3> &stack, const Cuda::HostMemory<unsigned char, 2> &image, const char *name)
+{
+  for(int i = 0; i < PATCHES; ++i) {
+    Cuda::Size<2> ofs = offset(i);
+
+    for(int y = 0; y < PATCH; ++y)
+      for(int x = 0; x < PATCH; ++x)
+	if(stack[Cuda::Size<3>(x, y, i)] != (Type)image[Cuda::Size<2>(ofs[0] + x, ofs[1] + y)]) {
+	  cerr << name << " failed\n";
+	  return false;
+	}
+  }
+
+  return true;
+}
+
+int
+main()
+{
+  int err = 0;
+  Cuda::HostMemoryHeap2D<unsigned char> image(SIZE, SIZE);
+
+  for(int i = SIZE * SIZE; i--;)
+    image.getBuffer()[i] = i * 7 + i / 13;
+
+  const Cuda::Size<2> patch(PATCH, PATCH);
+  Cuda::Size<3> stack_size(PATCH, PATCH, PATCHES);
+  struct timeval t0, t1;
+
+  // device, one call per patch:
+  Cuda::DeviceMemoryPitched2D<unsigned char> dimage(image);
+  Cuda::DeviceMemoryPitched3D<unsigned char> dstack(stack_size);
+  Cuda::Layout<unsigned char, 2> slice_layout(patch);
+  slice_layout.setPitch(dstack.stride[0] * sizeof(unsigned char));
+  gettimeofday(&t0, 0);
+
+  for(int i = 0; i < PATCHES; ++i) {
+    Cuda::DeviceMemoryReference2D<unsigned char> slice(slice_layout, dstack.getBuffer() + i * dstack.stride[1]);
+    Cuda::copy(slice, dimage, Cuda::Size<2>(), offset(i), patch);
+  }
+
+  cudaThreadSynchronize();
+  gettimeofday(&t1, 0);
+  double single = (t1 - t0) * 1000;
+
+  // device, batch:
+  Cuda::Batching::Queue<unsigned char, unsigned char, 2> dqueue(Cuda::MEMORY_DEVICE);
+
+  for(int i = 0; i < PATCHES; ++i)
+    dqueue.add(Cuda::Batching::Item<unsigned char, 2>(dstack, i),
+	       Cuda::Batching::Item<unsigned char, 2>(dimage, offset(i), patch));
+
+  dqueue.execute();  // includes upload of descriptors
+  dqueue.execute();
+  Cuda::HostMemoryHeap3D<unsigned char> hstack(dstack);
+
+  if(!check(hstack, image, "device batch copy"))
+    err = 1;
+
+  cout << "device copy of " << PATCHES << " patches: one call per patch " << single << " ms, batch "
+       << dqueue.getElapsedTime() << " ms\n";
+  return err;
+}
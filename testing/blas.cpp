@@ -20,12 +20,14 @@
 
 #include <sys/time.h>
 
+#include <cmath>
 #include <cstdlib>
 #include <iostream>
 
 #include <cudatemplates/copy.hpp>
 #include <cudatemplates/cublas.hpp>
 #include <cudatemplates/devicememorylinear.hpp>
+#include <cudatemplates/devicememorypitched.hpp>
 #include <cudatemplates/hostmemoryheap.hpp>
 
 using namespace std;
@@ -34,6 +36,8 @@ using namespace std;
 const int   SIZE    =   1024;  // image size
 const int   COUNT   = 100000;  // number of FFTs to perform
 const float EPSILON =   1e-6;  // error threshold
+const int   ROWS    =    150;  // matrix size for reference tests
+const int   COLS    =     77;
 
 
 double
@@ -42,6 +46,97 @@ operator-(const struct timeval &t1, const struct timeval &t2)
   return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
 }
 
+/**
+   Check vectors and matrices referring to pitched device memory.
+   The first dimension of the memory is the matrix row index, so column x of
+   the memory is a matrix row and row y of the memory is a matrix column.
+*/
+bool
+check_references()
+{
+  Cuda::Size<2> size(ROWS, COLS);
+  Cuda::HostMemoryHeap<float, 2> h0(size), h1(size);
+  Cuda::DeviceMemoryPitched<float, 2> mem(size);
+
+  for(int i = ROWS * COLS; i--;)
+    h0.getBuffer()[i] = (float)rand() / RAND_MAX - 0.5f;
+
+  Cuda::copy(mem, h0);
+  Cuda::BLAS::MatrixReference<float> A(mem);
+  const size_t ld = mem.stride[0];
+
+  if((A.getHeight() != (unsigned)ROWS) || (A.getWidth() != (unsigned)COLS) || (A.getLd() != ld) ||
+     (&A(3, 5) != mem.getBuffer() + 3 + 5 * ld)) {
+    cerr << "MatrixReference has wrong layout\n";
+    return false;
+  }
+
+  // dot products of rows and columns:
+  const int x0 = 7, y0 = 11;
+  Cuda::BLAS::VectorReference<float> r = Cuda::BLAS::row(mem, y0), c = Cuda::BLAS::column(mem, x0);
+  double rr = 0, cc = 0;
+
+  for(int x = 0; x < ROWS; ++x)
+    rr += (double)h0[Cuda::Size<2>(x, y0)] * h0[Cuda::Size<2>(x, y0)];
+
+  for(int y = 0; y < COLS; ++y)
+    cc += (double)h0[Cuda::Size<2>(x0, y)] * h0[Cuda::Size<2>(x0, y)];
+
+  if((fabs(Cuda::BLAS::dot(r, r) - rr) > 1e-4 * rr) || (fabs(Cuda::BLAS::dot(c, c) - cc) > 1e-4 * cc)) {
+    cerr << "row/column dot test failed\n";
+    return false;
+  }
+
+  // y = A * x with x referring to a column of the memory (strided by the pitch):
+  Cuda::BLAS::Vector<float> y(ROWS);
+  Cuda::BLAS::gemv('n', 1.0f, A, c, 0.0f, y);
+  float hy[ROWS];
+  y.getValues(hy);
+
+  for(int i = 0; i < ROWS; ++i) {
+    double g = 0, a = 0;
+
+    for(int j = 0; j < COLS; ++j) {
+      g += (double)h0[Cuda::Size<2>(i, j)] * h0[Cuda::Size<2>(x0, j)];
+      a += fabs((double)h0[Cuda::Size<2>(i, j)] * h0[Cuda::Size<2>(x0, j)]);
+    }
+
+    if(fabs(hy[i] - g) > 1e-4 * (a + 1)) {
+      cerr << "gemv with references failed at " << i << endl;
+      return false;
+    }
+  }
+
+  // axpy into a row must only change that row:
+  Cuda::BLAS::axpy(2.0f, Cuda::BLAS::row(mem, 0), r);
+  Cuda::copy(h1, mem);
+
+  for(int j = 0; j < COLS; ++j)
+    for(int i = 0; i < ROWS; ++i) {
+      Cuda::Size<2> p(i, j);
+      float e = (j == y0) ? h0[p] + 2.0f * h0[Cuda::Size<2>(i, 0)] : h0[p];
+
+      if(fabs(h1[p] - e) > 1e-5) {
+	cerr << "axpy with row reference failed at (" << i << ", " << j << ")\n";
+	return false;
+      }
+    }
+
+  // getValues/setValues pack and unpack the pitch:
+  A.setValues(h0.getBuffer());
+  A.getValues(h1.getBuffer());
+  Cuda::HostMemoryHeap<float, 2> h2(size);
+  Cuda::copy(h2, mem);
+
+  for(int i = ROWS * COLS; i--;)
+    if((h1.getBuffer()[i] != h0.getBuffer()[i]) || (h2.getBuffer()[i] != h0.getBuffer()[i])) {
+      cerr << "setValues/getValues of MatrixReference failed\n";
+      return false;
+    }
+
+  return true;
+}
+
 int
 main()
 {
@@ -68,5 +163,5 @@ main()
   Cuda::BLAS::axpy(ca, cx, cy);
   // Cuda::BLAS::gemv(ca, cm, cx, ca, cy);  // not yet implemented by NVIDIA
 
-  return 0;
+  return check_references() ? 0 : 1;
 }
@@ -0,0 +1,298 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/time.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include <cudatemplates/batchblas.hpp>
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/cublas.hpp>
+#include <cudatemplates/devicememorylinear.hpp>
+#include <cudatemplates/hostblas.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+
+using namespace std;
+
+
+const int   COUNT   = 100000;  // number of matrices
+const int   LOOP    =   1000;  // number of matrices for the looping variants
+const int   CHECK   =    500;  // number of matrices for checking transposed variants
+const float EPSILON =   1e-4;  // error threshold
+
+
+double
+operator-(const struct timeval &t1, const struct timeval &t2)
+{
+  return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
+}
+
+template <int N>
+int
+test()
+{
+  int err = 0;
+  Cuda::HostMemoryHeap3D<float> hA(N, N, COUNT), hB(N, N, COUNT), hC(N, N, COUNT);
+  Cuda::HostMemoryHeap2D<float> hx(N, COUNT);
+
+  for(int i = N * N * COUNT; i--;) {
+    hA.getBuffer()[i] = (float)rand() / RAND_MAX;
+    hB.getBuffer()[i] = (float)rand() / RAND_MAX;
+  }
+
+  // make A well-conditioned for trsv:
+  for(int l = 0; l < COUNT; ++l)
+    for(int i = 0; i < N; ++i)
+      hA.getBuffer()[i * (N + 1) + l * N * N] += N;
+
+  for(int i = N * COUNT; i--;)
+    hx.getBuffer()[i] = (float)rand() / RAND_MAX;
+
+  Cuda::DeviceMemoryLinear3D<float> dA(hA), dB(hB), dC(N, N, COUNT);
+  Cuda::DeviceMemoryLinear2D<float> dx(hx);
+  struct timeval t0, t1;
+
+  // batched, host:
+  gettimeofday(&t0, 0);
+  Cuda::BLAS::gemmBatched('n', 'n', 1.0f, hA, hB, 0.0f, hC);
+  gettimeofday(&t1, 0);
+  double t_host = (t1 - t0) / COUNT;
+
+  // looping over the host BLAS wrappers:
+  Cuda::HostMemoryHeap3D<float> hC_loop(N, N, LOOP);
+  gettimeofday(&t0, 0);
+
+  for(int l = 0; l < LOOP; ++l) {
+    Cuda::BLAS::Host::MatrixReference<float>
+      A(hA.getBuffer() + l * N * N, N, N, N),
+      B(hB.getBuffer() + l * N * N, N, N, N),
+      C(hC_loop.getBuffer() + l * N * N, N, N, N);
+    Cuda::BLAS::Host::gemm('n', 'n', 1.0f, A, B, 0.0f, C);
+  }
+
+  gettimeofday(&t1, 0);
+  double t_host_loop = (t1 - t0) / LOOP;
+
+  // the batched host result must match the host BLAS:
+  for(int i = N * N * LOOP; i--;)
+    if(fabs(hC.getBuffer()[i] - hC_loop.getBuffer()[i]) > EPSILON * N) {
+      cerr << "gemmBatched host test failed (N = " << N << ")\n";
+      err = 1;
+      break;
+    }
+
+  // batched, device:
+  cudaThreadSynchronize();
+  gettimeofday(&t0, 0);
+  Cuda::BLAS::gemmBatched('n', 'n', 1.0f, dA, dB, 0.0f, dC);
+  cudaThreadSynchronize();
+  gettimeofday(&t1, 0);
+  double t_device = (t1 - t0) / COUNT;
+
+  // compare with host result:
+  Cuda::HostMemoryHeap3D<float> hC2(N, N, COUNT);
+  Cuda::copy(hC2, dC);
+
+  for(int i = N * N * COUNT; i--;)
+    if(fabs(hC.getBuffer()[i] - hC2.getBuffer()[i]) > EPSILON * N) {
+      cerr << "gemmBatched test failed (N = " << N << ")\n";
+      err = 1;
+      break;
+    }
+
+  // looping over the CUBLAS wrappers:
+  gettimeofday(&t0, 0);
+
+  for(int l = 0; l < LOOP; ++l) {
+    Cuda::BLAS::MatrixReference<float>
+      A(dA.getBuffer() + l * N * N, N, N, N),
+      B(dB.getBuffer() + l * N * N, N, N, N),
+      C(dC.getBuffer() + l * N * N, N, N, N);
+    Cuda::BLAS::gemm('n', 'n', 1.0f, A, B, 0.0f, C);
+  }
+
+  cudaThreadSynchronize();
+  gettimeofday(&t1, 0);
+  double t_device_loop = (t1 - t0) / LOOP;
+
+  cout << N << "x" << N << " gemm [ns/matrix]: host " << t_host * 1e9
+       << " (loop " << t_host_loop * 1e9 << "), device " << t_device * 1e9
+       << " (loop " << t_device_loop * 1e9 << ")\n";
+
+  // gemv and trsv, batched only:
+  Cuda::HostMemoryHeap2D<float> hy(N, COUNT);
+  Cuda::DeviceMemoryLinear2D<float> dy(N, COUNT);
+  gettimeofday(&t0, 0);
+  Cuda::BLAS::gemvBatched('n', 1.0f, hA, hx, 0.0f, hy);
+  gettimeofday(&t1, 0);
+  t_host = (t1 - t0) / COUNT;
+  cudaThreadSynchronize();
+  gettimeofday(&t0, 0);
+  Cuda::BLAS::gemvBatched('n', 1.0f, dA, dx, 0.0f, dy);
+  cudaThreadSynchronize();
+  gettimeofday(&t1, 0);
+  t_device = (t1 - t0) / COUNT;
+  cout << N << "x" << N << " gemv [ns/matrix]: host " << t_host * 1e9 << ", device " << t_device * 1e9 << endl;
+
+  // compare with straightforward implementation:
+  Cuda::HostMemoryHeap2D<float> hy_dev(dy);
+
+  for(int l = 0; l < COUNT; ++l)
+    for(int i = 0; i < N; ++i) {
+      float s = 0;
+
+      for(int j = 0; j < N; ++j)
+	s += hA.getBuffer()[i + j * N + l * N * N] * hx.getBuffer()[j + l * N];
+
+      if((fabs(hy.getBuffer()[i + l * N] - s) > EPSILON * N) ||
+	 (fabs(hy_dev.getBuffer()[i + l * N] - s) > EPSILON * N)) {
+	cerr << "gemvBatched test failed (N = " << N << ")\n";
+	err = 1;
+	l = COUNT;
+	break;
+      }
+    }
+
+  // solving the lower triangle of A for y must give back x:
+  for(int l = 0; l < COUNT; ++l)
+    for(int i = 0; i < N; ++i) {
+      float s = 0;
+
+      for(int j = 0; j <= i; ++j)
+	s += hA.getBuffer()[i + j * N + l * N * N] * hx.getBuffer()[j + l * N];
+
+      hy.getBuffer()[i + l * N] = s;
+    }
+
+  Cuda::copy(dy, hy);
+  gettimeofday(&t0, 0);
+  Cuda::BLAS::trsvBatched('l', 'n', 'n', hA, hy);
+  gettimeofday(&t1, 0);
+  t_host = (t1 - t0) / COUNT;
+  cudaThreadSynchronize();
+  gettimeofday(&t0, 0);
+  Cuda::BLAS::trsvBatched('l', 'n', 'n', dA, dy);
+  cudaThreadSynchronize();
+  gettimeofday(&t1, 0);
+  t_device = (t1 - t0) / COUNT;
+  cout << N << "x" << N << " trsv [ns/matrix]: host " << t_host * 1e9 << ", device " << t_device * 1e9 << endl;
+  Cuda::HostMemoryHeap2D<float> hy2(dy);
+
+  for(int i = N * COUNT; i--;)
+    if((fabs(hy.getBuffer()[i] - hx.getBuffer()[i]) > EPSILON) ||
+       (fabs(hy2.getBuffer()[i] - hx.getBuffer()[i]) > EPSILON)) {
+      cerr << "trsvBatched test failed (N = " << N << ")\n";
+      err = 1;
+      break;
+    }
+
+  return err;
+}
+
+/**
+   Check all combinations of transposed operands of gemmBatched and
+   gemvBatched on the host and on the device against the host BLAS.
+*/
+template <int N>
+int
+check()
+{
+  const char ops[] = { 'n', 't' };
+  const float alpha = 0.75f, beta = 0.5f;
+  Cuda::HostMemoryHeap3D<float> hA(N, N, CHECK), hB(N, N, CHECK), hC0(N, N, CHECK);
+  Cuda::HostMemoryHeap2D<float> hx(N, CHECK), hy0(N, CHECK);
+
+  for(int i = N * N * CHECK; i--;) {
+    hA.getBuffer()[i] = (float)rand() / RAND_MAX - 0.5f;
+    hB.getBuffer()[i] = (float)rand() / RAND_MAX - 0.5f;
+    hC0.getBuffer()[i] = (float)rand() / RAND_MAX - 0.5f;
+  }
+
+  for(int i = N * CHECK; i--;) {
+    hx.getBuffer()[i] = (float)rand() / RAND_MAX - 0.5f;
+    hy0.getBuffer()[i] = (float)rand() / RAND_MAX - 0.5f;
+  }
+
+  Cuda::DeviceMemoryLinear3D<float> dA(hA), dB(hB);
+  Cuda::DeviceMemoryLinear2D<float> dx(hx);
+
+  for(int ka = 0; ka < 2; ++ka) {
+    for(int kb = 0; kb < 2; ++kb) {
+      Cuda::HostMemoryHeap3D<float> hC(hC0), hC_ref(hC0);
+      Cuda::DeviceMemoryLinear3D<float> dC(hC0);
+      Cuda::BLAS::gemmBatched(ops[ka], ops[kb], alpha, hA, hB, beta, hC);
+      Cuda::BLAS::gemmBatched(ops[ka], ops[kb], alpha, dA, dB, beta, dC);
+      Cuda::HostMemoryHeap3D<float> hC_dev(dC);
+
+      for(int l = 0; l < CHECK; ++l) {
+	Cuda::BLAS::Host::MatrixReference<float>
+	  A(hA.getBuffer() + l * N * N, N, N, N),
+	  B(hB.getBuffer() + l * N * N, N, N, N),
+	  C(hC_ref.getBuffer() + l * N * N, N, N, N);
+	Cuda::BLAS::Host::gemm(ops[ka], ops[kb], alpha, A, B, beta, C);
+      }
+
+      for(int i = N * N * CHECK; i--;)
+	if((fabs(hC.getBuffer()[i] - hC_ref.getBuffer()[i]) > EPSILON * N) ||
+	   (fabs(hC_dev.getBuffer()[i] - hC_ref.getBuffer()[i]) > EPSILON * N)) {
+	  cerr << "gemmBatched('" << ops[ka] << "', '" << ops[kb] << "') test failed (N = " << N << ")\n";
+	  return 1;
+	}
+    }
+
+    Cuda::HostMemoryHeap2D<float> hy(hy0), hy_ref(hy0);
+    Cuda::DeviceMemoryLinear2D<float> dy(hy0);
+    Cuda::BLAS::gemvBatched(ops[ka], alpha, hA, hx, beta, hy);
+    Cuda::BLAS::gemvBatched(ops[ka], alpha, dA, dx, beta, dy);
+    Cuda::HostMemoryHeap2D<float> hy_dev(dy);
+
+    for(int l = 0; l < CHECK; ++l) {
+      Cuda::BLAS::Host::MatrixReference<float> A(hA.getBuffer() + l * N * N, N, N, N);
+      Cuda::BLAS::Host::VectorReference<float> x(hx.getBuffer() + l * N, N), y(hy_ref.getBuffer() + l * N, N);
+      Cuda::BLAS::Host::gemv(ops[ka], alpha, A, x, beta, y);
+    }
+
+    for(int i = N * CHECK; i--;)
+      if((fabs(hy.getBuffer()[i] - hy_ref.getBuffer()[i]) > EPSILON * N) ||
+	 (fabs(hy_dev.getBuffer()[i] - hy_ref.getBuffer()[i]) > EPSILON * N)) {
+	cerr << "gemvBatched('" << ops[ka] << "') test failed (N = " << N << ")\n";
+	return 1;
+      }
+  }
+
+  return 0;
+}
+
+int
+main()
+{
+  Cuda::BLAS::init();
+  int err = 0;
+  err |= test<3>();
+  err |= test<4>();
+  err |= test<8>();
+  err |= test<12>();  // not a fixed-size specialization
+  err |= check<3>();
+  err |= check<8>();
+  err |= check<12>();
+  return err;
+}
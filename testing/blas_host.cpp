@@ -0,0 +1,391 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/time.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <cudatemplates/hostblas.hpp>
+#include <cudatemplates/hostmemoryreference.hpp>
+
+using namespace std;
+
+
+const int   SIZE    =    512;  // matrix size
+const int   COUNT   =     10;  // number of repetitions
+const float EPSILON =   1e-3;  // error threshold
+
+// shape of op(A) (M x K) and op(B) (K x N) for checking all gemm/gemv variants,
+// chosen to cross the cache block size:
+const int   M       =    150;
+const int   N       =     77;
+const int   K       =    203;
+const int   PAD     =      5;  // leading dimension exceeds number of rows by this
+const float PADDING =   -1e6;  // value of unused elements between columns
+
+
+double
+operator-(const struct timeval &t1, const struct timeval &t2)
+{
+  return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
+}
+
+/*
+  Code written against Cuda::BLAS only needs a different namespace alias
+  to run on the CPU:
+*/
+namespace blas = Cuda::BLAS::Host;
+
+/**
+   Create matrix with leading dimension larger than its height.
+   The unused elements between columns are set to PADDING.
+*/
+blas::MatrixReference<float>
+padded(std::vector<float> &buffer, int width, int height)
+{
+  buffer.assign((size_t)(height + PAD) * width, PADDING);
+
+  for(int j = 0; j < width; ++j)
+    for(int i = 0; i < height; ++i)
+      buffer[i + (size_t)j * (height + PAD)] = (float)rand() / RAND_MAX - 0.5f;
+
+  return blas::MatrixReference<float>(&buffer[0], width, height, height + PAD);
+}
+
+/**
+   Get element (i, j) of op(A).
+*/
+inline double
+element(const blas::Matrix<float> &A, bool trans, int i, int j)
+{
+  return trans ? A(j, i) : A(i, j);
+}
+
+/**
+   Check padding of matrix.
+*/
+bool
+unchanged(const std::vector<float> &buffer, int width, int height)
+{
+  for(int j = 0; j < width; ++j)
+    for(int i = height; i < height + PAD; ++i)
+      if(buffer[i + (size_t)j * (height + PAD)] != PADDING)
+	return false;
+
+  return true;
+}
+
+/**
+   Check gemm and gemv for non-square matrices, transposed operands and
+   leading dimensions larger than the number of rows against a straightforward
+   implementation.
+*/
+bool
+check_products()
+{
+  const char ops[] = { 'n', 't' };
+  const float alpha = 0.75f, beta = 0.5f;
+
+  for(int ka = 0; ka < 2; ++ka) {
+    const bool ta = (ops[ka] == 't');
+    std::vector<float> a_buffer, c_buffer;
+    blas::MatrixReference<float> A = ta ? padded(a_buffer, M, K) : padded(a_buffer, K, M);
+
+    for(int kb = 0; kb < 2; ++kb) {
+      const bool tb = (ops[kb] == 't');
+      std::vector<float> b_buffer;
+      blas::MatrixReference<float> B = tb ? padded(b_buffer, K, N) : padded(b_buffer, N, K);
+      blas::MatrixReference<float> C = padded(c_buffer, N, M);
+      std::vector<float> c0(c_buffer);
+      blas::gemm(ops[ka], ops[kb], alpha, A, B, beta, C);
+
+      for(int j = 0; j < N; ++j) {
+	for(int i = 0; i < M; ++i) {
+	  double c = 0, a = 0;
+
+	  for(int p = 0; p < K; ++p) {
+	    c += element(A, ta, i, p) * element(B, tb, p, j);
+	    a += fabs(element(A, ta, i, p) * element(B, tb, p, j));
+	  }
+
+	  c = alpha * c + beta * c0[i + (size_t)j * (M + PAD)];
+
+	  if(fabs(C(i, j) - c) > EPSILON * (a + 1)) {
+	    cerr << "gemm('" << ops[ka] << "', '" << ops[kb] << "') failed at (" << i << ", " << j << ")\n";
+	    return false;
+	  }
+	}
+      }
+
+      if(!unchanged(c_buffer, N, M)) {
+	cerr << "gemm('" << ops[ka] << "', '" << ops[kb] << "') modified padding\n";
+	return false;
+      }
+    }
+
+    // y = alpha * op(A) * x + beta * y with strided y:
+    std::vector<float> hx(K), hy(2 * M);
+
+    for(int p = K; p--;)
+      hx[p] = (float)rand() / RAND_MAX;
+
+    for(int i = 2 * M; i--;)
+      hy[i] = (float)rand() / RAND_MAX;
+
+    std::vector<float> y0(hy);
+    blas::VectorReference<float> x(&hx[0], K), y(&hy[0], M, 2);
+    blas::gemv(ops[ka], alpha, A, x, beta, y);
+
+    for(int i = 0; i < M; ++i) {
+      double g = 0, a = 0;
+
+      for(int p = 0; p < K; ++p) {
+	g += element(A, ta, i, p) * hx[p];
+	a += fabs(element(A, ta, i, p) * hx[p]);
+      }
+
+      g = alpha * g + beta * y0[2 * i];
+
+      if((fabs(y(i) - g) > EPSILON * (a + 1)) || (hy[2 * i + 1] != y0[2 * i + 1])) {
+	cerr << "gemv('" << ops[ka] << "') failed at " << i << endl;
+	return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+/**
+   Check vectors and matrices referring to pitched two-dimensional memory.
+   The first dimension of the memory is the matrix row index, so column x of
+   the memory is a matrix row and row y of the memory is a matrix column.
+*/
+bool
+check_references()
+{
+  Cuda::Layout<float, 2> layout(Cuda::Size<2>(M, N));
+  layout.setPitch((M + PAD) * sizeof(float));
+  std::vector<float> buffer(layout.getSize(), PADDING);
+  Cuda::HostMemoryReference<float, 2> mem(layout, &buffer[0]);
+
+  for(int y = 0; y < N; ++y)
+    for(int x = 0; x < M; ++x)
+      mem[Cuda::Size<2>(x, y)] = (float)rand() / RAND_MAX - 0.5f;
+
+  std::vector<float> b0(buffer);
+  blas::MatrixReference<float> A(mem);
+
+  if((A.getHeight() != (unsigned)M) || (A.getWidth() != (unsigned)N) || (A.getLd() != (unsigned)(M + PAD))) {
+    cerr << "MatrixReference has wrong shape\n";
+    return false;
+  }
+
+  for(int y = 0; y < N; ++y)
+    for(int x = 0; x < M; ++x)
+      if(&A(x, y) != &mem[Cuda::Size<2>(x, y)]) {
+	cerr << "MatrixReference element (" << x << ", " << y << ") at wrong address\n";
+	return false;
+      }
+
+  // dot products of rows and columns:
+  const int x0 = 7, y0 = 11;
+  blas::VectorReference<float> r = blas::row(mem, y0), c = blas::column(mem, x0);
+  double rr = 0, cc = 0;
+
+  for(int x = 0; x < M; ++x)
+    rr += (double)b0[x + y0 * (M + PAD)] * b0[x + y0 * (M + PAD)];
+
+  for(int y = 0; y < N; ++y)
+    cc += (double)b0[x0 + y * (M + PAD)] * b0[x0 + y * (M + PAD)];
+
+  if((r.getSize() != (unsigned)M) || (c.getSize() != (unsigned)N) ||
+     (fabs(blas::dot(r, r) - rr) > EPSILON * rr) || (fabs(blas::dot(c, c) - cc) > EPSILON * cc)) {
+    cerr << "row/column dot test failed\n";
+    return false;
+  }
+
+  // y = A * x with x referring to a column of the memory (strided by the pitch)
+  // and y referring to a row (contiguous):
+  std::vector<float> hy(M);
+  blas::VectorReference<float> x = blas::column(mem, x0), y(&hy[0], M);
+  blas::gemv('n', 1.0f, A, x, 0.0f, y);
+
+  for(int i = 0; i < M; ++i) {
+    double g = 0, a = 0;
+
+    for(int j = 0; j < N; ++j) {
+      g += (double)b0[i + j * (M + PAD)] * b0[x0 + j * (M + PAD)];
+      a += fabs((double)b0[i + j * (M + PAD)] * b0[x0 + j * (M + PAD)]);
+    }
+
+    if(fabs(hy[i] - g) > EPSILON * (a + 1)) {
+      cerr << "gemv with references failed at " << i << endl;
+      return false;
+    }
+  }
+
+  // axpy into a row must only change that row:
+  blas::axpy(2.0f, blas::row(mem, 0), r);
+
+  for(int j = 0; j < N; ++j)
+    for(int i = 0; i < M + PAD; ++i) {
+      size_t k = i + (size_t)j * (M + PAD);
+      float e = ((j == y0) && (i < M)) ? b0[k] + 2.0f * b0[i] : b0[k];
+
+      if(fabs(buffer[k] - e) > EPSILON) {
+	cerr << "axpy with row reference failed at (" << i << ", " << j << ")\n";
+	return false;
+      }
+    }
+
+  // getValues/setValues pack and unpack the leading dimension:
+  std::vector<float> packed(M * N);
+  A.getValues(&packed[0]);
+
+  for(int j = 0; j < N; ++j)
+    for(int i = 0; i < M; ++i)
+      if(packed[i + j * M] != buffer[i + (size_t)j * (M + PAD)]) {
+	cerr << "getValues of MatrixReference failed\n";
+	return false;
+      }
+
+  for(int k = M * N; k--;)
+    packed[k] = (float)k;
+
+  A.setValues(&packed[0]);
+
+  for(int j = 0; j < N; ++j)
+    for(int i = 0; i < M + PAD; ++i) {
+      size_t k = i + (size_t)j * (M + PAD);
+
+      if(buffer[k] != ((i < M) ? (float)(i + j * M) : PADDING)) {
+	cerr << "setValues of MatrixReference failed\n";
+	return false;
+      }
+    }
+
+  return true;
+}
+
+int
+main()
+{
+  blas::init();
+  int err = 0;
+
+  blas::Vector<float> x(SIZE * SIZE), y(SIZE * SIZE);
+  blas::Matrix<float> A(SIZE, SIZE), B(SIZE, SIZE), C(SIZE, SIZE);
+
+  float *hx = new float[SIZE * SIZE];
+
+  for(int i = SIZE * SIZE; i--;)
+    hx[i] = (float)rand() / RAND_MAX;
+
+  x.setValues(hx);
+  A.setValues(hx);
+  B.setValues(hx);
+  struct timeval t0, t1;
+
+  // level 1:
+  gettimeofday(&t0, 0);
+
+  for(int i = COUNT; i--;)
+    blas::axpy(0.5f, x, y);
+
+  gettimeofday(&t1, 0);
+  cout << "axpy: " << 2.0 * SIZE * SIZE * COUNT / (t1 - t0) * 1e-9 << " GFLOP/s\n";
+
+  float d = 0;
+  gettimeofday(&t0, 0);
+
+  for(int i = COUNT; i--;)
+    d += blas::dot(x, y);
+
+  gettimeofday(&t1, 0);
+  cout << "dot:  " << 2.0 * SIZE * SIZE * COUNT / (t1 - t0) * 1e-9 << " GFLOP/s (" << d << ")\n";
+
+  double ref = 0;
+
+  for(int i = SIZE * SIZE; i--;)
+    ref += (double)hx[i] * hx[i];
+
+  if(fabs(blas::nrm2(x) - sqrt(ref)) > EPSILON * sqrt(ref)) {
+    cerr << "nrm2 test failed\n";
+    err = 1;
+  }
+
+  // 1-based indices of largest/smallest magnitude, 0 for empty vectors:
+  float hi[] = { 0.5f, -3, 2, 0.25f, -0.125f, 3 };
+  blas::VectorReference<float> vi(hi, 6), vs(hi, 3, 2), ve(hi, 0);
+
+  if((blas::iamax(vi) != 2) || (blas::iamin(vi) != 5) || (blas::iamax(vs) != 2) || (blas::iamin(vs) != 3) ||
+     (blas::iamax(ve) != 0) || (blas::iamin(ve) != 0)) {
+    cerr << "iamax/iamin test failed\n";
+    err = 1;
+  }
+
+  // level 2:
+  blas::Vector<float> v(SIZE), w(SIZE);
+  v.setValues(hx);
+  gettimeofday(&t0, 0);
+
+  for(int i = COUNT; i--;)
+    blas::gemv('n', 1.0f, A, v, 0.0f, w);
+
+  gettimeofday(&t1, 0);
+  cout << "gemv: " << 2.0 * SIZE * SIZE * COUNT / (t1 - t0) * 1e-9 << " GFLOP/s\n";
+
+  // level 3:
+  gettimeofday(&t0, 0);
+
+  for(int i = COUNT; i--;)
+    blas::gemm('n', 'n', 1.0f, A, B, 0.0f, C);
+
+  gettimeofday(&t1, 0);
+  cout << "gemm: " << 2.0 * SIZE * SIZE * SIZE * COUNT / (t1 - t0) * 1e-9 << " GFLOP/s\n";
+
+  // verify some elements of gemm and gemv:
+  for(int k = 0; k < 16; ++k) {
+    int i = rand() % SIZE, j = rand() % SIZE;
+    double c = 0, g = 0;
+
+    for(int p = 0; p < SIZE; ++p) {
+      c += (double)A(i, p) * B(p, j);
+      g += (double)A(i, p) * v(p);
+    }
+
+    if((fabs(C(i, j) - c) > EPSILON * fabs(c)) || (fabs(w(i) - g) > EPSILON * fabs(g))) {
+      cerr << "gemm/gemv test failed at (" << i << ", " << j << ")\n";
+      err = 1;
+      break;
+    }
+  }
+
+  delete[] hx;
+
+  if(!check_products() || !check_references())
+    err = 1;
+
+  return err;
+}
@@ -0,0 +1,152 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/time.h>
+
+#include <iostream>
+
+#include <cudatemplates/channelimage.hpp>
+
+using namespace std;
+
+
+const int WIDTH    = 1280;  // image width
+const int HEIGHT   =  720;  // image height
+const int CHANNELS =    3;  // number of channels
+const int FRAMES   =    4;  // number of frames in ring
+const int COUNT    =   10;  // number of repetitions
+
+
+double
+operator-(const struct timeval &t1, const struct timeval &t2)
+{
+  return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
+}
+
+/**
+   Expected value of channel c at pixel (x, y) in frame n.
+*/
+inline float
+value(int c, int x, int y, int n)
+{
+  return (float)(c * 1000 + x + y * 7 + n * 13);
+}
+
+/**
+   Fill host memory (in given layout) of frame n.
+*/
+void
+fill(Cuda::ChannelImage<float> &image, Cuda::channel_layout_t layout, int n)
+{
+  Cuda::View<float, 3> v = image.host(layout, true);
+
+  for(int c = 0; c < CHANNELS; ++c)
+    for(int y = 0; y < HEIGHT; ++y)
+      for(int x = 0; x < WIDTH; ++x) {
+	size_t i[] = { x, y, c };
+
+	if(layout == Cuda::CHANNELS_INTERLEAVED)
+	  i[0] = c, i[1] = x, i[2] = y;
+
+	v[Cuda::Size<3>(i[0], i[1], i[2])] = value(c, x, y, n);
+      }
+}
+
+/**
+   Check view of host memory (in given layout) of frame n.
+*/
+bool
+check(const Cuda::View<float, 3> &v, Cuda::channel_layout_t layout, int n, const char *name)
+{
+  for(int c = 0; c < CHANNELS; ++c)
+    for(int y = 0; y < HEIGHT; ++y)
+      for(int x = 0; x < WIDTH; ++x) {
+	size_t i[] = { x, y, c };
+
+	if(layout == Cuda::CHANNELS_INTERLEAVED)
+	  i[0] = c, i[1] = x, i[2] = y;
+
+	if(v[Cuda::Size<3>(i[0], i[1], i[2])] != value(c, x, y, n)) {
+	  cerr << name << " failed\n";
+	  return false;
+	}
+      }
+
+  cout << name << ": ok\n";
+  return true;
+}
+
+int
+main()
+{
+  int err = 0;
+  Cuda::FrameRing<Cuda::ChannelImage<float> > ring(FRAMES, Cuda::Size<2>(WIDTH, HEIGHT), CHANNELS);
+
+  // conversion on the host:
+  fill(ring[0], Cuda::CHANNELS_INTERLEAVED, 0);
+
+  if(!check(ring[0].host(Cuda::CHANNELS_PLANAR), Cuda::CHANNELS_PLANAR, 0, "host interleaved to planar"))
+    err = 1;
+
+  // conversion on the device, modified planar data is converted back to interleaved:
+  ring[0].device(Cuda::CHANNELS_PLANAR);
+  ring[0].device(Cuda::CHANNELS_PLANAR, true);
+
+  if(!check(ring[0].host(Cuda::CHANNELS_INTERLEAVED), Cuda::CHANNELS_INTERLEAVED, 0, "device planar to host interleaved"))
+    err = 1;
+
+  ring[0].device(Cuda::CHANNELS_INTERLEAVED, true);
+
+  if(!check(ring[0].host(Cuda::CHANNELS_PLANAR), Cuda::CHANNELS_PLANAR, 0, "device interleaved to host planar"))
+    err = 1;
+
+  // frame ring:
+  for(int n = 1; n < FRAMES + 2; ++n) {
+    ring.advance();
+    fill(ring[0], Cuda::CHANNELS_INTERLEAVED, n);
+  }
+
+  if(!check(ring[1].host(Cuda::CHANNELS_PLANAR), Cuda::CHANNELS_PLANAR, FRAMES, "previous frame"))
+    err = 1;
+
+  // cost of repeated planar access (converted once) and explicit conversion per access:
+  struct timeval t0, t1;
+  double t[2];
+
+  for(int k = 0; k < 2; ++k) {
+    fill(ring[0], Cuda::CHANNELS_INTERLEAVED, 0);
+    ring[0].device(Cuda::CHANNELS_INTERLEAVED);
+    gettimeofday(&t0, 0);
+
+    for(int i = COUNT; i--;) {
+      if(k == 1)
+	ring[0].device(Cuda::CHANNELS_INTERLEAVED, true);
+
+      ring[0].device(Cuda::CHANNELS_PLANAR);
+    }
+
+    cudaThreadSynchronize();
+    gettimeofday(&t1, 0);
+    t[k] = (t1 - t0) / COUNT * 1000;
+  }
+
+  cout << "planar access: lazy " << t[0] << " ms, converted each time " << t[1] << " ms\n";
+  return err;
+}
@@ -0,0 +1,316 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <iostream>
+
+#include <cudatemplates/color.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+
+using namespace std;
+
+
+const int WIDTH  = 64;  // image width
+const int HEIGHT = 48;  // image height
+
+
+/**
+   Scalar reference conversion from RGB in [0, 1] to YUV.
+   The coefficients are taken from the standards, not from color.hpp.
+*/
+void
+reference_yuv(const double *rgb, double *yuv, Cuda::yuv_standard_t standard)
+{
+  if(standard == Cuda::YUV_BT709) {
+    yuv[0] = 0.2126 * rgb[0] + 0.7152 * rgb[1] + 0.0722 * rgb[2];
+    yuv[1] = (rgb[2] - yuv[0]) / 1.8556;
+    yuv[2] = (rgb[0] - yuv[0]) / 1.5748;
+  }
+  else {
+    yuv[0] = 0.299 * rgb[0] + 0.587 * rgb[1] + 0.114 * rgb[2];
+    yuv[1] = (rgb[2] - yuv[0]) / 1.772;
+    yuv[2] = (rgb[0] - yuv[0]) / 1.402;
+  }
+}
+
+/**
+   Check a value against the reference.
+*/
+bool
+check(double value, double expected, double epsilon, const char *name)
+{
+  if(fabs(value - expected) <= epsilon)
+    return true;
+
+  cerr << name << ": got " << value << ", expected " << expected << endl;
+  return false;
+}
+
+/**
+   Check RGB<->YUV conversions of floating point and eight bit images.
+*/
+bool
+check_yuv(Cuda::yuv_standard_t standard)
+{
+  Cuda::Size<2> size(WIDTH, HEIGHT);
+  Cuda::HostMemoryHeap<float3, 2> rgb(size), rgb2(size);
+  Cuda::HostMemoryHeap<float, 3> yuv(Cuda::Size<3>(WIDTH, HEIGHT, 3));
+  Cuda::HostMemoryHeap<uchar4, 2> rgb8(size), rgb8_2(size);
+  Cuda::HostMemoryHeap<uchar3, 2> yuv8(size);
+
+  for(int i = WIDTH * HEIGHT; i--;) {
+    uchar4 &p = rgb8.getBuffer()[i];
+    p.x = rand() % 256;
+    p.y = rand() % 256;
+    p.z = rand() % 256;
+    p.w = 0;
+    float3 &q = rgb.getBuffer()[i];
+    q.x = p.x / 255.0f;
+    q.y = p.y / 255.0f;
+    q.z = p.z / 255.0f;
+  }
+
+  // make sure the extreme values are covered:
+  rgb8.getBuffer()[0] = make_uchar4(0, 0, 0, 0);
+  rgb8.getBuffer()[1] = make_uchar4(255, 255, 255, 0);
+  rgb8.getBuffer()[2] = make_uchar4(255, 0, 0, 0);
+  rgb8.getBuffer()[3] = make_uchar4(0, 0, 255, 0);
+
+  for(int i = 4; i--;) {
+    const uchar4 &p = rgb8.getBuffer()[i];
+    rgb.getBuffer()[i] = make_float3(p.x / 255.0f, p.y / 255.0f, p.z / 255.0f);
+  }
+
+  Cuda::rgbToYuv(yuv, rgb, standard);
+  Cuda::yuvToRgb(rgb2, yuv, standard);
+  Cuda::rgbToYuv(yuv8, rgb8, standard);
+  Cuda::yuvToRgb(rgb8_2, yuv8, standard);
+
+  for(int y = 0; y < HEIGHT; ++y) {
+    for(int x = 0; x < WIDTH; ++x) {
+      int i = y * WIDTH + x;
+      const float3 &p = rgb.getBuffer()[i], &q = rgb2.getBuffer()[i];
+      double in[3] = { p.x, p.y, p.z }, ref[3];
+      reference_yuv(in, ref, standard);
+
+      for(int c = 0; c < 3; ++c)
+	if(!check(yuv[Cuda::Size<3>(x, y, c)], ref[c], 1e-5, "float YUV"))
+	  return false;
+
+      if(!check(q.x, p.x, 1e-5, "float YUV round trip (R)") ||
+	 !check(q.y, p.y, 1e-5, "float YUV round trip (G)") ||
+	 !check(q.z, p.z, 1e-5, "float YUV round trip (B)"))
+	return false;
+
+      // eight bit YUV uses the limited range:
+      const uchar3 &v = yuv8.getBuffer()[i];
+
+      if(!check(v.x, 16 + 219 * ref[0], 0.5 + 1e-3, "eight bit Y") ||
+	 !check(v.y, 128 + 224 * ref[1], 0.5 + 1e-3, "eight bit Cb") ||
+	 !check(v.z, 128 + 224 * ref[2], 0.5 + 1e-3, "eight bit Cr"))
+	return false;
+
+      // quantization of YUV to eight bits loses up to two levels of RGB:
+      const uchar4 &a = rgb8.getBuffer()[i], &b = rgb8_2.getBuffer()[i];
+
+      if(!check(b.x, a.x, 2, "eight bit YUV round trip (R)") ||
+	 !check(b.y, a.y, 2, "eight bit YUV round trip (G)") ||
+	 !check(b.z, a.z, 2, "eight bit YUV round trip (B)"))
+	return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+   Check RGB<->Lab conversion against known values and by a round trip.
+*/
+bool
+check_lab()
+{
+  Cuda::Size<2> size(WIDTH, HEIGHT);
+  Cuda::HostMemoryHeap<float4, 2> rgb(size), lab(size), rgb2(size);
+
+  for(int i = WIDTH * HEIGHT; i--;)
+    rgb.getBuffer()[i] = make_float4(rand() / (float)RAND_MAX, rand() / (float)RAND_MAX, rand() / (float)RAND_MAX, 0);
+
+  rgb.getBuffer()[0] = make_float4(1, 1, 1, 0);
+  rgb.getBuffer()[1] = make_float4(1, 0, 0, 0);
+  Cuda::rgbToLab(lab, rgb);
+  Cuda::labToRgb(rgb2, lab);
+
+  // white and sRGB red:
+  const float4 &w = lab.getBuffer()[0], &r = lab.getBuffer()[1];
+
+  if(!check(w.x, 100, 1e-2, "Lab of white (L)") || !check(w.y, 0, 1e-2, "Lab of white (a)") ||
+     !check(w.z, 0, 1e-2, "Lab of white (b)") || !check(r.x, 53.24, 1e-2, "Lab of red (L)") ||
+     !check(r.y, 80.09, 1e-2, "Lab of red (a)") || !check(r.z, 67.20, 1e-2, "Lab of red (b)"))
+    return false;
+
+  for(int i = WIDTH * HEIGHT; i--;) {
+    const float4 &p = rgb.getBuffer()[i], &q = rgb2.getBuffer()[i];
+
+    if(!check(q.x, p.x, 1e-4, "Lab round trip (R)") || !check(q.y, p.y, 1e-4, "Lab round trip (G)") ||
+       !check(q.z, p.z, 1e-4, "Lab round trip (B)"))
+      return false;
+  }
+
+  return true;
+}
+
+/**
+   Check YUV 4:2:0 conversions.
+   The image is constant in 2x2 blocks, so subsampling of the chroma planes
+   doesn't lose information.
+*/
+bool
+check_yuv420()
+{
+  Cuda::Size<2> size(WIDTH, HEIGHT), size420(WIDTH, HEIGHT * 3 / 2);
+  Cuda::HostMemoryHeap<uchar4, 2> rgb(size), rgb_nv12(size), rgb_i420(size);
+  Cuda::HostMemoryHeap<unsigned char, 2> nv12(size420), i420(size420);
+
+  for(int y = 0; y < HEIGHT; y += 2)
+    for(int x = 0; x < WIDTH; x += 2) {
+      uchar4 p = make_uchar4(rand() % 256, rand() % 256, rand() % 256, 0);
+
+      for(int j = 0; j < 2; ++j)
+	for(int i = 0; i < 2; ++i)
+	  rgb.getBuffer()[(y + j) * WIDTH + x + i] = p;
+    }
+
+  Cuda::rgbToNv12(nv12, rgb);
+  Cuda::nv12ToRgb(rgb_nv12, nv12);
+  Cuda::rgbToI420(i420, rgb);
+  Cuda::i420ToRgb(rgb_i420, i420);
+
+  for(int i = WIDTH * HEIGHT; i--;) {
+    const uchar4 &a = rgb.getBuffer()[i], &b = rgb_nv12.getBuffer()[i], &c = rgb_i420.getBuffer()[i];
+
+    if(!check(b.x, a.x, 2, "NV12 round trip (R)") || !check(b.y, a.y, 2, "NV12 round trip (G)") ||
+       !check(b.z, a.z, 2, "NV12 round trip (B)"))
+      return false;
+
+    if((b.x != c.x) || (b.y != c.y) || (b.z != c.z)) {
+      cerr << "NV12 and I420 differ\n";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+   Compare the conversions between eight bit RGBA and eight bit YUV (which
+   have SSE2 versions on the host) with the scalar per-pixel code. Both
+   perform the same single precision operations, the results must be equal.
+   The width is not a multiple of four, so the remaining columns are covered
+   as well.
+*/
+bool
+check_rgba()
+{
+  const int width = WIDTH + 6;
+  Cuda::Size<2> size(width, HEIGHT), size420(width, HEIGHT * 3 / 2);
+  Cuda::HostMemoryHeap<uchar4, 2> rgb(size), out(size), ref(size);
+  Cuda::HostMemoryHeap<unsigned char, 3> yuv(Cuda::Size<3>(width, HEIGHT, 3)), yuv_ref(yuv.size);
+  Cuda::HostMemoryHeap<unsigned char, 2> nv12(size420), nv12_ref(size420);
+
+  for(int i = width * HEIGHT; i--;)
+    rgb.getBuffer()[i] = make_uchar4(rand() % 256, rand() % 256, rand() % 256, rand() % 256);
+
+  const Cuda::Color::RgbToYuv to(Cuda::YUV_BT709);
+  const Cuda::Color::YuvToRgb from(Cuda::YUV_BT709);
+  const Cuda::Color::Interleaved<uchar4> rgb_view(rgb, rgb.getBuffer()), ref_view(ref, ref.getBuffer());
+  const Cuda::Color::Planar<unsigned char> yuv_ref_view(yuv_ref, yuv_ref.getBuffer());
+  const Cuda::Color::Yuv420 nv12_ref_view(nv12_ref, nv12_ref.getBuffer(), true);
+
+  // planar YUV:
+  Cuda::rgbToYuv(yuv, rgb, Cuda::YUV_BT709);
+
+  for(int y = 0; y < HEIGHT; ++y)
+    for(int x = 0; x < width; ++x)
+      Cuda::Color::pixel(to, yuv_ref_view, rgb_view, x, y);
+
+  for(int i = width * HEIGHT * 3; i--;)
+    if(!check(yuv.getBuffer()[i], yuv_ref.getBuffer()[i], 0, "RGBA to planar YUV"))
+      return false;
+
+  Cuda::yuvToRgb(out, yuv_ref, Cuda::YUV_BT709);
+
+  for(int y = 0; y < HEIGHT; ++y)
+    for(int x = 0; x < width; ++x)
+      Cuda::Color::pixel(from, ref_view, yuv_ref_view, x, y);
+
+  for(int i = width * HEIGHT; i--;) {
+    const uchar4 &a = out.getBuffer()[i], &b = ref.getBuffer()[i];
+
+    if(!check(a.x, b.x, 0, "planar YUV to RGBA (R)") || !check(a.y, b.y, 0, "planar YUV to RGBA (G)") ||
+       !check(a.z, b.z, 0, "planar YUV to RGBA (B)") || !check(a.w, 255, 0, "planar YUV to RGBA (A)"))
+      return false;
+  }
+
+  // NV12:
+  Cuda::rgbToNv12(nv12, rgb, Cuda::YUV_BT709);
+
+  for(int y = 0; y < HEIGHT; y += 2)
+    for(int x = 0; x < width; x += 2)
+      Cuda::Color::toYuv420(to, nv12_ref_view, rgb_view, x, y);
+
+  for(int i = width * HEIGHT * 3 / 2; i--;)
+    if(!check(nv12.getBuffer()[i], nv12_ref.getBuffer()[i], 0, "RGBA to NV12"))
+      return false;
+
+  Cuda::nv12ToRgb(out, nv12_ref, Cuda::YUV_BT709);
+
+  for(int y = 0; y < HEIGHT; y += 2)
+    for(int x = 0; x < width; x += 2)
+      Cuda::Color::fromYuv420(from, ref_view, nv12_ref_view, x, y);
+
+  for(int i = width * HEIGHT; i--;) {
+    const uchar4 &a = out.getBuffer()[i], &b = ref.getBuffer()[i];
+
+    if(!check(a.x, b.x, 0, "NV12 to RGBA (R)") || !check(a.y, b.y, 0, "NV12 to RGBA (G)") ||
+       !check(a.z, b.z, 0, "NV12 to RGBA (B)") || !check(a.w, 255, 0, "NV12 to RGBA (A)"))
+      return false;
+  }
+
+  return true;
+}
+
+int
+main()
+{
+  try {
+    if(!check_yuv(Cuda::YUV_BT601) || !check_yuv(Cuda::YUV_BT709) || !check_lab() || !check_yuv420() ||
+       !check_rgba())
+      return 1;
+  }
+  catch(const exception &e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  cout << "color conversion test passed\n";
+  return 0;
+}
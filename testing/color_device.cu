@@ -0,0 +1,172 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <iostream>
+
+#include <cudatemplates/color.hpp>
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememorypitched.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+
+using namespace std;
+
+
+const int WIDTH  = 642;  // image width (not a multiple of the block size)
+const int HEIGHT = 482;  // image height
+
+
+/**
+   Largest difference between the channels of two pixels.
+*/
+double difference(unsigned char a, unsigned char b) { return abs((int)a - (int)b); }
+double difference(float a, float b) { return fabs(a - b); }
+
+double
+difference(const uchar4 &a, const uchar4 &b)
+{
+  int d = abs((int)a.x - (int)b.x);
+  d = max(d, abs((int)a.y - (int)b.y));
+  d = max(d, abs((int)a.z - (int)b.z));
+  return max(d, abs((int)a.w - (int)b.w));
+}
+
+double
+difference(const float4 &a, const float4 &b)
+{
+  return max(max(fabs(a.x - b.x), fabs(a.y - b.y)), max(fabs(a.z - b.z), fabs(a.w - b.w)));
+}
+
+/**
+   Compare the result of a device conversion with the host result.
+*/
+template <class Type, unsigned Dim>
+bool
+compare(const char *name, const Cuda::HostMemoryHeap<Type, Dim> &h, const Cuda::DeviceMemoryPitched<Type, Dim> &d, double epsilon)
+{
+  Cuda::HostMemoryHeap<Type, Dim> hd(d.size);
+  Cuda::copy(hd, d);
+
+  for(size_t i = 0; i < h.getNumElements(); ++i)
+    if(difference(h.getBuffer()[i], hd.getBuffer()[i]) > epsilon) {
+      cerr << name << ": device and host results differ at " << i << endl;
+      return false;
+    }
+
+  return true;
+}
+
+int
+main()
+{
+  Cuda::Size<2> size(WIDTH, HEIGHT), size420(WIDTH, HEIGHT * 3 / 2);
+  Cuda::Size<3> size_planar(WIDTH, HEIGHT, 3);
+  Cuda::HostMemoryHeap<float4, 2> h_rgb(size), h_float4(size);
+  Cuda::HostMemoryHeap<uchar4, 2> h_rgb8(size), h_uchar4(size);
+  Cuda::HostMemoryHeap<float, 3> h_plane(size_planar);
+  Cuda::HostMemoryHeap<unsigned char, 3> h_plane8(size_planar);
+  Cuda::HostMemoryHeap<unsigned char, 2> h_yuv420(size420);
+
+  for(int i = WIDTH * HEIGHT; i--;) {
+    h_rgb.getBuffer()[i] = make_float4(rand() / (float)RAND_MAX, rand() / (float)RAND_MAX, rand() / (float)RAND_MAX, 1);
+    h_rgb8.getBuffer()[i] = make_uchar4(rand() % 256, rand() % 256, rand() % 256, 255);
+  }
+
+  Cuda::DeviceMemoryPitched<float4, 2> d_rgb(h_rgb), d_float4(size);
+  Cuda::DeviceMemoryPitched<uchar4, 2> d_rgb8(h_rgb8), d_uchar4(size);
+  Cuda::DeviceMemoryPitched<float, 3> d_plane(size_planar);
+  Cuda::DeviceMemoryPitched<unsigned char, 3> d_plane8(size_planar);
+  Cuda::DeviceMemoryPitched<unsigned char, 2> d_yuv420(size420);
+
+  // float results differ by rounding (fused multiply-add, powf on the
+  // device), eight bit results by one level at most:
+  const double EPSILON = 1e-5, EPSILON_LAB = 1e-3, EPSILON8 = 1;
+  bool ok = true;
+
+  try {
+    // each conversion from a YUV or Lab image starts from the host result, so
+    // that errors don't propagate:
+    Cuda::rgbToYuv(h_float4, h_rgb, Cuda::YUV_BT709);
+    Cuda::rgbToYuv(d_float4, d_rgb, Cuda::YUV_BT709);
+    ok = ok && compare("float4 RGB -> YUV", h_float4, d_float4, EPSILON);
+
+    Cuda::rgbToYuv(h_plane, h_rgb);
+    Cuda::rgbToYuv(d_plane, d_rgb);
+    ok = ok && compare("float4 RGB -> planar YUV", h_plane, d_plane, EPSILON);
+
+    Cuda::copy(d_plane, h_plane);
+    Cuda::yuvToRgb(h_float4, h_plane);
+    Cuda::yuvToRgb(d_float4, d_plane);
+    ok = ok && compare("planar YUV -> float4 RGB", h_float4, d_float4, EPSILON);
+
+    Cuda::rgbToYuv(h_uchar4, h_rgb8);
+    Cuda::rgbToYuv(d_uchar4, d_rgb8);
+    ok = ok && compare("uchar4 RGB -> YUV", h_uchar4, d_uchar4, EPSILON8);
+
+    Cuda::rgbToYuv(h_plane8, h_rgb8, Cuda::YUV_BT709);
+    Cuda::rgbToYuv(d_plane8, d_rgb8, Cuda::YUV_BT709);
+    ok = ok && compare("uchar4 RGBA -> planar YUV", h_plane8, d_plane8, EPSILON8);
+
+    Cuda::copy(d_plane8, h_plane8);
+    Cuda::yuvToRgb(h_uchar4, h_plane8, Cuda::YUV_BT709);
+    Cuda::yuvToRgb(d_uchar4, d_plane8, Cuda::YUV_BT709);
+    ok = ok && compare("planar YUV -> uchar4 RGBA", h_uchar4, d_uchar4, EPSILON8);
+
+    Cuda::rgbToNv12(h_yuv420, h_rgb8);
+    Cuda::rgbToNv12(d_yuv420, d_rgb8);
+    ok = ok && compare("uchar4 RGBA -> NV12", h_yuv420, d_yuv420, EPSILON8);
+
+    Cuda::copy(d_yuv420, h_yuv420);
+    Cuda::nv12ToRgb(h_uchar4, h_yuv420);
+    Cuda::nv12ToRgb(d_uchar4, d_yuv420);
+    ok = ok && compare("NV12 -> uchar4 RGBA", h_uchar4, d_uchar4, EPSILON8);
+
+    Cuda::rgbToI420(h_yuv420, h_rgb8);
+    Cuda::rgbToI420(d_yuv420, d_rgb8);
+    ok = ok && compare("uchar4 RGBA -> I420", h_yuv420, d_yuv420, EPSILON8);
+
+    Cuda::copy(d_yuv420, h_yuv420);
+    Cuda::i420ToRgb(h_uchar4, h_yuv420);
+    Cuda::i420ToRgb(d_uchar4, d_yuv420);
+    ok = ok && compare("I420 -> uchar4 RGBA", h_uchar4, d_uchar4, EPSILON8);
+
+    Cuda::rgbToLab(h_float4, h_rgb);
+    Cuda::rgbToLab(d_float4, d_rgb);
+    ok = ok && compare("float4 RGB -> Lab", h_float4, d_float4, EPSILON_LAB);
+
+    Cuda::copy(d_float4, h_float4);
+    Cuda::labToRgb(h_rgb, h_float4);
+    Cuda::labToRgb(d_rgb, d_float4);
+    ok = ok && compare("Lab -> float4 RGB", h_rgb, d_rgb, EPSILON);
+  }
+  catch(const exception &e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  if(!ok)
+    return 1;
+
+  cout << "device color conversion test passed\n";
+  return 0;
+}
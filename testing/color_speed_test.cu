@@ -2,7 +2,9 @@
 
 #include <iostream>
 
+#include <cudatemplates/color.hpp>
 #include <cudatemplates/devicememorypitched.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
 
 #include <cuda_runtime.h>
 
@@ -201,9 +203,96 @@ int CUDAtestMemLoad(int num, int width, int height)
   return 0;
 }
 
+/**
+Does a speed test for color space conversions (time per call in ms)
+*/
+int CUDAtestColorConversion(int num, int width, int height)
+{
+  cout << "Testing Color Space Conversions" << endl;
+  cout << "  Number of calls = " << num << endl;
+  cout << "  Size            = " << width << "x" << height << endl;
+  cout << "                                     host      device" << endl;
+
+  Cuda::Size<2> interleaved_size(width, height);
+  Cuda::Size<2> yuv420_size(width, height * 3 / 2);
+  Cuda::Size<3> plane_size(width, height, 3);
+  Cuda::HostMemoryHeap<float4, 2> h_float4_in(interleaved_size), h_float4_out(interleaved_size);
+  Cuda::HostMemoryHeap<uchar4, 2> h_uchar4_in(interleaved_size), h_uchar4_out(interleaved_size);
+  Cuda::HostMemoryHeap<float, 3> h_plane(plane_size);
+  Cuda::HostMemoryHeap<unsigned char, 2> h_yuv420(yuv420_size);
+  Cuda::DeviceMemoryPitched<float4, 2> d_float4_in(interleaved_size), d_float4_out(interleaved_size);
+  Cuda::DeviceMemoryPitched<uchar4, 2> d_uchar4_in(interleaved_size), d_uchar4_out(interleaved_size);
+  Cuda::DeviceMemoryPitched<float, 3> d_plane(plane_size);
+  Cuda::DeviceMemoryPitched<unsigned char, 2> d_yuv420(yuv420_size);
+
+  for(int i = width * height; i--;) {
+    float4 f = { 0.2f, 0.5f, 0.8f, 1 };
+    uchar4 c = { 50, 128, 200, 255 };
+    h_float4_in.getBuffer()[i] = f;
+    h_uchar4_in.getBuffer()[i] = c;
+  }
+
+  d_float4_in.initMem(0);
+  d_uchar4_in.initMem(0);
+  CUDA_CHECK(cudaGetLastError());
+
+  double start_time, host_time;
+
+#define CUDA_COLOR_TEST(name, call_host, call_device)	\
+  cout << name;						\
+  start_time = getTime();				\
+  for (int i=0; i<num; i++)				\
+    call_host;						\
+  host_time = getTime() - start_time;			\
+  start_time = getTime();				\
+  for (int i=0; i<num; i++)				\
+    call_device;					\
+  cout << host_time / num << "  " << (getTime() - start_time) / num << endl; \
+  CUDA_CHECK(cudaGetLastError());
+
+  CUDA_COLOR_TEST("float4 RGB -> YUV BT.709 (float4)  -  ",
+                  Cuda::rgbToYuv(h_float4_out, h_float4_in, Cuda::YUV_BT709),
+                  Cuda::rgbToYuv(d_float4_out, d_float4_in, Cuda::YUV_BT709));
+  CUDA_COLOR_TEST("float4 RGB -> YUV (3-plane)        -  ",
+                  Cuda::rgbToYuv(h_plane, h_float4_in),
+                  Cuda::rgbToYuv(d_plane, d_float4_in));
+  CUDA_COLOR_TEST("YUV (3-plane) -> float4 RGB        -  ",
+                  Cuda::yuvToRgb(h_float4_out, h_plane),
+                  Cuda::yuvToRgb(d_float4_out, d_plane));
+  CUDA_COLOR_TEST("uchar4 RGB -> YUV (uchar4)         -  ",
+                  Cuda::rgbToYuv(h_uchar4_out, h_uchar4_in),
+                  Cuda::rgbToYuv(d_uchar4_out, d_uchar4_in));
+  CUDA_COLOR_TEST("uchar4 RGBA -> NV12                -  ",
+                  Cuda::rgbToNv12(h_yuv420, h_uchar4_in),
+                  Cuda::rgbToNv12(d_yuv420, d_uchar4_in));
+  CUDA_COLOR_TEST("NV12 -> uchar4 RGBA                -  ",
+                  Cuda::nv12ToRgb(h_uchar4_out, h_yuv420),
+                  Cuda::nv12ToRgb(d_uchar4_out, d_yuv420));
+  CUDA_COLOR_TEST("uchar4 RGBA -> I420                -  ",
+                  Cuda::rgbToI420(h_yuv420, h_uchar4_in),
+                  Cuda::rgbToI420(d_yuv420, d_uchar4_in));
+  CUDA_COLOR_TEST("I420 -> uchar4 RGBA                -  ",
+                  Cuda::i420ToRgb(h_uchar4_out, h_yuv420),
+                  Cuda::i420ToRgb(d_uchar4_out, d_yuv420));
+  CUDA_COLOR_TEST("float4 RGB -> Lab (float4)         -  ",
+                  Cuda::rgbToLab(h_float4_out, h_float4_in),
+                  Cuda::rgbToLab(d_float4_out, d_float4_in));
+  CUDA_COLOR_TEST("Lab (float4) -> float4 RGB         -  ",
+                  Cuda::labToRgb(h_float4_in, h_float4_out),
+                  Cuda::labToRgb(d_float4_in, d_float4_out));
+
+#undef CUDA_COLOR_TEST
+
+  cout << endl << endl;
+  return 0;
+}
+
 int
 main()
 {
+  CUDAtestColorConversion(100, 640, 480);
+  CUDAtestColorConversion(20, 1920, 1080);
+
   CUDAtestMemLoad(5000, 512, 512);
   CUDAtestMemLoad(5000, 327, 571);
   CUDAtestMemLoad(20000, 34, 23);
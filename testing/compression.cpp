@@ -0,0 +1,202 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <iostream>
+
+#include <cudatemplates/compression.hpp>
+#include <cudatemplates/ctv.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/hostmemoryreference.hpp>
+
+using namespace std;
+
+
+const int SIZE  = 256;  // size of test volume in each dimension
+const int COUNT =   5;  // number of repetitions
+
+
+double
+operator-(const struct timeval &t1, const struct timeval &t2)
+{
+  return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
+}
+
+/**
+   Create 12 bit CT-like test volume: smooth structures with some noise.
+*/
+void
+phantom(Cuda::HostMemory<unsigned short, 3> &vol)
+{
+  srand(1);
+
+  for(int z = 0; z < SIZE; ++z)
+    for(int y = 0; y < SIZE; ++y)
+      for(int x = 0; x < SIZE; ++x) {
+	float dx = x - SIZE / 2, dy = y - SIZE / 2, dz = z - SIZE / 2;
+	float r = sqrtf(dx * dx + dy * dy + dz * dz);
+	float v = (r < SIZE * 0.45f) ? 1000 + 800 * cosf(r * 0.05f) + ((r < SIZE * 0.1f) ? 1500 : 0) : 0;
+	vol[Cuda::Size<3>(x, y, z)] = (unsigned short)(v + (v > 0 ? rand() % 8 : 0));
+      }
+}
+
+/**
+   Measure throughput of encoding and decoding.
+   @return decoding throughput in GB/s
+*/
+double
+benchmark(const Cuda::HostMemory<unsigned short, 3> &vol, Cuda::HostMemory<unsigned short, 3> &out,
+	  std::vector<unsigned char> &encoded, int threads)
+{
+#ifdef _OPENMP
+  omp_set_num_threads(threads);
+#endif
+
+  struct timeval t0, t1, t2;
+  gettimeofday(&t0, 0);
+
+  for(int i = COUNT; i--;)
+    Cuda::Compression::encode(encoded, vol);
+
+  gettimeofday(&t1, 0);
+
+  for(int i = COUNT; i--;)
+    Cuda::Compression::decode(out, encoded);
+
+  gettimeofday(&t2, 0);
+  double gb = vol.getBytes() * COUNT / 1e9;
+  cout << threads << " thread(s): encode " << gb / (t1 - t0) << " GB/s, decode " << gb / (t2 - t1) << " GB/s\n";
+  return gb / (t2 - t1);
+}
+
+int
+main()
+{
+  int err = 0;
+  Cuda::Size<3> size(SIZE, SIZE, SIZE);
+  Cuda::HostMemoryHeap<unsigned short, 3> vol(size), out(size);
+  phantom(vol);
+  std::vector<unsigned char> encoded;
+
+  // compression ratio and throughput:
+  int threads = 1;
+
+#ifdef _OPENMP
+  threads = omp_get_max_threads();
+#endif
+
+  double per_core = benchmark(vol, out, encoded, 1);
+
+  if(threads > 1)
+    benchmark(vol, out, encoded, threads);
+
+  cout << "compression ratio " << (double)vol.getBytes() / encoded.size() << ", decode per core "
+       << per_core << " GB/s\n";
+
+  if(memcmp(vol.getBuffer(), out.getBuffer(), vol.getBytes())) {
+    cerr << "round trip failed\n";
+    err = 1;
+  }
+
+  // incompressible data is stored:
+  for(size_t i = vol.getSize(); i--;)
+    vol.getBuffer()[i] = rand();
+
+  Cuda::Compression::encode(encoded, vol);
+  Cuda::Compression::decode(out, encoded);
+
+  if((encoded.size() > Cuda::Compression::bound(vol.getBytes())) ||
+     memcmp(vol.getBuffer(), out.getBuffer(), vol.getBytes())) {
+    cerr << "round trip of random data failed\n";
+    err = 1;
+  }
+
+  // corrupt data is detected:
+  encoded[encoded.size() / 2] ^= 0x55;
+  encoded.resize(encoded.size() - 1);
+
+  try {
+    Cuda::Compression::decode(out, encoded);
+    cerr << "corrupt data not detected\n";
+    err = 1;
+  }
+  catch(const std::exception &e) {
+  }
+
+  // padded data is encoded without padding and can be decoded with another pitch:
+  phantom(vol);
+  Cuda::Size<3> region(100, 50, 20);
+  Cuda::HostMemoryReference<unsigned short, 3> sub(vol, Cuda::Size<3>(10, 20, 30), region);
+  Cuda::Compression::encode(encoded, sub);
+  Cuda::Layout<unsigned short, 3> layout(region);
+  layout.setPitch(128 * sizeof(unsigned short));
+  std::vector<unsigned short> buffer(layout.getSize());
+  Cuda::HostMemoryReference<unsigned short, 3> pitched(layout, &buffer[0]);
+  Cuda::HostMemoryHeap<unsigned short, 3> packed(region);
+  Cuda::Compression::decode(pitched, encoded);
+  Cuda::Compression::decode(packed, encoded);
+  Cuda::Iterator<3> end = Cuda::Iterator<3>(region).setEnd();
+
+  if(Cuda::Compression::size(&encoded[0], encoded.size()) != region[0] * region[1] * region[2] * sizeof(unsigned short)) {
+    cerr << "padding was encoded\n";
+    err = 1;
+  }
+  else {
+    for(Cuda::Iterator<3> i(region); i != end; ++i) {
+      if((pitched[i] != sub[i]) || (packed[i] != sub[i])) {
+	cerr << "round trip of pitched data failed\n";
+	err = 1;
+	break;
+      }
+    }
+  }
+
+  // chunked storage:
+  Cuda::Ctv::Options options;
+  options.codec = Cuda::Ctv::CODEC_LZ;
+  struct timeval t0, t1, t2;
+  gettimeofday(&t0, 0);
+  Cuda::Ctv::save("compression_test.ctv", vol, options);
+  gettimeofday(&t1, 0);
+  Cuda::Ctv::load("compression_test.ctv", out, options);
+  gettimeofday(&t2, 0);
+  remove("compression_test.ctv");
+  double mb = vol.getBytes() / (1024.0 * 1024.0);
+  cout << "compressed .ctv: save " << mb / (t1 - t0) << " MB/s, load " << mb / (t2 - t1) << " MB/s\n";
+
+  if(memcmp(vol.getBuffer(), out.getBuffer(), vol.getBytes())) {
+    cerr << "compressed .ctv round trip failed\n";
+    err = 1;
+  }
+
+  if(err == 0)
+    cout << "all tests passed\n";
+
+  return err;
+}
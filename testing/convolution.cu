@@ -0,0 +1,200 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+#include <cudatemplates/convolution.hpp>
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememorypitched.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/hostmemoryreference.hpp>
+#include <cudatemplates/iterator.hpp>
+
+using namespace std;
+
+
+const int   SIZE    = 2048;  // image size
+const int   COUNT   =   10;  // number of repetitions
+const float EPSILON = 1e-4;  // error threshold
+
+
+double
+operator-(const struct timeval &t1, const struct timeval &t2)
+{
+  return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
+}
+
+/**
+   Straightforward (non-separated) convolution of a single element.
+   @param p position of the element
+   @param q position of the source element (only dimensions below d are set)
+   @param d current dimension
+*/
+template <class Type, unsigned Dim>
+double
+reference(const Cuda::HostMemory<Type, Dim> &src, const Cuda::Convolution::SeparableKernel<Dim> &kernel,
+	  const Cuda::SizeBase<Dim> &p, Cuda::border_t border, Cuda::Size<Dim> q = Cuda::Size<Dim>(), unsigned d = 0)
+{
+  if(d == Dim)
+    return src[q];
+
+  int r = kernel.getRadius(d);
+  double s = 0;
+
+  for(int i = -r; i <= r; ++i) {
+    q[d] = Cuda::border_index((int)p[d] + i, src.size[d], border);
+    s += kernel.getTaps(d)[i + r] * reference(src, kernel, p, border, q, d + 1);
+  }
+
+  return s;
+}
+
+/**
+   Convolve random data on the host and on the device and compare all
+   elements with the reference.
+   Integer results must be the saturated reference rounded to the nearest
+   integer, i.e., intermediate results must not be rounded or saturated.
+*/
+template <class Type, unsigned Dim>
+bool
+check(const char *name, const Cuda::Size<Dim> &size, const Cuda::Convolution::SeparableKernel<Dim> &kernel,
+      float low, float high, double epsilon)
+{
+  Cuda::HostMemoryHeap<Type, Dim> h(size), h_dst(size), d_dst(size);
+
+  for(int i = h.getNumElements(); i--;)
+    h.getBuffer()[i] = (Type)(low + (high - low) * rand() / RAND_MAX);
+
+  Cuda::DeviceMemoryPitched<Type, Dim> d(h), d_tmp(size);
+
+  for(int b = 0; b < 3; ++b) {
+    Cuda::border_t border = (Cuda::border_t)b;
+    Cuda::convolve(h_dst, h, kernel, border);
+    Cuda::convolve(d_tmp, d, kernel, border);
+    Cuda::copy(d_dst, d_tmp);
+    Cuda::Iterator<Dim> end = Cuda::Iterator<Dim>(size).setEnd();
+
+    for(Cuda::Iterator<Dim> i(size); i != end; ++i) {
+      double r = reference(h, kernel, i, border);
+
+      if(std::numeric_limits<Type>::is_integer) {
+	r = std::max(r, (double)std::numeric_limits<Type>::min());
+	r = std::min(r, (double)std::numeric_limits<Type>::max());
+      }
+
+      if((fabs(h_dst[i] - r) > epsilon) || (fabs(d_dst[i] - r) > epsilon)) {
+	cerr << name << " convolution test failed (border " << b << ")\n";
+	return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+int
+main()
+{
+  int err = 0;
+  Cuda::HostMemoryHeap2D<float> h(SIZE, SIZE), h_dst(SIZE, SIZE), d_dst(SIZE, SIZE);
+
+  for(int i = SIZE * SIZE; i--;)
+    h.getBuffer()[i] = (float)rand() / RAND_MAX;
+
+  Cuda::DeviceMemoryPitched2D<float> d(h), d_tmp(h);
+  const char *border_name[] = { "clamp", "mirror", "repeat" };
+  struct timeval t0, t1;
+
+  for(int radius = 1; radius <= 10; ++radius) {
+    Cuda::Convolution::SeparableKernel<2> kernel;
+    kernel.setGaussian(radius / 3.0f, radius);
+    Cuda::border_t border = (Cuda::border_t)(radius % 3);
+    gettimeofday(&t0, 0);
+
+    for(int i = COUNT; i--;)
+      Cuda::convolve(h_dst, h, kernel, border);
+
+    gettimeofday(&t1, 0);
+    double t_host = (t1 - t0) / COUNT;
+    cudaThreadSynchronize();
+    gettimeofday(&t0, 0);
+
+    for(int i = COUNT; i--;)
+      Cuda::convolve(d_tmp, d, kernel, border);
+
+    cudaThreadSynchronize();
+    gettimeofday(&t1, 0);
+    double t_device = (t1 - t0) / COUNT;
+    cout << "radius " << radius << " (" << border_name[border] << "): host "
+	 << SIZE * SIZE / t_host * 1e-6 << " Mpixel/s, device " << SIZE * SIZE / t_device * 1e-6 << " Mpixel/s\n";
+    Cuda::copy(d_dst, d_tmp);
+
+    // compare with reference on a few lines including the borders:
+    for(int y = 0; y < SIZE; y += (y < radius || y >= SIZE - radius - 1) ? 1 : 97) {
+      for(int x = 0; x < SIZE; ++x) {
+	Cuda::Size<2> p(x, y);
+	double r = reference(h, kernel, p, border);
+
+	if((fabs(h_dst[p] - r) > EPSILON) || (fabs(d_dst[p] - r) > EPSILON)) {
+	  cerr << "convolution test failed at (" << x << ", " << y << ")\n";
+	  err = 1;
+	  y = SIZE;
+	  break;
+	}
+      }
+    }
+  }
+
+  // sharpening kernel with intermediate values outside of the range of
+  // unsigned char, rounding error of the final pass only:
+  const float sharpen[] = { -1, 3, -1 };
+  Cuda::Convolution::SeparableKernel<2> kernel2(sharpen, 1);
+
+  if(!check<unsigned char, 2>("unsigned char", Cuda::Size<2>(301, 203), kernel2, 0, 255, 0.5 + 1e-3))
+    err = 1;
+
+  // three passes (alternating between both temporary buffers):
+  Cuda::Convolution::SeparableKernel<3> kernel3(sharpen, 1);
+  kernel3.setGaussian(1, 1.5f);
+
+  if(!check<unsigned char, 3>("3D unsigned char", Cuda::Size<3>(67, 45, 23), kernel3, 0, 255, 0.5 + 1e-3))
+    err = 1;
+
+  kernel3.setGaussian(0, 0.7f, 2);
+  kernel3.setGaussian(2, 1.0f, 9);
+
+  if(!check<float, 3>("3D float", Cuda::Size<3>(67, 45, 23), kernel3, 0, 1, EPSILON))
+    err = 1;
+
+  // empty images:
+  float dummy[2];
+  Cuda::HostMemoryReference<float, 2> h0(Cuda::Size<2>(5, 0), dummy), h1(Cuda::Size<2>(5, 0), dummy + 1);
+  Cuda::DeviceMemoryPitched<float, 2> d0(Cuda::Size<2>(5, 0)), d1(Cuda::Size<2>(5, 0));
+  Cuda::convolve(h1, h0, kernel2);
+  Cuda::convolve(d1, d0, kernel2);
+
+  return err;
+}
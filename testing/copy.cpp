@@ -302,6 +302,37 @@ test_array_copy()
 
 #include "test3d.cpp"
 
+  // four-dimensional data (no CUDA arrays):
+  size_t smax4 = 12;
+  Cuda::Size<4> size4a, size4b, pos4a, pos4b, size4;
+
+  for(size_t i = 4; i--;) {
+    size4a[i] = size4b[i] = smax4;
+    pos4a[i] = smax4 / 4;
+    pos4b[i] = smax4 / 3;
+    size4[i] = smax4 / 2;
+  }
+
+  err |= test_array_copy2<Cuda::HostMemoryHeap<float, 4>, Cuda::HostMemoryHeap<float, 4> >(size4a, size4b, pos4a, pos4b, size4, smax4);
+  err |= test_array_copy2<Cuda::HostMemoryHeap<float, 4>, Cuda::DeviceMemoryLinear<float, 4> >(size4a, size4b, pos4a, pos4b, size4, smax4);
+  err |= test_array_copy2<Cuda::HostMemoryHeap<float, 4>, Cuda::DeviceMemoryPitched<float, 4> >(size4a, size4b, pos4a, pos4b, size4, smax4);
+  err |= test_array_copy2<Cuda::DeviceMemoryLinear<float, 4>, Cuda::DeviceMemoryPitched<float, 4> >(size4a, size4b, pos4a, pos4b, size4, smax4);
+  err |= test_array_copy2<Cuda::DeviceMemoryPitched<float, 4>, Cuda::HostMemoryHeap<float, 4> >(size4a, size4b, pos4a, pos4b, size4, smax4);
+
+  // a region of pitched three-dimensional data takes a single call on the
+  // device, while host copies are done row by row:
+  {
+    const size_t rsize[] = { 6, 6, 6 };
+    const ssize_t dstep[] = { 1, 64, 64 * 12 }, sstep[] = { 1, 12, 12 * 12 };
+    Cuda::Transfer::Plan<3> plan(sizeof(float), rsize, dstep, sstep);
+
+    if((plan.dims != 3) || (plan.calls(cudaMemcpyHostToHost) != 36) ||
+       (plan.calls(cudaMemcpyHostToDevice) != (CUDA_TRANSFER_USE_3D_COPY ? 1 : 6))) {
+      cerr << "unexpected number of memcpy calls for 3D region\n";
+      err = 1;
+    }
+  }
+
   // simple usage example:
   {
     using namespace Cuda;
@@ -0,0 +1,165 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <sys/time.h>
+
+#include <iostream>
+
+#include <cudatemplates/ctv.hpp>
+#include <cudatemplates/devicememorypitched.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+
+using namespace std;
+
+
+const int SIZE = 256;  // size of test volume in each dimension
+
+const char *FILENAME = "ctv_test.ctv";
+
+
+double
+operator-(const struct timeval &t1, const struct timeval &t2)
+{
+  return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
+}
+
+/**
+   Fill host memory with test pattern.
+*/
+template <class Type, unsigned Dim>
+void
+fill(Cuda::HostMemory<Type, Dim> &mem)
+{
+  Cuda::Iterator<Dim> end = mem.end();
+  Type v = 0;
+
+  for(Cuda::Iterator<Dim> i = mem.begin(); i != end; ++i)
+    mem[i] = v++;
+}
+
+/**
+   Compare host memory.
+*/
+template <class Type, unsigned Dim>
+bool
+equal(const Cuda::HostMemory<Type, Dim> &a, const Cuda::HostMemory<Type, Dim> &b)
+{
+  Cuda::Iterator<Dim> end = a.end();
+
+  for(Cuda::Iterator<Dim> i = a.begin(); i != end; ++i)
+    if(a[i] != b[i])
+      return false;
+
+  return true;
+}
+
+/**
+   Round trip through file with given options and chunk size.
+*/
+template <class Type, unsigned Dim>
+bool
+roundtrip(const char *name, const Cuda::Size<Dim> &size, const Cuda::Ctv::Options &options, const Cuda::Size<Dim> &chunk)
+{
+  Cuda::HostMemoryHeap<Type, Dim> src(size);
+  fill(src);
+
+  for(unsigned i = Dim; i--;) {
+    src.spacing[i] = 0.5f + i;
+    src.region_ofs[i] = 1;
+    src.region_size[i] = size[i] - 2;
+  }
+
+  {
+    Cuda::Ctv::Writer writer(FILENAME, src, options, chunk);
+    writer.write(src);
+  }
+
+  // host memory:
+  Cuda::Ctv::Reader reader(FILENAME, options);
+  Cuda::Layout<Type, Dim> layout = reader.getLayout<Type, Dim>();
+  Cuda::HostMemoryHeap<Type, Dim> dst(layout);
+  reader.read(dst);
+  bool ok = equal(src, dst);
+
+  for(unsigned i = Dim; i--;)
+    ok = ok && (dst.spacing[i] == src.spacing[i]) && (dst.region_ofs[i] == 1) && (dst.region_size[i] == size[i] - 2);
+
+  // device memory:
+  Cuda::DeviceMemoryPitched<Type, Dim> dev(layout);
+  reader.read(dev);
+  Cuda::HostMemoryHeap<Type, Dim> back(dev);
+  ok = ok && equal(src, back);
+
+  cout << name << " (" << reader.getChunkCount() << " chunks): " << (ok ? "ok" : "failed") << endl;
+  return ok;
+}
+
+int
+main()
+{
+  int err = 0;
+  Cuda::Ctv::Options buffered, direct;
+  direct.direct = true;
+  buffered.chunk_bytes = direct.chunk_bytes = 1 << 16;
+
+  if(!roundtrip<float, 2>("2D float", Cuda::Size<2>(1000, 333), buffered, Cuda::Size<2>()) ||
+     !roundtrip<float, 2>("2D float, 2D chunks", Cuda::Size<2>(1000, 333), buffered, Cuda::Size<2>(300, 100)) ||
+     !roundtrip<unsigned short, 3>("3D ushort", Cuda::Size<3>(77, 55, 33), buffered, Cuda::Size<3>()) ||
+     !roundtrip<unsigned short, 3>("3D ushort, direct", Cuda::Size<3>(77, 55, 33), direct, Cuda::Size<3>()) ||
+     !roundtrip<int, 3>("3D int, 3D chunks, direct", Cuda::Size<3>(40, 30, 20), direct, Cuda::Size<3>(16, 8, 4)))
+    err = 1;
+
+  // type check:
+  try {
+    Cuda::Ctv::Reader reader(FILENAME);
+    reader.getLayout<float, 3>();
+    cerr << "type mismatch not detected\n";
+    err = 1;
+  }
+  catch(const std::exception &e) {
+  }
+
+  // throughput:
+  Cuda::Size<3> size(SIZE, SIZE, SIZE);
+  Cuda::HostMemoryHeap<float, 3> h(size);
+  Cuda::DeviceMemoryPitched<float, 3> d(size);
+  fill(h);
+  double mb = h.getBytes() / (1024.0 * 1024.0);
+
+  for(int k = 0; k < 2; ++k) {
+    Cuda::Ctv::Options options;
+    options.direct = (k == 1);
+    struct timeval t0, t1, t2, t3;
+    gettimeofday(&t0, 0);
+    Cuda::Ctv::save(FILENAME, h, options);
+    gettimeofday(&t1, 0);
+    Cuda::Ctv::load(FILENAME, h, options);
+    gettimeofday(&t2, 0);
+    Cuda::Ctv::load(FILENAME, d, options);
+    cudaThreadSynchronize();
+    gettimeofday(&t3, 0);
+    cout << (k ? "direct" : "buffered") << ": save " << mb / (t1 - t0) << " MB/s, load to host "
+	 << mb / (t2 - t1) << " MB/s, load to device " << mb / (t3 - t2) << " MB/s\n";
+  }
+
+  remove(FILENAME);
+  return err;
+}
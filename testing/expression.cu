@@ -0,0 +1,219 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/time.h>
+
+#include <cstdlib>
+#include <iostream>
+
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememorypitched.hpp>
+#include <cudatemplates/expression.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+
+using namespace std;
+
+
+const int SIZE  = 2048;  // image size
+const int COUNT =   20;  // number of repetitions
+
+
+double
+operator-(const struct timeval &t1, const struct timeval &t2)
+{
+  return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
+}
+
+/*
+  Compare host and device result of an expression with reference values.
+*/
+template <unsigned Dim>
+int
+check(const char *name, const Cuda::HostMemory<float, Dim> &a, const Cuda::DeviceMemory<float, Dim> &da,
+      const float *ref)
+{
+  Cuda::HostMemoryHeap<float, Dim> t(a.size);
+  Cuda::copy(t, da);
+
+  for(size_t i = a.getNumElements(); i--;)
+    if((a.getBuffer()[i] != ref[i]) || (t.getBuffer()[i] != ref[i])) {
+      cerr << name << " expression test failed at element " << i << endl;
+      return 1;
+    }
+
+  return 0;
+}
+
+/*
+  Evaluate expressions with other operators, scalars and memory operands on
+  host and device.
+*/
+template <class Host, class Device>
+int
+check_operators(const char *name, const Host &b, const Host &c, const Host &d)
+{
+  int err = 0;
+  const size_t n = b.getNumElements();
+  const float *pb = b.getBuffer(), *pc = c.getBuffer(), *pd = d.getBuffer();
+  Host a(b.size), r(b.size);
+  Device da(b.size), db(b), dc(c), dd(d);
+  float *pr = r.getBuffer();
+
+  // plain assignment:
+  Cuda::expr(a) = b;
+  Cuda::expr(da) = db;
+
+  for(size_t i = n; i--;)
+    pr[i] = pb[i];
+
+  err |= check(name, a, da, pr);
+
+  // scalar operands, subtraction and division:
+  Cuda::expr(a) = 2.0f * b - c / 4 + 1;
+  Cuda::expr(da) = 2.0f * db - dc / 4 + 1;
+
+  for(size_t i = n; i--;)
+    pr[i] = 2.0f * pb[i] - pc[i] / 4 + 1;
+
+  err |= check(name, a, da, pr);
+
+  // unary minus:
+  Cuda::expr(a) = -(b - c) / (d + 1) - -b;
+  Cuda::expr(da) = -(db - dc) / (dd + 1) - -db;
+
+  for(size_t i = n; i--;)
+    pr[i] = -(pb[i] - pc[i]) / (pd[i] + 1) - -pb[i];
+
+  err |= check(name, a, da, pr);
+
+  // compound assignment of memory and scalars:
+  Cuda::expr(a) = 10 / (c + 1);
+  Cuda::expr(a) += b;
+  Cuda::expr(a) *= 3;
+  Cuda::expr(a) -= d;
+  Cuda::expr(da) = 10 / (dc + 1);
+  Cuda::expr(da) += db;
+  Cuda::expr(da) *= 3;
+  Cuda::expr(da) -= dd;
+
+  for(size_t i = n; i--;) {
+    pr[i] = 10 / (pc[i] + 1);
+    pr[i] += pb[i];
+    pr[i] *= 3;
+    pr[i] -= pd[i];
+  }
+
+  err |= check(name, a, da, pr);
+
+  return err;
+}
+
+int
+main()
+{
+  int err = 0;
+  Cuda::HostMemoryHeap2D<float> a(SIZE, SIZE), b(SIZE, SIZE), c(SIZE, SIZE), d(SIZE, SIZE), t(SIZE, SIZE);
+
+  for(int i = SIZE * SIZE; i--;) {
+    b.getBuffer()[i] = rand() % 100;
+    c.getBuffer()[i] = rand() % 100;
+    d.getBuffer()[i] = rand() % 100;
+  }
+
+  Cuda::DeviceMemoryPitched2D<float> da(SIZE, SIZE), db(b), dc(c), dd(d), dt(SIZE, SIZE);
+  struct timeval t0, t1;
+
+  // host, one pass per operation:
+  gettimeofday(&t0, 0);
+
+  for(int i = COUNT; i--;) {
+    Cuda::expr(t) = b * c;
+    Cuda::expr(a) = t + d;
+  }
+
+  gettimeofday(&t1, 0);
+  double t_separate = (t1 - t0) / COUNT;
+
+  // host, fused:
+  gettimeofday(&t0, 0);
+
+  for(int i = COUNT; i--;)
+    Cuda::expr(a) = b * c + d;
+
+  gettimeofday(&t1, 0);
+  double t_fused = (t1 - t0) / COUNT;
+  cout << "host:   separate " << t_separate * 1e3 << " ms, fused " << t_fused * 1e3 << " ms\n";
+
+  // device, one pass per operation:
+  cudaThreadSynchronize();
+  gettimeofday(&t0, 0);
+
+  for(int i = COUNT; i--;) {
+    Cuda::expr(dt) = db * dc;
+    Cuda::expr(da) = dt + dd;
+  }
+
+  cudaThreadSynchronize();
+  gettimeofday(&t1, 0);
+  t_separate = (t1 - t0) / COUNT;
+
+  // device, fused:
+  gettimeofday(&t0, 0);
+
+  for(int i = COUNT; i--;)
+    Cuda::expr(da) = db * dc + dd;
+
+  cudaThreadSynchronize();
+  gettimeofday(&t1, 0);
+  t_fused = (t1 - t0) / COUNT;
+  cout << "device: separate " << t_separate * 1e3 << " ms, fused " << t_fused * 1e3 << " ms\n";
+
+  // compare results:
+  Cuda::copy(t, da);
+
+  for(int i = SIZE * SIZE; i--;)
+    if((a.getBuffer()[i] != t.getBuffer()[i]) ||
+       (a.getBuffer()[i] != b.getBuffer()[i] * c.getBuffer()[i] + d.getBuffer()[i])) {
+      cerr << "expression test failed\n";
+      err = 1;
+      break;
+    }
+
+  // other operators in 2D (size not a multiple of the block size) and 3D:
+  Cuda::HostMemoryHeap2D<float> b2(300, 200), c2(300, 200), d2(300, 200);
+  Cuda::HostMemoryHeap3D<float> b3(40, 30, 20), c3(40, 30, 20), d3(40, 30, 20);
+
+  for(int i = 300 * 200; i--;) {
+    b2.getBuffer()[i] = rand() % 100;
+    c2.getBuffer()[i] = rand() % 100;
+    d2.getBuffer()[i] = rand() % 100;
+  }
+
+  for(int i = 40 * 30 * 20; i--;) {
+    b3.getBuffer()[i] = rand() % 100;
+    c3.getBuffer()[i] = rand() % 100;
+    d3.getBuffer()[i] = rand() % 100;
+  }
+
+  err |= check_operators<Cuda::HostMemoryHeap2D<float>, Cuda::DeviceMemoryPitched2D<float> >("2D", b2, c2, d2);
+  err |= check_operators<Cuda::HostMemoryHeap3D<float>, Cuda::DeviceMemoryPitched3D<float> >("3D", b3, c3, d3);
+
+  return err;
+}
@@ -21,11 +21,13 @@
 #include <cstdlib>
 #include <iostream>
 
+#include <cudatemplates/batch.hpp>
 #include <cudatemplates/copy.hpp>
 #include <cudatemplates/cufft.hpp>
 #include <cudatemplates/devicememorylinear.hpp>
 #include <cudatemplates/event.hpp>
 #include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/hostmemoryreference.hpp>
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -37,6 +39,7 @@ using namespace std;
 const size_t SIZE_    =  256;  // image size
 const int    COUNT   = 1000;  // number of FFTs to perform
 const float  EPSILON = 1e-5;  // error threshold
+const size_t ITEMS   =   64;  // number of items in batched FFT
 
 
 double
@@ -100,6 +103,53 @@ main()
 	}
       }
     }
+
+    // batch of 1D transforms, executed by a single CUFFT call:
+    typedef Cuda::DeviceMemoryLinear<Cuda::FFT::real, 2> RealStorage;
+    typedef Cuda::DeviceMemoryLinear<Cuda::FFT::complex, 2> ComplexStorage;
+    Cuda::Batch<Cuda::FFT::real, 1, RealStorage> batch1_g(Cuda::Size<1>(SIZE_), ITEMS), batch2_g(Cuda::Size<1>(SIZE_), ITEMS);
+    Cuda::Batch<Cuda::FFT::complex, 1, ComplexStorage> batch_fft_g(Cuda::Size<1>(SIZE_ / 2 + 1), ITEMS);
+    Cuda::FFT::Plan<Cuda::FFT::real, Cuda::FFT::complex, 1> plan_r2c_batch(Cuda::Size<1>(SIZE_), batch1_g);
+    Cuda::FFT::Plan<Cuda::FFT::complex, Cuda::FFT::real, 1> plan_c2r_batch(Cuda::Size<1>(SIZE_), batch1_g);
+    Cuda::Size<2> batch_size(SIZE_, ITEMS);
+    copy(batch1_g.getStorage(), data1_h, Cuda::Size<2>(), Cuda::Size<2>(), batch_size);
+    plan_r2c_batch.exec(batch1_g, batch_fft_g);
+
+    // the spectrum of each item must match a single transform:
+    const size_t ITEM = ITEMS / 2 + 1;
+    Cuda::DeviceMemoryLinear1D<Cuda::FFT::real> item_g(SIZE_);
+    Cuda::DeviceMemoryLinear1D<Cuda::FFT::complex> item_fft_g(SIZE_ / 2 + 1);
+    Cuda::HostMemoryHeap1D<Cuda::FFT::complex> item_fft_h(SIZE_ / 2 + 1);
+    Cuda::HostMemoryHeap2D<Cuda::FFT::complex> batch_fft_h(SIZE_ / 2 + 1, ITEMS);
+    Cuda::FFT::Plan<Cuda::FFT::real, Cuda::FFT::complex, 1> plan_r2c_item(item_g.size);
+    Cuda::HostMemoryReference1D<Cuda::FFT::real> item_h(SIZE_, data1_h.getBuffer() + ITEM * data1_h.stride[0]);
+    copy(item_g, item_h);
+    plan_r2c_item.exec(item_g, item_fft_g);
+    copy(item_fft_h, item_fft_g);
+    copy(batch_fft_h, batch_fft_g.getStorage());
+
+    for(size_t i = 0; i < SIZE_ / 2 + 1; ++i) {
+      Cuda::FFT::complex a = item_fft_h[i], b = batch_fft_h[Cuda::Size<2>(i, ITEM)];
+
+      if((fabs(a.x - b.x) > EPSILON * SIZE_) || (fabs(a.y - b.y) > EPSILON * SIZE_)) {
+	cerr << "batched FFT spectrum doesn't match single FFT\n";
+	return 1;
+      }
+    }
+
+    plan_c2r_batch.exec(batch_fft_g, batch2_g);
+    copy(data2_h, batch2_g.getStorage(), Cuda::Size<2>(), Cuda::Size<2>(), batch_size);
+
+    for(index[1] = ITEMS; index[1]--;) {
+      for(index[0] = SIZE_; index[0]--;) {
+	float d = data2_h[index] / SIZE_ - data1_h[index];
+
+	if(fabs(d) > EPSILON) {
+	  cerr << "batched FFT failed\n";
+	  return 1;
+	}
+      }
+    }
   }
   catch(const exception &e) {
     cerr << e.what();
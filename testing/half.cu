@@ -0,0 +1,242 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <iostream>
+
+#include <cudatemplates/convert.hpp>
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememorylinear.hpp>
+#include <cudatemplates/devicememorypitched.hpp>
+#include <cudatemplates/half.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/pack.hpp>
+
+using namespace std;
+
+
+const size_t SIZE    = 4096;      // image size for bandwidth test
+const size_t SAMPLES = 10000000;  // number of random floats to convert
+const int    COUNT   = 10;        // number of conversions for timing
+
+
+double
+operator-(const struct timeval &t1, const struct timeval &t2)
+{
+  return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
+}
+
+/**
+   Get random bit pattern.
+*/
+inline uint32_t
+random32()
+{
+  return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+/**
+   Check scalar conversions against the software implementation.
+*/
+bool
+check_scalar()
+{
+  // all half values:
+  for(uint32_t h = 0; h < 0x10000; ++h) {
+    float f = Cuda::Float16::toFloatSoftware(h);
+
+    if(Cuda::Float16::bits(Cuda::half::fromBits(h)) != Cuda::Float16::bits(f)) {
+      cerr << "half to float conversion of " << hex << h << dec << " failed\n";
+      return false;
+    }
+
+    if(Cuda::Float16::fromFloatSoftware(f) != (((h & 0x7fff) > 0x7c00) ? (h | 0x200) : h)) {
+      cerr << "half round trip of " << hex << h << dec << " failed\n";
+      return false;
+    }
+  }
+
+  // rounding of random floats:
+  for(size_t i = 0; i < SAMPLES; ++i) {
+    float f = Cuda::Float16::value(random32());
+
+    if(Cuda::half(f).x != Cuda::Float16::fromFloatSoftware(f)) {
+      cerr << "float to half conversion of " << f << " failed\n";
+      return false;
+    }
+  }
+
+  // ties round to even:
+  if((Cuda::half(1.0f + 1.0f / 2048).x != 0x3c00) || (Cuda::half(1.0f + 3.0f / 2048).x != 0x3c02) ||
+     (Cuda::half(65520.0f).x != 0x7c00) || (Cuda::half(65519.0f).x != 0x7bff) ||
+     (Cuda::half(ldexpf(1, -25)).x != 0) || (Cuda::half(ldexpf(3, -26)).x != 1)) {
+    cerr << "half rounding failed\n";
+    return false;
+  }
+
+  // all bfloat16 values:
+  for(uint32_t b = 0; b < 0x10000; ++b) {
+    float f = Cuda::bfloat16::fromBits(b);
+
+    if(((b & 0x7fff) <= 0x7f80) && (Cuda::bfloat16(f).x != b)) {
+      cerr << "bfloat16 round trip of " << hex << b << dec << " failed\n";
+      return false;
+    }
+  }
+
+  if((Cuda::bfloat16(1.0f + 1.0f / 256).x != 0x3f80) || (Cuda::bfloat16(1.0f + 3.0f / 256).x != 0x3f82)) {
+    cerr << "bfloat16 rounding failed\n";
+    return false;
+  }
+
+  return true;
+}
+
+/**
+   Check conversion of images in host memory and measure bandwidth.
+*/
+template <class Type>
+bool
+check_host(const char *name, float epsilon)
+{
+  Cuda::Size<2> size(SIZE, SIZE), index;
+  Cuda::HostMemoryHeap<float, 2> data1(size), data3(size);
+  Cuda::HostMemoryHeap<Type, 2> data2(size);
+
+  for(index[1] = SIZE; index[1]--;)
+    for(index[0] = SIZE; index[0]--;)
+      data1[index] = rand() / (float)RAND_MAX;
+
+  struct timeval t1, t2, t3;
+  gettimeofday(&t1, 0);
+
+  for(int i = COUNT; i--;)
+    copy(data2, data1);
+
+  gettimeofday(&t2, 0);
+
+  for(int i = COUNT; i--;)
+    copy(data3, data2);
+
+  gettimeofday(&t3, 0);
+  double bytes = (double)SIZE * SIZE * (sizeof(float) + sizeof(Type)) * COUNT / (1 << 30);
+  cout
+    << name << ": float to " << name << ": " << (bytes / (t2 - t1)) << " GB/s, "
+    << name << " to float: " << (bytes / (t3 - t2)) << " GB/s\n";
+
+  for(index[1] = SIZE; index[1]--;) {
+    for(index[0] = SIZE; index[0]--;) {
+      if(fabs(data3[index] - data1[index]) > epsilon) {
+	cerr << name << " host conversion failed\n";
+	return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+/**
+   Check storage, conversion and packing in device memory.
+*/
+bool
+check_device()
+{
+  const size_t N = 256;
+  Cuda::Size<2> size(N, N), index;
+  Cuda::HostMemoryHeap<float, 2> data1_h(size), data2_h(size);
+  Cuda::HostMemoryHeap<Cuda::half, 2> half1_h(size), half2_h(size);
+
+  for(index[1] = N; index[1]--;)
+    for(index[0] = N; index[0]--;)
+      data1_h[index] = rand() / (float)RAND_MAX * 1000 - 500;
+
+  copy(half1_h, data1_h);
+
+  // conversion on the device must match the host:
+  Cuda::DeviceMemoryPitched<float, 2> data_g(size);
+  Cuda::DeviceMemoryPitched<Cuda::half, 2> half_g(size);
+  copy(data_g, data1_h);
+  copy(half_g, data_g);
+  copy(half2_h, half_g);
+
+  for(index[1] = N; index[1]--;) {
+    for(index[0] = N; index[0]--;) {
+      if(half1_h[index].x != half2_h[index].x) {
+	cerr << "device conversion to half failed\n";
+	return false;
+      }
+    }
+  }
+
+  // pack four float planes into half4 and unpack again:
+  Cuda::DeviceMemoryLinear<float, 2> x_g(data1_h), y_g(data1_h), z_g(data1_h), w_g(data1_h);
+  Cuda::DeviceMemoryLinear<Cuda::half4, 2> vector_g(size);
+  Cuda::pack(vector_g, x_g, y_g, z_g, w_g);
+  Cuda::unpack(x_g, y_g, z_g, w_g, vector_g);
+  Cuda::DeviceMemoryLinear<float, 2> *planes[] = { &x_g, &y_g, &z_g, &w_g };
+
+  for(int i = 4; i--;) {
+    copy(data2_h, *planes[i]);
+
+    for(index[1] = N; index[1]--;) {
+      for(index[0] = N; index[0]--;) {
+	if(data2_h[index] != (float)half1_h[index]) {
+	  cerr << "pack/unpack of half4 failed\n";
+	  return false;
+	}
+      }
+    }
+  }
+
+  return true;
+}
+
+int
+main()
+{
+  try {
+#ifdef CUDA_HALF_USE_F16C
+    cout << "using F16C for host conversions\n";
+#endif
+
+    if(!check_scalar())
+      return 1;
+
+    if(!check_host<Cuda::half>("half", 1.0f / 2048))
+      return 1;
+
+    if(!check_host<Cuda::bfloat16>("bfloat16", 1.0f / 256))
+      return 1;
+
+    if(!check_device())
+      return 1;
+  }
+  catch(const exception &e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  cout << "half precision test passed\n";
+  return 0;
+}
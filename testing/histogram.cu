@@ -0,0 +1,142 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/time.h>
+
+#include <cstdlib>
+#include <iostream>
+
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememorylinear.hpp>
+#include <cudatemplates/devicememorypitched.hpp>
+#include <cudatemplates/histogram.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/integral.hpp>
+
+using namespace std;
+
+
+const int SIZE  = 4096;  // image size
+const int COUNT =   10;  // number of repetitions
+
+
+double
+operator-(const struct timeval &t1, const struct timeval &t2)
+{
+  return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
+}
+
+int
+main()
+{
+  int err = 0;
+  Cuda::HostMemoryHeap2D<unsigned char> h(SIZE, SIZE);
+
+  for(int i = SIZE * SIZE; i--;)
+    h.getBuffer()[i] = rand() & 255;
+
+  Cuda::DeviceMemoryPitched2D<unsigned char> d(h);
+  Cuda::Size<2> ofs(100, 200), size(SIZE - 300, SIZE - 400);
+  h.setRegion(ofs, size);
+  d.setRegion(ofs, size);
+  struct timeval t0, t1;
+
+  // histogram:
+  Cuda::HostMemoryHeap1D<unsigned> hist_host((size_t)256);
+  Cuda::DeviceMemoryLinear1D<unsigned> dhist((size_t)256);
+  gettimeofday(&t0, 0);
+
+  for(int i = COUNT; i--;)
+    Cuda::histogram(h, hist_host);
+
+  gettimeofday(&t1, 0);
+  double t_host = (t1 - t0) / COUNT;
+  cudaThreadSynchronize();
+  gettimeofday(&t0, 0);
+
+  for(int i = COUNT; i--;)
+    Cuda::histogram(d, dhist);
+
+  cudaThreadSynchronize();
+  gettimeofday(&t1, 0);
+  double t_device = (t1 - t0) / COUNT;
+  double pixels = (double)size[0] * size[1];
+  cout << "histogram: host " << pixels / t_host * 1e-6 << " Mpixel/s, device " << pixels / t_device * 1e-6 << " Mpixel/s\n";
+  Cuda::HostMemoryHeap1D<unsigned> hist_device(dhist);
+  unsigned total = 0;
+
+  for(int i = 0; i < 256; ++i) {
+    total += hist_host.getBuffer()[i];
+
+    if(hist_host.getBuffer()[i] != hist_device.getBuffer()[i]) {
+      cerr << "histogram test failed\n";
+      err = 1;
+      break;
+    }
+  }
+
+  if(total != pixels) {
+    cerr << "histogram test failed\n";
+    err = 1;
+  }
+
+  // integral image:
+  Cuda::HostMemoryHeap2D<unsigned> int_host(size);
+  Cuda::DeviceMemoryPitched2D<unsigned> dint(size);
+  gettimeofday(&t0, 0);
+
+  for(int i = COUNT; i--;)
+    Cuda::integral(int_host, h);
+
+  gettimeofday(&t1, 0);
+  t_host = (t1 - t0) / COUNT;
+  cudaThreadSynchronize();
+  gettimeofday(&t0, 0);
+
+  for(int i = COUNT; i--;)
+    Cuda::integral(dint, d);
+
+  cudaThreadSynchronize();
+  gettimeofday(&t1, 0);
+  t_device = (t1 - t0) / COUNT;
+  cout << "integral:  host " << pixels / t_host * 1e-6 << " Mpixel/s, device " << pixels / t_device * 1e-6 << " Mpixel/s\n";
+  Cuda::HostMemoryHeap2D<unsigned> int_device(size);
+  Cuda::copy(int_device, dint);
+
+  // the last element is the weighted sum of the histogram:
+  unsigned s = 0;
+
+  for(int i = 0; i < 256; ++i)
+    s += hist_host.getBuffer()[i] * i;
+
+  for(int i = size[0] * size[1]; i--;)
+    if(int_host.getBuffer()[i] != int_device.getBuffer()[i]) {
+      cerr << "integral test failed\n";
+      err = 1;
+      break;
+    }
+
+  if(int_host.getBuffer()[size[0] * size[1] - 1] != s) {
+    cerr << "integral test failed\n";
+    err = 1;
+  }
+
+  return err;
+}
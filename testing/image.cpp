@@ -0,0 +1,259 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <iostream>
+
+#include <cudatemplates/devicememorypitched.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/hostmemorylocked.hpp>
+#include <cudatemplates/image.hpp>
+#include <cudatemplates/stream.hpp>
+
+using namespace std;
+
+
+const int WIDTH  = 1920;  // image width
+const int HEIGHT = 1080;  // image height
+const int COUNT  =   20;  // number of repetitions
+
+
+typedef Cuda::Image<Cuda::HostMemoryHeap2D<float>, Cuda::DeviceMemoryPitched2D<float>, float> Image;
+
+
+double
+operator-(const struct timeval &t1, const struct timeval &t2)
+{
+  return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
+}
+
+/**
+   Draw some annotations (a box outline and a label) into the host image.
+*/
+void
+annotate(Image &image, int n, float value)
+{
+  const int x = (n * 97) % (WIDTH - 200), y = (n * 61) % (HEIGHT - 100);
+  const int box[][4] = {
+    { x, y, 200, 2 }, { x, y + 98, 200, 2 }, { x, y + 2, 2, 96 }, { x + 198, y + 2, 2, 96 },  // outline
+    { x + 10, y + 10, 80, 12 }, { x + 90, y + 10, 30, 12 }                                    // label
+  };
+  float *buffer = image.getHostBuffer();
+
+  for(int i = 0; i < 6; ++i) {
+    for(int v = box[i][1]; v < box[i][1] + box[i][3]; ++v)
+      for(int u = box[i][0]; u < box[i][0] + box[i][2]; ++u)
+	buffer[u + v * WIDTH] = value;
+
+    image.setHostModified(Cuda::Size<2>(box[i][0], box[i][1]), Cuda::Size<2>(box[i][2], box[i][3]));
+  }
+}
+
+/**
+   Check if device memory equals host memory.
+*/
+template <class Host, class Device, class Pixel>
+bool
+equal(Cuda::Image<Host, Device, Pixel> &image)
+{
+  Cuda::HostMemoryHeap2D<Pixel> r(*image.getDeviceEntity());
+  Cuda::Iterator<2> end = r.end();
+
+  for(Cuda::Iterator<2> i = r.begin(); i != end; ++i)
+    if(memcmp(&r[i], &(*image.getHostEntity())[i], sizeof(Pixel)))
+      return false;
+
+  return true;
+}
+
+/**
+   Test ingestion of raw image data.
+   The result is compared with a plain conversion loop, the elapsed times of
+   both and of the asynchronous upload are reported.
+*/
+template <class Pixel, class SrcType>
+bool
+ingest(const char *name, unsigned channels, unsigned bits)
+{
+  typedef Cuda::Image<Cuda::HostMemoryLocked2D<Pixel>, Cuda::DeviceMemoryPitched2D<Pixel>, Pixel> Image;
+  const size_t step = (WIDTH + 13) * channels * sizeof(SrcType);  // padded rows
+  char *data = new char[step * HEIGHT];
+
+  for(int y = HEIGHT; y--;)
+    for(int x = WIDTH * channels; x--;)
+      ((SrcType *)(data + y * step))[x] = (x * 31 + y * 17) & ((1 << bits) - 1);
+
+  Image image(new Cuda::HostMemoryLocked2D<Pixel>(WIDTH, HEIGHT));
+  Cuda::HostMemoryHeap2D<Pixel> ref(WIDTH, HEIGHT);
+  const float scale = 1.0f / ((1 << bits) - 1);
+  struct timeval t0, t1;
+  double t[4];
+
+  // plain loop:
+  gettimeofday(&t0, 0);
+
+  for(int n = COUNT; n--;)
+    for(int y = 0; y < HEIGHT; ++y)
+      for(int x = 0; x < WIDTH; ++x) {
+	float c[4] = { 0, 0, 0, 1 };
+
+	for(unsigned k = 0; k < 4; ++k)
+	  c[k] = (k < channels) ? ((const SrcType *)(data + y * step))[x * channels + k] * scale :
+	    (k == 3) ? 1.0f : c[channels - 1];
+
+	Cuda::Ingestion::Output<Pixel>::store(ref[Cuda::Size<2>(x, y)], c);
+      }
+
+  gettimeofday(&t1, 0);
+  t[0] = (t1 - t0) / COUNT * 1000;
+
+  // conversion only:
+  gettimeofday(&t0, 0);
+
+  for(int n = COUNT; n--;)
+    Cuda::Ingestion::convert(image.getHostBuffer(), WIDTH, (const SrcType *)data, step, WIDTH, 0, HEIGHT, channels, bits);
+
+  gettimeofday(&t1, 0);
+  t[1] = (t1 - t0) / COUNT * 1000;
+
+  // conversion, synchronous upload:
+  gettimeofday(&t0, 0);
+
+  for(int n = COUNT; n--;)
+    image.updateHostBuffer((const SrcType *)data, WIDTH, HEIGHT, channels, bits, step);
+
+  gettimeofday(&t1, 0);
+  t[2] = (t1 - t0) / COUNT * 1000;
+
+  // conversion, asynchronous upload:
+  Cuda::Stream stream;
+  gettimeofday(&t0, 0);
+
+  for(int n = COUNT; n--;) {
+    image.updateHostBuffer((const SrcType *)data, WIDTH, HEIGHT, channels, bits, step, stream);
+    stream.synchronize();
+  }
+
+  gettimeofday(&t1, 0);
+  t[3] = (t1 - t0) / COUNT * 1000;
+  delete[] data;
+
+  cout << name << ": loop " << t[0] << " ms, conversion " << t[1] << " ms, with upload " << t[2]
+       << " ms, with asynchronous upload " << t[3] << " ms\n";
+  Cuda::Iterator<2> end = ref.end();
+
+  for(Cuda::Iterator<2> i = ref.begin(); i != end; ++i)
+    if(memcmp(&ref[i], &(*image.getHostEntity())[i], sizeof(Pixel))) {
+      cerr << name << ": ingestion failed\n";
+      return false;
+    }
+
+  return equal(image);
+}
+
+int
+main()
+{
+  int err = 0;
+  Cuda::HostMemoryHeap2D<float> *h = new Cuda::HostMemoryHeap2D<float>(WIDTH, HEIGHT);
+
+  for(int i = WIDTH * HEIGHT; i--;)
+    h->getBuffer()[i] = i;
+
+  Image image(h);
+
+  // region merging:
+  annotate(image, 0, 1);
+  cout << "regions after annotation: " << image.hostModifiedRegions().regions().size()
+       << ", modified pixels: " << image.hostModifiedRegions().area() << endl;
+
+  if(!equal(image)) {
+    cerr << "partial host to device update failed\n";
+    err = 1;
+  }
+
+  // device modification, copied back to host:
+  {
+    Cuda::HostMemoryHeap2D<float> patch(64, 32);
+
+    for(int i = 64 * 32; i--;)
+      patch.getBuffer()[i] = -1;
+
+    Cuda::Size<2> ofs(300, 400);
+    Cuda::copy(*image.getDeviceEntity(), patch, ofs, Cuda::Size<2>(), patch.size);
+    image.setDeviceModified(ofs, patch.size);
+
+    if((image.getHostBuffer()[300 + 400 * WIDTH] != -1) || !equal(image)) {
+      cerr << "partial device to host update failed\n";
+      err = 1;
+    }
+  }
+
+  // timing of partial and full updates:
+  struct timeval t0, t1;
+  double t[2];
+
+  for(int k = 0; k < 2; ++k) {
+    Cuda::Stream stream;
+    gettimeofday(&t0, 0);
+
+    for(int n = 0; n < COUNT; ++n) {
+      annotate(image, n, n);
+
+      if(k == 1)
+	image.setHostModified();
+
+      image.getDeviceEntity(stream);
+    }
+
+    stream.synchronize();
+    gettimeofday(&t1, 0);
+    t[k] = (t1 - t0) / COUNT * 1000;
+  }
+
+  cout << "update: partial " << t[0] << " ms, full " << t[1] << " ms\n";
+
+  if(!equal(image)) {
+    cerr << "asynchronous update failed\n";
+    err = 1;
+  }
+
+  // ingestion of raw data:
+  if(!ingest<float, unsigned char>("8 bit mono", 1, 8) ||
+     !ingest<float, unsigned short>("12 bit mono", 1, 12) ||
+     !ingest<float4, unsigned char>("8 bit rgb", 3, 8) ||
+     !ingest<float4, unsigned short>("16 bit rgba", 4, 16))
+    err = 1;
+
+  // 32 bit samples (the scale must not be computed in 32 bit arithmetic):
+  const unsigned int samples[] = { 0xffffffffu, 0x80000000u, 0 };
+  float normalized[3];
+  Cuda::Ingestion::convert(normalized, 3, samples, sizeof(samples), 3, 0, 1, 1, 32);
+
+  if((normalized[0] != 1) || (fabs(normalized[1] - 0.5f) > 1e-6) || (normalized[2] != 0)) {
+    cerr << "32 bit ingestion failed\n";
+    err = 1;
+  }
+
+  return err;
+}
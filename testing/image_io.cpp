@@ -0,0 +1,260 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <iostream>
+#include <sstream>
+
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/hostmemoryreference.hpp>
+#include <cudatemplates/imageio.hpp>
+
+using namespace std;
+
+
+const int WIDTH  = 1024;  // image width
+const int HEIGHT =  768;  // image height
+const int IMAGES =   32;  // number of images for batch decoding
+
+
+double
+operator-(const struct timeval &t1, const struct timeval &t2)
+{
+  return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
+}
+
+template <class Type>
+void
+fill(Cuda::HostMemory<Type, 2> &image, int n)
+{
+  typedef typename Cuda::ImageIO::Pixel<Type>::Component Component;
+
+  for(size_t y = 0; y < image.size[1]; ++y)
+    for(size_t x = 0; x < image.size[0]; ++x) {
+      Component *p = (Component *)&image[Cuda::Size<2>(x, y)];
+
+      for(int c = 0; c < Cuda::ImageIO::Pixel<Type>::channels; ++c)
+	p[c] = (Component)((x * 3 + y * 5 + c * 7 + n) % 251);
+    }
+}
+
+/**
+   Write image and read it back into padded memory.
+*/
+template <class Type>
+bool
+roundtrip(const char *filename)
+{
+  Cuda::HostMemoryHeap<Type, 2> src(Cuda::Size<2>(WIDTH, HEIGHT));
+  fill(src, 0);
+  Cuda::ImageIO::save(filename, src);
+
+  // destination with padded rows:
+  Cuda::Layout<Type, 2> layout(Cuda::ImageIO::size(filename));
+  layout.setPitch((WIDTH + 17) * sizeof(Type));
+  std::vector<Type> buffer(layout.getSize());
+  Cuda::HostMemoryReference<Type, 2> dst(layout, &buffer[0]);
+  Cuda::ImageIO::load(filename, dst);
+  remove(filename);
+
+  for(size_t y = 0; y < HEIGHT; ++y)
+    if(memcmp(&src[Cuda::Size<2>(0, y)], &dst[Cuda::Size<2>(0, y)], WIDTH * sizeof(Type))) {
+      cerr << filename << ": round trip failed\n";
+      return false;
+    }
+
+  cout << filename << ": ok\n";
+  return true;
+}
+
+/**
+   Write RGB image and read it into four-channel memory.
+*/
+bool
+expand()
+{
+  Cuda::HostMemoryHeap<uchar3, 2> src(Cuda::Size<2>(WIDTH, HEIGHT));
+  Cuda::HostMemoryHeap<uchar4, 2> dst(src.size);
+  fill(src, 0);
+  Cuda::ImageIO::save("image_io_test.ppm", src);
+  Cuda::ImageIO::load("image_io_test.ppm", dst);
+  remove("image_io_test.ppm");
+
+  for(size_t i = 0; i < src.getSize(); ++i) {
+    const uchar3 &a = src.getBuffer()[i];
+    const uchar4 &b = dst.getBuffer()[i];
+
+    if((a.x != b.x) || (a.y != b.y) || (a.z != b.z) || (b.w != 255)) {
+      cerr << "RGB to RGBA failed\n";
+      return false;
+    }
+  }
+
+  cout << "RGB to RGBA: ok\n";
+  return true;
+}
+
+/**
+   Compare decoded batch with the generated images.
+*/
+template <class Type>
+bool
+decoded(const std::vector<Cuda::HostMemory<Type, 2> *> &images)
+{
+  Cuda::HostMemoryHeap<Type, 2> ref(images[0]->size);
+
+  for(size_t i = 0; i < images.size(); ++i) {
+    fill(ref, (int)i);
+
+    if(memcmp(ref.getBuffer(), images[i]->getBuffer(), ref.getBytes()))
+      return false;
+  }
+
+  return true;
+}
+
+/**
+   Decode batch of images with given number of threads.
+   The destinations are cleared first, so that a load which doesn't write
+   the images is detected.
+   @return elapsed time in seconds
+*/
+template <class Type>
+double
+batch(const std::vector<std::string> &filenames, std::vector<Cuda::HostMemory<Type, 2> *> &images, int threads)
+{
+  for(size_t i = 0; i < images.size(); ++i)
+    memset(images[i]->getBuffer(), 0, images[i]->getBytes());
+
+#ifdef _OPENMP
+  omp_set_num_threads(threads);
+#endif
+
+  struct timeval t0, t1;
+  gettimeofday(&t0, 0);
+  Cuda::ImageIO::load(filenames, images);
+  gettimeofday(&t1, 0);
+  return t1 - t0;
+}
+
+template <class Type>
+bool
+benchmark(const char *ext)
+{
+  std::vector<std::string> filenames;
+  std::vector<Cuda::HostMemory<Type, 2> *> images;
+  std::vector<const Cuda::HostMemory<Type, 2> *> sources;
+
+  for(int i = 0; i < IMAGES; ++i) {
+    std::ostringstream s;
+    s << "image_io_test_" << i << ext;
+    filenames.push_back(s.str());
+    images.push_back(new Cuda::HostMemoryHeap<Type, 2>(Cuda::Size<2>(WIDTH, HEIGHT)));
+    fill(*images.back(), i);
+    sources.push_back(images.back());
+  }
+
+  Cuda::ImageIO::save(filenames, sources);
+  int threads = 1;
+
+#ifdef _OPENMP
+  threads = omp_get_max_threads();
+#endif
+
+  double t1 = batch(filenames, images, 1);
+  bool ok = decoded(images);
+  double tn = batch(filenames, images, threads);
+  ok = decoded(images) && ok;
+
+  for(int i = 0; i < IMAGES; ++i) {
+    remove(filenames[i].c_str());
+    delete images[i];
+  }
+
+  cout << IMAGES << " " << ext << " images: " << IMAGES / t1 << " images/s with 1 thread, "
+       << IMAGES / tn << " images/s with " << threads << " threads\n";
+
+  if(!ok)
+    cerr << ext << ": batch decoding failed\n";
+
+  return ok;
+}
+
+int
+main()
+{
+  int err = 0;
+
+  if(!roundtrip<unsigned char>("image_io_test.pgm") ||
+     !roundtrip<unsigned short>("image_io_test_16.pgm") ||
+     !roundtrip<uchar3>("image_io_test.ppm") ||
+     !roundtrip<float>("image_io_test.pfm") ||
+     !roundtrip<float3>("image_io_test_rgb.pfm") ||
+     !expand())
+    err = 1;
+
+#ifdef CUDA_IMAGEIO_USE_PNG
+  if(!roundtrip<unsigned char>("image_io_test.png") ||
+     !roundtrip<ushort4>("image_io_test_16.png"))
+    err = 1;
+
+  // existing test image:
+  try {
+    Cuda::HostMemoryHeap<unsigned char, 2> cameraman(Cuda::ImageIO::size("cameraman.png"));
+    Cuda::ImageIO::load("cameraman.png", cameraman);
+    cout << "cameraman.png: " << cameraman.size[0] << "x" << cameraman.size[1] << endl;
+  }
+  catch(const std::exception &e) {
+    cerr << e.what();
+    err = 1;
+  }
+#endif
+
+  // type mismatch is detected:
+  try {
+    Cuda::HostMemoryHeap<unsigned char, 2> gray(Cuda::Size<2>(WIDTH, HEIGHT));
+    Cuda::HostMemoryHeap<float, 2> f(gray.size);
+    Cuda::ImageIO::save("image_io_test.pgm", gray);
+    Cuda::ImageIO::load("image_io_test.pgm", f);
+    cerr << "type mismatch not detected\n";
+    err = 1;
+  }
+  catch(const std::exception &e) {
+  }
+
+  remove("image_io_test.pgm");
+
+  if(!benchmark<unsigned char>(".pgm"))
+    err = 1;
+
+#ifdef CUDA_IMAGEIO_USE_PNG
+  if(!benchmark<uchar3>(".png"))
+    err = 1;
+#endif
+
+  return err;
+}
@@ -0,0 +1,133 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <sys/time.h>
+
+#include <iostream>
+
+#include <cudatemplates/devicememorypitched.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/outofcorearray.hpp>
+
+using namespace std;
+
+
+const int SIZE  = 256;  // size of test volume in each dimension
+const int CHUNK =  32;  // size of chunks in each dimension
+const int TILE  =  48;  // size of tiles in each dimension (not aligned to chunks)
+
+const char *FILENAME = "out_of_core_test.ctv";
+
+
+double
+operator-(const struct timeval &t1, const struct timeval &t2)
+{
+  return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
+}
+
+inline float
+value(size_t x, size_t y, size_t z)
+{
+  return x + y * SIZE + z * SIZE * SIZE;
+}
+
+/**
+   Check tile copied from given offset.
+*/
+bool
+check(const Cuda::HostMemory<float, 3> &tile, const Cuda::Size<3> &ofs, const Cuda::Size<3> &size)
+{
+  for(size_t z = 0; z < size[2]; ++z)
+    for(size_t y = 0; y < size[1]; ++y)
+      for(size_t x = 0; x < size[0]; ++x)
+	if(tile[Cuda::Size<3>(x, y, z)] != value(ofs[0] + x, ofs[1] + y, ofs[2] + z))
+	  return false;
+
+  return true;
+}
+
+int
+main()
+{
+  int err = 0;
+
+  // create dataset:
+  {
+    Cuda::HostMemoryHeap<float, 3> vol(Cuda::Size<3>(SIZE, SIZE, SIZE));
+
+    for(int z = 0; z < SIZE; ++z)
+      for(int y = 0; y < SIZE; ++y)
+	for(int x = 0; x < SIZE; ++x)
+	  vol[Cuda::Size<3>(x, y, z)] = value(x, y, z);
+
+    Cuda::Ctv::Writer writer(FILENAME, vol, Cuda::Ctv::Options(), Cuda::Size<3>(CHUNK, CHUNK, CHUNK));
+    writer.write(vol);
+  }
+
+  // cache holds one slab of chunks plus some spare:
+  const size_t cache_bytes = (SIZE / CHUNK) * (SIZE / CHUNK) * 2 * CHUNK * CHUNK * CHUNK * sizeof(float);
+  Cuda::OutOfCoreArray<float, 3> array(FILENAME, cache_bytes);
+  Cuda::HostMemoryHeap<float, 3> tile(Cuda::Size<3>(TILE, TILE, TILE));
+  Cuda::DeviceMemoryPitched<float, 3> dtile(tile.size);
+  struct timeval t0, t1;
+  bool ok = true;
+
+  // tile-based traversal, copy to host and device memory:
+  gettimeofday(&t0, 0);
+
+  for(int z = 0; z < SIZE; z += TILE)
+    for(int y = 0; y < SIZE; y += TILE)
+      for(int x = 0; x < SIZE; x += TILE) {
+	Cuda::Size<3> ofs(x, y, z), size(min(TILE, SIZE - x), min(TILE, SIZE - y), min(TILE, SIZE - z));
+	Cuda::copy(tile, array, Cuda::Size<3>(), ofs, size);
+	ok = ok && check(tile, ofs, size);
+	Cuda::copy(dtile, array, Cuda::Size<3>(), ofs, size);
+      }
+
+  gettimeofday(&t1, 0);
+  Cuda::HostMemoryHeap<float, 3> back(dtile);
+  Cuda::Size<3> last(SIZE - SIZE % TILE, SIZE - SIZE % TILE, SIZE - SIZE % TILE);
+  ok = ok && check(back, last, Cuda::Size<3>(SIZE % TILE, SIZE % TILE, SIZE % TILE));
+
+  if(!ok) {
+    cerr << "tiled copy failed\n";
+    err = 1;
+  }
+
+  size_t accesses = array.getHits() + array.getMisses();
+  cout << "tiled traversal: " << SIZE * SIZE * SIZE * sizeof(float) * 2 / (t1 - t0) / (1 << 20) << " MB/s, "
+       << array.getMisses() << " chunk reads of " << accesses << " accesses (cache holds "
+       << array.getCapacity() << " chunks)\n";
+
+  // single elements:
+  for(int i = 0; i < 1000; ++i) {
+    size_t x = (i * 7919) % SIZE, y = (i * 104729) % SIZE, z = (i * 1299709) % SIZE;
+
+    if(array[Cuda::Size<3>(x, y, z)] != value(x, y, z)) {
+      cerr << "element access failed\n";
+      err = 1;
+      break;
+    }
+  }
+
+  remove(FILENAME);
+  return err;
+}
@@ -0,0 +1,165 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/time.h>
+
+#include <iostream>
+
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememorylinear.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/permute.hpp>
+
+using namespace std;
+
+
+const int SIZE_X = 256;  // volume width
+const int SIZE_Y = 200;  // volume height
+const int SIZE_Z = 150;  // volume depth
+const int COUNT  =  10;  // number of repetitions
+
+
+double
+operator-(const struct timeval &t1, const struct timeval &t2)
+{
+  return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
+}
+
+/**
+   Check result of permutation.
+*/
+bool
+check(const Cuda::HostMemory<float, 3> &dst, const Cuda::HostMemory<float, 3> &src, const unsigned *axes)
+{
+  Cuda::Iterator<3> end = dst.end();
+
+  for(Cuda::Iterator<3> i = dst.begin(); i != end; ++i) {
+    Cuda::Size<3> j;
+
+    for(int k = 3; k--;)
+      j[axes[k]] = i[k];
+
+    if(dst[i] != src[j])
+      return false;
+  }
+
+  return true;
+}
+
+int
+main()
+{
+  int err = 0;
+  const double bytes = 2.0 * SIZE_X * SIZE_Y * SIZE_Z * sizeof(float);
+  Cuda::HostMemoryHeap3D<float> h(SIZE_X, SIZE_Y, SIZE_Z);
+
+  for(int i = SIZE_X * SIZE_Y * SIZE_Z; i--;)
+    h.getBuffer()[i] = i;
+
+  Cuda::DeviceMemoryLinear3D<float> d(h);
+  unsigned axes[][3] = { { 1, 0, 2 }, { 2, 1, 0 }, { 2, 0, 1 }, { 0, 2, 1 } };
+  const char *names[] = { "yxz", "zyx", "zxy", "xzy" };
+  struct timeval t0, t1;
+
+  // reference: plain copy
+  {
+    Cuda::HostMemoryHeap3D<float> r(h.size);
+    Cuda::DeviceMemoryLinear3D<float> rd(h.size);
+    gettimeofday(&t0, 0);
+
+    for(int i = COUNT; i--;)
+      Cuda::copy(r, h);
+
+    gettimeofday(&t1, 0);
+    double t_host = (t1 - t0) / COUNT;
+    cudaThreadSynchronize();
+    gettimeofday(&t0, 0);
+
+    for(int i = COUNT; i--;)
+      Cuda::copy(rd, d);
+
+    cudaThreadSynchronize();
+    gettimeofday(&t1, 0);
+    double t_device = (t1 - t0) / COUNT;
+    cout << "copy: host " << bytes / t_host * 1e-9 << " GB/s, device " << bytes / t_device * 1e-9 << " GB/s\n";
+  }
+
+  for(int a = 0; a < 4; ++a) {
+    Cuda::Size<3> size;
+
+    for(int k = 3; k--;)
+      size[k] = h.size[axes[a][k]];
+
+    Cuda::HostMemoryHeap3D<float> r(size), rn(size);
+    Cuda::DeviceMemoryLinear3D<float> rd(size);
+
+    // element by element:
+    gettimeofday(&t0, 0);
+    Cuda::Iterator<3> end = rn.end();
+
+    for(Cuda::Iterator<3> i = rn.begin(); i != end; ++i) {
+      Cuda::Size<3> j;
+
+      for(int k = 3; k--;)
+	j[axes[a][k]] = i[k];
+
+      rn[i] = h[j];
+    }
+
+    gettimeofday(&t1, 0);
+    double t_naive = t1 - t0;
+
+    // host:
+    gettimeofday(&t0, 0);
+
+    for(int i = COUNT; i--;)
+      Cuda::permute(r, h, axes[a]);
+
+    gettimeofday(&t1, 0);
+    double t_host = (t1 - t0) / COUNT;
+
+    if(!check(r, h, axes[a])) {
+      cerr << "host permutation " << names[a] << " failed\n";
+      err = 1;
+    }
+
+    // device:
+    cudaThreadSynchronize();
+    gettimeofday(&t0, 0);
+
+    for(int i = COUNT; i--;)
+      Cuda::permute(rd, d, axes[a]);
+
+    cudaThreadSynchronize();
+    gettimeofday(&t1, 0);
+    double t_device = (t1 - t0) / COUNT;
+    Cuda::copy(r, rd);
+
+    if(!check(r, h, axes[a])) {
+      cerr << "device permutation " << names[a] << " failed\n";
+      err = 1;
+    }
+
+    cout << names[a] << ": iterator " << bytes / t_naive * 1e-9 << " GB/s, host " << bytes / t_host * 1e-9
+	 << " GB/s, device " << bytes / t_device * 1e-9 << " GB/s\n";
+  }
+
+  return err;
+}
@@ -0,0 +1,138 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/time.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/pyramid.hpp>
+
+using namespace std;
+
+
+const int   WIDTH   = 2048;  // image width
+const int   HEIGHT  = 1536;  // image height
+const int   COUNT   =   10;  // number of repetitions
+const float EPSILON = 1e-4;  // error threshold
+
+
+double
+operator-(const struct timeval &t1, const struct timeval &t2)
+{
+  return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
+}
+
+/**
+   Compute maximum absolute difference.
+*/
+float
+difference(const Cuda::HostMemory<float, 2> &a, const Cuda::HostMemory<float, 2> &b)
+{
+  float e = 0;
+
+  for(size_t y = 0; y < a.size[1]; ++y)
+    for(size_t x = 0; x < a.size[0]; ++x) {
+      Cuda::Size<2> p(x, y);
+      e = max(e, (float)fabs(a[p] - b[p]));
+    }
+
+  return e;
+}
+
+int
+main()
+{
+  int err = 0;
+  Cuda::Size<2> size(WIDTH, HEIGHT);
+  Cuda::HostMemoryHeap2D<float> h(size);
+
+  for(int i = WIDTH * HEIGHT; i--;)
+    h.getBuffer()[i] = (float)rand() / RAND_MAX;
+
+  Cuda::Pyramid<float, 2> ph(size);
+  Cuda::Pyramid<float, 2, Cuda::DeviceMemoryReference<float, 2> > pd(size);
+  ph.setBase(h);
+  pd.setBase(h);
+  struct timeval t0, t1;
+
+  // Gaussian pyramid:
+  gettimeofday(&t0, 0);
+
+  for(int i = COUNT; i--;) {
+    ph.base();
+    ph.build();
+  }
+
+  gettimeofday(&t1, 0);
+  double t_host = (t1 - t0) / COUNT;
+  cudaThreadSynchronize();
+  gettimeofday(&t0, 0);
+
+  for(int i = COUNT; i--;) {
+    pd.base();
+    pd.build();
+  }
+
+  cudaThreadSynchronize();
+  gettimeofday(&t1, 0);
+  double t_device = (t1 - t0) / COUNT;
+  cout << ph.getLevels() << " levels: host " << WIDTH * HEIGHT / t_host * 1e-6 << " Mpixel/s, device "
+       << WIDTH * HEIGHT / t_device * 1e-6 << " Mpixel/s\n";
+
+  for(unsigned i = 0; i < ph.getLevels(); ++i) {
+    Cuda::HostMemoryHeap2D<float> level(pd[i].size);
+    Cuda::copy(level, pd[i]);
+
+    if(difference(ph[i], level) > EPSILON) {
+      cerr << "Gaussian pyramid test failed at level " << i << endl;
+      err = 1;
+    }
+  }
+
+  // Laplacian pyramid, level 0 plus the upsampled Gaussian level 1 must
+  // reconstruct the image:
+  Cuda::Pyramid<float, 2> pl(size, 0, Cuda::PYRAMID_LAPLACIAN);
+  pl.setBase(h);
+  Cuda::HostMemory<float, 2> &l0 = pl[0];
+  Cuda::HostMemoryHeap2D<float> reconstructed(size);
+  Cuda::upsample(reconstructed, ph[1]);
+
+  for(int y = 0; y < HEIGHT; ++y)
+    for(int x = 0; x < WIDTH; ++x)
+      reconstructed[Cuda::Size<2>(x, y)] += l0[Cuda::Size<2>(x, y)];
+
+  if(difference(reconstructed, h) > EPSILON) {
+    cerr << "Laplacian pyramid test failed\n";
+    err = 1;
+  }
+
+  unsigned last = pl.getLevels() - 1;
+
+  if(difference(pl[last], ph[last]) > EPSILON) {
+    cerr << "Laplacian pyramid test failed at level " << last << endl;
+    err = 1;
+  }
+
+  return err;
+}
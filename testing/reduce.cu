@@ -0,0 +1,191 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/time.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+#include <cudatemplates/devicememorypitched.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/reduce.hpp>
+
+using namespace std;
+
+
+const int   SIZE    = 4096;  // image size
+const int   COUNT   =   10;  // number of repetitions
+const float EPSILON = 1e-5;  // relative error threshold
+
+
+double
+operator-(const struct timeval &t1, const struct timeval &t2)
+{
+  return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
+}
+
+/**
+   Check sum and L2 norm of integer data against a double precision
+   reference. Squares of the elements don't fit into the element type.
+*/
+template <class Type>
+bool
+check_integer(const char *type, int low, int high)
+{
+  Cuda::HostMemoryHeap2D<Type> h(1001, 333);
+  double sum = 0, norm2 = 0;
+
+  for(int i = 1001 * 333; i--;) {
+    Type v = (Type)(low + rand() % (high - low + 1));
+    h.getBuffer()[i] = v;
+    sum += v;
+    norm2 += (double)v * v;
+  }
+
+  norm2 = sqrt(norm2);
+  Cuda::DeviceMemoryPitched2D<Type> d(h);
+  Cuda::Reduction::summation_t summation[] = {
+    Cuda::Reduction::SUMMATION_NAIVE, Cuda::Reduction::SUMMATION_PAIRWISE, Cuda::Reduction::SUMMATION_KAHAN
+  };
+
+  for(int k = 0; k < 3; ++k) {
+    if(((double)Cuda::sum(h, summation[k]) != sum) || ((double)Cuda::sum(d, summation[k]) != sum)) {
+      cerr << type << " sum test failed\n";
+      return false;
+    }
+
+    if((fabs(Cuda::norm2(h, summation[k]) - norm2) > EPSILON * norm2) ||
+       (fabs(Cuda::norm2(d, summation[k]) - norm2) > EPSILON * norm2)) {
+      cerr << type << " norm2 test failed\n";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int
+main()
+{
+  int err = 0;
+  Cuda::HostMemoryHeap2D<float> h(SIZE, SIZE);
+  double ref = 0;
+
+  for(int i = SIZE * SIZE; i--;)
+    ref += h.getBuffer()[i] = (float)rand() / RAND_MAX;
+
+  Cuda::DeviceMemoryPitched2D<float> d(h);
+  const char *name[] = { "naive", "pairwise", "Kahan" };
+  Cuda::Reduction::summation_t summation[] = {
+    Cuda::Reduction::SUMMATION_NAIVE, Cuda::Reduction::SUMMATION_PAIRWISE, Cuda::Reduction::SUMMATION_KAHAN
+  };
+  struct timeval t0, t1;
+
+  for(int k = 0; k < 3; ++k) {
+    float s_host = 0, s_device = 0;
+    gettimeofday(&t0, 0);
+
+    for(int i = COUNT; i--;)
+      s_host = Cuda::sum(h, summation[k]);
+
+    gettimeofday(&t1, 0);
+    double t_host = (t1 - t0) / COUNT;
+    gettimeofday(&t0, 0);
+
+    for(int i = COUNT; i--;)
+      s_device = Cuda::sum(d, summation[k]);
+
+    gettimeofday(&t1, 0);
+    double t_device = (t1 - t0) / COUNT;
+    cout << name[k] << " sum: host " << SIZE * SIZE * sizeof(float) / t_host * 1e-9 << " GB/s (error "
+	 << s_host - ref << "), device " << SIZE * SIZE * sizeof(float) / t_device * 1e-9 << " GB/s (error "
+	 << s_device - ref << ")\n";
+
+    if((fabs(s_host - ref) > EPSILON * ref) || (fabs(s_device - ref) > EPSILON * ref)) {
+      cerr << name[k] << " sum test failed\n";
+      err = 1;
+    }
+  }
+
+  // extrema and region:
+  h.getBuffer()[123 + 456 * SIZE] = -1;
+  Cuda::DeviceMemoryPitched2D<float> d2(h);
+  Cuda::Size<2> pos_host, pos_device;
+  float m_host = Cuda::argmin(h, pos_host), m_device = Cuda::argmin(d2, pos_device);
+
+  if((m_host != -1) || (m_device != -1) || (pos_host != Cuda::Size<2>(123, 456)) || (pos_device != pos_host)) {
+    cerr << "argmin test failed\n";
+    err = 1;
+  }
+
+  // NaN values are skipped, also at the start of a row:
+  Cuda::HostMemoryHeap2D<float> n(5, 3);
+
+  for(int i = 15; i--;)
+    n.getBuffer()[i] = numeric_limits<float>::quiet_NaN();
+
+  n.getBuffer()[7] = 2;
+  n.getBuffer()[13] = 1;
+  Cuda::DeviceMemoryPitched2D<float> n_d(n);
+  m_host = Cuda::argmin(n, pos_host);
+  m_device = Cuda::argmin(n_d, pos_device);
+
+  if((m_host != 1) || (m_device != 1) || (pos_host != Cuda::Size<2>(3, 2)) || (pos_device != pos_host) ||
+     (Cuda::max(n) != 2) || (Cuda::max(n_d) != 2)) {
+    cerr << "NaN test failed\n";
+    err = 1;
+  }
+
+  // only NaN:
+  n.getBuffer()[7] = n.getBuffer()[13] = numeric_limits<float>::quiet_NaN();
+  copy(n_d, n);
+  m_host = Cuda::argmax(n, pos_host);
+  m_device = Cuda::argmax(n_d, pos_device);
+
+  if((m_host == m_host) || (m_device == m_device) || (pos_host != Cuda::Size<2>(0, 0)) || (pos_device != pos_host)) {
+    cerr << "all-NaN test failed\n";
+    err = 1;
+  }
+
+  Cuda::Size<2> ofs(100, 200), size(1000, 10);
+  double r_host = Cuda::reduce(h, Cuda::Reduction::Norm2<float, double>(), ofs, size);
+  double r_device = Cuda::reduce(d2, Cuda::Reduction::Norm2<float, double>(), ofs, size);
+  double r_ref = 0;
+
+  for(size_t y = ofs[1]; y < ofs[1] + size[1]; ++y)
+    for(size_t x = ofs[0]; x < ofs[0] + size[0]; ++x)
+      r_ref += (double)h[Cuda::Size<2>(x, y)] * h[Cuda::Size<2>(x, y)];
+
+  r_ref = sqrt(r_ref);
+
+  if((fabs(r_host - r_ref) > EPSILON * r_ref) || (fabs(r_device - r_ref) > EPSILON * r_ref)) {
+    cerr << "region norm2 test failed\n";
+    err = 1;
+  }
+
+  // integer types:
+  if(!check_integer<unsigned char>("unsigned char", 0, 255) || !check_integer<short>("short", -30000, 30000) ||
+     !check_integer<int>("int", -100000, 100000))
+    err = 1;
+
+  return err;
+}
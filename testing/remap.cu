@@ -0,0 +1,120 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/time.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememorypitched.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/remap.hpp>
+#include <cudatemplates/sampler.hpp>
+
+using namespace std;
+
+
+const int   WIDTH   = 2048;  // image width
+const int   HEIGHT  = 1536;  // image height
+const int   COUNT   =   10;  // number of repetitions
+const float EPSILON = 1e-4;  // error threshold
+
+
+double
+operator-(const struct timeval &t1, const struct timeval &t2)
+{
+  return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
+}
+
+int
+main()
+{
+  int err = 0;
+  Cuda::Size<2> size(WIDTH, HEIGHT);
+  Cuda::HostMemoryHeap2D<float> src(size), map_x(size), map_y(size), dst_sampler(size), dst_host(size), dst_device(size);
+
+  for(int i = WIDTH * HEIGHT; i--;)
+    src.getBuffer()[i] = (float)rand() / RAND_MAX;
+
+  // rotation by 10 degrees around the image center, scaled by 1.1:
+  float c = cos(0.1745f) * 1.1f, s = sin(0.1745f) * 1.1f;
+
+  for(int y = 0; y < HEIGHT; ++y)
+    for(int x = 0; x < WIDTH; ++x) {
+      float dx = x + 0.5f - WIDTH / 2, dy = y + 0.5f - HEIGHT / 2;
+      map_x[Cuda::Size<2>(x, y)] = c * dx - s * dy + WIDTH / 2;
+      map_y[Cuda::Size<2>(x, y)] = s * dx + c * dy + HEIGHT / 2;
+    }
+
+  Cuda::DeviceMemoryPitched2D<float> d_src(src), d_dst(size);
+  struct timeval t0, t1;
+
+  // reference: sample with floating-point coordinates:
+  Cuda::Sampler<float, 2> sampler(src, Cuda::FILTER_LINEAR, Cuda::BORDER_MIRROR);
+  const float *coord[] = { map_x.getBuffer(), map_y.getBuffer() };
+  gettimeofday(&t0, 0);
+
+  for(int i = COUNT; i--;)
+    sampler(dst_sampler.getBuffer(), coord, WIDTH * HEIGHT);
+
+  gettimeofday(&t1, 0);
+  double t_sampler = (t1 - t0) / COUNT;
+
+  // fixed-point map:
+  gettimeofday(&t0, 0);
+  Cuda::Remap<float, 2> remap(src, map_x, map_y, Cuda::BORDER_MIRROR);
+  gettimeofday(&t1, 0);
+  double t_init = t1 - t0;
+  gettimeofday(&t0, 0);
+
+  for(int i = COUNT; i--;)
+    remap(dst_host, src);
+
+  gettimeofday(&t1, 0);
+  double t_host = (t1 - t0) / COUNT;
+  remap(d_dst, d_src);
+  cudaThreadSynchronize();
+  gettimeofday(&t0, 0);
+
+  for(int i = COUNT; i--;)
+    remap(d_dst, d_src);
+
+  cudaThreadSynchronize();
+  gettimeofday(&t1, 0);
+  double t_device = (t1 - t0) / COUNT;
+  Cuda::copy(dst_device, d_dst);
+  double pixels = (double)WIDTH * HEIGHT;
+  cout << "sampler " << pixels / t_sampler * 1e-6 << " Mpixel/s, remap: initialization " << t_init
+       << " s, host " << pixels / t_host * 1e-6 << " Mpixel/s, device " << pixels / t_device * 1e-6 << " Mpixel/s\n";
+
+  for(int y = 0; y < HEIGHT; ++y)
+    for(int x = 0; x < WIDTH; ++x) {
+      Cuda::Size<2> p(x, y);
+
+      if((fabs(dst_host[p] - dst_sampler[p]) > EPSILON) || (fabs(dst_device[p] - dst_host[p]) > EPSILON)) {
+	cerr << "remap test failed at (" << x << ", " << y << ")\n";
+	return 1;
+      }
+    }
+
+  return err;
+}
@@ -0,0 +1,118 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/time.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include <cudatemplates/array.hpp>
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememorylinear.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/sampler.hpp>
+
+using namespace std;
+
+
+const int   WIDTH   =     300;  // texture width
+const int   HEIGHT  =     200;  // texture height
+const int   SAMPLES = 1 << 20;  // number of samples
+const float EPSILON =    1e-4;  // error threshold
+
+
+Cuda::Array2D<float>::Texture tex;
+
+
+double
+operator-(const struct timeval &t1, const struct timeval &t2)
+{
+  return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
+}
+
+__global__ void
+kernel(Cuda::DeviceMemoryLinear1D<float>::KernelData x, Cuda::DeviceMemoryLinear1D<float>::KernelData y,
+       Cuda::DeviceMemoryLinear1D<float>::KernelData result)
+{
+  int i = threadIdx.x + blockIdx.x * blockDim.x;
+  result.data[i] = tex2D(tex, x.data[i], y.data[i]);
+}
+
+int
+main()
+{
+  int err = 0;
+  Cuda::HostMemoryHeap2D<float> h(WIDTH, HEIGHT);
+
+  for(int i = WIDTH * HEIGHT; i--;)
+    h.getBuffer()[i] = (float)rand() / RAND_MAX;
+
+  Cuda::Array2D<float> a(h);
+
+  // normalized sample coordinates, partially outside the texture:
+  Cuda::HostMemoryHeap1D<float> x((size_t)SAMPLES), y((size_t)SAMPLES), r_host((size_t)SAMPLES), r_device((size_t)SAMPLES);
+
+  for(int i = SAMPLES; i--;) {
+    x.getBuffer()[i] = (float)rand() / RAND_MAX * 3 - 1;
+    y.getBuffer()[i] = (float)rand() / RAND_MAX * 3 - 1;
+  }
+
+  Cuda::DeviceMemoryLinear1D<float> dx(x), dy(y), dr((size_t)SAMPLES);
+  const float *coord[] = { x.getBuffer(), y.getBuffer() };
+  const char *filter_name[] = { "nearest", "linear" };
+  const char *border_name[] = { "clamp", "mirror", "repeat" };
+  cudaTextureFilterMode filter_mode[] = { cudaFilterModePoint, cudaFilterModeLinear };
+  cudaTextureAddressMode address_mode[] = { cudaAddressModeClamp, cudaAddressModeMirror, cudaAddressModeWrap };
+
+  for(int f = 0; f < 2; ++f) {
+    for(int b = 0; b < 3; ++b) {
+      // GPU:
+      tex.normalized = 1;
+      tex.filterMode = filter_mode[f];
+      tex.addressMode[0] = tex.addressMode[1] = address_mode[b];
+      a.bindTexture(tex);
+      kernel<<<SAMPLES / 256, 256>>>(dx, dy, dr);
+      a.unbindTexture(tex);
+      Cuda::copy(r_device, dr);
+
+      // CPU:
+      Cuda::Sampler<float, 2> sampler(h, (Cuda::filter_t)f, (Cuda::border_t)b, true);
+      struct timeval t0, t1;
+      gettimeofday(&t0, 0);
+      sampler(r_host.getBuffer(), coord, SAMPLES);
+      gettimeofday(&t1, 0);
+      float e = 0;
+
+      for(int i = SAMPLES; i--;)
+	e = max(e, (float)fabs(r_host.getBuffer()[i] - r_device.getBuffer()[i]));
+
+      cout << filter_name[f] << ", " << border_name[b] << ": host " << SAMPLES / (t1 - t0) * 1e-6
+	   << " Msamples/s, maximum difference to GPU " << e << endl;
+
+      if(e > EPSILON) {
+	cerr << "sampler test failed\n";
+	err = 1;
+      }
+    }
+  }
+
+  return err;
+}
@@ -0,0 +1,171 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/time.h>
+
+#include <iostream>
+
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/hostmemorystatic.hpp>
+
+using namespace std;
+
+
+const int SIZE_X = 1024;  // image width
+const int SIZE_Y = 1024;  // image height
+const int SIZE_Z =   16;  // volume depth
+const int COUNT  =    4;  // number of repetitions
+
+
+double
+operator-(const struct timeval &t1, const struct timeval &t2)
+{
+  return (t1.tv_sec - t2.tv_sec) + (t1.tv_usec - t2.tv_usec) * 1e-6;
+}
+
+/**
+   Extract all tiles from the given data.
+   Each tile is copied (and converted) into a block of static size "Tile" and
+   into a dynamically allocated block "Dynamic" of the same size, the elapsed
+   times are reported and the blocks are compared element by element.
+*/
+template <class Tile, class Dynamic, class Source>
+bool
+test(const char *name, const Source &src)
+{
+  const unsigned Dim = Tile::Dim;
+  Tile tile;
+  Dynamic dynamic(tile.size);
+  Cuda::Size<Dim> count, zero;
+  size_t tiles = 1;
+
+  for(unsigned i = Dim; i--;) {
+    count[i] = src.size[i] / tile.size[i];
+    tiles *= count[i];
+  }
+
+  double sum[2] = { 0, 0 }, t[2];
+  struct timeval t0, t1;
+
+  // timing (the sums only keep the copies from being optimized away):
+  for(int k = 0; k < 2; ++k) {
+    gettimeofday(&t0, 0);
+
+    for(int n = COUNT; n--;) {
+      Cuda::Iterator<Dim> end = Cuda::Iterator<Dim>(count).setEnd();
+
+      for(Cuda::Iterator<Dim> i(count); i != end; ++i) {
+	Cuda::Size<Dim> ofs;
+
+	for(unsigned j = Dim; j--;)
+	  ofs[j] = i[j] * tile.size[j];
+
+	if(k == 0) {
+	  Cuda::copy(tile, src, zero, ofs, tile.size);
+	  sum[k] += tile[Tile::Static::Count - 1];
+	}
+	else {
+	  Cuda::copy(dynamic, src, zero, ofs, tile.size);
+	  sum[k] += dynamic[Tile::Static::Count - 1];
+	}
+      }
+    }
+
+    gettimeofday(&t1, 0);
+    t[k] = (t1 - t0) / (COUNT * tiles) * 1e9;
+  }
+
+  cout << name << ": static " << t[0] << " ns/tile, dynamic " << t[1] << " ns/tile, ratio " << t[1] / t[0] << endl;
+
+  if(sum[0] != sum[1]) {
+    cerr << name << ": results differ\n";
+    return false;
+  }
+
+  // compare entire tiles:
+  Cuda::Iterator<Dim> end = Cuda::Iterator<Dim>(count).setEnd();
+  Cuda::Iterator<Dim> tile_end = Cuda::Iterator<Dim>(tile.size).setEnd();
+
+  for(Cuda::Iterator<Dim> i(count); i != end; ++i) {
+    Cuda::Size<Dim> ofs;
+
+    for(unsigned j = Dim; j--;)
+      ofs[j] = i[j] * tile.size[j];
+
+    Cuda::copy(tile, src, zero, ofs, tile.size);
+    Cuda::copy(dynamic, src, zero, ofs, tile.size);
+
+    for(Cuda::Iterator<Dim> j(tile.size); j != tile_end; ++j) {
+      if(tile[j] != dynamic[j]) {
+	cerr << name << ": tiles differ\n";
+	return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+int
+main()
+{
+  int err = 0;
+  Cuda::HostMemoryHeap2D<unsigned char> image(SIZE_X, SIZE_Y);
+  Cuda::HostMemoryHeap3D<float> volume(SIZE_X / 4, SIZE_Y / 4, SIZE_Z);
+
+  for(int i = SIZE_X * SIZE_Y; i--;)
+    image.getBuffer()[i] = i * 7;
+
+  for(int i = SIZE_X * SIZE_Y / 16 * SIZE_Z; i--;)
+    volume.getBuffer()[i] = i;
+
+  if(!test<Cuda::HostMemoryStatic<float, 8, 8>, Cuda::HostMemoryHeap2D<float> >("8x8 uchar->float", image))
+    err = 1;
+
+  if(!test<Cuda::HostMemoryStatic<float, 16, 16>, Cuda::HostMemoryHeap2D<float> >("16x16 uchar->float", image))
+    err = 1;
+
+  if(!test<Cuda::HostMemoryStatic<unsigned char, 32, 32>, Cuda::HostMemoryHeap2D<unsigned char> >("32x32 uchar", image))
+    err = 1;
+
+  if(!test<Cuda::HostMemoryStatic<float, 8, 8, 8>, Cuda::HostMemoryHeap3D<float> >("8x8x8 float", volume))
+    err = 1;
+
+  // static to static conversion and copy back into dynamic memory:
+  {
+    Cuda::HostMemoryStatic<float, 4, 4> a;
+
+    for(int i = 16; i--;)
+      a[i] = i * 0.5f;
+
+    Cuda::HostMemoryStatic<int, 4, 4> b;
+    Cuda::copy(b, a);
+    Cuda::HostMemoryHeap2D<int> c(8, 8);
+    Cuda::copy(c, b, Cuda::Size<2>(4, 2), Cuda::Size<2>(), b.size);
+
+    if((b[Cuda::Size<2>(3, 2)] != 5) || (c[Cuda::Size<2>(7, 4)] != 5)) {
+      cerr << "static copy failed\n";
+      err = 1;
+    }
+  }
+
+  return err;
+}
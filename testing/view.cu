@@ -0,0 +1,146 @@
+/*
+  Cuda Templates.
+
+  Copyright (C) 2008 Institute for Computer Graphics and Vision,
+                     Graz University of Technology
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+
+#include <cudatemplates/copy.hpp>
+#include <cudatemplates/devicememorylinear.hpp>
+#include <cudatemplates/devicememorypitched.hpp>
+#include <cudatemplates/hostmemoryheap.hpp>
+#include <cudatemplates/view.hpp>
+
+using namespace std;
+
+
+const int WIDTH  = 67;  // data width
+const int HEIGHT = 45;  // data height
+const int DEPTH  = 11;  // data depth
+
+
+/**
+   Compare host memory with view of host memory.
+*/
+template <class Type1, class Type2, unsigned Dim>
+bool
+equal(const Cuda::HostMemory<Type1, Dim> &a, const Cuda::View<Type2, Dim> &b)
+{
+  for(unsigned i = Dim; i--;)
+    if(a.size[i] != b.size[i])
+      return false;
+
+  Cuda::Iterator<Dim> end = a.end();
+
+  for(Cuda::Iterator<Dim> i = a.begin(); i != end; ++i)
+    if(a[i] != (Type1)b[i])
+      return false;
+
+  return true;
+}
+
+int
+check(bool ok, const char *name)
+{
+  cout << name << ": " << (ok ? "ok" : "failed") << endl;
+  return ok ? 0 : 1;
+}
+
+int
+main()
+{
+  int err = 0;
+  Cuda::HostMemoryHeap3D<int> h(WIDTH, HEIGHT, DEPTH);
+
+  for(int i = WIDTH * HEIGHT * DEPTH; i--;)
+    h.getBuffer()[i] = i;
+
+  Cuda::View<int, 3> vh(h);
+  Cuda::DeviceMemoryPitched3D<int> d(h);
+  Cuda::View<int, 3> vd(d);
+
+  // transposed and flipped slice, host to host:
+  {
+    Cuda::View<int, 2> v = vh.slice(2, 3).transpose().flip(1);
+    Cuda::HostMemoryHeap2D<int> r(HEIGHT, WIDTH);
+    Cuda::copy(r, v);
+    err |= check(equal(r, v), "transpose and flip (host)");
+  }
+
+  // region of interest of the layout:
+  {
+    h.setRegion(Cuda::Size<3>(5, 7, 2), Cuda::Size<3>(40, 30, 6));
+    Cuda::View<int, 3> v(h, true);
+    Cuda::HostMemoryHeap3D<int> r(40, 30, 6);
+    Cuda::copy(r, v);
+    err |= check(equal(r, v), "region of interest (host)");
+  }
+
+  // permuted axes, host to device and back:
+  {
+    unsigned axes[] = { 2, 0, 1 };
+    Cuda::View<int, 3> v = vh.permute(axes);
+    Cuda::DeviceMemoryPitched3D<int> r(DEPTH, WIDTH, HEIGHT);
+    Cuda::HostMemoryHeap3D<int> rh(DEPTH, WIDTH, HEIGHT);
+    Cuda::copy(r, v);
+    Cuda::copy(rh, r);
+    err |= check(equal(rh, v), "permute (host to device)");
+  }
+
+  // strided device data, device to host:
+  {
+    Cuda::HostMemoryHeap3D<int> r(WIDTH, (HEIGHT + 2) / 3, DEPTH);
+    Cuda::copy(r, vd.flip(0).subsample(1, 3));
+    err |= check(equal(r, vh.flip(0).subsample(1, 3)), "flip and subsample (device to host)");
+  }
+
+  // strided device data, device to device:
+  {
+    Cuda::DeviceMemoryLinear3D<int> r(DEPTH, HEIGHT, WIDTH);
+    Cuda::HostMemoryHeap3D<int> rh(DEPTH, HEIGHT, WIDTH);
+    unsigned axes[] = { 2, 1, 0 };
+    Cuda::copy(r, vd.permute(axes));
+    Cuda::copy(rh, r);
+    err |= check(equal(rh, vh.permute(axes)), "permute (device to device)");
+  }
+
+  // single channel of interleaved data, converted to float:
+  {
+    Cuda::HostMemoryHeap2D<uchar4> c(WIDTH, HEIGHT);
+
+    for(int i = WIDTH * HEIGHT; i--;) {
+      c.getBuffer()[i].x = i;
+      c.getBuffer()[i].y = i + 1;
+      c.getBuffer()[i].z = i + 2;
+      c.getBuffer()[i].w = i + 3;
+    }
+
+    Cuda::View<unsigned char, 2> v = Cuda::View<uchar4, 2>(c).channel<unsigned char>(2);
+    Cuda::HostMemoryHeap2D<float> r(WIDTH, HEIGHT);
+    Cuda::copy(r, v);
+    err |= check(equal(r, v), "channel conversion (host)");
+
+    Cuda::DeviceMemoryPitched2D<uchar4> cd(c);
+    Cuda::DeviceMemoryPitched2D<float> rd(WIDTH, HEIGHT);
+    Cuda::copy(rd, Cuda::View<uchar4, 2>(cd).channel<unsigned char>(2));
+    Cuda::copy(r, rd);
+    err |= check(equal(r, v), "channel conversion (device)");
+  }
+
+  return err;
+}